@@ -49,6 +49,18 @@ struct  bno055_raw_vector_t{
     int16_t z;
 };
 
+// Every fusion output from one burst read, see BNO055::getRawSample()
+struct bno055_raw_sample_t {
+    bno055_raw_vector_t acc;
+    bno055_raw_vector_t mag;
+    bno055_raw_vector_t gyr;
+    bno055_raw_vector_t eul;
+    bno055_raw_vector_t quat;
+    bno055_raw_vector_t lin;
+    bno055_raw_vector_t grav;
+    uint64_t time_us;           // timebaseNowUs() halfway through the read
+};
+
 struct offset {
     uint16_t offsetX;
     uint16_t offsetY;
@@ -98,6 +110,7 @@ public:
     // Status / Self-test
     char get_SysErr();
     char get_SysStatus();
+    bool isChipReady();
     void runSelfTest();
     BNO055Result readSelfTest();
 
@@ -124,6 +137,7 @@ public:
     bno055_raw_vector_t getRawLinearAccel();
     bno055_raw_vector_t getRawGravity();
     bno055_raw_vector_t getRawQuaternion();
+    bool getRawSample(bno055_raw_sample_t& sample);
 
     bno055_vector_t convertRaw(bno055_raw_vector_t raw, char vec);
 
@@ -3,6 +3,10 @@
 #include "bno055_const.h"
 #include <map>
 #include "func.h"
+#include "profiler.h"
+#include "timebase.h"
+
+PROFILE_PROBE(bno_read, "bno055 read");
 
 /**
  * @brief Constructor that owns and creates an I2C object internally.
@@ -49,6 +53,7 @@ void BNO055::dummy(){
  * @return 0 on success, non-zero on failure
  */
 int BNO055::readData(char regaddr, char* data, uint8_t len) {
+    PROFILE_SCOPE(bno_read);
     i2c->write(addr, &regaddr, 1);
     return i2c->read(addr, data, len);
 }
@@ -516,6 +521,20 @@ char BNO055::get_SysStatus() {
     return status;
 }
 
+/**
+ * @brief Checks that the chip answers with its ID. After a reset the BNO055
+ *        does not acknowledge its address until it has booted.
+ * @return true if CHIP_ID reads BNO055_ID
+ */
+bool BNO055::isChipReady() {
+    char reg = BNO055_CHIP_ID;
+    char id = 0x00;
+    if (i2c->write(addr, &reg, 1) != 0 || i2c->read(addr, &id, 1) != 0) {
+        return false;
+    }
+    return id == BNO055_ID;
+}
+
 /**
  * @brief Initiates a self-test by setting the SELF_TEST bit in SYS_TRIGGER.
  */
@@ -752,6 +771,42 @@ bno055_raw_vector_t BNO055::getRawQuaternion() {
     return bno055_getRawVector(BNO055_VECTOR_QUATERNION);
 }
 
+/**
+ * @brief Reads every fusion output, ACC_DATA through GRV_DATA, in one burst.
+ *        They then come from the same fusion update and share one
+ *        timestamp, taken halfway through the transaction.
+ * @param sample Filled in, the vectors are unchanged if the read fails
+ * @return true on success
+ */
+bool BNO055::getRawSample(bno055_raw_sample_t& sample) {
+    setPage(0);
+
+    char buffer[BNO055_VECTOR_GRAVITY + 6 - BNO055_VECTOR_ACCELEROMETER];
+    uint64_t start_us = timebaseNowUs();
+    int result = readData(BNO055_VECTOR_ACCELEROMETER, buffer, sizeof(buffer));
+    sample.time_us = timebaseMidpoint(start_us, timebaseNowUs());
+    if (result != 0) {
+        return false;
+    }
+
+    auto vector = [&](char vec, bno055_raw_vector_t& raw, bool with_w) {
+        const char* p = &buffer[vec - BNO055_VECTOR_ACCELEROMETER];
+        auto word = [&](int i) { return static_cast<int16_t>((p[2 * i + 1] << 8) | (p[2 * i] & 0xFF)); };
+        raw.w = with_w ? word(0) : 0;
+        raw.x = word(with_w ? 1 : 0);
+        raw.y = word(with_w ? 2 : 1);
+        raw.z = word(with_w ? 3 : 2);
+    };
+    vector(BNO055_VECTOR_ACCELEROMETER, sample.acc, false);
+    vector(BNO055_VECTOR_MAGNETOMETER, sample.mag, false);
+    vector(BNO055_VECTOR_GYROSCOPE, sample.gyr, false);
+    vector(BNO055_VECTOR_EULER, sample.eul, false);
+    vector(BNO055_VECTOR_QUATERNION, sample.quat, true);
+    vector(BNO055_VECTOR_LINEARACCEL, sample.lin, false);
+    vector(BNO055_VECTOR_GRAVITY, sample.grav, false);
+    return true;
+}
+
 bno055_vector_t BNO055::convertRaw(bno055_raw_vector_t raw, char vec) {
     double scale = 1.0;
 
@@ -0,0 +1,111 @@
+#include "boot.h"
+#include "bno055_const.h"
+
+BootSequencer::BootSequencer()
+    : _count(0),
+      _elapsed_ms(0)
+{
+}
+
+bool BootSequencer::add(const char* name, Callback<BootStatus()> poll) {
+    if (_count >= BOOT_MAX_STEPS) {
+        return false;
+    }
+    _steps[_count] = BootStep{name, poll, BootStatus::Pending, 0};
+    _count++;
+    return true;
+}
+
+bool BootSequencer::run(uint32_t timeout_ms) {
+    Timer timer;
+    timer.start();
+
+    bool pending = true;
+    while (pending) {
+        uint32_t now_ms = chrono::duration_cast<chrono::milliseconds>(timer.elapsed_time()).count();
+        pending = false;
+        for (int i = 0; i < _count; i++) {
+            BootStep& step = _steps[i];
+            if (step.status != BootStatus::Pending) {
+                continue;
+            }
+            step.status = now_ms < timeout_ms ? step.poll() : BootStatus::Failed;
+            if (step.status == BootStatus::Pending) {
+                pending = true;
+            } else {
+                step.done_ms = now_ms;
+            }
+        }
+        if (pending) {
+            ThisThread::sleep_for(chrono::milliseconds(BOOT_POLL_MS));
+        }
+    }
+    _elapsed_ms = chrono::duration_cast<chrono::milliseconds>(timer.elapsed_time()).count();
+
+    for (int i = 0; i < _count; i++) {
+        if (_steps[i].status == BootStatus::Failed) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int BootSequencer::getCount() const {
+    return _count;
+}
+
+const BootStep* BootSequencer::getStep(int index) const {
+    return (index >= 0 && index < _count) ? &_steps[index] : nullptr;
+}
+
+uint32_t BootSequencer::getElapsedMs() const {
+    return _elapsed_ms;
+}
+
+Bno055Boot::Bno055Boot(BNO055* bno)
+    : _bno(bno),
+      _stage(Stage::Start)
+{
+}
+
+BootStatus Bno055Boot::poll() {
+    switch (_stage) {
+        case Stage::Start:
+            // The reset also leaves it in normal power mode and CONFIGMODE
+            _bno->writeData(BNO055_OPR_MODE, 0x00, 1);
+            _bno->writeData(BNO055_SYS_TRIGGER, 0x20, 1);
+            _start = Kernel::Clock::now();
+            _stage = Stage::WaitChip;
+            break;
+
+        case Stage::WaitChip:
+            if (_bno->isChipReady()) {
+                _bno->writeData(BNO055_PAGE_ID, 0x00, 1);
+                _bno->writeData(BNO055_OPR_MODE, 0x0C, 1);     // NDOF
+                _stage = Stage::WaitFusion;
+            }
+            break;
+
+        case Stage::WaitFusion: {
+            char status = _bno->get_SysStatus();
+            if (status == BNO055_STATUS_FUSION) {
+                _stage = Stage::Done;
+            } else if (status == BNO055_STATUS_ERROR) {
+                _stage = Stage::Failed;
+            }
+            break;
+        }
+
+        case Stage::Done:
+        case Stage::Failed:
+            break;
+    }
+
+    if (_stage != Stage::Done && Kernel::Clock::now() - _start > chrono::milliseconds(BNO055_BOOT_TIMEOUT_MS)) {
+        _stage = Stage::Failed;
+    }
+    if (_stage == Stage::Done) {
+        return BootStatus::Done;
+    }
+    return _stage == Stage::Failed ? BootStatus::Failed : BootStatus::Pending;
+}
@@ -0,0 +1,93 @@
+#ifndef BOOT_H
+#define BOOT_H
+
+#include "mbed.h"
+#include "BNO055.h"
+
+/*
+ * Bring-up of the devices as polled steps that overlap.
+ *
+ * Each step starts an operation and returns, then is polled until it
+ * reports Done or Failed, so one device's reset time no longer waits on
+ * another's. Steps watch the device where it reports its own state (BNO055
+ * CHIP_ID and SYS_STATUS) and only fall back to fixed times where it
+ * doesn't (ESC arming). The sequencer keeps when each step finished, for
+ * `status`.
+ */
+
+#define BOOT_MAX_STEPS      4
+#define BOOT_POLL_MS        5
+
+#define BNO055_BOOT_TIMEOUT_MS      1500    // reset to fusion running, 650 ms typical
+#define BNO055_STATUS_FUSION        0x05    // SYS_STATUS: sensor fusion algorithm running
+#define BNO055_STATUS_ERROR         0x01    // SYS_STATUS: system error, see SYS_ERR
+
+enum class BootStatus {
+    Pending,
+    Done,
+    Failed
+};
+
+struct BootStep {
+    const char* name;
+    Callback<BootStatus()> poll;
+    BootStatus status;
+    uint32_t done_ms;           ///< Since BootSequencer::run() started
+};
+
+class BootSequencer {
+public:
+    BootSequencer();
+
+    /**
+     * @brief Add a step. poll starts it on its first call.
+     * @return false if there are already BOOT_MAX_STEPS.
+     */
+    bool add(const char* name, Callback<BootStatus()> poll);
+
+    /**
+     * @brief Poll every unfinished step each BOOT_POLL_MS until all have
+     * finished. Steps still pending after timeout_ms fail.
+     *
+     * @return true if no step failed.
+     */
+    bool run(uint32_t timeout_ms);
+
+    int getCount() const;
+    const BootStep* getStep(int index) const;
+    uint32_t getElapsedMs() const;      ///< Length of the last run()
+
+private:
+    BootStep _steps[BOOT_MAX_STEPS];
+    int _count;
+    uint32_t _elapsed_ms;
+};
+
+/**
+ * @brief BNO055 reset into NDOF fusion, as a BootSequencer step.
+ *
+ * Replaces the fixed 10, 25, 650, 10 and 20 ms sleeps: the chip does not
+ * answer until its reset is over, then CHIP_ID reads 0xA0, and SYS_STATUS
+ * reads BNO055_STATUS_FUSION once fusion runs.
+ */
+class Bno055Boot {
+public:
+    explicit Bno055Boot(BNO055* bno);
+
+    BootStatus poll();
+
+private:
+    enum class Stage {
+        Start,
+        WaitChip,
+        WaitFusion,
+        Done,
+        Failed
+    };
+
+    BNO055* _bno;
+    Stage _stage;
+    Kernel::Clock::time_point _start;
+};
+
+#endif // BOOT_H
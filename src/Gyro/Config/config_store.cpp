@@ -0,0 +1,47 @@
+#include "config_store.h"
+#include "crc.h"
+
+ConfigStore::ConfigStore(flash* f)
+    : _flash(f),
+      _next(CONFIG_SECTOR_ADDR)
+{
+}
+
+bool ConfigStore::load(ConfigData& data) {
+    bool found = false;
+    uint32_t addr = CONFIG_SECTOR_ADDR;
+    for (; addr < CONFIG_SECTOR_ADDR + CONFIG_SECTOR_SIZE; addr += sizeof(ConfigRecord)) {
+        ConfigRecord record;
+        _flash->read(addr, reinterpret_cast<uint8_t*>(&record), sizeof(record));
+        if (record.magic == 0xFFFFFFFF) {
+            break;
+        }
+        uint16_t crc = crc16(reinterpret_cast<const uint8_t*>(&record), offsetof(ConfigRecord, crc));
+        if (record.magic == CONFIG_MAGIC && crc == record.crc) {
+            data = record.data;
+            found = true;
+        }
+    }
+    _next = addr;
+    return found;
+}
+
+void ConfigStore::save(const ConfigData& data) {
+    if (_next >= CONFIG_SECTOR_ADDR + CONFIG_SECTOR_SIZE) {
+        _flash->eraseSector(CONFIG_SECTOR_ADDR);
+        _next = CONFIG_SECTOR_ADDR;
+    }
+
+    ConfigRecord record;
+    record.magic = CONFIG_MAGIC;
+    record.data = data;
+    record.spare = 0xFFFF;
+    record.crc = crc16(reinterpret_cast<const uint8_t*>(&record), offsetof(ConfigRecord, crc));
+    // Records never straddle a page, 16 divides 256
+    _flash->write(_next, reinterpret_cast<const uint8_t*>(&record), sizeof(record));
+    _next += sizeof(record);
+}
+
+uint32_t ConfigStore::getRecords() const {
+    return (_next - CONFIG_SECTOR_ADDR) / sizeof(ConfigRecord);
+}
@@ -0,0 +1,72 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include "mbed.h"
+#include "flash.h"
+
+/*
+ * Settings changed at run time, kept in a reserved W25Q32JV sector.
+ *
+ * The sector is a journal of fixed size records, each save programs the next
+ * erased slot and the newest record with a good CRC wins. A save is one
+ * page program, short enough to run while logging; only once all
+ * CONFIG_SLOTS are used does it erase the sector first. A record cut short
+ * by a reset fails its CRC and the one before it stays in force.
+ *
+ *   u32 magic "CFG1"
+ *   ConfigData
+ *   u16 CRC-16/CCITT-FALSE over everything before it
+ *
+ * `clear` only erases the log and leaves the settings in force.
+ * The caller serialises access to the flash, as for the log.
+ */
+
+#define CONFIG_SECTOR_ADDR  0x3FE000    // the sector before the fault record
+#define CONFIG_SECTOR_SIZE  0x1000
+#define CONFIG_MAGIC        0x31474643  // "CFG1"
+
+struct ConfigData {
+    uint16_t imu_hz;        ///< Sensor task, BNO055 reads
+    uint16_t enc_hz;        ///< Encoder task
+    uint16_t log_hz;        ///< Log task, flash entries
+    uint16_t reserved;
+};
+
+struct ConfigRecord {
+    uint32_t magic;
+    ConfigData data;
+    uint16_t spare;         ///< 0xFFFF, pads the record to 16 bytes
+    uint16_t crc;
+};
+
+#define CONFIG_SLOTS        (CONFIG_SECTOR_SIZE / sizeof(ConfigRecord))
+
+class ConfigStore {
+public:
+    ConfigStore(flash* f);
+
+    /**
+     * @brief Find the newest record and the next free slot, call once before
+     * save().
+     *
+     * @param data  Set to the stored settings, left alone if there are none.
+     * @return true if a stored record was found.
+     */
+    bool load(ConfigData& data);
+
+    /**
+     * @brief Append data as the newest record.
+     */
+    void save(const ConfigData& data);
+
+    /**
+     * @brief Records in the sector since it was last erased.
+     */
+    uint32_t getRecords() const;
+
+private:
+    flash* _flash;
+    uint32_t _next;         // address of the first erased slot
+};
+
+#endif // CONFIG_STORE_H
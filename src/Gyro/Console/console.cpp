@@ -0,0 +1,138 @@
+#include "console.h"
+#include <cstring>
+
+/**
+ * Constructor: the dispatcher thread only needs room for tokenising and
+ * calling handlers; formatting is done inside EUSBSerial's own thread.
+ */
+Console::Console(EUSBSerial* serial)
+    : _serial(serial),
+      _queue(sizeof(_queue_buffer), _queue_buffer),
+      _thread(osPriorityAboveNormal, sizeof(_stack), _stack, "console"),
+      _count(0),
+      _len(0),
+      _discard(false),
+      _pending(false),
+      _overflows(0)
+{
+}
+
+bool Console::addCommand(const char* name, Handler handler, const char* help) {
+    if (_count >= CONSOLE_MAX_COMMANDS) {
+        return false;
+    }
+
+    _commands[_count].name = name;
+    _commands[_count].help = help;
+    _commands[_count].handler = handler;
+    _count++;
+    return true;
+}
+
+void Console::start() {
+    _thread.start(callback(&_queue, &EventQueue::dispatch_forever));
+    _serial->attach(callback(this, &Console::onReceive));
+
+    // Pick up anything that arrived before the callback was attached
+    _queue.call(this, &Console::drain);
+}
+
+uint32_t Console::getOverflows() const {
+    return _overflows;
+}
+
+osThreadId_t Console::getThreadId() const {
+    return _thread.get_id();
+}
+
+/**
+ * Runs in USB interrupt context. Reading is deferred to the console thread
+ * and at most one drain event is queued at a time.
+ */
+void Console::onReceive() {
+    if (!_pending) {
+        _pending = true;
+        _queue.call(this, &Console::drain);
+    }
+}
+
+/**
+ * Moves every received byte into the line buffer, dispatching each
+ * newline terminated line. Incomplete lines are kept for the next call.
+ */
+void Console::drain() {
+    _pending = false;
+
+    char chunk[32];
+    size_t n;
+    while ((n = _serial->read(chunk, sizeof(chunk))) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            char c = chunk[i];
+
+            if (c == '\r') {
+                continue;
+            }
+
+            if (c == '\n') {
+                if (!_discard) {
+                    _line[_len] = 0;
+                    execute(_line);
+                }
+                _len = 0;
+                _discard = false;
+                continue;
+            }
+
+            if (_discard) {
+                continue;
+            }
+
+            if (_len >= CONSOLE_MAX_LINE - 1) {
+                _discard = true;
+                _overflows++;
+                _serial->printf("line too long\n");
+                continue;
+            }
+
+            _line[_len++] = c;
+        }
+    }
+}
+
+bool Console::execute(char* line) {
+    char* argv[CONSOLE_MAX_ARGS];
+    int argc = 0;
+
+    char* save = nullptr;
+    for (char* tok = strtok_r(line, " \t", &save);
+         tok && argc < CONSOLE_MAX_ARGS;
+         tok = strtok_r(nullptr, " \t", &save)) {
+        argv[argc++] = tok;
+    }
+
+    if (argc == 0) {
+        return false;
+    }
+
+    if (strcmp(argv[0], "help") == 0) {
+        help();
+        return true;
+    }
+
+    for (size_t i = 0; i < _count; i++) {
+        if (strcmp(argv[0], _commands[i].name) == 0) {
+            _commands[i].handler(argc, argv);
+            return true;
+        }
+    }
+
+    _serial->printf("unknown command: %s\n", argv[0]);
+    return false;
+}
+
+void Console::help() {
+    for (size_t i = 0; i < _count; i++) {
+        _serial->printf("  %-8s %s\n", _commands[i].name,
+                        _commands[i].help ? _commands[i].help : "");
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include "mbed.h"
+#include "EUSBSerial.h"
+
+#ifndef CONSOLE_MAX_LINE
+#define CONSOLE_MAX_LINE 64
+#endif
+
+#ifndef CONSOLE_MAX_COMMANDS
+#define CONSOLE_MAX_COMMANDS 16
+#endif
+
+#ifndef CONSOLE_MAX_ARGS
+#define CONSOLE_MAX_ARGS 8
+#endif
+
+#ifndef CONSOLE_STACK_SIZE
+#define CONSOLE_STACK_SIZE 2048
+#endif
+
+#define CONSOLE_EVENTS 8
+
+/**
+ * @brief Interrupt-driven command console on top of EUSBSerial.
+ *
+ * The USB receive callback only posts an event; a dedicated thread drains the
+ * received bytes into a persistent line buffer, so partial lines survive
+ * across USB packets. Complete lines are split into whitespace separated
+ * arguments and dispatched through a fixed table of registered handlers.
+ * The console keeps running for the lifetime of the firmware, including while
+ * logging.
+ */
+class Console {
+public:
+    /**
+     * @brief Command handler. argv[0] is the command name.
+     */
+    typedef Callback<void(int argc, char** argv)> Handler;
+
+    /**
+     * @brief Construct a new Console bound to a USB serial port.
+     *
+     * @param serial  USB serial used for input and for error replies.
+     */
+    Console(EUSBSerial* serial);
+
+    /**
+     * @brief Register a command handler.
+     *
+     * @param name     Command keyword (first token of a line). Must outlive the console.
+     * @param handler  Function invoked with the tokenised line.
+     * @param help     Optional one line description shown by `help`.
+     * @return true if registered, false if the table is full.
+     */
+    bool addCommand(const char* name, Handler handler, const char* help = nullptr);
+
+    /**
+     * @brief Attach the receive callback and start the dispatcher thread.
+     */
+    void start();
+
+    /**
+     * @brief Tokenise and dispatch one complete line.
+     *        Usable by other transports (e.g. radio) sharing the command table.
+     *
+     * @param line  Null terminated line; modified in place.
+     * @return true if a registered command handled the line.
+     */
+    bool execute(char* line);
+
+    /**
+     * @brief Number of input lines dropped because they exceeded CONSOLE_MAX_LINE.
+     */
+    uint32_t getOverflows() const;
+
+    /**
+     * @brief Dispatcher thread, nullptr until start().
+     */
+    osThreadId_t getThreadId() const;
+
+private:
+    struct Command {
+        const char* name;
+        const char* help;
+        Handler handler;
+    };
+
+    void onReceive();   ///< USB interrupt context: defer to thread
+    void drain();       ///< Thread context: assemble lines from received bytes
+    void help();
+
+    EUSBSerial* _serial;
+    // In the object, so a static console never needs the heap
+    uint8_t _queue_buffer[CONSOLE_EVENTS * EVENTS_EVENT_SIZE];
+    MBED_ALIGN(8) unsigned char _stack[CONSOLE_STACK_SIZE];
+    EventQueue _queue;
+    Thread _thread;
+
+    Command _commands[CONSOLE_MAX_COMMANDS];
+    size_t _count;
+
+    char _line[CONSOLE_MAX_LINE];   ///< Persistent partial line
+    size_t _len;
+    bool _discard;                  ///< Dropping the rest of an overlong line
+    volatile bool _pending;         ///< A drain event is already queued
+    uint32_t _overflows;
+};
+
+#endif // CONSOLE_H
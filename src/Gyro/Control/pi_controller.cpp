@@ -0,0 +1,56 @@
+#include "pi_controller.h"
+
+PIController::PIController(float kp, float ki, float kff, float outMin, float outMax)
+    : _kp(kp),
+      _ki(ki),
+      _kff(kff),
+      _outMin(outMin),
+      _outMax(outMax)
+{
+    reset();
+}
+
+void PIController::reset() {
+    _integral = 0.0f;
+    _output = 0.0f;
+    _error = 0.0f;
+    _saturated = false;
+}
+
+void PIController::setGains(float kp, float ki, float kff) {
+    _kp = kp;
+    _ki = ki;
+    _kff = kff;
+}
+
+float PIController::update(float setpoint, float measurement, float dt) {
+    _error = setpoint - measurement;
+
+    float base = _kff * setpoint + _kp * _error;
+    float integral = _integral + _ki * _error * dt;
+    float output = base + integral;
+
+    // Conditional integration: keep the old integral if the new one would only
+    // push further into saturation
+    bool high = output > _outMax && _error > 0.0f;
+    bool low = output < _outMin && _error < 0.0f;
+    if (!high && !low) {
+        _integral = integral;
+    }
+    float span = _outMax - _outMin;
+    if (_integral > span) _integral = span;
+    if (_integral < -span) _integral = -span;
+
+    output = base + _integral;
+    _saturated = output > _outMax || output < _outMin;
+    if (output > _outMax) output = _outMax;
+    if (output < _outMin) output = _outMin;
+
+    _output = output;
+    return output;
+}
+
+float PIController::getOutput() const { return _output; }
+float PIController::getError() const { return _error; }
+float PIController::getIntegral() const { return _integral; }
+bool PIController::isSaturated() const { return _saturated; }
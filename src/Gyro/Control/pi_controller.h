@@ -0,0 +1,52 @@
+#ifndef PI_CONTROLLER_H
+#define PI_CONTROLLER_H
+
+/**
+ * @brief PI controller with feed-forward and anti-windup.
+ *
+ * output = kff * setpoint + kp * error + integral, clamped to [outMin, outMax].
+ * The feed-forward term does most of the work (the open-loop command for the
+ * setpoint), the PI terms trim it against load and supply changes. The
+ * integral stops growing while the output is saturated in the direction of
+ * the error, and never exceeds the width of the output range, so the loop comes
+ * out of saturation without overshooting.
+ */
+class PIController {
+public:
+    PIController(float kp, float ki, float kff, float outMin, float outMax);
+
+    /**
+     * @brief Run one step of the loop.
+     *
+     * @param setpoint     Desired value.
+     * @param measurement  Measured value, same unit as setpoint.
+     * @param dt           Time since the last update (s).
+     * @return float Output, within [outMin, outMax].
+     */
+    float update(float setpoint, float measurement, float dt);
+
+    /**
+     * @brief Clear the integral, e.g. when the actuator was off.
+     */
+    void reset();
+
+    void setGains(float kp, float ki, float kff);
+
+    float getOutput() const;
+    float getError() const;        ///< setpoint - measurement at the last update
+    float getIntegral() const;
+    bool isSaturated() const;
+
+private:
+    float _kp;
+    float _ki;
+    float _kff;
+    const float _outMin;
+    const float _outMax;
+    float _integral;
+    float _output;
+    float _error;
+    bool _saturated;
+};
+
+#endif // PI_CONTROLLER_H
@@ -0,0 +1,43 @@
+#include "roll_controller.h"
+
+RollController::RollController(float angleKp, float rateKp, float rateKi, float maxRate,
+                               float maxWheelAccel, float wheelMin, float wheelMax)
+    : _angleKp(angleKp),
+      _maxRate(maxRate),
+      _wheelMin(wheelMin),
+      _wheelMax(wheelMax),
+      _rate(rateKp, rateKi, 0.0f, -maxWheelAccel, maxWheelAccel),
+      _rateSetpoint(0.0f),
+      _wheel(wheelMin)
+{
+}
+
+void RollController::engage(float wheelRpm) {
+    _rate.reset();
+    _rateSetpoint = 0.0f;
+    _wheel = wheelRpm;
+    if (_wheel < _wheelMin) _wheel = _wheelMin;
+    if (_wheel > _wheelMax) _wheel = _wheelMax;
+}
+
+float RollController::update(float target, float roll, float rate, float dt) {
+    // Shortest way round
+    float error = target - roll;
+    while (error > 180.0f) error -= 360.0f;
+    while (error < -180.0f) error += 360.0f;
+
+    _rateSetpoint = _angleKp * error;
+    if (_rateSetpoint > _maxRate) _rateSetpoint = _maxRate;
+    if (_rateSetpoint < -_maxRate) _rateSetpoint = -_maxRate;
+
+    // Torque on the body is opposite to the wheel's acceleration
+    float accel = _rate.update(_rateSetpoint, rate, dt);
+    _wheel -= accel * dt;
+    if (_wheel < _wheelMin) _wheel = _wheelMin;
+    if (_wheel > _wheelMax) _wheel = _wheelMax;
+    return _wheel;
+}
+
+float RollController::getRateSetpoint() const { return _rateSetpoint; }
+float RollController::getWheelSetpoint() const { return _wheel; }
+bool RollController::isWheelSaturated() const { return _wheel <= _wheelMin || _wheel >= _wheelMax; }
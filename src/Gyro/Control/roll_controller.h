@@ -0,0 +1,63 @@
+#ifndef ROLL_CONTROLLER_H
+#define ROLL_CONTROLLER_H
+
+#include "pi_controller.h"
+
+/**
+ * @brief Outer loops of the reaction wheel attitude controller.
+ *
+ *   roll target -> [P] -> rate setpoint -> [PI] -> wheel acceleration
+ *                                                  -> wheel speed setpoint
+ *
+ * The wheel speed setpoint feeds the wheel's own speed loop. Speeding the wheel
+ * up turns the body the other way, so a positive rate error slows the wheel.
+ * Roll and rate must be about the wheel axis, positive in the direction the
+ * wheel spins. The wheel runs around a bias speed since the ESC only drives
+ * one way, and the setpoint is kept within [wheelMin, wheelMax]; while it
+ * sits at a limit the wheel is saturated and cannot absorb more momentum.
+ */
+class RollController {
+public:
+    /**
+     * @param angleKp        Rate setpoint per degree of roll error (1/s).
+     * @param rateKp         Wheel acceleration per deg/s of rate error (RPM/s per deg/s).
+     * @param rateKi         Same, per deg/s of integrated rate error (RPM/s per deg).
+     * @param maxRate        Largest rate setpoint (deg/s).
+     * @param maxWheelAccel  Largest wheel acceleration command (RPM/s).
+     * @param wheelMin       Lowest wheel speed setpoint (RPM).
+     * @param wheelMax       Highest wheel speed setpoint (RPM).
+     */
+    RollController(float angleKp, float rateKp, float rateKi, float maxRate,
+                   float maxWheelAccel, float wheelMin, float wheelMax);
+
+    /**
+     * @brief Start controlling from the current wheel speed, clearing the integral.
+     */
+    void engage(float wheelRpm);
+
+    /**
+     * @brief Run one step.
+     *
+     * @param target  Roll target (deg).
+     * @param roll    Measured roll (deg).
+     * @param rate    Measured roll rate (deg/s).
+     * @param dt      Time since the last update (s).
+     * @return float Wheel speed setpoint (RPM).
+     */
+    float update(float target, float roll, float rate, float dt);
+
+    float getRateSetpoint() const;
+    float getWheelSetpoint() const;
+    bool isWheelSaturated() const;
+
+private:
+    const float _angleKp;
+    const float _maxRate;
+    const float _wheelMin;
+    const float _wheelMax;
+    PIController _rate;
+    float _rateSetpoint;
+    float _wheel;
+};
+
+#endif // ROLL_CONTROLLER_H
@@ -1,9 +1,13 @@
 #include "EUSBSerial.h"
+#include "profiler.h"
+#include "mem_stats.h"
+
+PROFILE_PROBE(usb_format, "usb printf format");
 
 //MBED_CONF_EUSBSERIAL_MAX_PACKET_SIZE
 
 
-EUSBSerial::EUSBSerial(uint16_t vid, uint16_t pid) : pc(false, vid, pid) {
+EUSBSerial::EUSBSerial(uint16_t vid, uint16_t pid) : pc(false, vid, pid), _stack_max(0) {
 
 }
 
@@ -15,7 +19,8 @@ bool EUSBSerial::printf(const char* format, ...) {
     if (!pc.connected())
         return false;
     
-    Thread t1;
+    ScopedLock<Mutex> lock(_lock);
+    Thread t1(osPriorityNormal, sizeof(_stack), _stack, "usb");
     Timer t;
 
     va_list args;
@@ -36,6 +41,7 @@ bool EUSBSerial::printf(const char* format, ...) {
     }
 
     t1.join();
+    _stack_max = std::max(_stack_max, stackUsed(_stack, sizeof(_stack)));
 
     return true;
 }
@@ -46,7 +52,11 @@ void EUSBSerial::_printf() {
 
     char buffer[MBED_CONF_EUSBSERIAL_MAX_PACKET_SIZE];
 
-    size_t n = vsnprintf (buffer, MBED_CONF_EUSBSERIAL_MAX_PACKET_SIZE, _format, _args);
+    size_t n;
+    {
+        PROFILE_SCOPE(usb_format);
+        n = vsnprintf (buffer, MBED_CONF_EUSBSERIAL_MAX_PACKET_SIZE, _format, _args);
+    }
     
     if (n > 0 && n < MBED_CONF_EUSBSERIAL_MAX_PACKET_SIZE) {
         pc.write(buffer, n);
@@ -59,7 +69,8 @@ bool EUSBSerial::write(const char* buf, size_t size) {
     if (!pc.connected())
         return false;
     
-    Thread t1;
+    ScopedLock<Mutex> lock(_lock);
+    Thread t1(osPriorityNormal, sizeof(_stack), _stack, "usb");
     Timer t;
 
     this->_format = buf;
@@ -76,6 +87,7 @@ bool EUSBSerial::write(const char* buf, size_t size) {
     }
 
     t1.join();
+    _stack_max = std::max(_stack_max, stackUsed(_stack, sizeof(_stack)));
     return true;
 }
 
@@ -87,10 +99,30 @@ void EUSBSerial::_write() {
     this->_success = true;
 }
 
+uint32_t EUSBSerial::getStackSize() const {
+    return sizeof(_stack);
+}
+
+uint32_t EUSBSerial::getStackMax() const {
+    return _stack_max;
+}
+
 char EUSBSerial::_getc() {
     return pc._getc();
 }
 
+size_t EUSBSerial::read(char* buf, size_t size) {
+    uint32_t n = 0;
+    if (!pc.receive_nb(reinterpret_cast<uint8_t*>(buf), size, &n))
+        return 0;
+
+    return n;
+}
+
+void EUSBSerial::attach(Callback<void()> cb) {
+    pc.attach(cb);
+}
+
 size_t EUSBSerial::available() {
     return pc.available();
 }
@@ -7,6 +7,7 @@
  * found in USBSerial.h. Features as follows:
  *     formatted print support (printf)
  *     newline terminated read support (readline)
+ *     non-blocking bulk reads and receive callbacks (read, attach)
  *     Redundant USB Connection monitoring and protection
  *
  * EUSBSerial implements QOL features while encapsulating
@@ -22,6 +23,11 @@
 #define MBED_CONF_EUSBSERIAL_MAX_PACKET_SIZE 1024
 #endif
 
+// The helper thread holds the printf buffer and vsnprintf's own frames
+#ifndef MBED_CONF_EUSBSERIAL_STACK_SIZE
+#define MBED_CONF_EUSBSERIAL_STACK_SIZE (MBED_CONF_EUSBSERIAL_MAX_PACKET_SIZE + 2048)
+#endif
+
 #ifndef _E_USB_SERIAL_H_
 #define _E_USB_SERIAL_H_
 
@@ -35,11 +41,21 @@ public:
 
     bool readline(char* buf, size_t size);
 
+    // Non-blocking: copies up to size already-received bytes into buf
+    size_t read(char* buf, size_t size);
+
+    // cb runs in interrupt context whenever new data arrives
+    void attach(Callback<void()> cb);
+
     size_t available();
     char _getc();
 
     bool connected();
 
+    // Stack of the helper thread and the most any call has used of it
+    uint32_t getStackSize() const;
+    uint32_t getStackMax() const;
+
 private:
     const char* _format;
     va_list _args;
@@ -47,6 +63,12 @@ private:
     bool _success;
     USBSerial pc;
 
+    // Every call's helper thread runs on this, so writes never allocate.
+    // _lock keeps calls from different threads from sharing it.
+    Mutex _lock;
+    MBED_ALIGN(8) unsigned char _stack[MBED_CONF_EUSBSERIAL_STACK_SIZE];
+    uint32_t _stack_max;
+
     void _printf();
     void _write();
 };
@@ -1,5 +1,11 @@
 #include "encoder.h"
 #include "platform/CriticalSectionLock.h"
+#include "pinmap.h"
+#include "PeripheralPins.h"
+#include "hal/us_ticker_api.h"
+#include "profiler.h"
+
+TRACE_PROBE(encoder_isr, "encoder isr", TRACE_ISR);
 
 // Lookup table for transitions between encoder states
 // Index = (oldState << 2) | newState
@@ -12,25 +18,173 @@ static const int8_t _transitionTable[16] = {
 };
 
 /**
- * Constructor: initializes encoder with interrupt handlers and starting state.
+ * Enables the clock of a timer that has an encoder interface.
+ * Returns false for timers without one and for the us_ticker timer.
+ */
+static bool enableTimerClock(TIM_TypeDef* timer) {
+#if defined(TIM_MST)
+    if (timer == TIM_MST) {
+        return false;
+    }
+#endif
+#if defined(TIM1)
+    if (timer == TIM1) { __HAL_RCC_TIM1_CLK_ENABLE(); return true; }
+#endif
+#if defined(TIM2)
+    if (timer == TIM2) { __HAL_RCC_TIM2_CLK_ENABLE(); return true; }
+#endif
+#if defined(TIM3)
+    if (timer == TIM3) { __HAL_RCC_TIM3_CLK_ENABLE(); return true; }
+#endif
+#if defined(TIM4)
+    if (timer == TIM4) { __HAL_RCC_TIM4_CLK_ENABLE(); return true; }
+#endif
+#if defined(TIM5)
+    if (timer == TIM5) { __HAL_RCC_TIM5_CLK_ENABLE(); return true; }
+#endif
+#if defined(TIM8)
+    if (timer == TIM8) { __HAL_RCC_TIM8_CLK_ENABLE(); return true; }
+#endif
+    return false;
+}
+
+// Timers already in encoder mode, so a second encoder on the same timer falls back
+static TIM_TypeDef* _claimedTimers[4] = {nullptr, nullptr, nullptr, nullptr};
+
+/**
+ * Constructor: uses the timer backend when the pins allow it, otherwise
+ * initializes interrupt handlers and starting state.
  */
 encoder::encoder(PinName channelA, PinName channelB, int pulsesPerRev)
-    : _chanA(channelA),
-      _chanB(channelB),
+    : _chanA(nullptr),
+      _chanB(nullptr),
+      _timer(nullptr),
       _position(0),
       _pulsesPerRev(pulsesPerRev),
       _prevState(0),
-      _direction(0)
+      _direction(0),
+      _lastCounter(0),
+      _edgeTime(0),
+      _seq(0),
+      _windowStart(0),
+      _windowEdges(0),
+      _windowInvalid(0),
+      _stormStart(0),
+      _polling(false),
+      _edges(0),
+      _invalid(0),
+      _glitches(0),
+      _storms(0)
 {
-    uint8_t A = _chanA.read();
-    uint8_t B = _chanB.read();
+    if (initTimer(channelA, channelB)) {
+        _extend.attach(callback(this, &encoder::extendISR), ENCODER_EXTEND_INTERVAL);
+        return;
+    }
+
+    _chanA = new InterruptIn(channelA);
+    _chanB = new InterruptIn(channelB);
+
+    uint8_t A = _chanA->read();
+    uint8_t B = _chanB->read();
     _prevState = (A << 1) | B;
 
     // Attach ISR to both rising and falling edges on each channel
-    _chanA.rise(callback(this, &encoder::encodeISR));
-    _chanA.fall(callback(this, &encoder::encodeISR));
-    _chanB.rise(callback(this, &encoder::encodeISR));
-    _chanB.fall(callback(this, &encoder::encodeISR));
+    _chanA->rise(callback(this, &encoder::encodeISR));
+    _chanA->fall(callback(this, &encoder::encodeISR));
+    _chanB->rise(callback(this, &encoder::encodeISR));
+    _chanB->fall(callback(this, &encoder::encodeISR));
+}
+
+encoder::~encoder() {
+    _extend.detach();
+    _poll.detach();
+    if (_timer) {
+        _timer->CR1 &= ~TIM_CR1_CEN;
+        for (TIM_TypeDef*& claimed : _claimedTimers) {
+            if (claimed == _timer) {
+                claimed = nullptr;
+            }
+        }
+    }
+    delete _chanA;
+    delete _chanB;
+}
+
+/**
+ * Checks the pin map for A on CH1 and B on CH2 of one timer and sets it up
+ * in encoder mode 3, counting every edge of both channels like the ISR.
+ */
+bool encoder::initTimer(PinName channelA, PinName channelB) {
+    int peripheralA = pinmap_find_peripheral(channelA, PinMap_PWM);
+    int peripheralB = pinmap_find_peripheral(channelB, PinMap_PWM);
+    if (peripheralA == (int)NC || peripheralA != peripheralB) {
+        return false;
+    }
+    int functionA = pinmap_find_function(channelA, PinMap_PWM);
+    int functionB = pinmap_find_function(channelB, PinMap_PWM);
+    if (STM_PIN_CHANNEL(functionA) != 1 || STM_PIN_INVERTED(functionA) ||
+        STM_PIN_CHANNEL(functionB) != 2 || STM_PIN_INVERTED(functionB)) {
+        return false;
+    }
+
+    TIM_TypeDef* timer = reinterpret_cast<TIM_TypeDef*>(peripheralA);
+    TIM_TypeDef** slot = nullptr;
+    for (TIM_TypeDef*& claimed : _claimedTimers) {
+        if (claimed == timer) {
+            return false;
+        }
+        if (!claimed && !slot) {
+            slot = &claimed;
+        }
+    }
+    if (!slot || !enableTimerClock(timer)) {
+        return false;
+    }
+    *slot = timer;
+
+    pinmap_pinout(channelA, PinMap_PWM);
+    pinmap_pinout(channelB, PinMap_PWM);
+
+    timer->CR1 = 0;
+    timer->SMCR = TIM_SMCR_SMS_0 | TIM_SMCR_SMS_1;              // encoder mode 3
+    timer->CCMR1 = TIM_CCMR1_CC1S_0 | TIM_CCMR1_CC2S_0 |        // TI1 -> IC1, TI2 -> IC2
+                   (ENCODER_TIMER_FILTER << TIM_CCMR1_IC1F_Pos) |
+                   (ENCODER_TIMER_FILTER << TIM_CCMR1_IC2F_Pos);
+    timer->CCER = 0;                                            // non-inverted inputs
+    timer->DIER = 0;
+    timer->PSC = 0;
+    timer->ARR = 0xFFFF;        // 16-bit wrap on the 32-bit timers too
+    timer->CNT = 0;
+    timer->EGR = TIM_EGR_UG;
+    timer->CR1 = TIM_CR1_CEN;
+
+    _timer = timer;
+    _lastCounter = 0;
+    return true;
+}
+
+/**
+ * Adds the signed 16-bit difference since the last fold, so the counter
+ * wrapping in either direction carries into the 32-bit position.
+ */
+void encoder::extendCount() const {
+    if (!_timer) {
+        return;
+    }
+    uint16_t counter = static_cast<uint16_t>(_timer->CNT);
+    int16_t step = static_cast<int16_t>(counter - _lastCounter);
+    _lastCounter = counter;
+    if (step != 0) {
+        _seq++;
+        _position += step;
+        _direction = (step > 0) ? 1 : -1;
+        _edgeTime = us_ticker_read();
+        _seq++;
+    }
+}
+
+void encoder::extendISR() {
+    extendCount();
 }
 
 /**
@@ -38,6 +192,7 @@ encoder::encoder(PinName channelA, PinName channelB, int pulsesPerRev)
  */
 int encoder::getCount() const {
     CriticalSectionLock lock;
+    extendCount();
     return _position;
 }
 
@@ -46,6 +201,7 @@ int encoder::getCount() const {
  */
 float encoder::getOrientationDegrees() const {
     CriticalSectionLock lock;
+    extendCount();
     return (static_cast<float>(_position) / _pulsesPerRev) * 360.0f;
 }
 
@@ -55,6 +211,7 @@ float encoder::getOrientationDegrees() const {
 float encoder::getOrientationRadians() const {
     static const float PI = 3.14159265358979f;
     CriticalSectionLock lock;
+    extendCount();
     return (static_cast<float>(_position) / _pulsesPerRev) * (2.0f * PI);
 }
 
@@ -63,6 +220,7 @@ float encoder::getOrientationRadians() const {
  */
 float encoder::getRevolutions() const {
     CriticalSectionLock lock;
+    extendCount();
     return static_cast<float>(_position) / _pulsesPerRev;
 }
 
@@ -71,32 +229,140 @@ float encoder::getRevolutions() const {
  */
 int encoder::getDirection() const {
     CriticalSectionLock lock;
+    extendCount();
     return _direction;
 }
 
+/**
+ * Seqlock read: writers make _seq odd while they update, so retry until the
+ * same even value is seen before and after copying. Writers run in ISRs or
+ * critical sections on the same core, so volatile ordering is enough.
+ */
+EncoderSnapshot encoder::getSnapshot() const {
+    EncoderSnapshot snapshot;
+    uint32_t seq;
+    do {
+        seq = _seq;
+        snapshot.count = _position;
+        snapshot.edge_us = _edgeTime;
+        snapshot.direction = static_cast<int8_t>(_direction);
+    } while ((seq & 1) || seq != _seq);
+    return snapshot;
+}
+
 /**
  * Resets encoder count and direction.
  */
 void encoder::reset() {
     CriticalSectionLock lock;
+    extendCount();
+    _seq++;
     _position = 0;
     _direction = 0;
+    _seq++;
+}
+
+bool encoder::isHardware() const {
+    return _timer != nullptr;
+}
+
+EncoderHealth encoder::getHealth() const {
+    CriticalSectionLock lock;
+    return EncoderHealth{_edges, _invalid, _glitches, _storms, _polling};
+}
+
+float encoder::getMaxRpm() const {
+    float counts_per_s = ENCODER_IRQ_MAX_EDGES_PER_S;
+    if (_timer) {
+        // The counter may move 32767 counts between folds
+        auto interval = chrono::duration_cast<chrono::microseconds>(ENCODER_EXTEND_INTERVAL);
+        counts_per_s = 32767.0f * 1000000.0f / interval.count();
+    }
+    return counts_per_s * 60.0f / _pulsesPerRev;
 }
 
 /**
  * ISR that handles changes on encoder input pins.
+ * Counts invalid transitions and glitches per window and hands over to
+ * polling when a noisy or floating line produces them, or fires faster
+ * than the encoder can physically move.
+ */
+void encoder::encodeISR() {
+    PROFILE_SCOPE(encoder_isr);
+    uint32_t now = us_ticker_read();
+    _edges++;
+
+    if (now - _windowStart >= ENCODER_STORM_WINDOW_US) {
+        _windowStart = now;
+        _windowEdges = 0;
+        _windowInvalid = 0;
+    }
+    if (++_windowEdges > ENCODER_STORM_EDGES || _windowInvalid > ENCODER_STORM_INVALID) {
+        _chanA->disable_irq();
+        _chanB->disable_irq();
+        _polling = true;
+        _storms++;
+        _stormStart = now;
+        _poll.attach(callback(this, &encoder::pollISR), ENCODER_POLL_INTERVAL);
+        return;
+    }
+
+    sample(now);
+}
+
+/**
+ * Samples the pins while the interrupts are masked, and re-enables them
+ * once the holdoff has passed. A line that is still noisy trips the storm
+ * detection again within one window.
+ */
+void encoder::pollISR() {
+    uint32_t now = us_ticker_read();
+    sample(now);
+
+    if (now - _stormStart >= ENCODER_STORM_HOLDOFF_US) {
+        _poll.detach();
+        _windowStart = now;
+        _windowEdges = 0;
+        _windowInvalid = 0;
+        _polling = false;
+        _chanA->enable_irq();
+        _chanB->enable_irq();
+    }
+}
+
+/**
  * Determines new state, calculates movement direction,
  * updates pulse count and stores new state.
  */
-void encoder::encodeISR() {
-    uint8_t A = _chanA.read();
-    uint8_t B = _chanB.read();
+void encoder::sample(uint32_t now_us) {
+    uint8_t A = _chanA->read();
+    uint8_t B = _chanB->read();
     uint8_t newState = (A << 1) | B;
 
+    if (newState == _prevState) {
+        // A pulse shorter than the interrupt latency, or nothing moved between polls
+        if (!_polling) {
+            _glitches++;
+            _windowInvalid++;
+        }
+        return;
+    }
+
     uint8_t index = (_prevState << 2) | newState;
     int8_t step = _transitionTable[index];
 
+    if (step == 0) {
+        // Both channels changed, so an edge was missed
+        _invalid++;
+        _windowInvalid++;
+    }
+
+    _seq++;
     _position += step;
     _direction = (step > 0) ? 1 : (step < 0 ? -1 : 0);
+    if (step != 0) {
+        _edgeTime = now_us;
+    }
+    _seq++;
     _prevState = newState;
 }
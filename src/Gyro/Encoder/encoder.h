@@ -3,9 +3,78 @@
 
 #include "mbed.h"
 
+// How often the timer backend folds the 16-bit hardware counter into the
+// 32-bit count. The counter must not move more than 32767 counts between
+// folds: 10 ms allows 3.2M counts/s, ~23000 RPM at 2048 PPR.
+#ifndef ENCODER_EXTEND_INTERVAL
+#define ENCODER_EXTEND_INTERVAL 10ms
+#endif
+
+// Timer input filter (IC1F/IC2F), 3 = 8 samples at the timer clock
+#ifndef ENCODER_TIMER_FILTER
+#define ENCODER_TIMER_FILTER    3
+#endif
+
+// Fastest signal the interrupt backend is rated for. An edge costs ~2.2 us
+// of ISR, so 250k edges/s takes about half the CPU; at 2048 counts per
+// revolution that is ~7300 RPM. getMaxRpm() gives it in RPM for the
+// encoder's own resolution, callers keep their speed setpoints below it.
+#ifndef ENCODER_IRQ_MAX_EDGES_PER_S
+#define ENCODER_IRQ_MAX_EDGES_PER_S 250000
+#endif
+
+// Interrupt backend storm protection: more than ENCODER_STORM_INVALID
+// invalid transitions and glitches within one window, the sign of a noisy
+// or floating line, masks the channel interrupts and polls the pins every
+// ENCODER_POLL_INTERVAL for ENCODER_STORM_HOLDOFF_US before trying
+// interrupts again. Clean rotation produces neither. ENCODER_STORM_EDGES is
+// only a backstop for noise that happens to look valid, well above the
+// rated edge rate so that no commanded speed ends up polled.
+#ifndef ENCODER_STORM_WINDOW_US
+#define ENCODER_STORM_WINDOW_US     1000
+#endif
+#ifndef ENCODER_STORM_EDGES
+#define ENCODER_STORM_EDGES         400
+#endif
+#ifndef ENCODER_STORM_INVALID
+#define ENCODER_STORM_INVALID       8
+#endif
+#ifndef ENCODER_STORM_HOLDOFF_US
+#define ENCODER_STORM_HOLDOFF_US    100000
+#endif
+#ifndef ENCODER_POLL_INTERVAL
+#define ENCODER_POLL_INTERVAL       1ms
+#endif
+
 /**
- * @brief A quadrature encoder class that uses interrupts and a lookup table
- *        to track position and direction.
+ * @brief Consistent view of an encoder, see encoder::getSnapshot().
+ */
+struct EncoderSnapshot {
+    int32_t count;      ///< Position in counts
+    uint32_t edge_us;   ///< us_ticker time of the edge that set count
+    int8_t direction;   ///< Last direction, as getDirection()
+};
+
+/**
+ * @brief Input health counters, see encoder::getHealth(). Always zero with
+ *        the timer backend, whose input filter handles noise.
+ */
+struct EncoderHealth {
+    uint32_t edges;     ///< Interrupts taken
+    uint32_t invalid;   ///< Transitions where both channels changed (counts lost)
+    uint32_t glitches;  ///< Interrupts where neither channel had changed by the time it was read
+    uint32_t storms;    ///< Times the interrupts were masked for polling
+    bool polling;       ///< Currently polling instead of taking interrupts
+};
+
+/**
+ * @brief A quadrature encoder class that tracks position and direction.
+ *
+ * When channel A is CH1 and channel B is CH2 of the same general purpose timer
+ * in the target's PinMap_PWM, the timer decodes the signal in encoder mode and
+ * no CPU time is spent per edge. Otherwise both channels fall back to
+ * interrupts and a lookup table. Use the _ALT0 pin names to pick alternate
+ * timers.
  *
  * Provides thread-safe access to encoder pulse count, orientation in degrees/radians,
  * number of revolutions, and last movement direction.
@@ -56,26 +125,102 @@ public:
      */
     int getDirection() const;
 
+    /**
+     * @brief Get count, last edge time and direction without blocking interrupts.
+     *
+     * Call from threads, not from ISRs that can preempt the encoder's own
+     * interrupts. With the timer backend edges are not
+     * seen individually, so edge_us is the time of the last counter fold that
+     * saw the count move (within ENCODER_EXTEND_INTERVAL of the edge).
+     *
+     * @return EncoderSnapshot Count, edge time and direction from the same edge.
+     */
+    EncoderSnapshot getSnapshot() const;
+
     /**
      * @brief Reset encoder count and direction to zero.
      */
     void reset();
 
+    /**
+     * @brief Whether the count comes from a hardware timer in encoder mode.
+     */
+    bool isHardware() const;
+
+    /**
+     * @brief Get the input health counters.
+     */
+    EncoderHealth getHealth() const;
+
+    /**
+     * @brief Fastest speed the backend tracks, in revolutions of
+     *        pulsesPerRev counts per minute.
+     *
+     * The timer backend is bounded by the counter extension interval,
+     * interrupts by ENCODER_IRQ_MAX_EDGES_PER_S.
+     */
+    float getMaxRpm() const;
+
+    ~encoder();
+
 private:
+    /**
+     * @brief Put the timer behind the two pins in encoder mode, if they allow it.
+     *
+     * @return true on success.
+     */
+    bool initTimer(PinName channelA, PinName channelB);
+
+    /**
+     * @brief Fold the hardware counter's movement since the last call into
+     *        the 32-bit position. Caller holds a critical section.
+     */
+    void extendCount() const;
+
+    /**
+     * @brief Ticker callback that keeps the 32-bit position current between reads.
+     */
+    void extendISR();
+
     /**
      * @brief Interrupt handler called on any edge of either channel.
      *        Computes new state and updates position and direction.
      */
     void encodeISR();
 
-    InterruptIn _chanA;         ///< Encoder input channel A
-    InterruptIn _chanB;         ///< Encoder input channel B
+    /**
+     * @brief Apply the channel state read at now_us. Shared by the ISR and polling.
+     */
+    void sample(uint32_t now_us);
+
+    /**
+     * @brief Ticker callback while storm protection has the interrupts masked.
+     */
+    void pollISR();
+
+    InterruptIn* _chanA;        ///< Encoder input channel A, interrupt backend only
+    InterruptIn* _chanB;        ///< Encoder input channel B, interrupt backend only
+    TIM_TypeDef* _timer;        ///< Timer in encoder mode, nullptr for interrupts
+    Ticker _extend;             ///< Periodic counter extension, timer backend only
+    Ticker _poll;               ///< Pin polling during a storm, interrupt backend only
+
+    mutable volatile int _position;     ///< Current encoder position (pulse count)
+    const int _pulsesPerRev;            ///< Pulses per full revolution
+    volatile uint8_t _prevState;        ///< Previous 2-bit state of (A, B)
+    mutable volatile int _direction;    ///< Last detected direction of rotation
+    mutable uint16_t _lastCounter;      ///< Hardware counter at the last fold
+    mutable volatile uint32_t _edgeTime;///< us_ticker time of the last edge
+    mutable volatile uint32_t _seq;     ///< Odd while position, direction and edge time are updated
 
-    
-    volatile int _position;     ///< Current encoder position (pulse count)
-    const int _pulsesPerRev;    ///< Pulses per full revolution
-    volatile uint8_t _prevState;///< Previous 2-bit state of (A, B)
-    volatile int _direction;    ///< Last detected direction of rotation
+    uint32_t _windowStart;      ///< Start of the current storm detection window
+    uint32_t _windowEdges;      ///< Edges in the current window
+    uint32_t _windowInvalid;    ///< Invalid transitions and glitches in the current window
+    uint32_t _stormStart;       ///< When the interrupts were masked
+    volatile bool _polling;
+    volatile uint32_t _edges;
+    volatile uint32_t _invalid;
+    volatile uint32_t _glitches;
+    volatile uint32_t _storms;
 };
 
 #endif // ENCODER_H
@@ -0,0 +1,69 @@
+#include "encoder_velocity.h"
+#include <cmath>
+
+EncoderVelocity::EncoderVelocity(int countsPerRev)
+    : _countsPerRev(static_cast<float>(countsPerRev))
+{
+    reset();
+}
+
+void EncoderVelocity::reset() {
+    _started = false;
+    _count = 0;
+    _edgeTime = 0;
+    _lastUpdate = 0;
+    _speed = 0.0f;
+    _accel = 0.0f;
+}
+
+void EncoderVelocity::update(const EncoderSnapshot& snapshot, uint32_t now_us) {
+    if (!_started) {
+        _count = snapshot.count;
+        _edgeTime = snapshot.edge_us;
+        _lastUpdate = now_us;
+        _started = true;
+        return;
+    }
+
+    float speed = _speed;
+    int32_t moved = snapshot.count - _count;
+    uint32_t span = snapshot.edge_us - _edgeTime;
+
+    if (moved != 0 && span > 0) {
+        // M counts over the T between edges
+        speed = static_cast<float>(moved) * 1e6f / static_cast<float>(span);
+        _count = snapshot.count;
+        _edgeTime = snapshot.edge_us;
+    } else if (moved == 0) {
+        uint32_t since = now_us - _edgeTime;
+        if (since >= ENCODER_STOP_US) {
+            speed = 0.0f;
+        } else if (since > 0) {
+            // The next edge is at least this far away
+            float bound = 1e6f / static_cast<float>(since);
+            if (fabsf(speed) > bound) {
+                speed = copysignf(bound, speed);
+            }
+        }
+    }
+
+    uint32_t dt = now_us - _lastUpdate;
+    if (dt > 0) {
+        float accel = (speed - _speed) * 1e6f / static_cast<float>(dt);
+        _accel += ENCODER_ACCEL_ALPHA * (accel - _accel);
+    }
+    _speed = speed;
+    _lastUpdate = now_us;
+}
+
+float EncoderVelocity::getSpeed() const {
+    return _speed;
+}
+
+float EncoderVelocity::getRPM() const {
+    return _speed * 60.0f / _countsPerRev;
+}
+
+float EncoderVelocity::getAcceleration() const {
+    return _accel;
+}
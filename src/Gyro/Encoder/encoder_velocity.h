@@ -0,0 +1,61 @@
+#ifndef ENCODER_VELOCITY_H
+#define ENCODER_VELOCITY_H
+
+#include <cstdint>
+#include "encoder.h"
+
+// Without an edge for this long the encoder counts as stopped
+#ifndef ENCODER_STOP_US
+#define ENCODER_STOP_US         500000
+#endif
+
+// Smoothing of the acceleration estimate, 1 = none
+#ifndef ENCODER_ACCEL_ALPHA
+#define ENCODER_ACCEL_ALPHA     0.2f
+#endif
+
+/**
+ * @brief Speed and acceleration from periodic encoder snapshots (M/T method).
+ *
+ * Each update divides the counts moved since the previous update (M) by the
+ * time between the last edges of the two windows (T), so a window always
+ * spans whole edges. That keeps the resolution of counting at high speed and
+ * of edge timing at low speed. When no edge arrived in a window the speed can
+ * be at most one count since the last edge, which brings it down smoothly
+ * until ENCODER_STOP_US.
+ */
+class EncoderVelocity {
+public:
+    /**
+     * @param countsPerRev  Counts per revolution, on the scale of encoder::getRevolutions().
+     */
+    explicit EncoderVelocity(int countsPerRev);
+
+    /**
+     * @brief Fold in a new snapshot.
+     *
+     * @param snapshot  From encoder::getSnapshot().
+     * @param now_us    us_ticker time the snapshot was taken.
+     */
+    void update(const EncoderSnapshot& snapshot, uint32_t now_us);
+
+    /**
+     * @brief Forget the history, the next update starts from rest.
+     */
+    void reset();
+
+    float getSpeed() const;             ///< counts/s
+    float getRPM() const;               ///< revolutions per minute
+    float getAcceleration() const;      ///< counts/s^2
+
+private:
+    const float _countsPerRev;
+    bool _started;
+    int32_t _count;         ///< Count at the last edge used
+    uint32_t _edgeTime;     ///< Time of that edge
+    uint32_t _lastUpdate;
+    float _speed;
+    float _accel;
+};
+
+#endif // ENCODER_VELOCITY_H
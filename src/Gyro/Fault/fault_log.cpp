@@ -0,0 +1,205 @@
+#include "fault_log.h"
+#include "crc.h"
+#include "profiler.h"
+#include "mem_stats.h"
+#include "rtx_os.h"
+#include "mbed_fault_handler.h"
+#include <cstring>
+
+FaultLog::FaultLog(PolledFlash* flash)
+    : _flash(flash),
+      _thread_count(0),
+      _monitor(nullptr),
+      _captured(false),
+      _fill(0),
+      _address(FAULT_SECTOR_ADDR),
+      _crc(0xFFFF),
+      _ok(true)
+{
+}
+
+bool FaultLog::watchThread(osThreadId_t id) {
+    CriticalSectionLock lock;
+    if (_thread_count >= FAULT_MAX_THREADS) {
+        return false;
+    }
+    _threads[_thread_count++] = id;
+    return true;
+}
+
+void FaultLog::watchTasks(const TaskMonitor* monitor) {
+    _monitor = monitor;
+}
+
+bool FaultLog::hasCaptured() const {
+    return _captured;
+}
+
+static void copy_name(char* out, const char* name) {
+    memset(out, 0, FAULT_NAME_LEN);
+    if (name) {
+        strncpy(out, name, FAULT_NAME_LEN);
+    }
+}
+
+static bool is_fault(mbed_error_status_t status) {
+    int code = MBED_GET_ERROR_CODE(status);
+    return code == MBED_ERROR_CODE_HARDFAULT_EXCEPTION || code == MBED_ERROR_CODE_MEMMANAGE_EXCEPTION ||
+           code == MBED_ERROR_CODE_BUSFAULT_EXCEPTION || code == MBED_ERROR_CODE_USAGEFAULT_EXCEPTION;
+}
+
+void FaultLog::put(const void* data, size_t length) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    _crc = crc16(bytes, length, _crc);
+    while (length > 0) {
+        size_t chunk = sizeof(_page) - _fill;
+        if (chunk > length) {
+            chunk = length;
+        }
+        memcpy(&_page[_fill], bytes, chunk);
+        _fill += chunk;
+        bytes += chunk;
+        length -= chunk;
+        if (_fill == sizeof(_page)) {
+            flush();
+        }
+    }
+}
+
+void FaultLog::flush() {
+    if (_fill == 0) {
+        return;
+    }
+    if (_ok && _address + _fill <= FAULT_SECTOR_ADDR + FAULT_SECTOR_SIZE) {
+        _ok = _flash->program(_address, _page, _fill);
+    }
+    _address += _fill;
+    _fill = 0;
+}
+
+bool FaultLog::capture(uint8_t reason, const mbed_error_ctx* error, int culprit) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (_captured) {
+        __set_PRIMASK(primask);
+        return false;
+    }
+    _captured = true;
+    traceStop();
+
+    FaultHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = FAULT_MAGIC;
+    header.time_ms = static_cast<uint32_t>(Kernel::Clock::now().time_since_epoch().count());
+    header.cfsr = SCB->CFSR;
+    header.hfsr = SCB->HFSR;
+    header.mmfar = SCB->MMFAR;
+    header.bfar = SCB->BFAR;
+    header.reason = reason;
+    header.culprit = culprit >= 0 ? static_cast<uint8_t>(culprit) : 0xFF;
+    header.cycles_per_us = static_cast<uint16_t>(profilerCyclesPerUs());
+
+    osThreadId_t current = osThreadGetId();
+    if (error) {
+        header.error_status = static_cast<uint32_t>(error->error_status);
+        header.pc = error->error_address;
+        header.sp = error->thread_current_sp;
+        if (is_fault(error->error_status)) {
+            // mbed's fault handler passes its register dump as the error value
+            const mbed_fault_context_t* regs = reinterpret_cast<const mbed_fault_context_t*>(error->error_value);
+            header.pc = regs->PC_reg;
+            header.lr = regs->LR_reg;
+            header.sp = regs->SP_reg;
+            header.psr = regs->xPSR;
+        }
+        current = reinterpret_cast<osThreadId_t>(error->thread_id);
+    }
+    copy_name(header.thread, current ? static_cast<osRtxThread_t*>(current)->name : nullptr);
+
+    // Names first, the events get whatever room is left
+    header.threads = static_cast<uint8_t>(_thread_count);
+    header.tasks = static_cast<uint8_t>(_monitor ? _monitor->getCount() : 0);
+    for (const ProfileProbe* probe = profileFirst(); probe; probe = probe->getNext()) {
+        header.probes++;
+        header.names_size += strlen(probe->getName()) + 1;
+    }
+    for (int i = 0; traceThreadName(i); i++) {
+        header.trace_threads++;
+        header.names_size += strlen(traceThreadName(i)) + 1;
+    }
+    uint32_t fixed = sizeof(FaultHeader) + header.threads * sizeof(FaultThread) +
+                     header.tasks * sizeof(FaultTask) + header.names_size;
+    uint32_t room = fixed + sizeof(uint16_t) < FAULT_SECTOR_SIZE ?
+                    (FAULT_SECTOR_SIZE - sizeof(uint16_t) - fixed) / sizeof(TraceEvent) : 0;
+    uint32_t events = traceCount();
+    if (events > FAULT_TRACE_EVENTS) events = FAULT_TRACE_EVENTS;
+    if (events > room) events = room;
+    header.events = static_cast<uint16_t>(events);
+    header.length = fixed + events * sizeof(TraceEvent);
+
+    _flash->begin();
+    _ok = _flash->eraseSector(FAULT_SECTOR_ADDR);
+    _address = FAULT_SECTOR_ADDR;
+    _fill = 0;
+    _crc = 0xFFFF;
+
+    put(&header, sizeof(header));
+    for (int i = 0; i < _thread_count; i++) {
+        const osRtxThread_t* thread = static_cast<const osRtxThread_t*>(_threads[i]);
+        FaultThread record;
+        copy_name(record.name, thread->name);
+        record.stack_size = thread->stack_size;
+        record.stack_max = stackUsed(thread->stack_mem, thread->stack_size);
+        record.sp = thread->sp;
+        put(&record, sizeof(record));
+    }
+    for (int i = 0; i < header.tasks; i++) {
+        TaskTiming timing = _monitor->getTiming(i);
+        FaultTask record;
+        copy_name(record.name, timing.name);
+        record.deadline_us = timing.deadline_us;
+        record.runs = timing.runs;
+        record.misses = timing.misses;
+        record.response_max_us = timing.response_max_us;
+        record.last_beat_us = timing.last_beat_us;
+        put(&record, sizeof(record));
+    }
+    for (const ProfileProbe* probe = profileFirst(); probe; probe = probe->getNext()) {
+        put(probe->getName(), strlen(probe->getName()) + 1);
+    }
+    for (int i = 0; traceThreadName(i); i++) {
+        put(traceThreadName(i), strlen(traceThreadName(i)) + 1);
+    }
+    uint32_t first = traceCount() - events;
+    for (uint32_t i = 0; i < events; i++) {
+        TraceEvent event;
+        traceRead(first + i, &event, 1);
+        put(&event, sizeof(event));
+    }
+
+    uint16_t crc = _crc;
+    put(&crc, sizeof(crc));
+    flush();
+
+    __set_PRIMASK(primask);
+    return _ok;
+}
+
+bool faultRead(flash& f, FaultHeader& header) {
+    f.read(FAULT_SECTOR_ADDR, reinterpret_cast<uint8_t*>(&header), sizeof(header));
+    if (header.magic != FAULT_MAGIC || header.length < sizeof(header) ||
+        header.length > FAULT_SECTOR_SIZE - sizeof(uint16_t)) {
+        return false;
+    }
+
+    uint16_t crc = crc16(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+    uint8_t buf[64];
+    for (uint32_t offset = sizeof(header); offset < header.length; offset += sizeof(buf)) {
+        uint32_t n = header.length - offset < sizeof(buf) ? header.length - offset : sizeof(buf);
+        f.read(FAULT_SECTOR_ADDR + offset, buf, n);
+        crc = crc16(buf, n, crc);
+    }
+    uint16_t stored = 0;
+    f.read(FAULT_SECTOR_ADDR + header.length, reinterpret_cast<uint8_t*>(&stored), sizeof(stored));
+    return crc == stored;
+}
@@ -0,0 +1,129 @@
+#ifndef FAULT_LOG_H
+#define FAULT_LOG_H
+
+#include "mbed.h"
+#include "flash.h"
+#include "flash_polled.h"
+#include "task_monitor.h"
+
+/*
+ * Crash capture to a reserved W25Q32JV sector, decoded on the host by fault.py.
+ *
+ * The record is streamed page by page through PolledFlash, so it can be
+ * written from mbed_error_hook() (hard faults reach it through mbed's fault
+ * handler) as well as from a thread about to be reset by the watchdog:
+ *
+ *   FaultHeader
+ *   FaultThread  x threads    watched threads, stack use from RTX's fill pattern
+ *   FaultTask    x tasks      TaskMonitor timings
+ *   names                     probe names then trace thread names, each null terminated
+ *   TraceEvent   x events     the newest trace events, oldest first (see Profiler/trace.h)
+ *   u16 CRC-16/CCITT-FALSE over everything before it
+ *
+ * All fields are little endian. A new capture replaces the previous record;
+ * `fault clear` erases it; `clear` only erases the log before it.
+ */
+
+#define FAULT_SECTOR_ADDR   0x3FF000    // last 4 KB sector, after the flight log and the config
+#define FAULT_SECTOR_SIZE   0x1000
+#define FAULT_MAGIC         0x31544C46  // "FLT1"
+#define FAULT_MAX_THREADS   12
+#define FAULT_TRACE_EVENTS  256         // newest events kept, fewer if the names leave no room
+#define FAULT_NAME_LEN      12
+
+// What triggered a capture
+#define FAULT_ERROR         1       // mbed_error(), including hard, bus, memory and usage faults
+#define FAULT_WATCHDOG      2       // kicks withheld, the watchdog is about to reset the board
+
+struct FaultHeader {
+    uint32_t magic;
+    uint32_t length;            ///< Bytes from the start of the header up to the CRC
+    uint32_t time_ms;           ///< Kernel clock, the same as the log timestamps
+    uint32_t error_status;      ///< mbed_error_status_t, 0 for watchdog captures
+    uint32_t pc;                ///< Faulting instruction, or where mbed_error() was called
+    uint32_t lr;
+    uint32_t sp;
+    uint32_t psr;
+    uint32_t cfsr;              ///< SCB fault status and address registers
+    uint32_t hfsr;
+    uint32_t mmfar;
+    uint32_t bfar;
+    char thread[FAULT_NAME_LEN];    ///< Thread running at the capture
+    uint16_t cycles_per_us;     ///< Trace timestamp rate
+    uint16_t events;
+    uint8_t reason;             ///< FAULT_ERROR or FAULT_WATCHDOG
+    uint8_t threads;
+    uint8_t tasks;
+    uint8_t culprit;            ///< Late TaskMonitor task for watchdog captures, 0xFF if none
+    uint8_t probes;             ///< Probe names, then trace thread names
+    uint8_t trace_threads;
+    uint16_t names_size;
+};
+
+struct FaultThread {
+    char name[FAULT_NAME_LEN];
+    uint32_t stack_size;
+    uint32_t stack_max;         ///< Most stack ever used, bytes
+    uint32_t sp;
+};
+
+struct FaultTask {
+    char name[FAULT_NAME_LEN];
+    uint32_t deadline_us;
+    uint32_t runs;
+    uint32_t misses;
+    uint32_t response_max_us;
+    uint32_t last_beat_us;
+};
+
+class FaultLog {
+public:
+    explicit FaultLog(PolledFlash* flash);
+
+    /**
+     * @brief Include a thread's stack in captures, call once it has started.
+     * @return false if FAULT_MAX_THREADS are already watched.
+     */
+    bool watchThread(osThreadId_t id);
+
+    void watchTasks(const TaskMonitor* monitor);
+
+    /**
+     * @brief Write a record, with interrupts masked throughout. Only the
+     * first call does anything, the board is expected to reset afterwards.
+     *
+     * @param error    Error context from mbed_error_hook(), nullptr otherwise.
+     * @param culprit  TaskMonitor id of the late task, -1 if none.
+     * @return false if the flash did not respond.
+     */
+    bool capture(uint8_t reason, const mbed_error_ctx* error = nullptr, int culprit = -1);
+
+    bool hasCaptured() const;
+
+private:
+    PolledFlash* _flash;
+    osThreadId_t _threads[FAULT_MAX_THREADS];
+    int _thread_count;
+    const TaskMonitor* _monitor;
+    volatile bool _captured;
+
+    // Write stream, flushed a page at a time
+    uint8_t _page[256];
+    size_t _fill;
+    uint32_t _address;
+    uint16_t _crc;
+    bool _ok;
+
+    void put(const void* data, size_t length);
+    void flush();
+};
+
+/**
+ * @brief Read the header of the record in the fault sector, through the
+ * normal driver. Not safe while something else uses the flash.
+ *
+ * @return true if there is a record and its CRC matches.
+ */
+bool faultRead(flash& f, FaultHeader& header);
+
+#endif // FAULT_LOG_H
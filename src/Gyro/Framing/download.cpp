@@ -0,0 +1,289 @@
+#include "download.h"
+#include "crc.h"
+#include <cstring>
+
+static_assert(DL_WINDOW >= 1 && DL_WINDOW <= 32, "DL_WINDOW must fit the 32 bit chunk mask");
+
+static void putU32(uint8_t* p, uint32_t v) {
+    memcpy(p, &v, 4);
+}
+
+static uint32_t getU32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static size_t putCrc(uint8_t* msg, size_t len) {
+    uint16_t crc = crc16(msg, len);
+    msg[len] = static_cast<uint8_t>(crc & 0xFF);
+    msg[len + 1] = static_cast<uint8_t>(crc >> 8);
+    return len + DL_CRC_SIZE;
+}
+
+static bool checkCrc(const uint8_t* msg, size_t len) {
+    if (len < DL_CRC_SIZE + 1) {
+        return false;
+    }
+    return crc16(msg, len - 2) == (msg[len - 2] | (msg[len - 1] << 8));
+}
+
+static uint32_t popcount(uint32_t x) {
+    uint32_t n = 0;
+    while (x) {
+        x &= x - 1;
+        n++;
+    }
+    return n;
+}
+
+// ===== FLIGHT SIDE =====
+
+bool dlIsInfoRequest(const uint8_t* msg, size_t len) {
+    return len == 1 + DL_CRC_SIZE && msg[0] == RADIO_MSG_LOG_INFO && checkCrc(msg, len);
+}
+
+bool dlParseRead(const uint8_t* msg, size_t len, uint32_t& base, uint32_t& mask) {
+    if (len != DL_READ_SIZE || msg[0] != RADIO_MSG_LOG_READ || !checkCrc(msg, len)) {
+        return false;
+    }
+    base = getU32(&msg[1]);
+    mask = getU32(&msg[5]);
+    return true;
+}
+
+size_t dlPackInfo(uint32_t size, uint8_t* out) {
+    out[0] = RADIO_MSG_LOG_INFO;
+    putU32(&out[1], size);
+    return putCrc(out, 5);
+}
+
+size_t dlPackData(uint32_t offset, const uint8_t* data, size_t len, uint8_t* out) {
+    if (len > DL_CHUNK_SIZE) {
+        return 0;
+    }
+    out[0] = RADIO_MSG_LOG_DATA;
+    putU32(&out[1], offset);
+    memcpy(&out[DL_HEADER_SIZE], data, len);
+    return putCrc(out, DL_HEADER_SIZE + len);
+}
+
+// ===== GROUND SIDE =====
+
+DownloadClient::DownloadClient(uint32_t chunk_air_ms)
+    : _chunk_ms(chunk_air_ms),
+      _state(Idle),
+      _size(0),
+      _base(0),
+      _have(0),
+      _asked(0),
+      _due(false),
+      _deadline(0),
+      _last_data(0),
+      _start(0),
+      _end(0),
+      _received(0),
+      _requests(0),
+      _repeats(0),
+      _duplicates(0),
+      _corrupt(0),
+      _chunk_offset(0),
+      _chunk_len(0)
+{
+}
+
+void DownloadClient::start(uint32_t offset, uint32_t now_ms) {
+    _state = Sizing;
+    _size = 0;
+    _base = offset - offset % DL_CHUNK_SIZE;
+    _have = 0;
+    _asked = 0;
+    _due = true;
+    _last_data = now_ms;
+
+    _start = now_ms;
+    _received = 0;
+    _requests = 0;
+    _repeats = 0;
+    _duplicates = 0;
+    _corrupt = 0;
+}
+
+void DownloadClient::cancel() {
+    _state = Idle;
+}
+
+uint32_t DownloadClient::windowMask() const {
+    if (_base >= _size) {
+        return 0;
+    }
+    uint32_t chunks = (_size - _base + DL_CHUNK_SIZE - 1) / DL_CHUNK_SIZE;
+    if (chunks >= DL_WINDOW) {
+        chunks = DL_WINDOW;
+    }
+    return chunks >= 32 ? 0xFFFFFFFFu : (1u << chunks) - 1;
+}
+
+void DownloadClient::schedule(uint32_t now_ms, uint32_t chunks) {
+    _due = false;
+    if (isStalled(now_ms)) {
+        _deadline = now_ms + DL_STALL_MS;
+    } else {
+        _deadline = now_ms + chunks * _chunk_ms + DL_TIMEOUT_MARGIN_MS;
+    }
+}
+
+const uint8_t* DownloadClient::poll(uint32_t now_ms, size_t& len) {
+    if (_state != Sizing && _state != Running) {
+        return nullptr;
+    }
+    if (!_due && static_cast<int32_t>(now_ms - _deadline) < 0) {
+        return nullptr;
+    }
+
+    _requests++;
+
+    if (_state == Sizing) {
+        _msg[0] = RADIO_MSG_LOG_INFO;
+        len = putCrc(_msg, 1);
+        schedule(now_ms, 1);
+        return _msg;
+    }
+
+    // Ask only for what is still missing in the window
+    uint32_t missing = windowMask() & ~_have;
+    _repeats += popcount(missing & _asked);
+    _asked |= missing;
+
+    _msg[0] = RADIO_MSG_LOG_READ;
+    putU32(&_msg[1], _base);
+    putU32(&_msg[5], missing);
+    len = putCrc(_msg, 9);
+    schedule(now_ms, popcount(missing));
+    return _msg;
+}
+
+uint32_t DownloadClient::timeUntilNext(uint32_t now_ms) const {
+    if (_state != Sizing && _state != Running) {
+        return UINT32_MAX;
+    }
+    if (_due) {
+        return 0;
+    }
+    int32_t left = static_cast<int32_t>(_deadline - now_ms);
+    return left > 0 ? static_cast<uint32_t>(left) : 0;
+}
+
+DownloadClient::Result DownloadClient::onMessage(const uint8_t* msg, size_t len, uint32_t now_ms) {
+    if (len == 0 || (msg[0] != RADIO_MSG_LOG_INFO && msg[0] != RADIO_MSG_LOG_DATA)) {
+        return Ignored;
+    }
+    if (!checkCrc(msg, len)) {
+        _corrupt++;
+        return Corrupt;
+    }
+
+    if (msg[0] == RADIO_MSG_LOG_INFO) {
+        if (len != DL_INFO_SIZE) {
+            return Ignored;     // a request, not a reply
+        }
+        _last_data = now_ms;
+        if (_state == Sizing) {
+            _size = getU32(&msg[1]);
+            _state = (_base >= _size) ? Done : Running;
+            _due = true;
+            _end = now_ms;      // only used once Done
+        }
+        return Info;
+    }
+
+    if (len < DL_HEADER_SIZE + DL_CRC_SIZE + 1) {
+        _corrupt++;
+        return Corrupt;
+    }
+
+    uint32_t offset = getU32(&msg[1]);
+    size_t data_len = len - DL_HEADER_SIZE - DL_CRC_SIZE;
+
+    if (_state != Running || offset < _base || (offset - _base) % DL_CHUNK_SIZE != 0) {
+        _duplicates++;
+        return Duplicate;
+    }
+    uint32_t index = (offset - _base) / DL_CHUNK_SIZE;
+    if (index >= DL_WINDOW || (_have & (1u << index))) {
+        _duplicates++;
+        return Duplicate;
+    }
+
+    uint32_t expected = _size - offset < DL_CHUNK_SIZE ? _size - offset : DL_CHUNK_SIZE;
+    if (data_len != expected) {
+        _corrupt++;
+        return Corrupt;
+    }
+
+    memcpy(_chunk, &msg[DL_HEADER_SIZE], data_len);
+    _chunk_offset = offset;
+    _chunk_len = data_len;
+    _have |= 1u << index;
+    _received += data_len;
+    _last_data = now_ms;
+
+    if (_have == windowMask()) {
+        // Window complete, slide to the next one
+        _base += DL_WINDOW * DL_CHUNK_SIZE;
+        _have = 0;
+        _asked = 0;
+        if (_base >= _size) {
+            _state = Done;
+            _end = now_ms;
+        } else {
+            _due = true;
+        }
+    } else if (!_due) {
+        // Chunks are still flowing, wait for the rest before repeating
+        uint32_t pending = popcount(_asked & ~_have);
+        _deadline = now_ms + pending * _chunk_ms + DL_TIMEOUT_MARGIN_MS;
+    }
+    return Chunk;
+}
+
+const uint8_t* DownloadClient::chunk() const { return _chunk; }
+uint32_t DownloadClient::chunkOffset() const { return _chunk_offset; }
+size_t DownloadClient::chunkLength() const { return _chunk_len; }
+
+DownloadClient::State DownloadClient::getState() const {
+    return _state;
+}
+
+bool DownloadClient::isStalled(uint32_t now_ms) const {
+    return (_state == Sizing || _state == Running) && now_ms - _last_data > DL_STALL_MS;
+}
+
+uint32_t DownloadClient::getSize() const {
+    return _size;
+}
+
+uint32_t DownloadClient::getOffset() const {
+    if (_state == Done) {
+        return _size;
+    }
+    uint32_t offset = _base;
+    for (uint32_t i = 0; i < DL_WINDOW && (_have & (1u << i)); i++) {
+        offset += DL_CHUNK_SIZE;
+    }
+    return (_size && offset > _size) ? _size : offset;
+}
+
+uint32_t DownloadClient::getReceived() const {
+    return _received;
+}
+
+uint32_t DownloadClient::getRate(uint32_t now_ms) const {
+    uint32_t elapsed = ((_state == Done) ? _end : now_ms) - _start;
+    return elapsed ? static_cast<uint32_t>(static_cast<uint64_t>(_received) * 1000 / elapsed) : 0;
+}
+
+uint32_t DownloadClient::getRequests() const { return _requests; }
+uint32_t DownloadClient::getRepeats() const { return _repeats; }
+uint32_t DownloadClient::getDuplicates() const { return _duplicates; }
+uint32_t DownloadClient::getCorrupt() const { return _corrupt; }
@@ -0,0 +1,372 @@
+#include "fec.h"
+#include <cstring>
+
+// GF(256) with primitive polynomial 0x11D. _gfExp is doubled so products
+// of two logarithms need no modulo.
+static const uint8_t _gfExp[512] = {
+    0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1D, 0x3A, 0x74, 0xE8, 0xCD, 0x87, 0x13, 0x26,
+    0x4C, 0x98, 0x2D, 0x5A, 0xB4, 0x75, 0xEA, 0xC9, 0x8F, 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0xC0,
+    0x9D, 0x27, 0x4E, 0x9C, 0x25, 0x4A, 0x94, 0x35, 0x6A, 0xD4, 0xB5, 0x77, 0xEE, 0xC1, 0x9F, 0x23,
+    0x46, 0x8C, 0x05, 0x0A, 0x14, 0x28, 0x50, 0xA0, 0x5D, 0xBA, 0x69, 0xD2, 0xB9, 0x6F, 0xDE, 0xA1,
+    0x5F, 0xBE, 0x61, 0xC2, 0x99, 0x2F, 0x5E, 0xBC, 0x65, 0xCA, 0x89, 0x0F, 0x1E, 0x3C, 0x78, 0xF0,
+    0xFD, 0xE7, 0xD3, 0xBB, 0x6B, 0xD6, 0xB1, 0x7F, 0xFE, 0xE1, 0xDF, 0xA3, 0x5B, 0xB6, 0x71, 0xE2,
+    0xD9, 0xAF, 0x43, 0x86, 0x11, 0x22, 0x44, 0x88, 0x0D, 0x1A, 0x34, 0x68, 0xD0, 0xBD, 0x67, 0xCE,
+    0x81, 0x1F, 0x3E, 0x7C, 0xF8, 0xED, 0xC7, 0x93, 0x3B, 0x76, 0xEC, 0xC5, 0x97, 0x33, 0x66, 0xCC,
+    0x85, 0x17, 0x2E, 0x5C, 0xB8, 0x6D, 0xDA, 0xA9, 0x4F, 0x9E, 0x21, 0x42, 0x84, 0x15, 0x2A, 0x54,
+    0xA8, 0x4D, 0x9A, 0x29, 0x52, 0xA4, 0x55, 0xAA, 0x49, 0x92, 0x39, 0x72, 0xE4, 0xD5, 0xB7, 0x73,
+    0xE6, 0xD1, 0xBF, 0x63, 0xC6, 0x91, 0x3F, 0x7E, 0xFC, 0xE5, 0xD7, 0xB3, 0x7B, 0xF6, 0xF1, 0xFF,
+    0xE3, 0xDB, 0xAB, 0x4B, 0x96, 0x31, 0x62, 0xC4, 0x95, 0x37, 0x6E, 0xDC, 0xA5, 0x57, 0xAE, 0x41,
+    0x82, 0x19, 0x32, 0x64, 0xC8, 0x8D, 0x07, 0x0E, 0x1C, 0x38, 0x70, 0xE0, 0xDD, 0xA7, 0x53, 0xA6,
+    0x51, 0xA2, 0x59, 0xB2, 0x79, 0xF2, 0xF9, 0xEF, 0xC3, 0x9B, 0x2B, 0x56, 0xAC, 0x45, 0x8A, 0x09,
+    0x12, 0x24, 0x48, 0x90, 0x3D, 0x7A, 0xF4, 0xF5, 0xF7, 0xF3, 0xFB, 0xEB, 0xCB, 0x8B, 0x0B, 0x16,
+    0x2C, 0x58, 0xB0, 0x7D, 0xFA, 0xE9, 0xCF, 0x83, 0x1B, 0x36, 0x6C, 0xD8, 0xAD, 0x47, 0x8E, 0x01,
+    0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1D, 0x3A, 0x74, 0xE8, 0xCD, 0x87, 0x13, 0x26, 0x4C,
+    0x98, 0x2D, 0x5A, 0xB4, 0x75, 0xEA, 0xC9, 0x8F, 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0xC0, 0x9D,
+    0x27, 0x4E, 0x9C, 0x25, 0x4A, 0x94, 0x35, 0x6A, 0xD4, 0xB5, 0x77, 0xEE, 0xC1, 0x9F, 0x23, 0x46,
+    0x8C, 0x05, 0x0A, 0x14, 0x28, 0x50, 0xA0, 0x5D, 0xBA, 0x69, 0xD2, 0xB9, 0x6F, 0xDE, 0xA1, 0x5F,
+    0xBE, 0x61, 0xC2, 0x99, 0x2F, 0x5E, 0xBC, 0x65, 0xCA, 0x89, 0x0F, 0x1E, 0x3C, 0x78, 0xF0, 0xFD,
+    0xE7, 0xD3, 0xBB, 0x6B, 0xD6, 0xB1, 0x7F, 0xFE, 0xE1, 0xDF, 0xA3, 0x5B, 0xB6, 0x71, 0xE2, 0xD9,
+    0xAF, 0x43, 0x86, 0x11, 0x22, 0x44, 0x88, 0x0D, 0x1A, 0x34, 0x68, 0xD0, 0xBD, 0x67, 0xCE, 0x81,
+    0x1F, 0x3E, 0x7C, 0xF8, 0xED, 0xC7, 0x93, 0x3B, 0x76, 0xEC, 0xC5, 0x97, 0x33, 0x66, 0xCC, 0x85,
+    0x17, 0x2E, 0x5C, 0xB8, 0x6D, 0xDA, 0xA9, 0x4F, 0x9E, 0x21, 0x42, 0x84, 0x15, 0x2A, 0x54, 0xA8,
+    0x4D, 0x9A, 0x29, 0x52, 0xA4, 0x55, 0xAA, 0x49, 0x92, 0x39, 0x72, 0xE4, 0xD5, 0xB7, 0x73, 0xE6,
+    0xD1, 0xBF, 0x63, 0xC6, 0x91, 0x3F, 0x7E, 0xFC, 0xE5, 0xD7, 0xB3, 0x7B, 0xF6, 0xF1, 0xFF, 0xE3,
+    0xDB, 0xAB, 0x4B, 0x96, 0x31, 0x62, 0xC4, 0x95, 0x37, 0x6E, 0xDC, 0xA5, 0x57, 0xAE, 0x41, 0x82,
+    0x19, 0x32, 0x64, 0xC8, 0x8D, 0x07, 0x0E, 0x1C, 0x38, 0x70, 0xE0, 0xDD, 0xA7, 0x53, 0xA6, 0x51,
+    0xA2, 0x59, 0xB2, 0x79, 0xF2, 0xF9, 0xEF, 0xC3, 0x9B, 0x2B, 0x56, 0xAC, 0x45, 0x8A, 0x09, 0x12,
+    0x24, 0x48, 0x90, 0x3D, 0x7A, 0xF4, 0xF5, 0xF7, 0xF3, 0xFB, 0xEB, 0xCB, 0x8B, 0x0B, 0x16, 0x2C,
+    0x58, 0xB0, 0x7D, 0xFA, 0xE9, 0xCF, 0x83, 0x1B, 0x36, 0x6C, 0xD8, 0xAD, 0x47, 0x8E, 0x01, 0x02,
+};
+
+static const uint8_t _gfLog[256] = {
+    0x00, 0x00, 0x01, 0x19, 0x02, 0x32, 0x1A, 0xC6, 0x03, 0xDF, 0x33, 0xEE, 0x1B, 0x68, 0xC7, 0x4B,
+    0x04, 0x64, 0xE0, 0x0E, 0x34, 0x8D, 0xEF, 0x81, 0x1C, 0xC1, 0x69, 0xF8, 0xC8, 0x08, 0x4C, 0x71,
+    0x05, 0x8A, 0x65, 0x2F, 0xE1, 0x24, 0x0F, 0x21, 0x35, 0x93, 0x8E, 0xDA, 0xF0, 0x12, 0x82, 0x45,
+    0x1D, 0xB5, 0xC2, 0x7D, 0x6A, 0x27, 0xF9, 0xB9, 0xC9, 0x9A, 0x09, 0x78, 0x4D, 0xE4, 0x72, 0xA6,
+    0x06, 0xBF, 0x8B, 0x62, 0x66, 0xDD, 0x30, 0xFD, 0xE2, 0x98, 0x25, 0xB3, 0x10, 0x91, 0x22, 0x88,
+    0x36, 0xD0, 0x94, 0xCE, 0x8F, 0x96, 0xDB, 0xBD, 0xF1, 0xD2, 0x13, 0x5C, 0x83, 0x38, 0x46, 0x40,
+    0x1E, 0x42, 0xB6, 0xA3, 0xC3, 0x48, 0x7E, 0x6E, 0x6B, 0x3A, 0x28, 0x54, 0xFA, 0x85, 0xBA, 0x3D,
+    0xCA, 0x5E, 0x9B, 0x9F, 0x0A, 0x15, 0x79, 0x2B, 0x4E, 0xD4, 0xE5, 0xAC, 0x73, 0xF3, 0xA7, 0x57,
+    0x07, 0x70, 0xC0, 0xF7, 0x8C, 0x80, 0x63, 0x0D, 0x67, 0x4A, 0xDE, 0xED, 0x31, 0xC5, 0xFE, 0x18,
+    0xE3, 0xA5, 0x99, 0x77, 0x26, 0xB8, 0xB4, 0x7C, 0x11, 0x44, 0x92, 0xD9, 0x23, 0x20, 0x89, 0x2E,
+    0x37, 0x3F, 0xD1, 0x5B, 0x95, 0xBC, 0xCF, 0xCD, 0x90, 0x87, 0x97, 0xB2, 0xDC, 0xFC, 0xBE, 0x61,
+    0xF2, 0x56, 0xD3, 0xAB, 0x14, 0x2A, 0x5D, 0x9E, 0x84, 0x3C, 0x39, 0x53, 0x47, 0x6D, 0x41, 0xA2,
+    0x1F, 0x2D, 0x43, 0xD8, 0xB7, 0x7B, 0xA4, 0x76, 0xC4, 0x17, 0x49, 0xEC, 0x7F, 0x0C, 0x6F, 0xF6,
+    0x6C, 0xA1, 0x3B, 0x52, 0x29, 0x9D, 0x55, 0xAA, 0xFB, 0x60, 0x86, 0xB1, 0xBB, 0xCC, 0x3E, 0x5A,
+    0xCB, 0x59, 0x5F, 0xB0, 0x9C, 0xA9, 0xA0, 0x51, 0x0B, 0xF5, 0x16, 0xEB, 0x7A, 0x75, 0x2C, 0xD7,
+    0x4F, 0xAE, 0xD5, 0xE9, 0xE6, 0xE7, 0xAD, 0xE8, 0x74, 0xD6, 0xF4, 0xEA, 0xA8, 0x50, 0x58, 0xAF,
+};
+
+static inline uint8_t gfMul(uint8_t a, uint8_t b) {
+    if (a == 0 || b == 0) {
+        return 0;
+    }
+    return _gfExp[_gfLog[a] + _gfLog[b]];
+}
+
+static inline uint8_t gfDiv(uint8_t a, uint8_t b) {
+    if (a == 0) {
+        return 0;
+    }
+    return _gfExp[_gfLog[a] + 255 - _gfLog[b]];
+}
+
+// Evaluate a polynomial (lowest power first) at alpha^-power
+static uint8_t gfEvalInv(const uint8_t* poly, size_t degree, unsigned power) {
+    uint8_t result = 0;
+    unsigned step = (255 - power % 255) % 255;
+    for (size_t i = degree + 1; i-- > 0;) {
+        result = gfMul(result, _gfExp[step]) ^ poly[i];
+    }
+    return result;
+}
+
+// ===== REED-SOLOMON =====
+
+ReedSolomon::ReedSolomon(uint8_t roots) {
+    if (roots > FEC_MAX_ROOTS) {
+        roots = FEC_MAX_ROOTS;
+    }
+    _roots = roots;
+
+    // g(x) = (x + alpha^0)(x + alpha^1)...(x + alpha^(roots - 1))
+    memset(_gen, 0, sizeof(_gen));
+    _gen[0] = 1;
+    for (uint8_t r = 0; r < roots; r++) {
+        for (size_t j = r + 1; j > 0; j--) {
+            _gen[j] ^= gfMul(_gfExp[r], _gen[j - 1]);
+        }
+    }
+}
+
+/**
+ * LFSR division of data(x) * x^roots by the generator. The parity register
+ * holds the remainder, highest power first.
+ */
+void ReedSolomon::encode(const uint8_t* data, size_t len, uint8_t* parity) const {
+    memset(parity, 0, _roots);
+
+    for (size_t i = 0; i < len; i++) {
+        uint8_t feedback = data[i] ^ parity[0];
+        if (feedback != 0) {
+            uint8_t log_fb = _gfLog[feedback];
+            for (size_t j = 0; j + 1 < _roots; j++) {
+                parity[j] = parity[j + 1] ^ (_gen[j + 1] ? _gfExp[log_fb + _gfLog[_gen[j + 1]]] : 0);
+            }
+            parity[_roots - 1] = _gfExp[log_fb + _gfLog[_gen[_roots]]];
+        } else {
+            memmove(parity, parity + 1, _roots - 1);
+            parity[_roots - 1] = 0;
+        }
+    }
+}
+
+/**
+ * Syndromes, Berlekamp-Massey for the error locator, Chien search for the
+ * positions and Forney for the magnitudes.
+ */
+int ReedSolomon::decode(uint8_t* codeword, size_t len) const {
+    if (len < _roots || len > 255) {
+        return -1;
+    }
+
+    // Syndromes S_i = c(alpha^i), codeword stored highest power first
+    uint8_t synd[FEC_MAX_ROOTS];
+    bool clean = true;
+    for (uint8_t i = 0; i < _roots; i++) {
+        uint8_t s = 0;
+        for (size_t k = 0; k < len; k++) {
+            s = gfMul(s, _gfExp[i]) ^ codeword[k];
+        }
+        synd[i] = s;
+        clean &= (s == 0);
+    }
+    if (clean) {
+        return 0;
+    }
+
+    // Berlekamp-Massey, polynomials lowest power first
+    uint8_t lambda[FEC_MAX_ROOTS + 1] = {1};
+    uint8_t prev[FEC_MAX_ROOTS + 1] = {1};
+    uint8_t prev_disc = 1;
+    size_t order = 0;
+    size_t shift = 1;
+
+    for (size_t n = 0; n < _roots; n++) {
+        uint8_t disc = synd[n];
+        for (size_t i = 1; i <= order; i++) {
+            disc ^= gfMul(lambda[i], synd[n - i]);
+        }
+
+        if (disc == 0) {
+            shift++;
+            continue;
+        }
+
+        uint8_t coef = gfDiv(disc, prev_disc);
+        if (2 * order <= n) {
+            uint8_t saved[FEC_MAX_ROOTS + 1];
+            memcpy(saved, lambda, sizeof(saved));
+            for (size_t i = 0; i + shift <= _roots; i++) {
+                lambda[i + shift] ^= gfMul(coef, prev[i]);
+            }
+            order = n + 1 - order;
+            memcpy(prev, saved, sizeof(prev));
+            prev_disc = disc;
+            shift = 1;
+        } else {
+            for (size_t i = 0; i + shift <= _roots; i++) {
+                lambda[i + shift] ^= gfMul(coef, prev[i]);
+            }
+            shift++;
+        }
+    }
+
+    if (order == 0 || 2 * order > _roots) {
+        return -1;
+    }
+
+    // Error evaluator omega(x) = S(x) * lambda(x) mod x^roots
+    uint8_t omega[FEC_MAX_ROOTS];
+    for (size_t i = 0; i < _roots; i++) {
+        uint8_t v = 0;
+        for (size_t j = 0; j <= i && j <= order; j++) {
+            v ^= gfMul(synd[i - j], lambda[j]);
+        }
+        omega[i] = v;
+    }
+
+    // Formal derivative: only odd powers survive in characteristic 2
+    uint8_t deriv[FEC_MAX_ROOTS];
+    for (size_t i = 0; i < order; i++) {
+        deriv[i] = (i & 1) ? 0 : lambda[i + 1];
+    }
+
+    size_t pos[FEC_MAX_ROOTS / 2];
+    uint8_t mag[FEC_MAX_ROOTS / 2];
+    size_t found = 0;
+
+    for (size_t k = 0; k < len; k++) {
+        unsigned power = static_cast<unsigned>(len - 1 - k);    // X = alpha^power
+        if (gfEvalInv(lambda, order, power) != 0) {
+            continue;
+        }
+        if (found == order) {
+            return -1;
+        }
+
+        uint8_t num = gfEvalInv(omega, _roots - 1, power);
+        uint8_t den = gfEvalInv(deriv, order - 1, power);
+        if (den == 0) {
+            return -1;
+        }
+        pos[found] = k;
+        mag[found] = gfMul(_gfExp[power % 255], gfDiv(num, den));
+        found++;
+    }
+
+    if (found != order) {
+        return -1;
+    }
+    for (size_t i = 0; i < found; i++) {
+        codeword[pos[i]] ^= mag[i];
+    }
+    return static_cast<int>(found);
+}
+
+uint8_t ReedSolomon::roots() const {
+    return _roots;
+}
+
+// ===== FRAME LEVEL =====
+
+static const struct {
+    uint8_t header;
+    uint8_t roots;
+    uint8_t depth;
+} _modes[FEC_MODES] = {
+    { 0x00, 0,  1 },    // FEC_OFF, no header
+    { 0x87, 8,  2 },    // FEC_LIGHT
+    { 0xC9, 16, 2 },    // FEC_MEDIUM
+    { 0xDE, 16, 4 },    // FEC_HEAVY
+};
+
+static const ReedSolomon _rs8(8);
+static const ReedSolomon _rs16(16);
+
+static const ReedSolomon& codec(uint8_t mode) {
+    return _modes[mode].roots == 8 ? _rs8 : _rs16;
+}
+
+static int bitDistance(uint8_t a, uint8_t b) {
+    uint8_t x = a ^ b;
+    int n = 0;
+    while (x) {
+        x &= x - 1;
+        n++;
+    }
+    return n;
+}
+
+size_t fecOverhead(uint8_t mode) {
+    if (mode == FEC_OFF || mode >= FEC_MODES) {
+        return 0;
+    }
+    return 1 + _modes[mode].roots * _modes[mode].depth;
+}
+
+size_t fecMaxData(uint8_t mode) {
+    return FRAME_MAX_PAYLOAD - fecOverhead(mode);
+}
+
+size_t fecEncode(uint8_t mode, const uint8_t* data, size_t len, uint8_t* out) {
+    if (mode >= FEC_MODES || len == 0 || len > fecMaxData(mode)) {
+        return 0;
+    }
+    if (mode == FEC_OFF) {
+        memcpy(out, data, len);
+        return len;
+    }
+
+    const ReedSolomon& rs = codec(mode);
+    size_t roots = _modes[mode].roots;
+    size_t depth = _modes[mode].depth;
+
+    out[0] = _modes[mode].header;
+    memcpy(&out[1], data, len);
+
+    uint8_t* parity_out = &out[1 + len];
+    for (size_t i = 0; i < depth; i++) {
+        uint8_t cw[FRAME_MAX_PAYLOAD];
+        uint8_t parity[FEC_MAX_ROOTS];
+        size_t k = 0;
+        for (size_t j = i; j < len; j += depth) {
+            cw[k++] = data[j];
+        }
+        rs.encode(cw, k, parity);
+        for (size_t j = 0; j < roots; j++) {
+            parity_out[j * depth + i] = parity[j];
+        }
+    }
+    return 1 + len + roots * depth;
+}
+
+int fecDecode(const uint8_t* in, size_t len, uint8_t* out, size_t& out_len) {
+    if (len == 0) {
+        return FEC_UNCODED;
+    }
+
+    uint8_t mode = FEC_OFF;
+    int header_errors = 0;
+    for (uint8_t m = 1; m < FEC_MODES; m++) {
+        int d = bitDistance(in[0], _modes[m].header);
+        if (d <= 1) {
+            mode = m;
+            header_errors = d;
+            break;
+        }
+    }
+    if (mode == FEC_OFF) {
+        return FEC_UNCODED;
+    }
+
+    // A corrected header that fails to decode was probably uncoded data
+    int failed = header_errors ? FEC_UNCODED : FEC_FAILED;
+
+    const ReedSolomon& rs = codec(mode);
+    size_t roots = _modes[mode].roots;
+    size_t depth = _modes[mode].depth;
+    size_t overhead = fecOverhead(mode);
+    if (len <= overhead) {
+        return failed;
+    }
+
+    size_t data_len = len - overhead;
+    const uint8_t* data = &in[1];
+    const uint8_t* parity = &in[1 + data_len];
+    int corrected = header_errors;
+
+    for (size_t i = 0; i < depth; i++) {
+        uint8_t cw[FRAME_MAX_PAYLOAD + FEC_MAX_ROOTS];
+        size_t k = 0;
+        for (size_t j = i; j < data_len; j += depth) {
+            cw[k++] = data[j];
+        }
+        for (size_t j = 0; j < roots; j++) {
+            cw[k + j] = parity[j * depth + i];
+        }
+
+        int n = rs.decode(cw, k + roots);
+        if (n < 0) {
+            return failed;
+        }
+        corrected += n;
+
+        for (size_t j = i, c = 0; j < data_len; j += depth, c++) {
+            out[j] = cw[c];
+        }
+    }
+
+    out_len = data_len;
+    return corrected;
+}
@@ -0,0 +1,105 @@
+#ifndef FEC_H
+#define FEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include "framing.h"
+
+/*
+ * Optional forward error correction for radio payloads, shared by src/Gyro
+ * and src/Radio (keep both copies identical).
+ *
+ * A coded payload is carried inside a normal frame (framing.h):
+ *
+ *   [header][data ...][parity ...]
+ *
+ * The data is split into `depth` interleaved Reed-Solomon codewords over
+ * GF(256): codeword i holds data bytes i, i + depth, i + 2 * depth, ... so a
+ * burst of errors is spread over all of them. The data stays in its original
+ * order (the code is systematic) and the parity follows, interleaved the same
+ * way. Each codeword corrects up to roots / 2 byte errors.
+ *
+ * The header byte selects the mode. Header values are at least 4 bits apart
+ * from each other and from the uncoded message types, so a single bit error
+ * in the header is corrected and uncoded payloads pass through unchanged.
+ *
+ * The radio modem's '+' configuration commands must never be coded.
+ */
+
+#define FEC_OFF         0
+#define FEC_LIGHT       1       // 8 roots x depth 2, corrects 4 bytes per codeword
+#define FEC_MEDIUM      2       // 16 roots x depth 2, corrects 8 bytes per codeword
+#define FEC_HEAVY       3       // 16 roots x depth 4, corrects 8 bytes per codeword
+#define FEC_MODES       4
+
+#define FEC_MAX_ROOTS   16
+
+// fecDecode() results besides the number of corrected bytes
+#define FEC_UNCODED     (-1)    // no FEC header, use the payload as is
+#define FEC_FAILED      (-2)    // too many errors
+
+/**
+ * @brief Systematic Reed-Solomon codec over GF(256), table driven.
+ *
+ * Primitive polynomial 0x11D, first consecutive root alpha^0.
+ */
+class ReedSolomon {
+public:
+    ReedSolomon(uint8_t roots);
+
+    /**
+     * @brief Compute the parity of one codeword.
+     *
+     * @param data    Data bytes, len + roots() must not exceed 255.
+     * @param parity  Output, roots() bytes.
+     */
+    void encode(const uint8_t* data, size_t len, uint8_t* parity) const;
+
+    /**
+     * @brief Correct one codeword in place.
+     *
+     * @param codeword  Data followed by parity.
+     * @param len       Codeword length including parity, at most 255.
+     * @return int Number of corrected bytes, or -1 if uncorrectable.
+     */
+    int decode(uint8_t* codeword, size_t len) const;
+
+    uint8_t roots() const;
+
+private:
+    uint8_t _roots;
+    uint8_t _gen[FEC_MAX_ROOTS + 1];    ///< Generator polynomial, highest power first
+};
+
+/**
+ * @brief Bytes added by a mode (header and parity).
+ */
+size_t fecOverhead(uint8_t mode);
+
+/**
+ * @brief Largest message that still fits one frame in a mode.
+ */
+size_t fecMaxData(uint8_t mode);
+
+/**
+ * @brief Encode a message.
+ *
+ * FEC_OFF copies the message unchanged.
+ *
+ * @param out  Buffer of at least FRAME_MAX_PAYLOAD bytes.
+ * @return size_t Coded length, or 0 if the message is too long for the mode.
+ */
+size_t fecEncode(uint8_t mode, const uint8_t* data, size_t len, uint8_t* out);
+
+/**
+ * @brief Decode a received payload.
+ *
+ * @param in       Frame payload.
+ * @param len      Payload length.
+ * @param out      Buffer of at least FRAME_MAX_PAYLOAD bytes for the corrected message.
+ * @param out_len  Set to the message length on success.
+ * @return int Corrected bytes (>= 0), FEC_UNCODED or FEC_FAILED.
+ */
+int fecDecode(const uint8_t* in, size_t len, uint8_t* out, size_t& out_len);
+
+#endif // FEC_H
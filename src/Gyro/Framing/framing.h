@@ -0,0 +1,112 @@
+#ifndef FRAMING_H
+#define FRAMING_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Radio link framing, shared by src/Gyro and src/Radio (keep both copies identical)
+ *
+ *   [FRAME_START][total length][ptr][payload ...]
+ *
+ * FRAME_START bytes inside the payload are replaced by a COBS style pointer
+ * chain: ptr holds the distance from itself to the first escaped byte, each
+ * escaped byte holds the distance to the next one and the last holds 0.
+ * The radio modem parses this format for its '+' configuration commands, so
+ * the length stays a single byte and payloads are limited to FRAME_MAX_PAYLOAD.
+ *
+ * Nothing here allocates or depends on mbed, so the module builds on the host.
+ */
+
+#define FRAME_START         234
+#define FRAME_OVERHEAD      3
+#define FRAME_MAX_SIZE      255
+#define FRAME_MAX_PAYLOAD   (FRAME_MAX_SIZE - FRAME_OVERHEAD)
+
+/**
+ * @brief Streaming encoder into a fixed buffer.
+ *
+ * The pointer chain is patched as bytes arrive, so each put() is O(1) and no
+ * second pass over the payload is needed.
+ */
+class FrameEncoder {
+public:
+    FrameEncoder();
+
+    void begin();
+
+    /**
+     * @brief Append payload bytes.
+     * @return false (and nothing appended) if the payload would exceed FRAME_MAX_PAYLOAD.
+     */
+    bool put(uint8_t byte);
+    bool put(const uint8_t* data, size_t len);
+
+    /**
+     * @brief Terminate the pointer chain and fill in the length byte.
+     * @return size_t Encoded frame size.
+     */
+    size_t finish();
+
+    const uint8_t* data() const;
+    size_t size() const;
+
+private:
+    uint8_t _buf[FRAME_MAX_SIZE];
+    size_t _len;
+    size_t _last;       ///< Index of the last pointer slot in the chain
+};
+
+/**
+ * @brief One-shot encode.
+ *
+ * @param data  Payload.
+ * @param len   Payload length, at most FRAME_MAX_PAYLOAD.
+ * @param out   Output buffer of at least len + FRAME_OVERHEAD bytes.
+ * @return size_t Frame size, or 0 if the payload is too long.
+ */
+size_t frameEncode(const uint8_t* data, size_t len, uint8_t* out);
+
+/**
+ * @brief Incremental decoder, fed one byte at a time from a UART.
+ *
+ * Escaped bytes are restored as they arrive; a complete payload is available
+ * through payload()/length() after feed() returns FrameDecoder::Frame and
+ * stays valid until the next byte is fed.
+ */
+class FrameDecoder {
+public:
+    enum Result {
+        None,       ///< Need more bytes
+        Frame,      ///< A complete payload is ready
+        Error,      ///< Malformed frame dropped, decoder resynchronised
+    };
+
+    FrameDecoder();
+
+    Result feed(uint8_t byte);
+    void reset();
+
+    const uint8_t* payload() const;
+    size_t length() const;
+
+    uint32_t getFrames() const;      ///< Frames decoded
+    uint32_t getErrors() const;      ///< Malformed frames dropped
+    uint32_t getSkipped() const;     ///< Bytes discarded while waiting for FRAME_START
+
+private:
+    enum State { WaitStart, WaitLength, WaitPointer, Body };
+
+    State _state;
+    uint8_t _buf[FRAME_MAX_PAYLOAD];
+    size_t _total;      ///< Frame length from the header
+    size_t _count;      ///< Frame bytes received so far
+    size_t _skip;       ///< Bytes until the next escaped byte, 0 if none
+    size_t _len;        ///< Length of the last completed payload
+
+    uint32_t _frames;
+    uint32_t _errors;
+    uint32_t _skipped;
+};
+
+#endif // FRAMING_H
@@ -0,0 +1,90 @@
+#ifndef RADIO_PROTOCOL_H
+#define RADIO_PROTOCOL_H
+
+/*
+ * Message layout carried inside radio frames (framing.h) on the 434 MHz link.
+ * Shared by src/Gyro and src/Radio, keep both copies identical.
+ * Any message may be wrapped in forward error correction, see fec.h.
+ *
+ * Telemetry (RADIO_MSG_TELEMETRY), little endian:
+ *   u8   type
+ *   u8   field mask (RADIO_TLM_*)
+ *   u32  timestamp (ms)
+ *   u8   flight state
+ *   [RADIO_TLM_QUAT]  i16 w, x, y, z        raw BNO055 quaternion
+ *   [RADIO_TLM_ENC]   i32 enc1, enc2        encoder counts
+ *   [RADIO_TLM_ACC]   i16 x, y, z           raw BNO055 acceleration
+ *   u16  CRC-16/CCITT-FALSE over everything before it
+ *
+ * Optional fields appear in mask bit order. Lower bits have higher priority
+ * and are the last to be dropped when the airtime budget is tight.
+ *
+ * Command (RADIO_MSG_COMMAND), ground -> flight computer:
+ *   u8   type
+ *   u8   sequence number
+ *   ...  command text (not null terminated)
+ *   u16  CRC
+ *
+ * Acknowledgement (RADIO_MSG_ACK), flight computer -> ground:
+ *   u8   type
+ *   u8   sequence number being acknowledged
+ *   u8   status (RADIO_ACK_*)
+ *   u16  CRC
+ *
+ * Log download (download.h), all ending in a u16 CRC:
+ *   RADIO_MSG_LOG_INFO  ground -> flight: type
+ *                       flight -> ground: type, u32 log size in bytes
+ *   RADIO_MSG_LOG_READ  ground -> flight: type, u32 base offset, u32 chunk mask
+ *                       (bit i requests the chunk at base + i * DL_CHUNK_SIZE)
+ *   RADIO_MSG_LOG_DATA  flight -> ground: type, u32 offset, up to DL_CHUNK_SIZE bytes
+ *
+ * TDMA beacon (RADIO_MSG_BEACON), ground -> all flight computers (tdma.h):
+ *   u8   type
+ *   u8   sequence number
+ *   u8   node slots
+ *   u16  ground slot length (ms)
+ *   u16  node slot length (ms)
+ *   u16  CRC
+ *
+ * Node envelope (RADIO_MSG_NODE), either direction when node IDs are in use:
+ *   u8   type
+ *   u8   node ID in the low nibble, its complement in the high nibble
+ *   ...  any message above
+ * Flight computers wrap what they send with their own ID, the ground station
+ * wraps what it sends with the destination's. Messages without an envelope
+ * are accepted by every node.
+ */
+
+// Link timing, set up by setup() in src/Gyro/main.cpp
+#ifndef RADIO_AIR_BPS
+#define RADIO_AIR_BPS           38400   // on-air data rate (+srate38400)
+#endif
+#define RADIO_AIR_OVERHEAD      12      // per packet modem preamble, sync word, length and CRC
+#define RADIO_UART_BAUD         115200  // host to modem UART
+
+#define RADIO_MSG_TELEMETRY     0x20
+#define RADIO_MSG_COMMAND       0x30
+#define RADIO_MSG_ACK           0x31
+#define RADIO_MSG_LOG_INFO      0x50
+#define RADIO_MSG_LOG_READ      0x51
+#define RADIO_MSG_LOG_DATA      0x52
+#define RADIO_MSG_BEACON        0x40
+#define RADIO_MSG_NODE          0x60
+
+#define RADIO_ACK_OK            0x00    // command executed
+#define RADIO_ACK_CORRUPT       0x01    // NAK: CRC failed, retransmit now
+#define RADIO_ACK_REJECTED      0x02    // NAK: command unknown or not allowed, do not retry
+
+#define RADIO_TLM_QUAT          0x01
+#define RADIO_TLM_ENC           0x02
+#define RADIO_TLM_ACC           0x04
+
+#define RADIO_TLM_BASE_SIZE     7       // type, mask, timestamp, state
+#define RADIO_TLM_QUAT_SIZE     8
+#define RADIO_TLM_ENC_SIZE      8
+#define RADIO_TLM_ACC_SIZE      6
+#define RADIO_TLM_CRC_SIZE      2
+#define RADIO_TLM_MAX_SIZE      (RADIO_TLM_BASE_SIZE + RADIO_TLM_QUAT_SIZE + RADIO_TLM_ENC_SIZE + \
+                                 RADIO_TLM_ACC_SIZE + RADIO_TLM_CRC_SIZE)
+
+#endif // RADIO_PROTOCOL_H
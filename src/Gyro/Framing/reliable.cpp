@@ -0,0 +1,230 @@
+#include "reliable.h"
+#include "crc.h"
+#include <cstring>
+
+static void putCrc(uint8_t* msg, size_t len) {
+    uint16_t crc = crc16(msg, len);
+    msg[len] = static_cast<uint8_t>(crc & 0xFF);
+    msg[len + 1] = static_cast<uint8_t>(crc >> 8);
+}
+
+static bool checkCrc(const uint8_t* msg, size_t len) {
+    if (len < RELIABLE_CRC_SIZE) {
+        return false;
+    }
+    uint16_t crc = msg[len - 2] | (msg[len - 1] << 8);
+    return crc16(msg, len - 2) == crc;
+}
+
+size_t reliableAck(uint8_t seq, uint8_t status, uint8_t* out) {
+    out[0] = RADIO_MSG_ACK;
+    out[1] = seq;
+    out[2] = status;
+    putCrc(out, 3);
+    return RELIABLE_ACK_SIZE;
+}
+
+// ===== SENDER =====
+
+ReliableSender::ReliableSender(uint8_t first_seq)
+    : _len(0),
+      _seq(first_seq - 1),
+      _outcome(Delivered),
+      _due(false),
+      _tries(0),
+      _start(0),
+      _sent_at(0),
+      _deadline(0),
+      _latency(0),
+      _has_rtt(false),
+      _srtt(0),
+      _rttvar(0),
+      _rto(RELIABLE_RTO_INITIAL_MS),
+      _base_rto(RELIABLE_RTO_INITIAL_MS),
+      _transmissions(0),
+      _retransmissions(0),
+      _delivered(0),
+      _failed(0)
+{
+}
+
+bool ReliableSender::send(const uint8_t* data, size_t len, uint32_t now_ms) {
+    if (busy() || len > RELIABLE_MAX_COMMAND) {
+        return false;
+    }
+
+    _seq++;
+    _msg[0] = RADIO_MSG_COMMAND;
+    _msg[1] = _seq;
+    memcpy(&_msg[RELIABLE_HEADER_SIZE], data, len);
+    putCrc(_msg, RELIABLE_HEADER_SIZE + len);
+    _len = RELIABLE_HEADER_SIZE + len + RELIABLE_CRC_SIZE;
+
+    _outcome = Pending;
+    _due = true;
+    _tries = 0;
+    _start = now_ms;
+    _rto = _base_rto;   // backoff only applies to the command that lost frames
+    return true;
+}
+
+bool ReliableSender::busy() const {
+    return _outcome == Pending;
+}
+
+const uint8_t* ReliableSender::poll(uint32_t now_ms, size_t& len) {
+    if (!busy()) {
+        return nullptr;
+    }
+
+    if (!_due) {
+        if (static_cast<int32_t>(now_ms - _deadline) < 0) {
+            return nullptr;
+        }
+        // Timed out: back off before the next attempt
+        _rto = (_rto * 2 > RELIABLE_RTO_MAX_MS) ? RELIABLE_RTO_MAX_MS : _rto * 2;
+    }
+
+    if (_tries >= RELIABLE_MAX_TRIES) {
+        _outcome = Failed;
+        _failed++;
+        return nullptr;
+    }
+    if (_tries > 0) {
+        _retransmissions++;
+    }
+
+    _due = false;
+    _tries++;
+    _transmissions++;
+    _sent_at = now_ms;
+    _deadline = now_ms + _rto;
+
+    len = _len;
+    return _msg;
+}
+
+uint32_t ReliableSender::timeUntilNext(uint32_t now_ms) const {
+    if (!busy()) {
+        return UINT32_MAX;
+    }
+    if (_due) {
+        return 0;
+    }
+    int32_t left = static_cast<int32_t>(_deadline - now_ms);
+    return left > 0 ? static_cast<uint32_t>(left) : 0;
+}
+
+bool ReliableSender::onAck(const uint8_t* msg, size_t len, uint32_t now_ms) {
+    if (len != RELIABLE_ACK_SIZE || msg[0] != RADIO_MSG_ACK || !checkCrc(msg, len)) {
+        return false;
+    }
+    if (!busy() || _due || msg[1] != _seq) {
+        return false;   // late ACK for an older command
+    }
+
+    uint8_t status = msg[2];
+    if (status == RADIO_ACK_CORRUPT) {
+        // Retransmit immediately; the link is alive, so no backoff
+        _due = true;
+        return false;
+    }
+
+    // Karn's rule: only unambiguous round trips update the estimate
+    if (_tries == 1) {
+        sample(now_ms - _sent_at);
+    }
+
+    _latency = now_ms - _start;
+    _outcome = (status == RADIO_ACK_OK) ? Delivered : Rejected;
+    _delivered++;
+    return true;
+}
+
+/**
+ * RFC 6298 smoothed round trip time and variance.
+ */
+void ReliableSender::sample(uint32_t rtt) {
+    if (!_has_rtt) {
+        _srtt = rtt;
+        _rttvar = rtt / 2;
+        _has_rtt = true;
+    } else {
+        uint32_t err = (_srtt > rtt) ? _srtt - rtt : rtt - _srtt;
+        _rttvar = (3 * _rttvar + err) / 4;
+        _srtt = (7 * _srtt + rtt) / 8;
+    }
+
+    uint32_t rto = _srtt + 4 * _rttvar;
+    if (rto < RELIABLE_RTO_MIN_MS) rto = RELIABLE_RTO_MIN_MS;
+    if (rto > RELIABLE_RTO_MAX_MS) rto = RELIABLE_RTO_MAX_MS;
+    _rto = rto;
+    _base_rto = rto;
+}
+
+ReliableSender::Outcome ReliableSender::getOutcome() const { return _outcome; }
+uint8_t ReliableSender::getSequence() const { return _seq; }
+uint32_t ReliableSender::getLatency() const { return _latency; }
+uint8_t ReliableSender::getTries() const { return _tries; }
+uint32_t ReliableSender::getRto() const { return _rto; }
+uint32_t ReliableSender::getSrtt() const { return _srtt; }
+uint32_t ReliableSender::getTransmissions() const { return _transmissions; }
+uint32_t ReliableSender::getRetransmissions() const { return _retransmissions; }
+uint32_t ReliableSender::getDelivered() const { return _delivered; }
+uint32_t ReliableSender::getFailed() const { return _failed; }
+
+// ===== RECEIVER =====
+
+ReliableReceiver::ReliableReceiver()
+    : _len(0), _seq(0), _status(RADIO_ACK_OK), _next(0), _duplicates(0), _corrupt(0) {
+    memset(_history, 0, sizeof(_history));
+    _text[0] = 0;
+}
+
+ReliableReceiver::Result ReliableReceiver::accept(const uint8_t* msg, size_t len, uint32_t now_ms) {
+    if (len < RELIABLE_HEADER_SIZE || msg[0] != RADIO_MSG_COMMAND) {
+        return Invalid;
+    }
+
+    _seq = msg[1];
+    if (len < RELIABLE_HEADER_SIZE + RELIABLE_CRC_SIZE || !checkCrc(msg, len)) {
+        _status = RADIO_ACK_CORRUPT;
+        _corrupt++;
+        return Corrupt;
+    }
+
+    for (size_t i = 0; i < RELIABLE_HISTORY; i++) {
+        const Entry& e = _history[i];
+        if (e.valid && e.seq == _seq && now_ms - e.time < RELIABLE_DUP_WINDOW_MS) {
+            _status = e.status;
+            _duplicates++;
+            return Duplicate;
+        }
+    }
+
+    _len = len - RELIABLE_HEADER_SIZE - RELIABLE_CRC_SIZE;
+    memcpy(_text, &msg[RELIABLE_HEADER_SIZE], _len);
+    _text[_len] = 0;
+
+    Entry& e = _history[_next];
+    e.valid = false;    // filled in by complete()
+    e.seq = _seq;
+    e.time = now_ms;
+    return New;
+}
+
+void ReliableReceiver::complete(uint8_t status) {
+    _status = status;
+    _history[_next].status = status;
+    _history[_next].valid = true;
+    _next = (_next + 1) % RELIABLE_HISTORY;
+}
+
+size_t ReliableReceiver::ack(uint8_t* out) const {
+    return reliableAck(_seq, _status, out);
+}
+
+const char* ReliableReceiver::payload() const { return _text; }
+size_t ReliableReceiver::length() const { return _len; }
+uint32_t ReliableReceiver::getDuplicates() const { return _duplicates; }
+uint32_t ReliableReceiver::getCorrupt() const { return _corrupt; }
@@ -0,0 +1,198 @@
+#ifndef RELIABLE_H
+#define RELIABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include "framing.h"
+#include "radio_protocol.h"
+
+/*
+ * Sequence numbered radio commands with ACK/NAK, shared by src/Gyro and
+ * src/Radio (keep both copies identical).
+ *
+ * The ground station keeps one command in flight (stop and wait). Its
+ * retransmit timeout adapts to the measured round trip time as in RFC 6298,
+ * using Karn's rule so retransmitted commands never produce RTT samples.
+ * The flight computer remembers recently executed sequence numbers and
+ * answers duplicates with the original status instead of executing again.
+ *
+ * All times are milliseconds supplied by the caller, so the module has no
+ * mbed dependency and runs unchanged in the host simulation.
+ */
+
+#define RELIABLE_HEADER_SIZE    2       // type, sequence
+#define RELIABLE_CRC_SIZE       2
+#define RELIABLE_ACK_SIZE       5
+#define RELIABLE_MAX_COMMAND    (FRAME_MAX_PAYLOAD - RELIABLE_HEADER_SIZE - RELIABLE_CRC_SIZE)
+
+#ifndef RELIABLE_RTO_INITIAL_MS
+#define RELIABLE_RTO_INITIAL_MS 500
+#endif
+
+#ifndef RELIABLE_RTO_MIN_MS
+#define RELIABLE_RTO_MIN_MS     100
+#endif
+
+#ifndef RELIABLE_RTO_MAX_MS
+#define RELIABLE_RTO_MAX_MS     4000
+#endif
+
+#ifndef RELIABLE_MAX_TRIES
+#define RELIABLE_MAX_TRIES      8
+#endif
+
+#ifndef RELIABLE_HISTORY
+#define RELIABLE_HISTORY        8
+#endif
+
+// Executed sequence numbers older than this are forgotten, so a restarted
+// ground station reusing a sequence number is not mistaken for a duplicate
+#ifndef RELIABLE_DUP_WINDOW_MS
+#define RELIABLE_DUP_WINDOW_MS  30000
+#endif
+
+/**
+ * @brief Build an acknowledgement message.
+ *
+ * @param out  Buffer of at least RELIABLE_ACK_SIZE bytes.
+ * @return size_t Message length.
+ */
+size_t reliableAck(uint8_t seq, uint8_t status, uint8_t* out);
+
+/**
+ * @brief Ground side: sends one command at a time until it is acknowledged.
+ */
+class ReliableSender {
+public:
+    enum Outcome {
+        Pending,        ///< Still waiting for an ACK
+        Delivered,      ///< ACK received
+        Rejected,       ///< NAK received, the command was not executed
+        Failed,         ///< Gave up after RELIABLE_MAX_TRIES transmissions
+    };
+
+    /**
+     * @param first_seq  Initial sequence number, ideally random per boot.
+     */
+    ReliableSender(uint8_t first_seq = 0);
+
+    /**
+     * @brief Queue a new command. It is transmitted by the next poll().
+     * @return false if a command is still in flight or len is too long.
+     */
+    bool send(const uint8_t* data, size_t len, uint32_t now_ms);
+
+    bool busy() const;
+
+    /**
+     * @brief Returns the message to transmit now (first send or retransmit).
+     *
+     * @param now_ms  Current time.
+     * @param len     Set to the message length.
+     * @return const uint8_t* Message to frame and send, nullptr if nothing is due.
+     */
+    const uint8_t* poll(uint32_t now_ms, size_t& len);
+
+    /**
+     * @brief Milliseconds until poll() has something to send, or UINT32_MAX if idle.
+     */
+    uint32_t timeUntilNext(uint32_t now_ms) const;
+
+    /**
+     * @brief Handle a received RADIO_MSG_ACK message.
+     * @return true if it completed the command in flight.
+     */
+    bool onAck(const uint8_t* msg, size_t len, uint32_t now_ms);
+
+    Outcome getOutcome() const;     ///< Result of the last finished (or current) command
+    uint8_t getSequence() const;    ///< Sequence number of the last command
+    uint32_t getLatency() const;    ///< Send to ACK time of the last delivered command
+    uint8_t getTries() const;       ///< Transmissions used by the last command
+    uint32_t getRto() const;
+    uint32_t getSrtt() const;
+
+    uint32_t getTransmissions() const;
+    uint32_t getRetransmissions() const;
+    uint32_t getDelivered() const;
+    uint32_t getFailed() const;
+
+private:
+    void sample(uint32_t rtt);
+
+    uint8_t _msg[FRAME_MAX_PAYLOAD];
+    size_t _len;
+    uint8_t _seq;
+    Outcome _outcome;
+    bool _due;              ///< Transmit on the next poll() without waiting
+    uint8_t _tries;
+    uint32_t _start;
+    uint32_t _sent_at;
+    uint32_t _deadline;
+    uint32_t _latency;
+
+    bool _has_rtt;
+    uint32_t _srtt;
+    uint32_t _rttvar;
+    uint32_t _rto;
+    uint32_t _base_rto;     ///< RTO from the RTT estimate, without backoff
+
+    uint32_t _transmissions;
+    uint32_t _retransmissions;
+    uint32_t _delivered;
+    uint32_t _failed;
+};
+
+/**
+ * @brief Flight side: validates commands and suppresses duplicates.
+ */
+class ReliableReceiver {
+public:
+    enum Result {
+        New,            ///< Execute payload(), then call complete()
+        Duplicate,      ///< Already executed, reply with ack() only
+        Corrupt,        ///< CRC failed, reply with ack() (a NAK)
+        Invalid,        ///< Not a command message
+    };
+
+    ReliableReceiver();
+
+    Result accept(const uint8_t* msg, size_t len, uint32_t now_ms);
+
+    /**
+     * @brief Record the status of the command returned as New.
+     */
+    void complete(uint8_t status);
+
+    /**
+     * @brief Build the reply for the last accepted message.
+     * @param out  Buffer of at least RELIABLE_ACK_SIZE bytes.
+     */
+    size_t ack(uint8_t* out) const;
+
+    const char* payload() const;    ///< Null terminated command text
+    size_t length() const;
+
+    uint32_t getDuplicates() const;
+    uint32_t getCorrupt() const;
+
+private:
+    struct Entry {
+        bool valid;
+        uint8_t seq;
+        uint8_t status;
+        uint32_t time;
+    };
+
+    char _text[RELIABLE_MAX_COMMAND + 1];
+    size_t _len;
+    uint8_t _seq;
+    uint8_t _status;
+
+    Entry _history[RELIABLE_HISTORY];
+    size_t _next;
+
+    uint32_t _duplicates;
+    uint32_t _corrupt;
+};
+
+#endif // RELIABLE_H
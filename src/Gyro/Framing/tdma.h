@@ -0,0 +1,179 @@
+#ifndef TDMA_H
+#define TDMA_H
+
+#include <cstddef>
+#include <cstdint>
+#include "framing.h"
+#include "radio_protocol.h"
+
+/*
+ * Time division of the radio channel between several flight computers,
+ * shared by src/Gyro and src/Radio (keep both copies identical).
+ *
+ * The ground station sends a beacon at the start of every superframe:
+ *
+ *   | ground slot          | node 1 | node 2 | ... | node N | ground slot ...
+ *     beacon, uplink
+ *
+ * The ground slot holds the beacon, sent one guard time after the slot
+ * starts, and at most one command and one download request. Every node then owns one slot, numbered by its node ID, and only
+ * transmits inside it with a guard time at both ends. Slots bound the time
+ * on air: a node hands its frame to the modem one UART transfer early, while
+ * the previous slot's owner is still transmitting.
+ *
+ * Nodes time their slots from the beacon. A late reading of the beacon (the
+ * receive loop polls the UART) only ever delays it, so an early reading
+ * replaces the estimate and late ones are blended in slowly. Without beacons
+ * a node keeps the last schedule for TDMA_HOLDOVER_MS, then transmits freely
+ * as it did before TDMA.
+ *
+ * Times are milliseconds supplied by the caller, as in reliable.h.
+ */
+
+#define TDMA_MAX_NODES      8       // node IDs 1..8, 0 means unassigned
+#define TDMA_BEACON_SIZE    9
+#define TDMA_NODE_OVERHEAD  2       // RADIO_MSG_NODE envelope
+
+#ifndef TDMA_GUARD_MS
+#define TDMA_GUARD_MS       3       // idle time at both ends of every slot
+#endif
+
+// How often nodes look at the UART, so the latest start time in a slot
+// must be at least this far after the earliest
+#ifndef TDMA_POLL_MS
+#define TDMA_POLL_MS        2
+#endif
+
+#ifndef TDMA_HOLDOVER_MS
+#define TDMA_HOLDOVER_MS    10000   // ~1 ms of drift between 50 ppm crystals
+#endif
+
+#ifndef TDMA_UPLINK_MAX
+#define TDMA_UPLINK_MAX     48      // longest command text the ground slot is sized for
+#endif
+
+static_assert(TDMA_MAX_NODES <= 15, "node IDs must fit a nibble");
+
+/**
+ * @brief Time a frame spends on air, rounded up.
+ *
+ * @param air_bytes  On-air size including RADIO_AIR_OVERHEAD.
+ */
+uint32_t tdmaAirMs(size_t air_bytes);
+
+/**
+ * @brief Time to hand a frame to the modem over the UART, rounded down.
+ */
+uint32_t tdmaUartMs(size_t air_bytes);
+
+/**
+ * @brief On-air size of a message sent with the given FEC mode.
+ */
+size_t tdmaAirBytes(size_t msg_len, uint8_t fec);
+
+/**
+ * @param out  Buffer of at least len + TDMA_NODE_OVERHEAD bytes.
+ * @return size_t Message length, 0 if it would not fit a frame.
+ */
+size_t nodeWrap(uint8_t node, const uint8_t* msg, size_t len, uint8_t* out);
+
+/**
+ * @brief Strip the node envelope, if there is one.
+ *
+ * @param msg   Message, advanced past the envelope.
+ * @param len   Length, reduced by the envelope.
+ * @param node  Node ID, 0 for messages without an envelope.
+ * @return false if the node ID check failed.
+ */
+bool nodeUnwrap(const uint8_t*& msg, size_t& len, uint8_t& node);
+
+/**
+ * @brief Superframe layout announced by the ground station.
+ */
+struct TdmaSchedule {
+    uint8_t nodes;
+    uint16_t ground_ms;
+    uint16_t slot_ms;
+
+    uint32_t period() const;
+
+    /**
+     * @brief Ground slot that fits a beacon, a command and a download request.
+     */
+    static uint16_t groundSlot(uint8_t fec);
+
+    /**
+     * @brief Node slot that fits a full telemetry frame.
+     */
+    static uint16_t nodeSlot(uint8_t fec);
+};
+
+/**
+ * @param out  Buffer of at least TDMA_BEACON_SIZE bytes.
+ */
+size_t tdmaPackBeacon(const TdmaSchedule& schedule, uint8_t seq, uint8_t* out);
+
+/**
+ * @return true if msg is a valid beacon.
+ */
+bool tdmaParseBeacon(const uint8_t* msg, size_t len, TdmaSchedule& schedule, uint8_t& seq);
+
+/**
+ * @brief Flight computer side: follows the beacons and gates transmissions to the node's slot.
+ */
+class TdmaNode {
+public:
+    TdmaNode();
+
+    /**
+     * @brief Set the node ID (0 disables TDMA) and forget the schedule.
+     */
+    void setNode(uint8_t node, uint32_t now_ms);
+    uint8_t getNode() const;
+
+    /**
+     * @brief Resync from a beacon.
+     *
+     * @param delay_ms  Time from the ground station sending the beacon to now,
+     *                  excluding the receive loop's own delay.
+     * @return true if msg was a valid beacon.
+     */
+    bool onBeacon(const uint8_t* msg, size_t len, uint32_t now_ms, uint32_t delay_ms);
+
+    /**
+     * @brief Milliseconds until a frame may be handed to the modem, 0 for now.
+     *
+     * @param air_bytes  On-air size of the frame, see tdmaAirBytes().
+     */
+    uint32_t timeUntilSlot(uint32_t now_ms, size_t air_bytes) const;
+
+    /**
+     * @brief Record a transmission so the next one waits for it to finish.
+     */
+    void onTransmit(uint32_t now_ms, size_t air_bytes);
+
+    /**
+     * @brief On-air bytes that fit in one slot, 0 without a schedule.
+     */
+    size_t getSlotBytes(uint32_t now_ms) const;
+
+    bool isSynced(uint32_t now_ms) const;
+    const TdmaSchedule& getSchedule() const;
+    uint32_t getBeacons() const;
+    uint32_t getMissed() const;         ///< Beacons not received while synced
+    int32_t getError() const;           ///< Last beacon arrival relative to prediction (ms)
+
+private:
+    uint8_t _node;
+    TdmaSchedule _schedule;
+    bool _synced;
+    uint32_t _start;            ///< Estimated start of a superframe
+    uint32_t _last_beacon;
+    uint32_t _busy_until;
+    uint8_t _seq;
+    uint32_t _beacons;
+    uint32_t _missed;
+    int32_t _error;
+};
+
+#endif // TDMA_H
@@ -0,0 +1,89 @@
+#include "log_index.h"
+
+LogIndex::LogIndex(flash* f, uint32_t start, uint32_t end, uint32_t index_addr, size_t (*entry_size)(uint8_t))
+    : _flash(f),
+      _start(start),
+      _end(end),
+      _indexAddr(index_addr),
+      _entrySize(entry_size),
+      _indexed(0),
+      _walked(0)
+{
+}
+
+uint32_t LogIndex::readSlot(uint32_t slot) {
+    uint32_t addr = 0xFFFFFFFF;
+    _flash->read(_indexAddr + slot * 4, reinterpret_cast<uint8_t*>(&addr), sizeof(addr));
+    return addr;
+}
+
+void LogIndex::writeSlot(uint32_t slot, uint32_t addr) {
+    _flash->write(_indexAddr + slot * 4, reinterpret_cast<const uint8_t*>(&addr), sizeof(addr));
+}
+
+// A slot cut short by a reset points outside its sector
+bool LogIndex::validSlot(uint32_t slot, uint32_t addr) const {
+    uint32_t base = _start + slot * LOG_INDEX_SPAN;
+    return addr >= base && addr < base + LOG_INDEX_SPAN && addr < _end;
+}
+
+uint32_t LogIndex::findEnd() {
+    const uint32_t slots = (_end - _start + LOG_INDEX_SPAN - 1) / LOG_INDEX_SPAN;
+
+    // First erased slot
+    uint32_t low = 0, high = slots;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (readSlot(mid) != 0xFFFFFFFF) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    _indexed = low;
+
+    // Walk from the newest boundary that is whole
+    uint32_t addr = _start;
+    for (uint32_t slot = _indexed; slot > 0; slot--) {
+        uint32_t boundary = readSlot(slot - 1);
+        if (validSlot(slot - 1, boundary)) {
+            addr = boundary;
+            break;
+        }
+    }
+
+    const uint32_t from = addr;
+    uint8_t page[256];
+    uint32_t page_addr = _end;
+    while (addr < _end) {
+        if (addr < page_addr || addr >= page_addr + sizeof(page)) {
+            page_addr = addr;
+            _flash->read(page_addr, page, _end - addr < sizeof(page) ? _end - addr : sizeof(page));
+        }
+        uint8_t flags = page[addr - page_addr];
+        if (flags == 0xFF) {
+            _walked = addr - from;
+            return addr;
+        }
+        size_t size = _entrySize(flags);
+        if (size == 0) {
+            break;
+        }
+        noteEntry(addr);
+        addr += size;
+    }
+    _walked = addr - from;
+    return _end;
+}
+
+void LogIndex::noteEntry(uint32_t addr) {
+    uint32_t slot = (addr - _start) / LOG_INDEX_SPAN;
+    if (slot >= _indexed) {
+        writeSlot(slot, addr);
+        _indexed = slot + 1;
+    }
+}
+
+uint32_t LogIndex::getWalked() const {
+    return _walked;
+}
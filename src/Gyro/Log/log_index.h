@@ -0,0 +1,75 @@
+#ifndef LOG_INDEX_H
+#define LOG_INDEX_H
+
+#include "mbed.h"
+#include "flash.h"
+
+/*
+ * Entry boundaries of the flight log, kept in a reserved W25Q32JV sector so
+ * the end of the log is found without walking it from the start.
+ *
+ * The log area is split into 4 KB sectors. Slot k, a u32 at
+ * LOG_INDEX_ADDR + 4 * k, holds the address of an entry that starts in log
+ * sector k, programmed when the first entry there is written. Entries are
+ * shorter than a sector, so every written sector has one and the
+ * programmed slots are a prefix: findEnd() binary-searches them for the
+ * last, then walks the entries from that address, at most one sector and a
+ * bit. A reset between an entry and its slot only lengthens that walk; the
+ * walk programs the missing slots it passes. A log written before the index
+ * existed is walked from the start once, which fills it in.
+ *
+ * `clear` erases the index with the log. The caller serialises access to
+ * the flash, as for the log.
+ */
+
+#define LOG_INDEX_ADDR      0x3FD000    // the sector before the config
+#define LOG_INDEX_SIZE      0x1000
+#define LOG_INDEX_SPAN      0x1000      // log bytes per slot
+
+class LogIndex {
+public:
+    /**
+     * @param f             Flash holding the log and the index.
+     * @param start         First byte of the log area.
+     * @param end           Byte after the log area, at most
+     *                      LOG_INDEX_SIZE / 4 spans from start.
+     * @param index_addr    Sector holding the slots.
+     * @param entry_size    Size of an entry from its flag byte, 0 for a
+     *                      byte that starts no entry.
+     */
+    LogIndex(flash* f, uint32_t start, uint32_t end, uint32_t index_addr, size_t (*entry_size)(uint8_t));
+
+    /**
+     * @brief Find the first erased entry of the log.
+     *
+     * @return Its address, or the end of the log area if the log is full or
+     *         the walk met a byte that starts no entry.
+     */
+    uint32_t findEnd();
+
+    /**
+     * @brief Record an entry just written at addr, programs its sector's
+     * slot if it is the first entry there.
+     */
+    void noteEntry(uint32_t addr);
+
+    /**
+     * @brief Bytes of log the last findEnd() walked.
+     */
+    uint32_t getWalked() const;
+
+private:
+    uint32_t readSlot(uint32_t slot);
+    void writeSlot(uint32_t slot, uint32_t addr);
+    bool validSlot(uint32_t slot, uint32_t addr) const;
+
+    flash* _flash;
+    const uint32_t _start;
+    const uint32_t _end;
+    const uint32_t _indexAddr;
+    size_t (*const _entrySize)(uint8_t);
+    uint32_t _indexed;      // slots programmed, a prefix
+    uint32_t _walked;
+};
+
+#endif // LOG_INDEX_H
@@ -1,5 +1,21 @@
 #include "Servo.h"
 #include "mbed.h"
+#include "pinmap.h"
+#include "PeripheralPins.h"
+
+struct ProtocolTiming {
+    int period_us;
+    float min_us;
+    float max_us;
+};
+
+// Indexed by ServoProtocol
+static const ProtocolTiming timings[] = {
+    {20000, 1000.0f, 2000.0f},
+    {2500,  1000.0f, 2000.0f},
+    {1000,  125.0f,  250.0f},
+    {250,   5.0f,    25.0f},
+};
 
 static float clamp(float value, float min, float max) {
     if (value < min) return min;
@@ -7,15 +23,76 @@ static float clamp(float value, float min, float max) {
     return value;
 }
 
-Servo::Servo(PinName pin) : _pwm(pin) {
+Servo::Servo(PinName pin, ServoProtocol protocol)
+    : _pwm(pin),
+      _protocol(protocol),
+      _timer(nullptr),
+      _ccr(nullptr),
+      _ticks_per_us(1.0f),
+      _latency_us(0.0f),
+      _max_latency_us(0.0f) {
     calibrate();     // Use default calibration
-    _pwm.period_ms(20);
+    const ProtocolTiming& timing = timings[static_cast<int>(protocol)];
+    _pwm.period_us(timing.period_us);
+
+    if (protocol != ServoProtocol::Pwm50) {
+        // The first write configures and enables the output channel
+        _pwm.pulsewidth_us(static_cast<int>(timing.min_us));
+
+        int peripheral = pinmap_find_peripheral(pin, PinMap_PWM);
+        int function = pinmap_find_function(pin, PinMap_PWM);
+        _timer = reinterpret_cast<TIM_TypeDef*>(peripheral);
+        _ccr = &_timer->CCR1 + (STM_PIN_CHANNEL(function) - 1);
+        setupTimer(timing.period_us);
+    }
+}
+
+void Servo::setupTimer(int period_us) {
+    // PwmOut has set the timer up with a 1 us tick, so the prescaler gives the
+    // timer clock in MHz. Divide it as little as the counter allows instead,
+    // Multishot needs better than 1 us.
+    float mhz = static_cast<float>(_timer->PSC + 1);
+    uint32_t ticks = static_cast<uint32_t>(period_us * mhz);
+    uint32_t prescaler = (ticks + 0xFFFF) / 0x10000;
+
+    _timer->CR1 &= ~TIM_CR1_CEN;
+    _timer->PSC = prescaler - 1;
+    _timer->ARR = ticks / prescaler - 1;
+    _ticks_per_us = mhz / prescaler;
+    *_ccr = static_cast<uint32_t>(timings[static_cast<int>(_protocol)].min_us * _ticks_per_us);
+    _timer->EGR = TIM_EGR_UG;
+    _timer->CR1 |= TIM_CR1_CEN;
 }
 
 void Servo::write(float percent) {
-    float offset = _range_us * 2.0f * (percent - 0.5f);
-    _pwm.pulsewidth_us(1500 + (int)clamp(offset, -_range_us, _range_us));
     _p = clamp(percent, 0.0f, 1.0f);
+
+    if (!_timer) {
+        float offset = _range_us * 2.0f * (percent - 0.5f);
+        _pwm.pulsewidth_us(1500 + (int)clamp(offset, -_range_us, _range_us));
+        return;
+    }
+
+    const ProtocolTiming& timing = timings[static_cast<int>(_protocol)];
+    float pulse_us = timing.min_us + _p * (timing.max_us - timing.min_us);
+    uint32_t compare = static_cast<uint32_t>(pulse_us * _ticks_per_us);
+
+    core_util_critical_section_enter();
+    uint32_t count = _timer->CNT;
+    bool low = count >= *_ccr;
+    *_ccr = compare;            // preloaded, takes effect at the next update event
+    if (low) {
+        // Restart the frame: loads the new width and starts the pulse now
+        _timer->EGR = TIM_EGR_UG;
+        _latency_us = 0.0f;
+    } else {
+        _latency_us = (_timer->ARR + 1 - count) / _ticks_per_us;
+    }
+    core_util_critical_section_exit();
+
+    if (_latency_us > _max_latency_us) {
+        _max_latency_us = _latency_us;
+    }
 }
 
 void Servo::position(float degrees) {
@@ -32,6 +109,18 @@ float Servo::read() {
     return _p;
 }
 
+ServoProtocol Servo::protocol() const {
+    return _protocol;
+}
+
+float Servo::latency_us() const {
+    return _latency_us;
+}
+
+float Servo::max_latency_us() const {
+    return _max_latency_us;
+}
+
 Servo& Servo::operator= (float percent) {
     write(percent);
     return *this;
@@ -3,6 +3,23 @@
 
 #include "mbed.h"
 
+/** Output timing. Pwm50 is a standard servo; the others are ESC protocols
+ *  with a faster frame and a pulse that starts as soon as it is written
+ *  (see Servo::write)
+ *
+ *  protocol     frame     pulse
+ *  Pwm50        20 ms     1000-2000 us
+ *  Pwm400       2.5 ms    1000-2000 us
+ *  OneShot125   1 ms      125-250 us
+ *  Multishot    250 us    5-25 us
+ */
+enum class ServoProtocol {
+    Pwm50,
+    Pwm400,
+    OneShot125,
+    Multishot
+};
+
 /** Servo control class, based on a PwmOut
  *
  * Example:
@@ -33,10 +50,15 @@ public:
     /** Create a servo object connected to the specified PwmOut pin
      *
      * @param pin PwmOut pin to connect to 
+     * @param protocol Output timing, ESC protocols need the pin's timer to themselves
      */
-    Servo(PinName pin);
+    Servo(PinName pin, ServoProtocol protocol = ServoProtocol::Pwm50);
     
     /** Set the servo position, normalised to it's full range
+     *
+     * With an ESC protocol the frame restarts so the pulse goes out now,
+     * unless the previous pulse is still high, in which case the new width
+     * is used from the next frame.
      *
      * @param percent A normalised number 0.0-1.0 to represent the full range.
      */
@@ -61,16 +83,37 @@ public:
      */
     void calibrate(float range = 500.0f, float degrees = 45.0); 
         
+    /** Output timing in use */
+    ServoProtocol protocol() const;
+
+    /** Time from the last write() to the start of its pulse, read from the timer
+     *
+     * @returns Microseconds, 0 for Pwm50 where it is not measured
+     */
+    float latency_us() const;
+
+    /** Largest latency_us() since construction */
+    float max_latency_us() const;
+
     /**  Shorthand for the write and read functions */
     Servo& operator= (float percent);
     Servo& operator= (Servo& rhs);
     operator float();
 
 protected:
+    /** Take over the PwmOut's timer for an ESC protocol */
+    void setupTimer(int period_us);
+
     PwmOut _pwm;
     float _range_us;
     float _degrees;
     float _p;
+    ServoProtocol _protocol;
+    TIM_TypeDef* _timer;            // ESC protocols only
+    volatile uint32_t* _ccr;        // compare register of the pin's channel
+    float _ticks_per_us;
+    float _latency_us;
+    float _max_latency_us;
 };
 
 #endif
@@ -5,15 +5,53 @@
  * @brief Construct a new Motor object.
  * Initializes the internal Servo and sets it to neutral (stop).
  */
-Motor::Motor(PinName pin)
-    : _servo(pin), _speed(0.0f) {
+Motor::Motor(PinName pin, ServoProtocol protocol)
+    : _servo(pin, protocol), _speed(0.0f), _arm_stage(ArmStage::Idle) {
 }
 
 void Motor::arm() {
-    _servo.write(1.0);
-    ThisThread::sleep_for(1000ms);
-    _servo.write(0.0);
-    ThisThread::sleep_for(1000ms);
+    beginArm();
+    while (!pollArm()) {
+        ThisThread::sleep_for(10ms);
+    }
+}
+
+void Motor::beginArm() {
+    if (armNeedsFullThrottle()) {
+        _servo.write(1.0);
+        _arm_stage = ArmStage::FullThrottle;
+        _arm_next = Kernel::Clock::now() + 1000ms;
+    } else {
+        _servo.write(0.0);
+        _arm_stage = ArmStage::ZeroThrottle;
+        _arm_next = Kernel::Clock::now() + 2000ms;
+    }
+}
+
+bool Motor::pollArm() {
+    if (_arm_stage == ArmStage::Armed) {
+        return true;
+    }
+    if (_arm_stage == ArmStage::Idle || Kernel::Clock::now() < _arm_next) {
+        return false;
+    }
+    if (_arm_stage == ArmStage::FullThrottle) {
+        _servo.write(0.0);
+        _arm_stage = ArmStage::ZeroThrottle;
+        _arm_next = Kernel::Clock::now() + 1000ms;
+        return false;
+    }
+    _arm_stage = ArmStage::Armed;
+    return true;
+}
+
+bool Motor::isArmed() const {
+    return _arm_stage == ArmStage::Armed;
+}
+
+bool Motor::armNeedsFullThrottle() const {
+    ServoProtocol protocol = _servo.protocol();
+    return protocol == ServoProtocol::Pwm50 || protocol == ServoProtocol::Pwm400;
 }
 
 /**
@@ -39,6 +77,18 @@ float Motor::getSpeed() const {
     return _speed;
 }
 
+ServoProtocol Motor::getProtocol() const {
+    return _servo.protocol();
+}
+
+float Motor::getLatency() const {
+    return _servo.latency_us();
+}
+
+float Motor::getMaxLatency() const {
+    return _servo.max_latency_us();
+}
+
 /**
  * @brief Stop the motor by setting speed to 0 (neutral).
  */
@@ -15,8 +15,10 @@ public:
      * @brief Construct a new Motor object.
      * 
      * @param pin The PWM pin connected to the servo motor.
+     * @param protocol ESC signal, see ServoProtocol. The faster protocols
+     *                 need an ESC that supports them.
      */
-    Motor(PinName pin);
+    Motor(PinName pin, ServoProtocol protocol = ServoProtocol::Pwm50);
 
     /**
      * @brief Set motor power/speed.
@@ -41,12 +43,61 @@ public:
     /**
     * @brief Performs a startup calibration routine for an ESC.
     * Sends the necessary PWM signals to initialize most brushless ESCs.
+    * With PWM that is full then zero throttle for throttle range calibration.
+    * OneShot125 and Multishot have a fixed range, those ESCs detect the
+    * protocol at power up and only need zero throttle to arm.
     */
     void arm();
 
+    /**
+     * @brief Start arm() without blocking, pollArm() finishes it.
+     */
+    void beginArm();
+
+    /**
+     * @brief Advance the arming sequence started by beginArm().
+     * @return true once the ESC is armed.
+     */
+    bool pollArm();
+
+    /**
+     * @brief Armed since power up.
+     */
+    bool isArmed() const;
+
+    /**
+     * @brief Arming sends a full throttle pulse, PWM throttle range
+     * calibration. Arming with the faster protocols only holds zero throttle.
+     */
+    bool armNeedsFullThrottle() const;
+
+    /**
+     * @brief Get the ESC protocol in use.
+     */
+    ServoProtocol getProtocol() const;
+
+    /**
+     * @brief Time from the last setSpeed() to the start of its pulse (us).
+     */
+    float getLatency() const;
+
+    /**
+     * @brief Largest getLatency() so far (us).
+     */
+    float getMaxLatency() const;
+
 private:
+    enum class ArmStage {
+        Idle,
+        FullThrottle,
+        ZeroThrottle,
+        Armed
+    };
+
     Servo _servo;
     float _speed;
+    ArmStage _arm_stage;
+    Kernel::Clock::time_point _arm_next;    ///< End of the current stage
 };
 
 #endif // MOTOR_H
@@ -0,0 +1,87 @@
+#include "mem_stats.h"
+#include "rtx_os.h"
+
+static HeapWatch* first_watch = nullptr;
+
+HeapWatch::HeapWatch(const char* name, bool hot)
+    : _name(name),
+      _hot(hot),
+      _thread(nullptr),
+      _runs(0),
+      _allocating(0),
+      _bytes(0),
+      _peak(0),
+      _next(nullptr)
+{
+    // Static initialisation runs on one thread, before main()
+    HeapWatch** tail = &first_watch;
+    while (*tail) {
+        tail = &(*tail)->_next;
+    }
+    *tail = this;
+}
+
+uint32_t HeapWatch::begin() {
+    return heapAllocated();
+}
+
+void HeapWatch::end(uint32_t start) {
+    uint32_t bytes = heapAllocated() - start;
+
+    core_util_critical_section_enter();
+    _thread = osThreadGetId();
+    _runs++;
+    if (bytes > 0) {
+        _allocating++;
+        _bytes += bytes;
+        if (bytes > _peak) {
+            _peak = bytes;
+        }
+    }
+    core_util_critical_section_exit();
+
+#if HEAP_GUARD
+    if (_hot && bytes > 0) {
+        MBED_ERROR1(MBED_MAKE_ERROR(MBED_MODULE_APPLICATION, MBED_ERROR_CODE_INVALID_OPERATION),
+                    "heap used on the hot path", bytes);
+    }
+#endif
+}
+
+HeapStats HeapWatch::getStats() const {
+    HeapStats stats;
+    CriticalSectionLock lock;
+    stats.name = _name;
+    stats.hot = _hot;
+    stats.thread = _thread;
+    stats.runs = _runs;
+    stats.allocating = _allocating;
+    stats.bytes = _bytes;
+    stats.peak = _peak;
+    return stats;
+}
+
+const HeapWatch* HeapWatch::getNext() const {
+    return _next;
+}
+
+const HeapWatch* heapWatchFirst() {
+    return first_watch;
+}
+
+uint32_t heapAllocated() {
+    mbed_stats_heap_t stats;
+    mbed_stats_heap_get(&stats);
+    return stats.total_size;
+}
+
+uint32_t stackUsed(const void* stack_mem, uint32_t stack_size) {
+    const uint32_t* words = static_cast<const uint32_t*>(stack_mem);
+    uint32_t count = stack_size / sizeof(uint32_t);
+    uint32_t untouched = 0;
+    while (untouched < count &&
+           (words[untouched] == osRtxStackFillPattern || words[untouched] == osRtxStackMagicWord)) {
+        untouched++;
+    }
+    return stack_size - untouched * sizeof(uint32_t);
+}
@@ -0,0 +1,112 @@
+#ifndef MEM_STATS_H
+#define MEM_STATS_H
+
+#include "mbed.h"
+
+/*
+ * Stack and heap use, for the `mem` report.
+ *
+ * Stacks: with platform.stack-stats-enabled RTX fills every thread stack
+ * with a pattern when the thread starts, so the deepest overwritten word is
+ * the most the thread has ever used. osThreadGetStackSpace() reports it for
+ * running threads, stackUsed() reads it from any stack memory.
+ *
+ * Heap: mbed only counts allocations for the whole heap (with
+ * platform.heap-stats-enabled). A HeapWatch wraps one thread's loop body and
+ * compares the bytes allocated so far before and after each run:
+ *
+ *   HeapWatch heap_motor("motor", true);
+ *
+ *   while (true) {
+ *       HeapScope heap_scope(heap_motor);
+ *       ...
+ *   }
+ *
+ * Allocations by whatever preempts the run count too. A hot watch marks the
+ * hot path: with HEAP_GUARD 1 (add "HEAP_GUARD=1" to the macros in
+ * mbed_app.json) its first allocation is a fatal error, which the fault log
+ * records along with the thread it ran on.
+ */
+
+#ifndef HEAP_GUARD
+#define HEAP_GUARD 0
+#endif
+
+#if HEAP_GUARD && !defined(MBED_HEAP_STATS_ENABLED)
+#error "HEAP_GUARD needs platform.heap-stats-enabled"
+#endif
+
+#define MEM_MAX_THREADS     16
+
+/**
+ * @brief Copy of a watch's statistics.
+ */
+struct HeapStats {
+    const char* name;
+    bool hot;
+    osThreadId_t thread;    ///< Thread of the last run, nullptr before the first
+    uint32_t runs;
+    uint32_t allocating;    ///< Runs that allocated
+    uint32_t bytes;         ///< Allocated over all runs
+    uint32_t peak;          ///< Most allocated in one run
+};
+
+class HeapWatch {
+public:
+    /**
+     * @brief Adds the watch to the list heapWatchFirst() walks, construct
+     * at file scope only.
+     *
+     * @param hot  On the hot path, must never allocate.
+     */
+    explicit HeapWatch(const char* name, bool hot = false);
+
+    /**
+     * @return Bytes allocated so far, for end().
+     */
+    uint32_t begin();
+    void end(uint32_t start);
+
+    HeapStats getStats() const;
+    const HeapWatch* getNext() const;
+
+private:
+    const char* _name;
+    const bool _hot;
+    osThreadId_t _thread;
+    uint32_t _runs;
+    uint32_t _allocating;
+    uint32_t _bytes;
+    uint32_t _peak;
+    HeapWatch* _next;
+};
+
+class HeapScope {
+public:
+    explicit HeapScope(HeapWatch& watch)
+        : _watch(watch), _start(watch.begin()) {}
+
+    ~HeapScope() {
+        _watch.end(_start);
+    }
+
+private:
+    HeapWatch& _watch;
+    const uint32_t _start;
+};
+
+const HeapWatch* heapWatchFirst();
+
+/**
+ * @brief Bytes allocated since boot, freed or not. 0 without heap stats.
+ */
+uint32_t heapAllocated();
+
+/**
+ * @brief Most of a stack ever used, from the fill pattern RTX wrote when
+ * the thread started. Memory that is reused by one thread after another
+ * only shows the latest.
+ */
+uint32_t stackUsed(const void* stack_mem, uint32_t stack_size);
+
+#endif // MEM_STATS_H
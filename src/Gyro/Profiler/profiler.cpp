@@ -0,0 +1,165 @@
+#include "profiler.h"
+#include <cstring>
+
+static ProfileProbe* first_probe = nullptr;
+
+ProfileProbe::ProfileProbe(const char* name, uint8_t category)
+    : _name(name),
+      _id(0),
+      _category(category),
+      _next(nullptr)
+{
+    reset();
+    // Static initialisation runs on one thread, before main()
+    ProfileProbe** tail = &first_probe;
+    while (*tail) {
+        tail = &(*tail)->_next;
+        _id++;
+    }
+    *tail = this;
+}
+
+ProfileStats ProfileProbe::getStats() const {
+    ProfileStats stats;
+    CriticalSectionLock lock;
+    stats.name = _name;
+    stats.count = _count;
+    stats.min = _count ? _min : 0;
+    stats.max = _max;
+    stats.total = _total;
+    memcpy(stats.hist, _hist, sizeof(_hist));
+    return stats;
+}
+
+void ProfileProbe::reset() {
+    CriticalSectionLock lock;
+    _count = 0;
+    _min = UINT32_MAX;
+    _max = 0;
+    _total = 0;
+    memset(_hist, 0, sizeof(_hist));
+}
+
+const char* ProfileProbe::getName() const {
+    return _name;
+}
+
+uint8_t ProfileProbe::getId() const {
+    return _id;
+}
+
+uint8_t ProfileProbe::getCategory() const {
+    return _category;
+}
+
+const ProfileProbe* ProfileProbe::getNext() const {
+    return _next;
+}
+
+const ProfileProbe* profileFirst() {
+    return first_probe;
+}
+
+#if PROFILER_ENABLED
+
+PROFILE_PROBE(overhead_probe, "(empty scope)");
+
+static volatile uint32_t idle_last = 0;
+static volatile uint32_t idle_cycles = 0;
+
+// Sample state, only touched by profilerSample() and profilerReset()
+static uint32_t sample_cycles = 0;
+static uint32_t sample_idle = 0;
+static float last_load = 0.0f;
+static uint64_t total_cycles = 0;
+static uint64_t total_idle = 0;
+
+static void idle_hook() {
+    uint32_t now = DWT->CYCCNT;
+    uint32_t gap = now - idle_last;
+    idle_last = now;
+    if (gap < PROFILE_IDLE_GAP) {
+        idle_cycles += gap;
+    }
+}
+
+void profilerStart() {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    sample_cycles = DWT->CYCCNT;
+    sample_idle = idle_cycles;
+    idle_last = sample_cycles;
+    Kernel::attach_idle_hook(idle_hook);
+}
+
+void profilerSample() {
+    core_util_critical_section_enter();
+    uint32_t now = DWT->CYCCNT;
+    uint32_t idle = idle_cycles;
+    core_util_critical_section_exit();
+
+    uint32_t elapsed = now - sample_cycles;
+    uint32_t idled = idle - sample_idle;
+    sample_cycles = now;
+    sample_idle = idle;
+    if (elapsed == 0) {
+        return;
+    }
+    last_load = 1.0f - static_cast<float>(idled) / static_cast<float>(elapsed);
+    total_cycles += elapsed;
+    total_idle += idled;
+}
+
+float profilerLoad() {
+    return last_load;
+}
+
+float profilerAverageLoad() {
+    if (total_cycles == 0) {
+        return 0.0f;
+    }
+    return 1.0f - static_cast<float>(total_idle) / static_cast<float>(total_cycles);
+}
+
+uint32_t profilerOverhead() {
+    uint32_t best = UINT32_MAX;
+    for (int i = 0; i < 8; i++) {
+        core_util_critical_section_enter();
+        uint32_t start = DWT->CYCCNT;
+        {
+            PROFILE_SCOPE(overhead_probe);
+        }
+        uint32_t cycles = DWT->CYCCNT - start;
+        core_util_critical_section_exit();
+        if (cycles < best) {
+            best = cycles;
+        }
+    }
+    return best;
+}
+
+uint32_t profilerCyclesPerUs() {
+    return SystemCoreClock / 1000000;
+}
+
+void profilerReset() {
+    for (ProfileProbe* probe = first_probe; probe; probe = probe->_next) {
+        probe->reset();
+    }
+    total_cycles = 0;
+    total_idle = 0;
+}
+
+#else
+
+void profilerStart() {}
+void profilerSample() {}
+float profilerLoad() { return 0.0f; }
+float profilerAverageLoad() { return 0.0f; }
+uint32_t profilerOverhead() { return 0; }
+uint32_t profilerCyclesPerUs() { return SystemCoreClock / 1000000; }
+void profilerReset() {}
+
+#endif
@@ -0,0 +1,235 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "mbed.h"
+#include "trace.h"
+
+/*
+ * Cycle-count profiling on the Cortex-M4 DWT.
+ *
+ * A probe is a ProfileProbe at file scope, timed by a PROFILE_SCOPE in the
+ * code it measures:
+ *
+ *   PROFILE_PROBE(bno_read, "bno055 read");
+ *
+ *   int BNO055::readData(char regaddr, char* data, uint8_t len) {
+ *       PROFILE_SCOPE(bno_read);
+ *       ...
+ *   }
+ *
+ * The scope reads CYCCNT on entry and exit and adds the difference to the
+ * probe with interrupts masked, so probes work in ISRs and from any thread.
+ * Times are wall clock: a scope that is preempted or sleeps includes the
+ * time spent elsewhere. With PROFILER_ENABLED 0 both macros expand to
+ * nothing and the functions below do nothing.
+ *
+ * Probes are also the names of trace events, see trace.h.
+ *
+ * CPU load comes from an idle hook that spins instead of sleeping (the cycle
+ * counter stops while the core sleeps) and counts the cycles between back
+ * to back calls as idle.
+ */
+
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+#define PROFILE_HIST_BINS   16
+#define PROFILE_HIST_SHIFT  6       // bin 0 is below 64 cycles, each bin after doubles
+#define PROFILE_BIN_END(bin) (1UL << (PROFILE_HIST_SHIFT + (bin)))     // cycles
+#define PROFILE_IDLE_GAP    256     // cycles, longer gaps between idle hook calls were spent elsewhere
+
+/**
+ * @brief Copy of a probe's statistics, in cycles.
+ */
+struct ProfileStats {
+    const char* name;
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t hist[PROFILE_HIST_BINS];   ///< Bin b counts times below 64 << b cycles, the last one everything longer
+};
+
+class ProfileProbe {
+public:
+    /**
+     * @brief Adds the probe to the list profileFirst() walks, construct at
+     * file scope only (or as a member of something that is).
+     *
+     * @param category  TRACE_* category its trace events are recorded under.
+     */
+    explicit ProfileProbe(const char* name, uint8_t category = TRACE_DRIVER);
+
+    /**
+     * @brief Start timing, what PROFILE_SCOPE does on entry.
+     *
+     * @return Start time in cycles, for end().
+     */
+    uint32_t begin();
+    void end(uint32_t start);
+
+    /**
+     * @brief Trace an instant, does not touch the statistics.
+     */
+    void mark(uint8_t arg = 0);
+
+    void record(uint32_t cycles);
+    ProfileStats getStats() const;
+    void reset();
+
+    const char* getName() const;
+    uint8_t getId() const;          ///< Position in the list, the name of its trace events
+    uint8_t getCategory() const;
+    const ProfileProbe* getNext() const;
+
+private:
+    friend void profilerReset();
+
+    const char* _name;
+    uint8_t _id;
+    uint8_t _category;
+    uint32_t _count;
+    uint32_t _min;
+    uint32_t _max;
+    uint64_t _total;
+    uint32_t _hist[PROFILE_HIST_BINS];
+    ProfileProbe* _next;
+};
+
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfileProbe& probe)
+        : _probe(probe), _start(probe.begin()) {}
+
+    ~ProfileScope() {
+        _probe.end(_start);
+    }
+
+private:
+    ProfileProbe& _probe;
+    const uint32_t _start;
+};
+
+/**
+ * @brief Mutex whose lock waits and holds are probes, so blocking shows in
+ * `stats` and on trace timelines. Same rules as ProfileProbe, and not for
+ * recursive locking.
+ */
+class ProfiledMutex : public Mutex {
+public:
+    ProfiledMutex(const char* wait_name, const char* hold_name)
+        : _wait(wait_name, TRACE_LOCK), _hold(hold_name, TRACE_LOCK), _hold_start(0) {}
+
+    void lock() {
+        uint32_t start = _wait.begin();
+        Mutex::lock();
+        _wait.end(start);
+        _hold_start = _hold.begin();
+    }
+
+    void unlock() {
+        _hold.end(_hold_start);
+        Mutex::unlock();
+    }
+
+private:
+    ProfileProbe _wait;
+    ProfileProbe _hold;
+    uint32_t _hold_start;
+};
+
+#if PROFILER_ENABLED
+#define PROFILE_PROBE(var, name)            ProfileProbe var(name)
+#define TRACE_PROBE(var, name, category)    ProfileProbe var(name, category)
+#define TRACE_MARKER(var, name)             ProfileProbe var(name, TRACE_MARKS)
+#define PROFILE_SCOPE(var)                  ProfileScope var##_scope(var)
+#define TRACE_MARK(var, arg)                var.mark(arg)
+#define PROFILED_MUTEX(var, wait_name, hold_name) ProfiledMutex var(wait_name, hold_name)
+#else
+#define PROFILE_PROBE(var, name)
+#define TRACE_PROBE(var, name, category)
+#define TRACE_MARKER(var, name)
+#define PROFILE_SCOPE(var)
+#define TRACE_MARK(var, arg)
+#define PROFILED_MUTEX(var, wait_name, hold_name) Mutex var
+#endif
+
+inline uint32_t ProfileProbe::begin() {
+    uint32_t now = DWT->CYCCNT;
+    if (trace_mask & _category) {
+        traceRecord(TRACE_BEGIN, _id, 0, now);
+    }
+    return now;
+}
+
+inline void ProfileProbe::end(uint32_t start) {
+    uint32_t now = DWT->CYCCNT;
+    record(now - start);
+    if (trace_mask & _category) {
+        traceRecord(TRACE_END, _id, 0, now);
+    }
+}
+
+inline void ProfileProbe::mark(uint8_t arg) {
+    if (trace_mask & _category) {
+        traceRecord(TRACE_INSTANT, _id, arg, DWT->CYCCNT);
+    }
+}
+
+inline void ProfileProbe::record(uint32_t cycles) {
+    uint32_t bin = cycles >> PROFILE_HIST_SHIFT;
+    bin = bin ? 32 - __CLZ(bin) : 0;
+    if (bin >= PROFILE_HIST_BINS) {
+        bin = PROFILE_HIST_BINS - 1;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    _count++;
+    _total += cycles;
+    if (cycles < _min) _min = cycles;
+    if (cycles > _max) _max = cycles;
+    _hist[bin]++;
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief Start the cycle counter and the idle hook. Probes only count after this.
+ */
+void profilerStart();
+
+/**
+ * @brief Fold the idle time into the load figures, call at least every
+ * 2^32 cycles (about 40 s at 100 MHz).
+ */
+void profilerSample();
+
+/**
+ * @brief CPU load over the last profilerSample() interval, 0-1.
+ */
+float profilerLoad();
+
+/**
+ * @brief CPU load since profilerStart() or profilerReset(), 0-1.
+ */
+float profilerAverageLoad();
+
+/**
+ * @brief Cycles an empty PROFILE_SCOPE costs.
+ */
+uint32_t profilerOverhead();
+
+uint32_t profilerCyclesPerUs();
+
+/**
+ * @brief Clear every probe and the average load.
+ */
+void profilerReset();
+
+/**
+ * @brief First probe in the list, nullptr if there are none.
+ */
+const ProfileProbe* profileFirst();
+
+#endif // PROFILER_H
@@ -0,0 +1,131 @@
+#include "trace.h"
+#include "profiler.h"
+#include <cstring>
+
+volatile uint32_t trace_mask = 0;
+
+#if PROFILER_ENABLED
+
+static TraceEvent ring[TRACE_EVENTS];
+static volatile uint32_t head = 0;          // events written since traceStart()
+static volatile uint32_t stop_at = 0;       // head at which a trigger stops the trace, 0 if not triggered
+static bool armed = false;
+
+// Slot 0 is interrupts. Slots are only ever appended to, so lookups can scan
+// without a lock.
+static osThreadId_t thread_ids[TRACE_MAX_THREADS];
+static char thread_names[TRACE_MAX_THREADS][TRACE_THREAD_NAME + 1] = {"isr"};
+static volatile int thread_count = 1;
+
+static uint8_t thread_slot() {
+    if (__get_IPSR() != 0) {
+        return 0;
+    }
+    osThreadId_t id = osThreadGetId();
+    int count = thread_count;
+    for (int i = 1; i < count; i++) {
+        if (thread_ids[i] == id) {
+            return i;
+        }
+    }
+
+    CriticalSectionLock lock;
+    // Another thread may have taken the slot we were about to use
+    for (int i = count; i < thread_count; i++) {
+        if (thread_ids[i] == id) {
+            return i;
+        }
+    }
+    if (thread_count >= TRACE_MAX_THREADS) {
+        return 0;
+    }
+    int slot = thread_count;
+    const char* name = osThreadGetName(id);
+    thread_ids[slot] = id;
+    strncpy(thread_names[slot], name ? name : "", TRACE_THREAD_NAME);
+    thread_count = slot + 1;
+    return slot;
+}
+
+void traceRecord(uint8_t phase, uint8_t name, uint8_t arg, uint32_t cycles) {
+    uint8_t thread = thread_slot();
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (trace_mask != 0) {
+        TraceEvent& event = ring[head % TRACE_EVENTS];
+        event.cycles = cycles;
+        event.phase = phase;
+        event.name = name;
+        event.thread = thread;
+        event.arg = arg;
+        head++;
+        if (head == stop_at) {
+            trace_mask = 0;
+        }
+    }
+    __set_PRIMASK(primask);
+}
+
+bool traceStart(uint32_t mask, bool on_trigger) {
+    CriticalSectionLock lock;
+    head = 0;
+    stop_at = 0;
+    armed = on_trigger;
+    trace_mask = mask;
+    return true;
+}
+
+void traceStop() {
+    trace_mask = 0;
+}
+
+void traceTrigger() {
+    CriticalSectionLock lock;
+    if (armed && trace_mask != 0) {
+        armed = false;
+        stop_at = head + TRACE_EVENTS / 2;
+    }
+}
+
+bool traceRunning() {
+    return trace_mask != 0;
+}
+
+bool traceTriggered() {
+    return stop_at != 0 && trace_mask == 0;
+}
+
+uint32_t traceCount() {
+    uint32_t count = head;
+    return count < TRACE_EVENTS ? count : TRACE_EVENTS;
+}
+
+size_t traceRead(uint32_t first, TraceEvent* out, size_t n) {
+    uint32_t written = head;
+    uint32_t count = traceCount();
+    uint32_t oldest = written - count;
+    size_t copied = 0;
+    for (uint32_t i = first; i < count && copied < n; i++) {
+        out[copied++] = ring[(oldest + i) % TRACE_EVENTS];
+    }
+    return copied;
+}
+
+const char* traceThreadName(int slot) {
+    return (slot >= 0 && slot < thread_count) ? thread_names[slot] : nullptr;
+}
+
+#else
+
+void traceRecord(uint8_t, uint8_t, uint8_t, uint32_t) {}
+bool traceStart(uint32_t, bool) { return false; }
+void traceStop() {}
+void traceTrigger() {}
+bool traceRunning() { return false; }
+bool traceTriggered() { return false; }
+uint32_t traceCount() { return 0; }
+size_t traceRead(uint32_t, TraceEvent*, size_t) { return 0; }
+const char* traceThreadName(int) { return nullptr; }
+
+#endif
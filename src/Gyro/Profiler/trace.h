@@ -0,0 +1,100 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "mbed.h"
+
+/*
+ * Event trace ring, for seeing how threads interleave on a timeline.
+ *
+ * Profiler probes (see profiler.h) double as trace points: while tracing, a
+ * PROFILE_SCOPE adds a begin and an end event and a TRACE_MARK an instant,
+ * if the probe's category is in the mask given to traceStart(). Each event
+ * is 8 bytes, stamped with the DWT cycle counter and the thread it ran on
+ * (slot 0 for interrupts), and the ring keeps the last TRACE_EVENTS.
+ *
+ * mbed-os builds RTX with its thread switch event compiled out, so there are
+ * no switch events. trace.py gives every thread its own track instead, and a
+ * thread that is preempted or blocked shows as a span that stays open while
+ * spans on other tracks run.
+ */
+
+#ifndef TRACE_EVENTS
+#define TRACE_EVENTS        512     // 4 KB
+#endif
+#define TRACE_MAX_THREADS   16      // slot 0 is interrupts, threads past the last share it
+#define TRACE_THREAD_NAME   12      // characters kept of a thread's name
+
+// Categories, a probe belongs to one
+#define TRACE_TASK      0x01    // periodic tasks and thread loops
+#define TRACE_DRIVER    0x02    // driver calls
+#define TRACE_LOCK      0x04    // mutex waits and holds
+#define TRACE_ISR       0x08    // interrupt handlers, off by default as encoder edges would flood the ring
+#define TRACE_MARKS     0x10    // instants, such as deadline misses
+#define TRACE_ALL       0x1F
+#define TRACE_DEFAULT   (TRACE_ALL & ~TRACE_ISR)
+
+// Event phases, the same letters as the Chrome trace format
+#define TRACE_BEGIN     'B'
+#define TRACE_END       'E'
+#define TRACE_INSTANT   'i'
+
+struct TraceEvent {
+    uint32_t cycles;    ///< DWT->CYCCNT, wraps every 2^32 cycles
+    uint8_t phase;      ///< TRACE_BEGIN, TRACE_END or TRACE_INSTANT
+    uint8_t name;       ///< ProfileProbe::getId()
+    uint8_t thread;     ///< traceThreadName() slot
+    uint8_t arg;
+};
+
+/**
+ * @brief Categories being recorded, 0 while stopped.
+ */
+extern volatile uint32_t trace_mask;
+
+/**
+ * @brief Add an event to the ring. Use the probe functions rather than calling this.
+ */
+void traceRecord(uint8_t phase, uint8_t name, uint8_t arg, uint32_t cycles);
+
+/**
+ * @brief Clear the ring and record the given categories.
+ *
+ * @param on_trigger  Stop by itself half a ring after traceTrigger(), so the
+ *                    events around it are kept. Otherwise record until traceStop().
+ * @return false if the profiler is disabled.
+ */
+bool traceStart(uint32_t mask, bool on_trigger = false);
+
+void traceStop();
+
+/**
+ * @brief Something worth seeing happened, see traceStart(). Safe from interrupts.
+ */
+void traceTrigger();
+
+bool traceRunning();
+
+/**
+ * @brief true once a trigger stopped the trace.
+ */
+bool traceTriggered();
+
+/**
+ * @brief Number of events in the ring, the oldest ones have been overwritten past TRACE_EVENTS.
+ */
+uint32_t traceCount();
+
+/**
+ * @brief Copy events out of the ring, oldest first. Stop the trace first.
+ *
+ * @param first  Index from the oldest event in the ring.
+ * @return Number of events copied.
+ */
+size_t traceRead(uint32_t first, TraceEvent* out, size_t n);
+
+/**
+ * @brief Name of the thread in a slot, "isr" for slot 0 and nullptr past the used slots.
+ */
+const char* traceThreadName(int slot);
+
+#endif // TRACE_H
@@ -0,0 +1,201 @@
+#include "rate_scheduler.h"
+#include "hal/us_ticker_api.h"
+
+RateGroup::RateGroup(const char* name, uint32_t divider, uint32_t phase, osPriority priority, uint32_t stack_size,
+                     unsigned char* stack_mem)
+    : _name(name),
+      _divider(divider > 0 ? divider : 1),
+      _phase(phase),
+      _countdown(0),
+      _stack_size(stack_size),
+      _count(0),
+      _monitor(nullptr),
+      _heap(nullptr),
+      _release_us(0),
+      _release_period_us(0),
+      _deadline_us(0),
+      _last_period_us(0),
+      _busy(false),
+      _timed(false),
+      _release_overruns(0),
+      _running(false),
+      _last_start(0),
+      _stats{0, 0, 0, 0, 0},
+      _queue(sizeof(_queue_buffer), _queue_buffer),
+      _thread(priority, stack_size, stack_mem, name)
+{
+}
+
+bool RateGroup::add(Callback<void()> task, const char* name) {
+    if (_running || _count >= RATE_MAX_TASKS) {
+        return false;
+    }
+    _tasks[_count] = task;
+    _names[_count] = name;
+    _ids[_count] = -1;
+    _count++;
+    return true;
+}
+
+void RateGroup::watchHeap(HeapWatch* watch) {
+    _heap = watch;
+}
+
+void RateGroup::setDivider(uint32_t divider) {
+    _divider = divider > 0 ? divider : 1;
+}
+
+const char* RateGroup::getName() const {
+    return _name;
+}
+
+int RateGroup::getTaskCount() const {
+    return _count;
+}
+
+uint32_t RateGroup::getPeriodUs() const {
+    return _divider * RATE_TICK_US;
+}
+
+uint32_t RateGroup::getStackSize() const {
+    return _stack_size;
+}
+
+osThreadId_t RateGroup::getThreadId() const {
+    return _thread.get_id();
+}
+
+RateGroupStats RateGroup::getStats() const {
+    CriticalSectionLock lock;
+    return _stats;
+}
+
+void RateGroup::start(TaskMonitor* monitor) {
+    _monitor = monitor;
+    _deadline_us = getPeriodUs();
+    for (int i = 0; i < _count; i++) {
+        if (_monitor && _names[i]) {
+            _ids[i] = _monitor->add(_names[i], _deadline_us);
+        }
+    }
+    _countdown = _phase % _divider + 1;     // the first tick is tick 0
+    _running = true;
+    _thread.start(callback(&_queue, &EventQueue::dispatch_forever));
+}
+
+void RateGroup::release() {
+    // A group that is still running skips the release rather than queueing
+    // up runs to catch up with
+    if (_busy) {
+        _stats.overruns++;
+        return;
+    }
+    _busy = true;
+    _release_overruns = _stats.overruns;
+    _release_us = us_ticker_read();
+    _release_period_us = _countdown * RATE_TICK_US;
+    if (_queue.call(callback(this, &RateGroup::run)) == 0) {
+        _busy = false;
+    }
+}
+
+void RateGroup::run() {
+    uint32_t start_us = us_ticker_read();
+    uint32_t release_us = _release_us;
+    uint32_t period_us = _release_period_us;
+    uint32_t heap_start = _heap ? _heap->begin() : 0;
+
+    // The first run at a new period
+    if (period_us != _deadline_us) {
+        for (int i = 0; i < _count; i++) {
+            if (_ids[i] >= 0) {
+                _monitor->setDeadline(_ids[i], period_us);
+            }
+        }
+        _deadline_us = period_us;
+    }
+
+    uint32_t task_start_us = start_us;
+    for (int i = 0; i < _count; i++) {
+        _tasks[i]();
+        uint32_t end_us = us_ticker_read();
+        if (_ids[i] >= 0) {
+            _monitor->report(_ids[i], release_us, task_start_us, end_us);
+        }
+        task_start_us = end_us;
+    }
+    if (_heap) {
+        _heap->end(heap_start);
+    }
+
+    uint32_t exec_us = task_start_us - start_us;
+
+    core_util_critical_section_enter();
+    if (_timed) {
+        uint32_t elapsed = start_us - _last_start;
+        uint32_t jitter = elapsed > _last_period_us ? elapsed - _last_period_us : _last_period_us - elapsed;
+        if (jitter > _stats.jitter_max_us) {
+            _stats.jitter_max_us = jitter;
+        }
+        _stats.jitter_sum_us += jitter;
+    }
+    if (exec_us > _stats.exec_max_us) {
+        _stats.exec_max_us = exec_us;
+    }
+    _stats.runs++;
+    _last_start = start_us;
+    _last_period_us = period_us;
+    _timed = _stats.overruns == _release_overruns;   // no release skipped since this one
+    _busy = false;
+    core_util_critical_section_exit();
+}
+
+RateScheduler::RateScheduler(TaskMonitor* monitor)
+    : _count(0),
+      _monitor(monitor),
+      _running(false)
+{
+}
+
+bool RateScheduler::add(RateGroup* group) {
+    if (_running || _count >= RATE_MAX_GROUPS) {
+        return false;
+    }
+    _groups[_count++] = group;
+    return true;
+}
+
+void RateScheduler::start() {
+    for (int i = 0; i < _count; i++) {
+        _groups[i]->start(_monitor);
+    }
+    _running = true;
+    tick();
+    _ticker.attach(callback(this, &RateScheduler::tick), chrono::microseconds(RATE_TICK_US));
+}
+
+int RateScheduler::getGroupCount() const {
+    return _count;
+}
+
+const RateGroup* RateScheduler::getGroup(int index) const {
+    return (index >= 0 && index < _count) ? _groups[index] : nullptr;
+}
+
+uint32_t RateScheduler::getStackBytes() const {
+    uint32_t total = 0;
+    for (int i = 0; i < _count; i++) {
+        total += _groups[i]->getStackSize();
+    }
+    return total;
+}
+
+void RateScheduler::tick() {
+    for (int i = 0; i < _count; i++) {
+        RateGroup* group = _groups[i];
+        if (--group->_countdown == 0) {
+            group->_countdown = group->_divider;
+            group->release();
+        }
+    }
+}
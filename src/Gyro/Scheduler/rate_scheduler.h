@@ -0,0 +1,164 @@
+#ifndef RATE_SCHEDULER_H
+#define RATE_SCHEDULER_H
+
+#include "mbed.h"
+#include "task_monitor.h"
+#include "mem_stats.h"
+
+/*
+ * Rate-monotonic scheduling of the periodic tasks.
+ *
+ * One hardware Ticker counts RATE_TICK_US ticks and releases every rate group
+ * whose divider and phase match the tick:
+ *
+ *   tick        0    1    2    3    4    5    6    7    8    9   10   11 ...
+ *   1 kHz       x    x    x    x    x    x    x    x    x    x    x    x
+ *   100 Hz           x                                                 x
+ *   20 Hz                      x
+ *   5 Hz                                          x
+ *
+ * Each group runs its tasks in registration order on its own thread, with a
+ * higher priority for a faster group, by dispatching an EventQueue that the
+ * ticker posts to. Releases come from the tick count, so periods don't drift
+ * by the time the tasks take, and the phases keep the slower groups from
+ * starting on the same tick. Named tasks report every run to the scheduler's
+ * TaskMonitor, with the group period as their deadline.
+ *
+ * setDivider() changes a running group's period. The group still releases
+ * on the tick it was due, then counts the new period from there, so no
+ * period is cut short or stretched; the deadlines follow on that run.
+ */
+
+#ifndef RATE_TICK_US
+#define RATE_TICK_US        1000
+#endif
+
+#define RATE_MAX_GROUPS     4
+#define RATE_MAX_TASKS      4       // per group
+
+/**
+ * @brief Timing of one group since start, in microseconds.
+ */
+struct RateGroupStats {
+    uint32_t runs;
+    uint32_t overruns;          ///< Releases skipped because the previous run had not finished
+    uint32_t jitter_max_us;     ///< Worst |start-to-start time - period|
+    uint64_t jitter_sum_us;
+    uint32_t exec_max_us;       ///< Longest run of all the group's tasks
+};
+
+class RateGroup {
+public:
+    /**
+     * @param name        For status output.
+     * @param divider     Period in ticks, e.g. 10 for 100 Hz.
+     * @param phase       Tick within the period the group starts on.
+     * @param priority    Thread priority, higher for faster groups.
+     * @param stack_size  Thread stack, enough for the deepest task.
+     * @param stack_mem   Static stack of stack_size bytes, 8 byte aligned,
+     *                    nullptr to allocate it from the heap.
+     */
+    RateGroup(const char* name, uint32_t divider, uint32_t phase, osPriority priority, uint32_t stack_size,
+              unsigned char* stack_mem = nullptr);
+
+    /**
+     * @brief Add a task, run every period after the ones added before it.
+     *
+     * @param name  Name in the TaskMonitor, nullptr to leave the task unmonitored.
+     * @return false if the group is full or already running.
+     */
+    bool add(Callback<void()> task, const char* name = nullptr);
+
+    /**
+     * @brief Count heap use of every run in watch, call before starting.
+     */
+    void watchHeap(HeapWatch* watch);
+
+    /**
+     * @brief Change the period, from the next release on. Safe while running.
+     */
+    void setDivider(uint32_t divider);
+
+    const char* getName() const;
+    int getTaskCount() const;
+    uint32_t getPeriodUs() const;       ///< The latest setDivider(), in effect from the next release
+    uint32_t getStackSize() const;
+    osThreadId_t getThreadId() const;   ///< nullptr until started
+
+    /**
+     * @brief Copy of the statistics, consistent with each other.
+     */
+    RateGroupStats getStats() const;
+
+private:
+    friend class RateScheduler;
+
+    void start(TaskMonitor* monitor);
+    void release();     // ticker interrupt, after reloading _countdown
+    void run();         // group thread
+
+    const char* _name;
+    volatile uint32_t _divider;
+    const uint32_t _phase;
+    uint32_t _countdown;        // ticks to the next release, counted down by the ticker
+    const uint32_t _stack_size;
+    Callback<void()> _tasks[RATE_MAX_TASKS];
+    const char* _names[RATE_MAX_TASKS];
+    int _ids[RATE_MAX_TASKS];       // in _monitor, -1 for unmonitored tasks
+    int _count;
+    TaskMonitor* _monitor;
+    HeapWatch* _heap;
+    volatile uint32_t _release_us;
+    volatile uint32_t _release_period_us;   // from the release to the next one
+    uint32_t _deadline_us;      // in _monitor
+    uint32_t _last_period_us;
+    volatile bool _busy;
+    bool _timed;                // _last_start is one period before the next run
+    uint32_t _release_overruns; // overruns when the running event was posted
+    bool _running;
+    uint32_t _last_start;
+    RateGroupStats _stats;
+
+    // One event is pending or running at a time, see release()
+    uint8_t _queue_buffer[2 * EVENTS_EVENT_SIZE];
+    EventQueue _queue;
+    Thread _thread;
+};
+
+class RateScheduler {
+public:
+    /**
+     * @param monitor  Receives the timing of the named tasks, may be nullptr.
+     */
+    RateScheduler(TaskMonitor* monitor = nullptr);
+
+    /**
+     * @return false if there are already RATE_MAX_GROUPS or the scheduler is running.
+     */
+    bool add(RateGroup* group);
+
+    /**
+     * @brief Register the named tasks with the monitor, start the group
+     * threads, then the ticker. Groups release from tick 0.
+     */
+    void start();
+
+    int getGroupCount() const;
+    const RateGroup* getGroup(int index) const;
+
+    /**
+     * @brief Stack reserved for all groups, to compare with a thread per task.
+     */
+    uint32_t getStackBytes() const;
+
+private:
+    void tick();        // ticker interrupt
+
+    RateGroup* _groups[RATE_MAX_GROUPS];
+    int _count;
+    TaskMonitor* _monitor;
+    bool _running;
+    Ticker _ticker;
+};
+
+#endif // RATE_SCHEDULER_H
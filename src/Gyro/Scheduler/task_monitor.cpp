@@ -0,0 +1,95 @@
+#include "task_monitor.h"
+#include "mbed.h"
+#include "profiler.h"
+
+TRACE_MARKER(deadline_miss, "deadline miss");
+
+TaskMonitor::TaskMonitor()
+    : _count(0),
+      _started(false)
+{
+}
+
+int TaskMonitor::add(const char* name, uint32_t deadline_us) {
+    if (_count >= MONITOR_MAX_TASKS) {
+        return -1;
+    }
+    _tasks[_count] = TaskTiming{name, deadline_us, 0, 0, 0, 0, 0, 0};
+    return _count++;
+}
+
+void TaskMonitor::setDeadline(int id, uint32_t deadline_us) {
+    if (id < 0 || id >= _count) {
+        return;
+    }
+    CriticalSectionLock lock;
+    _tasks[id].deadline_us = deadline_us;
+}
+
+void TaskMonitor::start(uint32_t now_us) {
+    CriticalSectionLock lock;
+    for (int i = 0; i < _count; i++) {
+        _tasks[i].last_beat_us = now_us;
+    }
+    _started = true;
+}
+
+void TaskMonitor::report(int id, uint32_t release_us, uint32_t start_us, uint32_t end_us) {
+    if (id < 0 || id >= _count) {
+        return;
+    }
+    TaskTiming& task = _tasks[id];
+    uint32_t exec_us = end_us - start_us;
+    uint32_t response_us = end_us - release_us;
+
+    CriticalSectionLock lock;
+    task.runs++;
+    if (exec_us > task.exec_max_us) {
+        task.exec_max_us = exec_us;
+    }
+    if (response_us > task.response_max_us) {
+        task.response_max_us = response_us;
+    }
+    if (response_us > task.deadline_us) {
+        task.misses++;
+        task.last_miss_us = end_us;
+        TRACE_MARK(deadline_miss, id);
+        traceTrigger();
+    }
+    task.last_beat_us = end_us;
+}
+
+uint32_t TaskMonitor::stallTime(const TaskTiming& task) const {
+    uint32_t two_deadlines = 2 * task.deadline_us;
+    return two_deadlines > MONITOR_STALL_US ? two_deadlines : MONITOR_STALL_US;
+}
+
+int TaskMonitor::check(uint32_t now_us) const {
+    if (!_started) {
+        return -1;
+    }
+    for (int i = 0; i < _count; i++) {
+        TaskTiming task = getTiming(i);
+        // Heartbeats can land after now_us was read, those count as on time
+        int32_t silent = static_cast<int32_t>(now_us - task.last_beat_us);
+        if (silent > static_cast<int32_t>(stallTime(task))) {
+            return i;
+        }
+        if (task.misses > 0 && static_cast<int32_t>(now_us - task.last_miss_us) < MONITOR_RECOVERY_US) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int TaskMonitor::getCount() const {
+    return _count;
+}
+
+TaskTiming TaskMonitor::getTiming(int id) const {
+    if (id < 0 || id >= _count) {
+        return TaskTiming{nullptr, 0, 0, 0, 0, 0, 0, 0};
+    }
+    CriticalSectionLock lock;
+    return _tasks[id];
+}
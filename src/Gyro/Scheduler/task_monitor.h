@@ -0,0 +1,96 @@
+#ifndef TASK_MONITOR_H
+#define TASK_MONITOR_H
+
+#include <cstdint>
+
+/*
+ * Deadline and liveness monitoring of the periodic tasks.
+ *
+ * Every task reports each run: when it was released, when it started and
+ * when it finished. A run that finishes later than the task's deadline after
+ * its release is a miss. A task that stops reporting altogether (stuck in a
+ * driver, waiting on a lost peripheral) is stalled once it has been silent
+ * for two deadlines or MONITOR_STALL_US, whichever is longer.
+ *
+ * check() is meant to gate the hardware watchdog: a stalled task, or one
+ * that missed a deadline within MONITOR_RECOVERY_US, stops the kicks, so a
+ * fault that doesn't clear resets the board while a single late run doesn't.
+ *
+ * Times are us_ticker microseconds supplied by the caller, as in
+ * encoder_velocity.h.
+ */
+
+#define MONITOR_MAX_TASKS   12
+
+#ifndef MONITOR_STALL_US
+#define MONITOR_STALL_US    500000
+#endif
+
+#ifndef MONITOR_RECOVERY_US
+#define MONITOR_RECOVERY_US 1000000
+#endif
+
+/**
+ * @brief Timing of one task since start().
+ */
+struct TaskTiming {
+    const char* name;
+    uint32_t deadline_us;
+    uint32_t runs;
+    uint32_t misses;
+    uint32_t exec_max_us;       ///< Longest start to finish
+    uint32_t response_max_us;   ///< Longest release to finish
+    uint32_t last_beat_us;      ///< Finish of the last run
+    uint32_t last_miss_us;
+};
+
+class TaskMonitor {
+public:
+    TaskMonitor();
+
+    /**
+     * @brief Register a task, before start().
+     *
+     * @param deadline_us  Longest release to finish, usually the period.
+     * @return int Task ID for report(), -1 if MONITOR_MAX_TASKS are registered.
+     */
+    int add(const char* name, uint32_t deadline_us);
+
+    /**
+     * @brief Change a task's deadline, e.g. for a new period. Safe while running.
+     */
+    void setDeadline(int id, uint32_t deadline_us);
+
+    /**
+     * @brief Start the stall clocks, tasks that haven't run yet count from now.
+     */
+    void start(uint32_t now_us);
+
+    /**
+     * @brief Record one run, from the task's own thread.
+     */
+    void report(int id, uint32_t release_us, uint32_t start_us, uint32_t end_us);
+
+    /**
+     * @brief Find a task that is stalled or missed a deadline recently.
+     *
+     * @return int Its ID, -1 if every task is on time.
+     */
+    int check(uint32_t now_us) const;
+
+    int getCount() const;
+
+    /**
+     * @brief Copy of a task's timing, consistent with itself.
+     */
+    TaskTiming getTiming(int id) const;
+
+private:
+    uint32_t stallTime(const TaskTiming& task) const;
+
+    TaskTiming _tasks[MONITOR_MAX_TASKS];
+    int _count;
+    bool _started;
+};
+
+#endif // TASK_MONITOR_H
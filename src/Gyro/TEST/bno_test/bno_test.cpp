@@ -1,6 +1,7 @@
 #include "bno_test.h"
 #include "func.h"
 #include "bno055_const.h"
+#include "timebase.h"
 
 BNO055Test::BNO055Test(BNO055* sensor, USBSerial* serial) {
     this->sensor = sensor;
@@ -115,6 +116,27 @@ void BNO055Test::test_reset() {
     print_status("Software Reset Test", sys_status == 0x00);
 }
 
+// One burst agrees with the single vector reads and is stamped inside the transaction
+void BNO055Test::test_raw_sample() {
+    sensor->setOPMode(0x0C);        // NDOF, for fusion output
+    ThisThread::sleep_for(700ms);
+
+    bno055_raw_sample_t sample;
+    uint64_t before_us = timebaseNowUs();
+    bool ok = sensor->getRawSample(sample);
+    uint64_t after_us = timebaseNowUs();
+    bno055_raw_vector_t grav = sensor->getRawGravity();
+    pc->printf("  read %llu us, stamped %llu us in, gravity %d %d %d (single read %d %d %d)\n",
+        static_cast<unsigned long long>(after_us - before_us), static_cast<unsigned long long>(sample.time_us - before_us),
+        sample.grav.x, sample.grav.y, sample.grav.z, grav.x, grav.y, grav.z);
+
+    // 100 LSB per m/s^2, the board sits still between the two reads
+    ok &= sample.time_us > before_us && sample.time_us < after_us;
+    ok &= abs(sample.grav.x) + abs(sample.grav.y) + abs(sample.grav.z) > 500;
+    ok &= abs(sample.grav.x - grav.x) < 50 && abs(sample.grav.y - grav.y) < 50 && abs(sample.grav.z - grav.z) < 50;
+    print_status("Burst Sample Test", ok);
+}
+
 void BNO055Test::run_all_tests() {
     test_page(); 
     test_set_get_OPMode(); 
@@ -127,4 +149,5 @@ void BNO055Test::run_all_tests() {
     test_set_get_UnitConfig(); 
     test_set_get_SysTrigger(); 
     test_reset(); 
+    test_raw_sample();
 }
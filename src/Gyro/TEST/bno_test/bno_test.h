@@ -21,6 +21,7 @@ public:
     void test_set_get_UnitConfig();
     void test_set_get_SysTrigger();
     void test_reset();
+    void test_raw_sample();
     void run_all_tests();
     void Dummy();
     void test_page();
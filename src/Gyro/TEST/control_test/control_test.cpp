@@ -0,0 +1,170 @@
+#include "control_test.h"
+#include "mbed.h"
+#include <cmath>
+
+// Same values as main.cpp
+#define DT          0.01f
+#define SETPOINT    3000.0f
+#define KFF         (0.4f / SETPOINT)
+#define KP          0.0002f
+#define KI          0.001f
+#define MAX_RPM     7500.0f     // 0.4 command -> 3000 RPM on the bench
+#define ANGLE_KP    2.0f
+#define RATE_KP     40.0f
+#define RATE_KI     10.0f
+#define RPM_TO_DPS  6.0f
+
+ControlTest::ControlTest(USBSerial* serial) {
+    this->pc = serial;
+}
+
+void ControlTest::print_status(const char* test_name, bool passed) {
+    pc->printf("[%s] %s\n", passed ? "PASS" : "FAIL", test_name);
+}
+
+float ControlTest::MotorModel::step(float command, float dt) {
+    float target = command * max_rpm * supply - load_rpm;
+    if (target < 0.0f) target = 0.0f;
+    rpm += (target - rpm) * dt / tau;
+    return rpm;
+}
+
+float ControlTest::run(PIController& pi, MotorModel& motor, float setpoint, float seconds, float* peak) {
+    int steps = static_cast<int>(seconds / DT + 0.5f);
+    int settled = steps - static_cast<int>(1.0f / DT);
+    float worst = 0.0f;
+    for (int i = 0; i < steps; i++) {
+        float out = pi.update(setpoint, motor.rpm, DT);
+        motor.step(out, DT);
+        if (peak && motor.rpm > *peak) *peak = motor.rpm;
+        if (i >= settled && fabsf(setpoint - motor.rpm) > worst) worst = fabsf(setpoint - motor.rpm);
+    }
+    return worst;
+}
+
+float ControlTest::run_roll(RollController& roll, PIController& pi, MotorModel& wheel, BodyModel& body,
+                           float target, float seconds) {
+    int steps = static_cast<int>(seconds / DT + 0.5f);
+    int settled = steps - static_cast<int>(1.0f / DT);
+    float measured_roll = body.roll, measured_rate = body.rate;
+    float worst = 0.0f;
+    for (int i = 0; i < steps; i++) {
+        float setpoint = roll.update(target, measured_roll, measured_rate, DT);
+        float out = pi.update(setpoint, wheel.rpm, DT);
+        measured_roll = body.roll;
+        measured_rate = body.rate;
+
+        float before = wheel.rpm;
+        wheel.step(out, DT);
+        body.rate += -(wheel.rpm - before) * RPM_TO_DPS / body.inertia + body.disturbance * DT;
+        body.roll += body.rate * DT;
+        if (i >= settled && fabsf(target - body.roll) > worst) worst = fabsf(target - body.roll);
+    }
+    return worst;
+}
+
+void ControlTest::test_feed_forward_only() {
+    PIController pi(0.0f, 0.0f, KFF, 0.0f, 1.0f);
+    float out = pi.update(SETPOINT, 0.0f, DT);
+    print_status("Feed Forward Only Test", fabsf(out - 0.4f) < 1e-6f && fabsf(pi.getIntegral()) < 1e-9f);
+}
+
+void ControlTest::test_tracks_setpoint() {
+    PIController pi(KP, KI, KFF, 0.0f, 1.0f);
+    MotorModel motor = {0.0f, MAX_RPM, 1.0f, 200.0f, 0.1f};    // friction, open loop would settle 200 RPM low
+    float worst = run(pi, motor, SETPOINT, 4.0f);
+    pc->printf("  %.1f RPM (setpoint %.0f), worst error %.1f RPM\n", motor.rpm, SETPOINT, worst);
+    print_status("Tracks Setpoint Test", worst < SETPOINT * 0.01f);
+}
+
+void ControlTest::test_rejects_load_step() {
+    PIController pi(KP, KI, KFF, 0.0f, 1.0f);
+    MotorModel motor = {0.0f, MAX_RPM, 1.0f, 0.0f, 0.1f};
+    run(pi, motor, SETPOINT, 3.0f);
+    motor.load_rpm = 600.0f;
+    float worst = run(pi, motor, SETPOINT, 3.0f);
+    pc->printf("  after load step %.1f RPM, worst error %.1f RPM\n", motor.rpm, worst);
+    print_status("Rejects Load Step Test", worst < SETPOINT * 0.01f);
+}
+
+void ControlTest::test_rejects_supply_sag() {
+    PIController pi(KP, KI, KFF, 0.0f, 1.0f);
+    MotorModel motor = {0.0f, MAX_RPM, 1.0f, 0.0f, 0.1f};
+    run(pi, motor, SETPOINT, 3.0f);
+    motor.supply = 0.8f;        // 12.6 V pack down to ~10 V
+    float worst = run(pi, motor, SETPOINT, 3.0f);
+    pc->printf("  after supply sag %.1f RPM, command %.3f, worst error %.1f RPM\n", motor.rpm, pi.getOutput(), worst);
+    print_status("Rejects Supply Sag Test", worst < SETPOINT * 0.01f);
+}
+
+void ControlTest::test_anti_windup() {
+    // Ask for more than the motor can do, then come back within range: without
+    // anti-windup the integral would hold the command at full for seconds
+    PIController pi(KP, KI, KFF, 0.0f, 1.0f);
+    MotorModel motor = {0.0f, MAX_RPM, 1.0f, 0.0f, 0.1f};
+    run(pi, motor, 10000.0f, 5.0f);
+    bool saturated = pi.isSaturated() && pi.getOutput() == 1.0f;
+
+    float peak = 0.0f;
+    float worst = run(pi, motor, SETPOINT, 4.0f, &peak);
+    pc->printf("  integral %.3f, peak after release %.0f RPM, worst error %.1f RPM\n", pi.getIntegral(), peak, worst);
+    print_status("Anti Windup Test", saturated && worst < SETPOINT * 0.01f && pi.getIntegral() <= 1.0f);
+}
+
+void ControlTest::test_roll_settles() {
+    PIController pi(KP, KI, KFF, 0.0f, 1.0f);
+    RollController roll(ANGLE_KP, RATE_KP, RATE_KI, 30.0f, 20000.0f, 1000.0f, 6000.0f);
+    MotorModel wheel = {0.0f, MAX_RPM, 1.0f, 0.0f, 0.1f};
+    run(pi, wheel, SETPOINT, 3.0f);
+
+    BodyModel body = {20.0f, 0.0f, 50.0f, 0.0f};
+    roll.engage(wheel.rpm);
+    float worst = run_roll(roll, pi, wheel, body, 0.0f, 5.0f);
+    pc->printf("  roll %.2f deg, rate %.2f dps, wheel %.0f RPM, worst error %.2f deg\n",
+        body.roll, body.rate, wheel.rpm, worst);
+    print_status("Roll Settles Test", worst < 0.5f && fabsf(body.rate) < 0.5f);
+}
+
+void ControlTest::test_roll_rejects_disturbance() {
+    // A steady torque is absorbed by the wheel speeding up or slowing down
+    PIController pi(KP, KI, KFF, 0.0f, 1.0f);
+    RollController roll(ANGLE_KP, RATE_KP, RATE_KI, 30.0f, 20000.0f, 1000.0f, 6000.0f);
+    MotorModel wheel = {0.0f, MAX_RPM, 1.0f, 0.0f, 0.1f};
+    run(pi, wheel, SETPOINT, 3.0f);
+
+    BodyModel body = {0.0f, 0.0f, 50.0f, 2.0f};
+    roll.engage(wheel.rpm);
+    float worst = run_roll(roll, pi, wheel, body, 10.0f, 10.0f);
+    pc->printf("  roll %.2f deg (target 10), wheel %.0f RPM, worst error %.2f deg\n", body.roll, wheel.rpm, worst);
+    print_status("Roll Rejects Disturbance Test", worst < 0.5f && !roll.isWheelSaturated());
+}
+
+void ControlTest::test_roll_wheel_saturation() {
+    // More torque than the wheel can take: the setpoint stops at its limit instead of running away
+    PIController pi(KP, KI, KFF, 0.0f, 1.0f);
+    RollController roll(ANGLE_KP, RATE_KP, RATE_KI, 30.0f, 20000.0f, 1000.0f, 6000.0f);
+    MotorModel wheel = {0.0f, MAX_RPM, 1.0f, 0.0f, 0.1f};
+    run(pi, wheel, SETPOINT, 3.0f);
+
+    BodyModel body = {0.0f, 0.0f, 50.0f, 40.0f};
+    roll.engage(wheel.rpm);
+    run_roll(roll, pi, wheel, body, 0.0f, 10.0f);
+    pc->printf("  wheel setpoint %.0f RPM, saturated %d\n", roll.getWheelSetpoint(), roll.isWheelSaturated());
+    print_status("Roll Wheel Saturation Test", roll.isWheelSaturated() &&
+        (roll.getWheelSetpoint() == 1000.0f || roll.getWheelSetpoint() == 6000.0f));
+}
+
+void ControlTest::run_all_tests() {
+    pc->printf("\nRunning Control Tests...\n");
+
+    test_feed_forward_only();
+    test_tracks_setpoint();
+    test_rejects_load_step();
+    test_rejects_supply_sag();
+    test_anti_windup();
+    test_roll_settles();
+    test_roll_rejects_disturbance();
+    test_roll_wheel_saturation();
+
+    pc->printf("\nAll control tests completed.\n");
+}
@@ -0,0 +1,61 @@
+#ifndef CONTROL_TEST_H
+#define CONTROL_TEST_H
+
+#include "mbed.h"
+#include "pi_controller.h"
+#include "roll_controller.h"
+#include "USBSerial.h"
+
+class ControlTest {
+public:
+    // Constructor
+    ControlTest(USBSerial* serial);
+
+    // Runs all tests
+    void run_all_tests();
+
+    // Individual test functions, against a simulated motor so no hardware is needed
+    void test_feed_forward_only();
+    void test_tracks_setpoint();
+    void test_rejects_load_step();
+    void test_rejects_supply_sag();
+    void test_anti_windup();
+    void test_roll_settles();
+    void test_roll_rejects_disturbance();
+    void test_roll_wheel_saturation();
+
+private:
+    // First order motor and ESC: full command spins up to max_rpm * supply within tau
+    struct MotorModel {
+        float rpm;
+        float max_rpm;
+        float supply;       // 1.0 = nominal battery voltage
+        float load_rpm;     // speed lost to load at the current command
+        float tau;
+
+        float step(float command, float dt);
+    };
+
+    // Body spinning on the wheel axis: wheel speed changes turn it the other way
+    struct BodyModel {
+        float roll;         // deg
+        float rate;         // deg/s
+        float inertia;      // body / wheel moment of inertia
+        float disturbance;  // deg/s^2 from outside torques
+    };
+
+    // Runs the roll cascade for seconds with one sample of sensor latency, returns the largest |roll error| in the last second
+    float run_roll(RollController& roll, PIController& pi, MotorModel& wheel, BodyModel& body,
+                   float target, float seconds);
+
+    // Runs the loop for seconds at the main.cpp rate, returns the largest |error| in the last second
+    float run(PIController& pi, MotorModel& motor, float setpoint, float seconds, float* peak = nullptr);
+
+    // Helper function to print test results
+    void print_status(const char* test_name, bool passed);
+
+    // Pointer to USB serial output for logging
+    USBSerial* pc;
+};
+
+#endif // CONTROL_TEST_H
@@ -0,0 +1,132 @@
+#include "encoder_test.h"
+#include "mbed.h"
+#include <cmath>
+
+#define SAMPLE_US   10000       // MOTOR_CONTROL_INTERVAL in main.cpp
+
+EncoderTest::EncoderTest(USBSerial* serial) {
+    this->pc = serial;
+}
+
+void EncoderTest::print_status(const char* test_name, bool passed) {
+    pc->printf("[%s] %s\n", passed ? "PASS" : "FAIL", test_name);
+}
+
+EncoderSnapshot EncoderTest::snapshot_at(double t_us, double p0, double speed, double accel) {
+    auto position = [&](double t) {
+        double s = t / 1e6;
+        return p0 + speed * s + 0.5 * accel * s * s;
+    };
+
+    EncoderSnapshot snapshot;
+    double p = position(t_us);
+    snapshot.count = static_cast<int32_t>(speed >= 0 ? floor(p) : ceil(p));
+    snapshot.direction = speed > 0 ? 1 : (speed < 0 ? -1 : 0);
+
+    // Search back for the time the position crossed the current count
+    double lo = 0.0, hi = t_us;
+    for (int i = 0; i < 60; i++) {
+        double mid = (lo + hi) / 2;
+        int32_t c = static_cast<int32_t>(speed >= 0 ? floor(position(mid)) : ceil(position(mid)));
+        if (c == snapshot.count) hi = mid; else lo = mid;
+    }
+    snapshot.edge_us = static_cast<uint32_t>(hi);
+    return snapshot;
+}
+
+void EncoderTest::test_velocity_constant_speed() {
+    EncoderVelocity v(2048);
+    const double speed = 6827.0;     // 200 RPM
+    bool ok = true;
+    for (int i = 0; i <= 100; i++) {
+        uint32_t t = i * SAMPLE_US;
+        v.update(snapshot_at(t, 0.5, speed, 0), t);
+        if (i >= 2 && fabs(v.getSpeed() - speed) > speed * 0.01) ok = false;
+    }
+    pc->printf("  %.1f RPM (expected 200.0)\n", v.getRPM());
+    print_status("Velocity Constant Speed Test", ok && fabs(v.getRPM() - 200.0f) < 2.0f);
+}
+
+void EncoderTest::test_velocity_low_speed() {
+    // 7 counts/s: fewer than one edge per sample, counting alone would read 0 or 100 counts/s
+    EncoderVelocity v(2048);
+    const double speed = 7.0;
+    bool ok = true;
+    for (int i = 0; i <= 300; i++) {
+        uint32_t t = i * SAMPLE_US;
+        v.update(snapshot_at(t, 0.5, speed, 0), t);
+        if (i >= 50 && fabs(v.getSpeed() - speed) > speed * 0.05) ok = false;
+    }
+    pc->printf("  %.2f counts/s (expected 7.00)\n", v.getSpeed());
+    print_status("Velocity Low Speed Test", ok);
+}
+
+void EncoderTest::test_velocity_reverse() {
+    EncoderVelocity v(2048);
+    const double speed = -3000.0;
+    for (int i = 0; i <= 50; i++) {
+        uint32_t t = i * SAMPLE_US;
+        v.update(snapshot_at(t, -0.5, speed, 0), t);
+    }
+    print_status("Velocity Reverse Test", fabs(v.getSpeed() - speed) < 30.0);
+}
+
+void EncoderTest::test_velocity_stop() {
+    EncoderVelocity v(2048);
+    uint32_t t = 0;
+    for (int i = 0; i <= 50; i++) {
+        t = i * SAMPLE_US;
+        v.update(snapshot_at(t, 0.5, 1000.0, 0), t);
+    }
+    float moving = v.getSpeed();
+
+    // Encoder stops: no more edges, the estimate must decay, then read zero
+    EncoderSnapshot last = snapshot_at(t, 0.5, 1000.0, 0);
+    bool decreasing = true;
+    float prev = moving;
+    for (int i = 1; i <= 60; i++) {
+        uint32_t now = t + i * SAMPLE_US;
+        v.update(last, now);
+        if (v.getSpeed() > prev) decreasing = false;
+        prev = v.getSpeed();
+    }
+    pc->printf("  %.1f counts/s moving, %.1f stopped\n", moving, v.getSpeed());
+    print_status("Velocity Stop Test", fabs(moving - 1000.0f) < 10.0f && decreasing && v.getSpeed() == 0.0f);
+}
+
+void EncoderTest::test_acceleration() {
+    EncoderVelocity v(2048);
+    const double accel = 20000.0;    // counts/s^2
+    for (int i = 0; i <= 100; i++) {
+        uint32_t t = i * SAMPLE_US;
+        v.update(snapshot_at(t, 0.5, 500.0, accel), t);
+    }
+    pc->printf("  %.0f counts/s^2 (expected 20000)\n", v.getAcceleration());
+    print_status("Acceleration Test", fabs(v.getAcceleration() - accel) < accel * 0.05);
+}
+
+void EncoderTest::test_count_past_16_bits() {
+    // 24000 RPM at 2048 PPR for one second runs past an int16 count
+    EncoderVelocity v(2048);
+    const double speed = 819200.0;
+    EncoderSnapshot s = {};
+    for (int i = 0; i <= 100; i++) {
+        uint32_t t = i * SAMPLE_US;
+        s = snapshot_at(t, 0.5, speed, 0);
+        v.update(s, t);
+    }
+    print_status("Count Past 16 Bits Test", s.count > 32767 && fabs(v.getRPM() - 24000.0f) < 24.0f);
+}
+
+void EncoderTest::run_all_tests() {
+    pc->printf("\nRunning Encoder Tests...\n");
+
+    test_velocity_constant_speed();
+    test_velocity_low_speed();
+    test_velocity_reverse();
+    test_velocity_stop();
+    test_acceleration();
+    test_count_past_16_bits();
+
+    pc->printf("\nAll encoder tests completed.\n");
+}
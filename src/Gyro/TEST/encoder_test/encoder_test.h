@@ -0,0 +1,36 @@
+#ifndef ENCODER_TEST_H
+#define ENCODER_TEST_H
+
+#include "mbed.h"
+#include "encoder.h"
+#include "encoder_velocity.h"
+#include "USBSerial.h"
+
+class EncoderTest {
+public:
+    // Constructor
+    EncoderTest(USBSerial* serial);
+
+    // Runs all tests
+    void run_all_tests();
+
+    // Individual test functions, on synthetic edges so no encoder is needed
+    void test_velocity_constant_speed();
+    void test_velocity_low_speed();
+    void test_velocity_reverse();
+    void test_velocity_stop();
+    void test_acceleration();
+    void test_count_past_16_bits();
+
+private:
+    // Helper function to print test results
+    void print_status(const char* test_name, bool passed);
+
+    // Snapshot at time t_us of an encoder at position p0 + speed * t + accel * t^2 / 2 (counts)
+    EncoderSnapshot snapshot_at(double t_us, double p0, double speed, double accel);
+
+    // Pointer to USB serial output for logging
+    USBSerial* pc;
+};
+
+#endif // ENCODER_TEST_H
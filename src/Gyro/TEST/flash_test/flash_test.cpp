@@ -1,5 +1,6 @@
 #include "flash_test.h"
 #include "func.h"
+#include "log_index.h"
 #include "mbed.h"
 
 FlashTest::FlashTest(flash* flashMem, USBSerial* serial) {
@@ -101,6 +102,60 @@ void FlashTest::test_read_write_float() {
     print_status("Write & Read Float Test", fabs(readValue - testValue) < 0.001f);
 }
 
+// Session (0x40) and encoder (0x04) entries, as log_entry_size() in main.cpp
+static size_t test_entry_size(uint8_t flags) {
+    return flags == 0x40 ? 14 : flags == 0x04 ? 21 : 0;
+}
+
+// A populated log: the end is found from the index in about the same time
+// as for an empty one, the part of boot before the first sample that
+// depends on the log (session_begin())
+void FlashTest::test_log_index_end() {
+    const uint32_t start = 0x100000, end = 0x140000, index = 0x140000;
+    const uint32_t budget_us = 20000;
+    flashMem->eraseRange(start, index + LOG_INDEX_SIZE);
+
+    LogIndex writer(flashMem, start, end, index, test_entry_size);
+    uint32_t empty_end = writer.findEnd();
+
+    // Fill all but the last 3 KB, a page per program
+    uint32_t addr = start;
+    uint8_t page[256];
+    size_t used = 0;
+    uint32_t page_addr = start;
+    for (int i = 0; addr + 21 <= end - 0xC00; i++) {
+        uint8_t flags = (i % 500 == 0) ? 0x40 : 0x04;
+        size_t n = test_entry_size(flags);
+        if (used + n > sizeof(page)) {
+            flashMem->write(page_addr, page, used);
+            page_addr += used;
+            used = 0;
+        }
+        memset(&page[used], i & 0xFF, n);
+        page[used] = flags;
+        used += n;
+        writer.noteEntry(addr);
+        addr += n;
+    }
+    flashMem->write(page_addr, page, used);
+
+    Timer timer;
+    timer.start();
+    LogIndex index_at_boot(flashMem, start, end, index, test_entry_size);
+    uint32_t found = index_at_boot.findEnd();
+    uint8_t session[14];
+    memset(session, 0xFF, sizeof(session));
+    session[0] = 0x40;
+    flashMem->write(found, session, sizeof(session));
+    index_at_boot.noteEntry(found);
+    uint32_t elapsed_us = chrono::duration_cast<chrono::microseconds>(timer.elapsed_time()).count();
+
+    pc->printf("  %u KB logged, end found and session written in %u us, %u bytes walked\n",
+        (addr - start) / 1024, elapsed_us, index_at_boot.getWalked());
+    print_status("Log Index End Test", empty_end == start && found == addr &&
+        index_at_boot.getWalked() < LOG_INDEX_SPAN + 21 && elapsed_us < budget_us);
+}
+
 void FlashTest::run_all_tests() {
     pc->printf("\nRunning W25Q16JV Flash Tests...\n");
 
@@ -110,6 +165,7 @@ void FlashTest::run_all_tests() {
     test_enable_disable_write();
     test_reset();
     test_read_write_float();
+    test_log_index_end();
 
     pc->printf("\nAll flash tests completed.\n");
 }
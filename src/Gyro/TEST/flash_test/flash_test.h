@@ -20,6 +20,7 @@ public:
     void test_enable_disable_write();
     void test_reset();
     void test_read_write_float();
+    void test_log_index_end();
 
 private:
     // Helper function to print test results
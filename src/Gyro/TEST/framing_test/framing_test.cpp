@@ -0,0 +1,416 @@
+#include "framing_test.h"
+#include "mbed.h"
+#include <vector>
+
+// Original heap based encoder, kept as the reference implementation
+static std::vector<uint8_t> reference_encode(const uint8_t* data, size_t len) {
+    std::vector<uint8_t> buf(len + 3, 0);
+    for (size_t i = 0; i < len; ++i) {
+        buf[i + 3] = data[i];
+    }
+    buf[0] = 234;
+    buf[1] = static_cast<uint8_t>(len + 3);
+    buf[2] = 0;
+
+    size_t count = 0;
+    size_t last_i = 2;
+    for (size_t i = 3; i < buf.size(); ++i) {
+        count += 1;
+        if (buf[i] == 234) {
+            buf[last_i] = static_cast<uint8_t>(count);
+            last_i = i;
+            count = 0;
+        }
+    }
+    buf[last_i] = 0;
+    return buf;
+}
+
+FramingTest::FramingTest(USBSerial* serial) {
+    this->pc = serial;
+}
+
+void FramingTest::print_status(const char* test_name, bool passed) {
+    pc->printf("[%s] %s\n", passed ? "PASS" : "FAIL", test_name);
+}
+
+void FramingTest::fill_payload(uint8_t* buf, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        int r = rand() % 4;
+        buf[i] = (r == 0) ? FRAME_START : (r == 1) ? 0 : static_cast<uint8_t>(rand());
+    }
+}
+
+void FramingTest::test_encode_matches_reference() {
+    uint8_t payload[FRAME_MAX_PAYLOAD];
+    uint8_t out[FRAME_MAX_SIZE];
+    bool passed = true;
+
+    for (int i = 0; i < 500 && passed; i++) {
+        size_t len = rand() % (FRAME_MAX_PAYLOAD + 1);
+        fill_payload(payload, len);
+
+        std::vector<uint8_t> expected = reference_encode(payload, len);
+        size_t n = frameEncode(payload, len, out);
+        passed = n == expected.size() && memcmp(out, expected.data(), n) == 0;
+    }
+
+    print_status("Encode Matches Reference Test", passed);
+}
+
+void FramingTest::test_streaming_encoder() {
+    uint8_t payload[FRAME_MAX_PAYLOAD];
+    uint8_t out[FRAME_MAX_SIZE];
+    FrameEncoder enc;
+    bool passed = true;
+
+    for (int i = 0; i < 500 && passed; i++) {
+        size_t len = rand() % (FRAME_MAX_PAYLOAD + 1);
+        fill_payload(payload, len);
+
+        enc.begin();
+        for (size_t j = 0; j < len; j++) {
+            enc.put(payload[j]);
+        }
+        enc.finish();
+
+        size_t n = frameEncode(payload, len, out);
+        passed = enc.size() == n && memcmp(enc.data(), out, n) == 0;
+    }
+
+    print_status("Streaming Encoder Test", passed);
+}
+
+void FramingTest::test_round_trip() {
+    uint8_t payload[FRAME_MAX_PAYLOAD];
+    uint8_t out[FRAME_MAX_SIZE];
+    FrameDecoder dec;
+    bool passed = true;
+
+    for (int i = 0; i < 500 && passed; i++) {
+        size_t len = rand() % (FRAME_MAX_PAYLOAD + 1);
+        fill_payload(payload, len);
+        size_t n = frameEncode(payload, len, out);
+
+        int frames = 0;
+        for (size_t j = 0; j < n; j++) {
+            if (dec.feed(out[j]) == FrameDecoder::Frame) {
+                frames++;
+                passed = passed && j == n - 1 && dec.length() == len &&
+                         memcmp(dec.payload(), payload, len) == 0;
+            }
+        }
+        passed = passed && frames == 1;
+    }
+
+    print_status("Round Trip Test", passed);
+}
+
+void FramingTest::test_resync_after_noise() {
+    const uint8_t msg[] = "start";
+    uint8_t out[FRAME_MAX_SIZE];
+    size_t n = frameEncode(msg, sizeof(msg) - 1, out);
+
+    // Line noise and a malformed header (length < 3) ahead of a good frame
+    FrameDecoder dec;
+    const uint8_t noise[] = {0x55, 0xAA, 1, 2, FRAME_START, 1};
+    bool error = false;
+    for (uint8_t b : noise) {
+        error = error || dec.feed(b) == FrameDecoder::Error;
+    }
+
+    bool found = false;
+    for (size_t i = 0; i < n; i++) {
+        if (dec.feed(out[i]) == FrameDecoder::Frame) {
+            found = dec.length() == sizeof(msg) - 1 && memcmp(dec.payload(), msg, dec.length()) == 0;
+        }
+    }
+
+    print_status("Resync After Noise Test", found && error && dec.getSkipped() == 4);
+}
+
+void FramingTest::test_rejects_oversize() {
+    uint8_t payload[FRAME_MAX_PAYLOAD + 1] = {0};
+    uint8_t out[FRAME_MAX_SIZE + 1];
+    FrameEncoder enc;
+
+    bool passed = frameEncode(payload, sizeof(payload), out) == 0;
+    passed = passed && !enc.put(payload, sizeof(payload));
+    passed = passed && enc.put(payload, FRAME_MAX_PAYLOAD) && !enc.put(0);
+
+    print_status("Reject Oversize Payload Test", passed);
+}
+
+void FramingTest::test_fec_corrects_errors() {
+    uint8_t msg[FRAME_MAX_PAYLOAD];
+    uint8_t coded[FRAME_MAX_PAYLOAD];
+    uint8_t out[FRAME_MAX_PAYLOAD];
+    bool passed = true;
+
+    static const size_t correctable[FEC_MODES] = {0, 4 * 2, 8 * 2, 8 * 4};
+
+    for (uint8_t mode = FEC_LIGHT; mode < FEC_MODES; mode++) {
+        for (int i = 0; i < 100 && passed; i++) {
+            size_t len = 1 + rand() % fecMaxData(mode);
+            fill_payload(msg, len);
+            size_t n = fecEncode(mode, msg, len, coded);
+
+            // A burst of roots / 2 bytes per codeword inside the data or the
+            // parity, spread over the codewords by the interleaver
+            size_t burst = correctable[mode];
+            size_t at = (len >= burst) ? 1 + rand() % (len - burst + 1) : 1 + len;
+            for (size_t j = 0; j < burst; j++) {
+                coded[at + j] ^= 1 + rand() % 255;
+            }
+
+            size_t out_len = 0;
+            int fixed = fecDecode(coded, n, out, out_len);
+            passed = fixed == static_cast<int>(burst) && out_len == len &&
+                     memcmp(out, msg, len) == 0;
+        }
+    }
+
+    print_status("FEC Corrects Errors Test", passed);
+}
+
+void FramingTest::test_fec_passes_uncoded() {
+    const uint8_t msg[] = {RADIO_MSG_TELEMETRY, 1, 2, 3};
+    uint8_t coded[FRAME_MAX_PAYLOAD];
+    uint8_t out[FRAME_MAX_PAYLOAD];
+    size_t out_len = 0;
+
+    bool passed = fecDecode(msg, sizeof(msg), out, out_len) == FEC_UNCODED;
+    passed = passed && fecEncode(FEC_OFF, msg, sizeof(msg), coded) == sizeof(msg);
+    passed = passed && fecEncode(FEC_HEAVY, msg, fecMaxData(FEC_HEAVY) + 1, coded) == 0;
+
+    print_status("FEC Passes Uncoded Test", passed);
+}
+
+// Downloads a fake log through DownloadClient with every third chunk lost
+void FramingTest::test_download_with_loss() {
+    static uint8_t log[DL_CHUNK_SIZE * 20 + 50];
+    static uint8_t copy[sizeof(log)];
+    fill_payload(log, sizeof(log));
+    memset(copy, 0, sizeof(copy));
+
+    DownloadClient client(40);
+    uint32_t now = 0;
+    uint32_t sent = 0;
+    client.start(0, now);
+
+    for (int step = 0; step < 1000 && client.getState() != DownloadClient::Done; step++) {
+        size_t len;
+        const uint8_t* req = client.poll(now, len);
+        uint8_t reply[DL_DATA_MAX_SIZE];
+        uint32_t base, mask;
+
+        if (req && dlIsInfoRequest(req, len)) {
+            size_t n = dlPackInfo(sizeof(log), reply);
+            client.onMessage(reply, n, now);
+        } else if (req && dlParseRead(req, len, base, mask)) {
+            for (uint32_t i = 0; i < 32; i++) {
+                uint32_t offset = base + i * DL_CHUNK_SIZE;
+                if (!(mask & (1u << i)) || offset >= sizeof(log)) {
+                    continue;
+                }
+                now += 40;
+                if (sent++ % 3 == 2) {
+                    continue;
+                }
+                size_t chunk = sizeof(log) - offset < DL_CHUNK_SIZE ? sizeof(log) - offset : DL_CHUNK_SIZE;
+                size_t n = dlPackData(offset, &log[offset], chunk, reply);
+                if (client.onMessage(reply, n, now) == DownloadClient::Chunk) {
+                    memcpy(&copy[client.chunkOffset()], client.chunk(), client.chunkLength());
+                }
+            }
+        }
+        now += 10;
+    }
+
+    bool passed = client.getState() == DownloadClient::Done &&
+                  client.getOffset() == sizeof(log) &&
+                  client.getRepeats() > 0 &&
+                  memcmp(log, copy, sizeof(log)) == 0;
+
+    // A corrupted chunk must be rejected
+    uint8_t reply[DL_DATA_MAX_SIZE];
+    size_t n = dlPackData(0, log, DL_CHUNK_SIZE, reply);
+    reply[10] ^= 0x01;
+    client.start(0, now);
+    passed = passed && client.onMessage(reply, n, now) == DownloadClient::Corrupt;
+
+    print_status("Download With Loss Test", passed);
+}
+
+// Node envelope checks and slot timing of a node synced from a beacon
+void FramingTest::test_tdma_slots() {
+    const uint8_t msg[] = {RADIO_MSG_TELEMETRY, 1, 2, 3};
+    uint8_t wrapped[sizeof(msg) + TDMA_NODE_OVERHEAD];
+    size_t len = nodeWrap(3, msg, sizeof(msg), wrapped);
+
+    const uint8_t* inner = wrapped;
+    uint8_t node = 0;
+    bool passed = nodeUnwrap(inner, len, node) && node == 3 && len == sizeof(msg) &&
+                  memcmp(inner, msg, len) == 0;
+
+    wrapped[1] ^= 0x01;         // node 3 -> 2 without fixing the check nibble
+    inner = wrapped;
+    len = sizeof(wrapped);
+    passed = passed && !nodeUnwrap(inner, len, node);
+
+    TdmaSchedule schedule = {4, 40, 22};
+    uint8_t beacon[TDMA_BEACON_SIZE];
+    tdmaPackBeacon(schedule, 0, beacon);
+
+    // Beacon sent at t = 1000 (one guard into the ground slot), seen 10 ms later
+    TdmaNode tdma;
+    tdma.setNode(2, 0);
+    passed = passed && tdma.timeUntilSlot(500, 60) != 0;     // waiting for the first beacon
+    passed = passed && tdma.onBeacon(beacon, sizeof(beacon), 1010, 10);
+
+    // Slot 2 is on air from 1000 - guard + 40 + 22 + guard = 1062, after a 4 ms UART transfer
+    size_t air = 60;
+    uint32_t lead = tdmaUartMs(air);
+    uint32_t first = 1062 - lead;
+    passed = passed && tdma.timeUntilSlot(first - 1, air) == 1;
+    passed = passed && tdma.timeUntilSlot(first, air) == 0;
+    passed = passed && tdma.timeUntilSlot(first + 20, air) != 0;
+    passed = passed && tdma.timeUntilSlot(first + schedule.period(), air) == 0;
+
+    tdma.onTransmit(first, air);
+    passed = passed && tdma.timeUntilSlot(first + 1, air) != 0;
+
+    print_status("TDMA Slots Test", passed);
+}
+
+// Fields are dropped from the lowest priority up: with room between field
+// sizes a smaller, later field is not sent in place of a larger one
+void FramingTest::test_telemetry_budget() {
+    const size_t fixed = RADIO_AIR_OVERHEAD + FRAME_OVERHEAD + fecOverhead(FEC_OFF) +
+                         RADIO_TLM_BASE_SIZE + RADIO_TLM_CRC_SIZE;
+    static const struct { size_t room; uint8_t mask; uint32_t dropped; } cases[] = {
+        { 7,  0,                                               3 },    // acc (6) would fit, quat (8) does not
+        { 8,  RADIO_TLM_QUAT,                                  2 },    // acc would fit after quat, enc does not
+        { 16, RADIO_TLM_QUAT | RADIO_TLM_ENC,                  1 },
+        { 22, RADIO_TLM_QUAT | RADIO_TLM_ENC | RADIO_TLM_ACC,  0 },
+    };
+
+    RadioTelemetrySample sample = {};
+    uint8_t out[RADIO_TLM_MAX_SIZE];
+    bool passed = true;
+    for (const auto& c : cases) {
+        RadioTelemetry telem(nullptr, 10, 1.0f);
+        telem.setFec(FEC_OFF);
+        telem.setSlotBytes(fixed + c.room);
+        size_t len = telem.pack(sample, out);
+        if (len == 0 || out[1] != c.mask || telem.getFieldsDropped() != c.dropped) {
+            pc->printf("  room %u: mask 0x%02x, %u dropped\n", static_cast<unsigned>(c.room), len ? out[1] : 0, telem.getFieldsDropped());
+            passed = false;
+        }
+    }
+
+    print_status("Telemetry Budget Test", passed);
+}
+
+// Reports encode and decode cost in bytes per CPU cycle using the DWT cycle counter
+void FramingTest::benchmark() {
+    uint8_t payload[FRAME_MAX_PAYLOAD];
+    uint8_t out[FRAME_MAX_SIZE];
+    fill_payload(payload, sizeof(payload));
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    const int runs = 100;
+    size_t n = 0;
+
+    uint32_t start = DWT->CYCCNT;
+    for (int i = 0; i < runs; i++) {
+        n = frameEncode(payload, sizeof(payload), out);
+    }
+    uint32_t encode_cycles = DWT->CYCCNT - start;
+
+    FrameDecoder dec;
+    start = DWT->CYCCNT;
+    for (int i = 0; i < runs; i++) {
+        for (size_t j = 0; j < n; j++) {
+            dec.feed(out[j]);
+        }
+    }
+    uint32_t decode_cycles = DWT->CYCCNT - start;
+
+    start = DWT->CYCCNT;
+    for (int i = 0; i < runs; i++) {
+        std::vector<uint8_t> ref = reference_encode(payload, sizeof(payload));
+    }
+    uint32_t reference_cycles = DWT->CYCCNT - start;
+
+    float bytes = static_cast<float>(runs) * sizeof(payload);
+    pc->printf("encode:    %.3f bytes/cycle\n", bytes / encode_cycles);
+    pc->printf("decode:    %.3f bytes/cycle\n", bytes / decode_cycles);
+    pc->printf("reference: %.3f bytes/cycle\n", bytes / reference_cycles);
+}
+
+// Cycles per telemetry sized message for each FEC mode, clean and with the
+// largest burst every codeword can still correct
+void FramingTest::benchmark_fec() {
+    uint8_t msg[RADIO_TLM_MAX_SIZE];
+    uint8_t coded[FRAME_MAX_PAYLOAD];
+    uint8_t noisy[FRAME_MAX_PAYLOAD];
+    uint8_t out[FRAME_MAX_PAYLOAD];
+    size_t out_len;
+    fill_payload(msg, sizeof(msg));
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    const int runs = 20;
+    for (uint8_t mode = FEC_LIGHT; mode < FEC_MODES; mode++) {
+        size_t n = 0;
+        uint32_t start = DWT->CYCCNT;
+        for (int i = 0; i < runs; i++) {
+            n = fecEncode(mode, msg, sizeof(msg), coded);
+        }
+        uint32_t encode_cycles = (DWT->CYCCNT - start) / runs;
+
+        start = DWT->CYCCNT;
+        for (int i = 0; i < runs; i++) {
+            fecDecode(coded, n, out, out_len);
+        }
+        uint32_t clean_cycles = (DWT->CYCCNT - start) / runs;
+
+        memcpy(noisy, coded, n);
+        for (size_t j = 1; j < n; j += n / 4) {
+            noisy[j] ^= 0x5A;
+        }
+        start = DWT->CYCCNT;
+        for (int i = 0; i < runs; i++) {
+            fecDecode(noisy, n, out, out_len);
+        }
+        uint32_t noisy_cycles = (DWT->CYCCNT - start) / runs;
+
+        pc->printf("fec mode %u (%u bytes): encode %u, decode %u clean / %u with errors cycles\n",
+            mode, n, encode_cycles, clean_cycles, noisy_cycles);
+    }
+}
+
+void FramingTest::run_all_tests() {
+    pc->printf("\nRunning Framing Tests...\n");
+
+    test_encode_matches_reference();
+    test_streaming_encoder();
+    test_round_trip();
+    test_resync_after_noise();
+    test_rejects_oversize();
+    test_fec_corrects_errors();
+    test_fec_passes_uncoded();
+    test_download_with_loss();
+    test_tdma_slots();
+    test_telemetry_budget();
+    benchmark();
+    benchmark_fec();
+
+    pc->printf("\nAll framing tests completed.\n");
+}
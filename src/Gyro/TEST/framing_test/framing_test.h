@@ -0,0 +1,46 @@
+#ifndef FRAMING_TEST_H
+#define FRAMING_TEST_H
+
+#include "mbed.h"
+#include "framing.h"
+#include "fec.h"
+#include "radio_protocol.h"
+#include "download.h"
+#include "tdma.h"
+#include "radio_telemetry.h"
+#include "USBSerial.h"
+
+class FramingTest {
+public:
+    // Constructor
+    FramingTest(USBSerial* serial);
+
+    // Runs all tests
+    void run_all_tests();
+
+    // Individual test functions
+    void test_encode_matches_reference();
+    void test_streaming_encoder();
+    void test_round_trip();
+    void test_resync_after_noise();
+    void test_rejects_oversize();
+    void test_fec_corrects_errors();
+    void test_fec_passes_uncoded();
+    void test_download_with_loss();
+    void test_tdma_slots();
+    void test_telemetry_budget();
+    void benchmark();
+    void benchmark_fec();
+
+private:
+    // Helper function to print test results
+    void print_status(const char* test_name, bool passed);
+
+    // Fills buf with random bytes biased towards FRAME_START
+    void fill_payload(uint8_t* buf, size_t len);
+
+    // Pointer to USB serial output for logging
+    USBSerial* pc;
+};
+
+#endif // FRAMING_TEST_H
@@ -0,0 +1,176 @@
+#include "profiler_test.h"
+#include "mbed.h"
+#include "rtx_os.h"
+
+PROFILE_PROBE(test_probe, "test");
+PROFILE_PROBE(test_wait, "test wait");
+TRACE_MARKER(test_mark, "test mark");
+HeapWatch test_heap("test heap");
+
+ProfilerTest::ProfilerTest(USBSerial* serial) {
+    this->pc = serial;
+}
+
+void ProfilerTest::print_status(const char* test_name, bool passed) {
+    pc->printf("[%s] %s\n", passed ? "PASS" : "FAIL", test_name);
+}
+
+void ProfilerTest::test_record_statistics() {
+    test_probe.reset();
+    test_probe.record(100);
+    test_probe.record(300);
+    test_probe.record(200);
+    ProfileStats stats = test_probe.getStats();
+
+    bool ok = stats.count == 3 && stats.min == 100 && stats.max == 300 && stats.total == 600;
+    test_probe.reset();
+    stats = test_probe.getStats();
+    ok &= stats.count == 0 && stats.min == 0 && stats.max == 0;
+    print_status("Record Statistics Test", ok);
+}
+
+void ProfilerTest::test_histogram_bins() {
+    test_probe.reset();
+    test_probe.record(0);           // bin 0
+    test_probe.record(63);          // bin 0
+    test_probe.record(64);          // bin 1
+    test_probe.record(127);         // bin 1
+    test_probe.record(128);         // bin 2
+    test_probe.record(UINT32_MAX);  // last bin
+    ProfileStats stats = test_probe.getStats();
+
+    bool ok = stats.hist[0] == 2 && stats.hist[1] == 2 && stats.hist[2] == 1 &&
+              stats.hist[PROFILE_HIST_BINS - 1] == 1 &&
+              PROFILE_BIN_END(0) == 64 && PROFILE_BIN_END(2) == 256;
+    test_probe.reset();
+    print_status("Histogram Bins Test", ok);
+}
+
+void ProfilerTest::test_scope_timing() {
+    test_wait.reset();
+    for (int i = 0; i < 10; i++) {
+        PROFILE_SCOPE(test_wait);
+        wait_us(100);
+    }
+    ProfileStats stats = test_wait.getStats();
+    float per_us = static_cast<float>(profilerCyclesPerUs());
+    float mean_us = stats.total / per_us / stats.count;
+    pc->printf("  wait_us(100): min %.1f, mean %.1f, max %.1f us\n",
+        stats.min / per_us, mean_us, stats.max / per_us);
+
+    bool ok = stats.count == 10 && stats.min / per_us >= 100.0f && mean_us < 150.0f;
+    print_status("Scope Timing Test", ok);
+}
+
+void ProfilerTest::test_overhead() {
+    uint32_t cycles = profilerOverhead();
+    pc->printf("  empty scope: %u cycles\n", cycles);
+    print_status("Probe Overhead Test", cycles > 0 && cycles < 100);
+}
+
+void ProfilerTest::test_cpu_load() {
+    profilerSample();
+    ThisThread::sleep_for(200ms);       // idle
+    profilerSample();
+    float idle_load = profilerLoad();
+
+    wait_us(200000);                    // busy
+    profilerSample();
+    float busy_load = profilerLoad();
+
+    pc->printf("  load sleeping %.1f%%, busy waiting %.1f%%\n", idle_load * 100.0f, busy_load * 100.0f);
+    print_status("CPU Load Test", idle_load < 0.2f && busy_load > 0.9f);
+}
+
+// Scopes trace a begin and an end on this thread, in order, only while tracing
+void ProfilerTest::test_trace_events() {
+    traceStart(TRACE_DRIVER);
+    {
+        PROFILE_SCOPE(test_probe);
+    }
+    TRACE_MARK(test_mark, 7);       // not in the mask
+    traceStop();
+    {
+        PROFILE_SCOPE(test_probe);
+    }
+
+    TraceEvent events[3];
+    size_t n = traceRead(0, events, 3);
+    const char* thread = traceThreadName(events[0].thread);
+    const char* expected = ThisThread::get_name() ? ThisThread::get_name() : "";
+    bool ok = n == 2 && traceCount() == 2 &&
+              events[0].phase == TRACE_BEGIN && events[1].phase == TRACE_END &&
+              events[0].name == test_probe.getId() && events[1].name == test_probe.getId() &&
+              events[0].thread != 0 && events[0].thread == events[1].thread &&
+              thread && strncmp(thread, expected, TRACE_THREAD_NAME) == 0 &&
+              events[1].cycles - events[0].cycles < 1000;
+    print_status("Trace Events Test", ok);
+}
+
+// A trigger keeps half a ring of events after it, then stops
+void ProfilerTest::test_trace_trigger() {
+    traceStart(TRACE_ALL, true);
+    for (int i = 0; i < TRACE_EVENTS; i++) {
+        PROFILE_SCOPE(test_probe);
+    }
+    TRACE_MARK(test_mark, 7);
+    traceTrigger();
+    for (int i = 0; i < TRACE_EVENTS; i++) {
+        PROFILE_SCOPE(test_probe);
+    }
+
+    // The mark is the last event of the first half
+    TraceEvent mark;
+    bool ok = !traceRunning() && traceTriggered() && traceCount() == TRACE_EVENTS &&
+              traceRead(TRACE_EVENTS / 2 - 1, &mark, 1) == 1 &&
+              mark.phase == TRACE_INSTANT && mark.name == test_mark.getId() && mark.arg == 7;
+    print_status("Trace Trigger Test", ok);
+}
+
+// Only the run that allocates counts, needs platform.heap-stats-enabled
+void ProfilerTest::test_heap_watch() {
+    HeapStats before = test_heap.getStats();
+    {
+        HeapScope scope(test_heap);
+    }
+    uint8_t* block;
+    {
+        HeapScope scope(test_heap);
+        block = new uint8_t[64];
+    }
+    delete[] block;
+
+    HeapStats after = test_heap.getStats();
+    bool ok = after.runs == before.runs + 2 && after.allocating == before.allocating + 1 &&
+              after.bytes >= before.bytes + 64 && after.peak >= 64 && after.thread == ThisThread::get_id();
+    print_status("Heap Watch Test", ok);
+}
+
+// The deepest word off the fill pattern sets the high-water mark
+void ProfilerTest::test_stack_used() {
+    uint32_t stack[64];
+    for (int i = 0; i < 64; i++) {
+        stack[i] = osRtxStackFillPattern;
+    }
+    stack[0] = osRtxStackMagicWord;
+    bool ok = stackUsed(stack, sizeof(stack)) == 0;
+    stack[40] = 0;
+    ok = ok && stackUsed(stack, sizeof(stack)) == 24 * sizeof(uint32_t);
+    print_status("Stack Used Test", ok);
+}
+
+void ProfilerTest::run_all_tests() {
+    pc->printf("\nRunning Profiler Tests...\n");
+
+    test_record_statistics();
+    test_histogram_bins();
+    test_scope_timing();
+    test_overhead();
+    test_cpu_load();
+    test_trace_events();
+    test_trace_trigger();
+    test_heap_watch();
+    test_stack_used();
+
+    pc->printf("\nAll profiler tests completed.\n");
+}
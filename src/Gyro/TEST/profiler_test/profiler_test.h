@@ -0,0 +1,36 @@
+#ifndef PROFILER_TEST_H
+#define PROFILER_TEST_H
+
+#include "mbed.h"
+#include "profiler.h"
+#include "mem_stats.h"
+#include "USBSerial.h"
+
+class ProfilerTest {
+public:
+    // Constructor
+    ProfilerTest(USBSerial* serial);
+
+    // Runs all tests
+    void run_all_tests();
+
+    // Individual test functions, profilerStart() must have been called
+    void test_record_statistics();
+    void test_histogram_bins();
+    void test_scope_timing();
+    void test_overhead();
+    void test_cpu_load();
+    void test_trace_events();
+    void test_trace_trigger();
+    void test_heap_watch();
+    void test_stack_used();
+
+private:
+    // Helper function to print test results
+    void print_status(const char* test_name, bool passed);
+
+    // Pointer to USB serial output for logging
+    USBSerial* pc;
+};
+
+#endif // PROFILER_TEST_H
@@ -0,0 +1,269 @@
+#include "scheduler_test.h"
+#include "mbed.h"
+#include "hal/us_ticker_api.h"
+
+SchedulerTest::SchedulerTest(USBSerial* serial) {
+    this->pc = serial;
+}
+
+void SchedulerTest::print_status(const char* test_name, bool passed) {
+    pc->printf("[%s] %s\n", passed ? "PASS" : "FAIL", test_name);
+}
+
+void SchedulerTest::Probe::run() {
+    if (runs == 0) {
+        first_us = us_ticker_read();
+    }
+    if (ordered < 2) {
+        order[ordered++] = 1;
+    }
+    runs++;
+    if (busy_us) {
+        wait_us(busy_us);
+    }
+}
+
+void SchedulerTest::Probe::after() {
+    if (ordered < 2) {
+        order[ordered++] = 2;
+    }
+}
+
+// The groups main.cpp uses, counted over one second
+void SchedulerTest::test_rates() {
+    Probe probes[4] = {};
+    RateGroup fast ("1kHz", 1, 0, osPriorityRealtime, 1024);
+    RateGroup medium ("100Hz", 10, 1, osPriorityAboveNormal, 1024);
+    RateGroup slow ("20Hz", 50, 3, osPriorityNormal, 1024);
+    RateGroup slowest ("5Hz", 200, 7, osPriorityBelowNormal, 1024);
+    RateGroup* groups[] = {&fast, &medium, &slow, &slowest};
+    RateScheduler scheduler;
+    for (int i = 0; i < 4; i++) {
+        groups[i]->add(callback(&probes[i], &Probe::run));
+        scheduler.add(groups[i]);
+    }
+
+    scheduler.start();
+    ThisThread::sleep_for(1000ms);
+
+    const uint32_t expected[] = {1000, 100, 20, 5};
+    bool ok = true;
+    for (int i = 0; i < 4; i++) {
+        RateGroupStats stats = groups[i]->getStats();
+        uint32_t runs = probes[i].runs;
+        pc->printf("  %s: %u runs (expected %u), jitter max %u us, %u overruns\n",
+            groups[i]->getName(), runs, expected[i], stats.jitter_max_us, stats.overruns);
+        if (runs + 2 < expected[i] || runs > expected[i] + 2) ok = false;
+        if (stats.overruns != 0) ok = false;
+        if (stats.jitter_max_us > 500) ok = false;
+    }
+    print_status("Rate Group Rates Test", ok);
+}
+
+// Groups start on their phase tick after the scheduler starts
+void SchedulerTest::test_phases() {
+    Probe probes[3] = {};
+    RateGroup a ("a", 10, 0, osPriorityHigh, 1024);
+    RateGroup b ("b", 10, 3, osPriorityAboveNormal, 1024);
+    RateGroup c ("c", 10, 7, osPriorityNormal, 1024);
+    RateGroup* groups[] = {&a, &b, &c};
+    RateScheduler scheduler;
+    for (int i = 0; i < 3; i++) {
+        groups[i]->add(callback(&probes[i], &Probe::run));
+        scheduler.add(groups[i]);
+    }
+
+    scheduler.start();
+    ThisThread::sleep_for(100ms);
+
+    const uint32_t phases[] = {0, 3, 7};
+    bool ok = true;
+    for (int i = 1; i < 3; i++) {
+        int32_t offset = static_cast<int32_t>(probes[i].first_us - probes[0].first_us);
+        pc->printf("  %s starts %d us after a (expected %u)\n",
+            groups[i]->getName(), offset, phases[i] * RATE_TICK_US);
+        if (offset < static_cast<int32_t>(phases[i] * RATE_TICK_US) - 200 ||
+            offset > static_cast<int32_t>(phases[i] * RATE_TICK_US) + 200) {
+            ok = false;
+        }
+    }
+    print_status("Rate Group Phase Test", ok);
+}
+
+void SchedulerTest::test_task_order() {
+    Probe probe = {};
+    RateGroup group ("group", 10, 0, osPriorityNormal, 1024);
+    RateScheduler scheduler;
+    group.add(callback(&probe, &Probe::run));
+    group.add(callback(&probe, &Probe::after));
+    scheduler.add(&group);
+
+    scheduler.start();
+    ThisThread::sleep_for(50ms);
+
+    print_status("Task Order Test", probe.ordered == 2 && probe.order[0] == 1 && probe.order[1] == 2);
+}
+
+// A run longer than the period skips releases instead of queueing them
+void SchedulerTest::test_overrun() {
+    Probe probe = {};
+    probe.busy_us = 15000;
+    RateGroup group ("group", 10, 0, osPriorityNormal, 1024);
+    RateScheduler scheduler;
+    group.add(callback(&probe, &Probe::run));
+    scheduler.add(&group);
+
+    scheduler.start();
+    ThisThread::sleep_for(1000ms);
+
+    RateGroupStats stats = group.getStats();
+    pc->printf("  %u runs, %u overruns, longest run %u us\n", stats.runs, stats.overruns, stats.exec_max_us);
+    bool ok = stats.overruns >= 45 && stats.runs >= 45 && stats.runs <= 55 &&
+              stats.exec_max_us >= 15000 && stats.jitter_max_us < 1000;
+    print_status("Overrun Test", ok);
+}
+
+void SchedulerTest::test_registration() {
+    Probe probe = {};
+    RateGroup group ("group", 10, 0, osPriorityNormal, 1024);
+    RateGroup extra ("extra", 10, 0, osPriorityNormal, 1024);
+    RateScheduler scheduler;
+
+    bool ok = true;
+    for (int i = 0; i < RATE_MAX_TASKS; i++) {
+        ok &= group.add(callback(&probe, &Probe::after));
+    }
+    ok &= !group.add(callback(&probe, &Probe::after));
+    for (int i = 0; i < RATE_MAX_GROUPS - 1; i++) {
+        ok &= scheduler.add(&group);
+    }
+    ok &= scheduler.add(&extra);
+    ok &= !scheduler.add(&extra);
+    ok &= scheduler.getStackBytes() == RATE_MAX_GROUPS * 1024;
+    print_status("Registration Limits Test", ok);
+}
+
+void SchedulerTest::test_monitor_deadline() {
+    TaskMonitor monitor;
+    int id = monitor.add("task", 10000);
+    monitor.start(0);
+
+    monitor.report(id, 0, 1000, 9000);          // on time
+    monitor.report(id, 10000, 10500, 20000);    // exactly on the deadline
+    monitor.report(id, 20000, 26000, 31000);    // late start, finishes 11 ms after release
+    TaskTiming timing = monitor.getTiming(id);
+
+    bool ok = timing.runs == 3 && timing.misses == 1 &&
+              timing.response_max_us == 11000 && timing.exec_max_us == 9500 &&
+              monitor.check(31000) == id;
+    print_status("Monitor Deadline Test", ok);
+}
+
+void SchedulerTest::test_monitor_stall() {
+    TaskMonitor monitor;
+    int fast = monitor.add("fast", 1000);
+    int slow = monitor.add("slow", 400000);
+    monitor.start(1000000);
+
+    bool ok = monitor.check(1000000 + MONITOR_STALL_US) == -1;     // nothing has run, but not for long
+    for (uint32_t t = 1000000; t < 1000000 + MONITOR_STALL_US + 10000; t += 1000) {
+        monitor.report(fast, t, t, t + 100);
+    }
+    // slow gets two deadlines, longer than MONITOR_STALL_US
+    ok &= monitor.check(1000000 + MONITOR_STALL_US + 10000) == -1;
+    ok &= monitor.check(1000000 + 800001) == slow;
+    monitor.report(slow, 1000000 + 800000, 1000000 + 800000, 1000000 + 800010);
+    ok &= monitor.check(1000000 + 800020) == -1;
+    ok &= monitor.check(1000000 + 1100000) == fast;     // fast stopped reporting at 1.51 s
+    print_status("Monitor Stall Test", ok);
+}
+
+void SchedulerTest::test_monitor_recovery() {
+    TaskMonitor monitor;
+    int id = monitor.add("task", 10000);
+    monitor.start(0);
+
+    monitor.report(id, 0, 0, 15000);            // miss
+    bool ok = monitor.check(15000) == id;
+    uint32_t t = 10000;
+    for (; t < 15000 + MONITOR_RECOVERY_US; t += 10000) {
+        monitor.report(id, t, t, t + 1000);
+        if (t + 1000 < 15000 + MONITOR_RECOVERY_US) ok &= monitor.check(t + 1000) == id;
+    }
+    monitor.report(id, t, t, t + 1000);
+    ok &= monitor.check(t + 1000) == -1;
+    ok &= monitor.getTiming(id).misses == 1;
+    print_status("Monitor Recovery Test", ok);
+}
+
+// Named group tasks report to the scheduler's monitor, with the period as deadline
+void SchedulerTest::test_group_reports() {
+    Probe fast = {};
+    Probe slow = {};
+    slow.busy_us = 12000;
+    TaskMonitor monitor;
+    RateGroup group ("group", 10, 0, osPriorityNormal, 1024);
+    RateScheduler scheduler(&monitor);
+    group.add(callback(&fast, &Probe::run), "fast");
+    group.add(callback(&fast, &Probe::after));
+    group.add(callback(&slow, &Probe::run), "slow");
+    scheduler.add(&group);
+
+    scheduler.start();
+    monitor.start(us_ticker_read());
+    ThisThread::sleep_for(200ms);
+
+    TaskTiming timing[2] = {monitor.getTiming(0), monitor.getTiming(1)};
+    pc->printf("  %s: %u runs, %u misses; %s: %u runs, %u misses, worst response %u us\n",
+        timing[0].name, timing[0].runs, timing[0].misses,
+        timing[1].name, timing[1].runs, timing[1].misses, timing[1].response_max_us);
+    bool ok = monitor.getCount() == 2 && timing[0].deadline_us == 10000 &&
+              timing[0].runs > 0 && timing[0].misses == 0 &&
+              timing[1].runs > 0 && timing[1].misses == timing[1].runs &&
+              monitor.check(us_ticker_read()) == 1;
+    print_status("Group Monitor Reports Test", ok);
+}
+
+// A new divider takes over at the next release, the deadline with it
+void SchedulerTest::test_set_divider() {
+    Probe probe = {};
+    TaskMonitor monitor;
+    RateGroup group ("group", 10, 0, osPriorityNormal, 1024);
+    RateScheduler scheduler(&monitor);
+    group.add(callback(&probe, &Probe::run), "task");
+    scheduler.add(&group);
+
+    scheduler.start();
+    monitor.start(us_ticker_read());
+    ThisThread::sleep_for(500ms);
+    uint32_t before = probe.runs;
+    group.setDivider(20);
+    ThisThread::sleep_for(500ms);
+    uint32_t after = probe.runs - before;
+
+    RateGroupStats stats = group.getStats();
+    TaskTiming timing = monitor.getTiming(0);
+    pc->printf("  %u runs at 100 Hz, %u at 50 Hz, jitter max %u us, deadline %u us\n",
+        before, after, stats.jitter_max_us, timing.deadline_us);
+    bool ok = before + 2 >= 50 && before <= 52 && after + 2 >= 25 && after <= 27 &&
+              stats.jitter_max_us < 500 && group.getPeriodUs() == 20000 &&
+              timing.deadline_us == 20000 && timing.misses == 0;
+    print_status("Set Divider Test", ok);
+}
+
+void SchedulerTest::run_all_tests() {
+    pc->printf("\nRunning Scheduler Tests...\n");
+
+    test_rates();
+    test_phases();
+    test_task_order();
+    test_overrun();
+    test_registration();
+    test_monitor_deadline();
+    test_monitor_stall();
+    test_monitor_recovery();
+    test_group_reports();
+    test_set_divider();
+
+    pc->printf("\nAll scheduler tests completed.\n");
+}
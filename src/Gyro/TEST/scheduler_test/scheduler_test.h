@@ -0,0 +1,51 @@
+#ifndef SCHEDULER_TEST_H
+#define SCHEDULER_TEST_H
+
+#include "mbed.h"
+#include "rate_scheduler.h"
+#include "task_monitor.h"
+#include "USBSerial.h"
+
+class SchedulerTest {
+public:
+    // Constructor
+    SchedulerTest(USBSerial* serial);
+
+    // Runs all tests
+    void run_all_tests();
+
+    // Individual test functions, each runs its own scheduler for about a second
+    void test_rates();
+    void test_phases();
+    void test_task_order();
+    void test_overrun();
+    void test_registration();
+    void test_set_divider();
+
+    // Monitor tests on made-up timestamps
+    void test_monitor_deadline();
+    void test_monitor_stall();
+    void test_monitor_recovery();
+    void test_group_reports();
+
+private:
+    // Records the runs of one group
+    struct Probe {
+        volatile uint32_t runs;
+        volatile uint32_t first_us;
+        volatile uint32_t busy_us;      // time each run spends busy waiting
+        volatile int order[2];          // which task ran first and second, first run only
+        volatile int ordered;
+
+        void run();                     // records as task 1
+        void after();                   // records as task 2
+    };
+
+    // Helper function to print test results
+    void print_status(const char* test_name, bool passed);
+
+    // Pointer to USB serial output for logging
+    USBSerial* pc;
+};
+
+#endif // SCHEDULER_TEST_H
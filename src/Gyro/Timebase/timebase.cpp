@@ -0,0 +1,18 @@
+#include "timebase.h"
+#include "mbed.h"
+#include "hal/us_ticker_api.h"
+
+static uint32_t last_low = 0;
+static uint64_t high = 0;       // wraps seen, in the upper 32 bits
+
+uint64_t timebaseNowUs() {
+    core_util_critical_section_enter();
+    uint32_t low = us_ticker_read();
+    if (low < last_low) {
+        high += 1ULL << 32;
+    }
+    last_low = low;
+    uint64_t now_us = high | low;
+    core_util_critical_section_exit();
+    return now_us;
+}
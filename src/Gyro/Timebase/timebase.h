@@ -0,0 +1,32 @@
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <cstdint>
+
+/*
+ * Microsecond timebase shared by every sample timestamp.
+ *
+ * The us_ticker is a free running 32 bit hardware timer (TIM5 on the F401),
+ * the one the encoder, scheduler and monitor already read. timebaseNowUs()
+ * extends it to 64 bits in software by counting its wraps, so its low 32
+ * bits are us_ticker_read() and compare directly with it. The wraps are
+ * only seen if it is called at least once per 71 minutes; the encoder task
+ * calls it at up to 1 kHz.
+ *
+ * Kernel::Clock, which the timestamps used before, counts milliseconds.
+ */
+
+/**
+ * @brief Microseconds since boot. Safe from interrupts and any thread.
+ */
+uint64_t timebaseNowUs();
+
+/**
+ * @brief Halfway between two timebaseNowUs() readings, e.g. either side of
+ * an I2C transaction.
+ */
+inline uint64_t timebaseMidpoint(uint64_t start_us, uint64_t end_us) {
+    return start_us + (end_us - start_us) / 2;
+}
+
+#endif // TIMEBASE_H
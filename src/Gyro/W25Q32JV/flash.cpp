@@ -1,5 +1,8 @@
 #include "mbed.h"
 #include "flash.h"
+#include "profiler.h"
+
+PROFILE_PROBE(flash_page, "flash page program");
 
 #ifndef FLASH_ENABLE_RESET
 #define FLASH_ENABLE_RESET  0x66
@@ -75,6 +78,7 @@ void flash::write(uint32_t address, const uint8_t *buffer, size_t length) {
     const size_t PAGE_SIZE = 256;
 
     while (length > 0) {
+        PROFILE_SCOPE(flash_page);
         enableWrite();
 
         uint32_t page_offset = address % PAGE_SIZE;
@@ -162,6 +166,45 @@ void flash::eraseSector(uint32_t address) {
     isDone(4000);
 }
 
+/**
+ * Erases a 64KB block at the given address.
+ * @param address - Address within the block to erase
+ */
+void flash::eraseBlock(uint32_t address) {
+    enableWrite();
+
+    uint8_t cmd[4];
+    cmd[0] = 0xD8; // 64KB Block Erase command
+    cmd[1] = (address >> 16) & 0xFF;
+    cmd[2] = (address >> 8) & 0xFF;
+    cmd[3] = address & 0xFF;
+
+    csLow();
+    _spi.write((const char *)cmd, 4, NULL, 0);
+    csHigh();
+
+    isDone(4000);
+}
+
+/**
+ * Erases [start, end), both 4KB aligned: whole 64KB blocks where they fit,
+ * sectors for the rest.
+ * @param start - First address to erase
+ * @param end - Address after the last one to erase
+ */
+void flash::eraseRange(uint32_t start, uint32_t end) {
+    uint32_t addr = start;
+    while (addr < end) {
+        if ((addr & 0xFFFF) == 0 && end - addr >= 0x10000) {
+            eraseBlock(addr);
+            addr += 0x10000;
+        } else {
+            eraseSector(addr);
+            addr += 0x1000;
+        }
+    }
+}
+
 void flash::eraseAll() {
     for (uint32_t addr = 0; addr < 0x400000; addr += 0x1000) {
         eraseSector(addr);
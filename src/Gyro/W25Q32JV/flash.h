@@ -20,6 +20,8 @@ public:
 
     // Erase operations
     void eraseSector(uint32_t address);
+    void eraseBlock(uint32_t address);
+    void eraseRange(uint32_t start, uint32_t end);
     void eraseAll();
     
 
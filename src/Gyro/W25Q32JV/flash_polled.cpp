@@ -0,0 +1,92 @@
+#include "flash_polled.h"
+#include "pinmap.h"
+#include "PeripheralPins.h"
+#include "hal/watchdog_api.h"
+
+#define POLLED_WRITE_ENABLE     0x06
+#define POLLED_READ_STATUS      0x05
+#define POLLED_PAGE_PROGRAM     0x02
+#define POLLED_SECTOR_ERASE     0x20
+#define POLLED_PAGE_SIZE        256
+
+PolledFlash::PolledFlash(PinName mosi, PinName miso, PinName sclk, PinName csPin)
+    : _spi(reinterpret_cast<SPI_TypeDef*>(pinmap_find_peripheral(sclk, PinMap_SPI_SCLK)))
+{
+    // Only resolves the port and mask, the flash object configures the pin
+    gpio_init(&_cs, csPin);
+}
+
+uint8_t PolledFlash::transfer(uint8_t out) {
+    while (!(_spi->SR & SPI_SR_TXE)) {}
+    *reinterpret_cast<volatile uint8_t*>(&_spi->DR) = out;
+    while (!(_spi->SR & SPI_SR_RXNE)) {}
+    return *reinterpret_cast<volatile uint8_t*>(&_spi->DR);
+}
+
+void PolledFlash::select() {
+    gpio_write(&_cs, 0);
+    wait_us(5);
+}
+
+void PolledFlash::deselect() {
+    while (_spi->SR & SPI_SR_BSY) {}
+    wait_us(5);
+    gpio_write(&_cs, 1);
+}
+
+void PolledFlash::begin() {
+    while (_spi->SR & SPI_SR_BSY) {}
+    gpio_write(&_cs, 1);
+    _spi->CR1 |= SPI_CR1_SPE;
+    // Clear a byte or an overrun an interrupted transfer left behind
+    (void)_spi->DR;
+    (void)_spi->SR;
+    wait_us(5);
+}
+
+void PolledFlash::command(uint8_t cmd, uint32_t address) {
+    select();
+    transfer(POLLED_WRITE_ENABLE);
+    deselect();
+
+    select();
+    transfer(cmd);
+    transfer(static_cast<uint8_t>(address >> 16));
+    transfer(static_cast<uint8_t>(address >> 8));
+    transfer(static_cast<uint8_t>(address));
+}
+
+bool PolledFlash::waitReady(uint32_t timeout_ms) {
+    for (uint32_t elapsed_us = 0; elapsed_us < timeout_ms * 1000; elapsed_us += 100) {
+        select();
+        transfer(POLLED_READ_STATUS);
+        uint8_t status = transfer(0x00);
+        deselect();
+        if ((status & 0x01) == 0) {
+            return true;
+        }
+        // A sector erase outlasts short watchdog timeouts
+        hal_watchdog_kick();
+        wait_us(100);
+    }
+    return false;
+}
+
+bool PolledFlash::eraseSector(uint32_t address) {
+    command(POLLED_SECTOR_ERASE, address);
+    deselect();
+    return waitReady(400);      // 400 ms worst case sector erase
+}
+
+bool PolledFlash::program(uint32_t address, const uint8_t* data, size_t length) {
+    size_t page_left = POLLED_PAGE_SIZE - address % POLLED_PAGE_SIZE;
+    if (length > page_left) {
+        length = page_left;
+    }
+    command(POLLED_PAGE_PROGRAM, address);
+    for (size_t i = 0; i < length; i++) {
+        transfer(data[i]);
+    }
+    deselect();
+    return waitReady(3);        // 3 ms worst case page program
+}
@@ -0,0 +1,53 @@
+#ifndef FLASH_POLLED_H
+#define FLASH_POLLED_H
+
+#include "mbed.h"
+#include "hal/gpio_api.h"
+
+/**
+ * @brief Bare W25Q32JV erase and program over SPI registers, for fault handlers.
+ *
+ * The flash class goes through mbed's SPI, which takes a mutex and sleeps
+ * while the chip is busy. Neither works in a fault handler or with
+ * interrupts masked, so this drives the STM32 SPI data register and the chip
+ * select pin directly and busy-waits. It reuses the SPI setup of the flash
+ * object on the same pins and must only be used once nothing else will touch
+ * the chip again before a reset.
+ */
+class PolledFlash {
+public:
+    /**
+     * @brief Looks up the SPI peripheral and chip select, does not touch the hardware.
+     */
+    PolledFlash(PinName mosi, PinName miso, PinName sclk, PinName csPin);
+
+    /**
+     * @brief Take over the bus: wait out the current byte and end any
+     * command the flash class left half sent.
+     */
+    void begin();
+
+    /**
+     * @brief Erase the 4 KB sector holding address.
+     * @return false if the chip stayed busy.
+     */
+    bool eraseSector(uint32_t address);
+
+    /**
+     * @brief Program up to one page, without crossing a 256 byte page boundary.
+     * @return false if the chip stayed busy.
+     */
+    bool program(uint32_t address, const uint8_t* data, size_t length);
+
+private:
+    SPI_TypeDef* _spi;
+    gpio_t _cs;
+
+    uint8_t transfer(uint8_t out);
+    void select();
+    void deselect();
+    void command(uint8_t cmd, uint32_t address);
+    bool waitReady(uint32_t timeout_ms);
+};
+
+#endif // FLASH_POLLED_H
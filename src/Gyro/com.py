@@ -1,10 +1,9 @@
 import serial
-import time
-import pandas as pd
-import numpy as np
+import csv
+from telemetry import TelemetryDecoder
 
 
-# A short script to read sensor data from the serial bus and store it into a csv file
+# A short script to read binary telemetry from the serial bus and store it into a csv file
 
 COM_PORT = 'COM4'
 BAUD_RATE = 9600
@@ -13,34 +12,42 @@ print(serial.__file__)
 ser = serial.Serial(COM_PORT, BAUD_RATE, timeout=1)
 
 columns = [
+    'TIMESTAMP_US',
     'ACC_X', 'ACC_Y', 'ACC_Z',
     'MAG_X', 'MAG_Y', 'MAG_Z',
     'GYR_X', 'GYR_Y', 'GYR_Z',
     'EUL_X', 'EUL_Y', 'EUL_Z',
     'LINACC_X', 'LINACC_Y', 'LINACC_Z',
     'GRAV_X', 'GRAV_Y', 'GRAV_Z',
-    'QUAT_X', 'QUAT_Y', 'QUAT_Z'
+    'QUAT_W', 'QUAT_X', 'QUAT_Y', 'QUAT_Z',
+    'TEMP'
 ] # column names
-df = pd.DataFrame(columns = columns)
-try:    
-    print("Reading from Serial Port")
-    while True:
-        line = ser.readline().decode('utf-8').strip()
-        print(line)
-        if line:
-            values = line.split(' ')
-            if len(values) == len(columns):
-                try:
-                    float_values = [float(v) for v in values]
-                    df.loc[len(df)] = float_values
-                    print(f"Logged row: {float_values}")
-                except ValueError:
-                    print(f"Skipping invalid line: {line}")
+decoder = TelemetryDecoder()
+rows = 0
+with open(CSV_FILE, 'w', newline='') as out:
+    writer = csv.writer(out)
+    writer.writerow(columns)
+    try:
+        print("Reading from Serial Port")
+        while True:
+            data = ser.read(ser.in_waiting or 1)
+            for frame in decoder.feed(data):
+                if frame['type'] == 'enc':
+                    print(f"[{frame['timestamp'] / 1000:.3f} ms] ENC1: {frame['enc1']:.3f} ({frame['rpm1']:.1f} RPM) "
+                          f"ENC2: {frame['enc2']:.3f} ({frame['rpm2']:.1f} RPM)")
+                    continue
+                if frame['type'] != 'imu':
+                    continue
+                writer.writerow(
+                    [frame['timestamp']] + frame['acc'] + frame['mag'] + frame['gyr'] +
+                    frame['eul'] + frame['lin'] + frame['grav'] + frame['quat'] + [frame['temp']]
+                )
+                rows += 1
+                if rows % 100 == 0:
+                    print(f"Logged {rows} IMU rows ({decoder.crc_errors} CRC errors)")
 
-except KeyboardInterrupt:
-    print("\nStopping data collection.")
-finally:
-    ser.close()
-    df.to_csv(CSV_FILE, index=False)
-    print(f"Data saved to {CSV_FILE}")
-    
\ No newline at end of file
+    except KeyboardInterrupt:
+        print("\nStopping data collection.")
+    finally:
+        ser.close()
+        print(f"Data saved to {CSV_FILE}")
@@ -0,0 +1,79 @@
+import os
+import sys
+import serial
+from telemetry import TelemetryDecoder
+
+
+# Downloads the flight log over the radio through the ground station (src/Radio)
+# and writes it to a file that src/Gyro's decode state understands.
+#
+#   python download.py COM5 flight.bin
+#
+# Received chunk offsets are kept in <file>.chunks, so running the script again
+# after a ground station reset or a lost link resumes from the first missing
+# chunk instead of starting over.
+
+COM_PORT = sys.argv[1] if len(sys.argv) > 1 else 'COM5'
+OUT_FILE = sys.argv[2] if len(sys.argv) > 2 else 'flight.bin'
+CHUNK_SIZE = 128        # DL_CHUNK_SIZE in Framing/download.h
+RAW_LINK_BPS = 38400
+
+
+def load_chunks(path):
+    if not os.path.exists(path):
+        return set()
+    with open(path) as f:
+        return {int(line) for line in f if line.strip()}
+
+
+def first_missing(chunks):
+    offset = 0
+    while offset in chunks:
+        offset += CHUNK_SIZE
+    return offset
+
+
+chunk_file = OUT_FILE + '.chunks'
+chunks = load_chunks(chunk_file)
+start = first_missing(chunks)
+
+ser = serial.Serial(COM_PORT, 115200, timeout=0.1)
+decoder = TelemetryDecoder()
+
+mode = 'r+b' if os.path.exists(OUT_FILE) else 'w+b'
+with open(OUT_FILE, mode) as out, open(chunk_file, 'a') as index:
+    print(f"downloading from offset {start}")
+    ser.write(b'!binary\n')
+    ser.write(f'!download {start}\n'.encode())
+    try:
+        done = False
+        while not done:
+            for frame in decoder.feed(ser.read(ser.in_waiting or 1)):
+                kind = frame['type']
+                if kind == 'log_data':
+                    if frame['offset'] in chunks:
+                        continue
+                    out.seek(frame['offset'])
+                    out.write(frame['data'])
+                    chunks.add(frame['offset'])
+                    index.write(f"{frame['offset']}\n")
+                elif kind == 'log_progress':
+                    size = frame['size']
+                    pct = 100.0 * frame['offset'] / size if size else 0.0
+                    load = 100.0 * frame['bytes_per_s'] * 8 / RAW_LINK_BPS
+                    stalled = ' (stalled)' if frame['stalled'] else ''
+                    print(f"{frame['state']}{stalled}: {frame['offset']} / {size} bytes ({pct:.0f}%), "
+                          f"{frame['bytes_per_s']} B/s ({load:.0f}% of link), {frame['repeats']} repeats")
+                    if frame['state'] == 'done':
+                        out.truncate(size)
+                        done = True
+            out.flush()
+            index.flush()
+    except KeyboardInterrupt:
+        ser.write(b'!cancel\n')
+        print(f"cancelled, run again to resume from offset {first_missing(chunks)}")
+    finally:
+        ser.close()
+
+if first_missing(chunks) >= os.path.getsize(OUT_FILE):
+    print(f"complete: {OUT_FILE}, {os.path.getsize(OUT_FILE)} bytes")
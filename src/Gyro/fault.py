@@ -0,0 +1,175 @@
+import os
+import sys
+import time
+import struct
+from telemetry import TelemetryDecoder, crc16
+from trace import write_chrome
+
+
+# Decodes the fault record FaultLog writes to the last flash sector (see
+# Fault/fault_log.h): what faulted, the registers, every watched thread's
+# stack use, the task timings, and the trace events leading up to it.
+#
+#   python fault.py COM4 [trace.json]          sends `fault dump` and reads the frames
+#   python fault.py sector.bin [trace.json]    decodes a saved copy of the sector
+#
+# With a second argument the trace events are also written as Chrome trace
+# JSON, like trace.py does.
+
+SECTOR_ADDR = 0x3FF000      # FAULT_SECTOR_ADDR
+TIMEOUT_S = 5
+
+HEADER_STRUCT = struct.Struct('<12I12sHHBBBBBBH')
+THREAD_STRUCT = struct.Struct('<12sIII')
+TASK_STRUCT = struct.Struct('<12sIIIII')
+EVENT_STRUCT = struct.Struct('<IcBBB')
+MAGIC = 0x31544C46
+REASONS = {1: 'error', 2: 'watchdog'}
+
+# MBED_ERROR_CODE_* of mbed's fault handler
+FAULT_CODES = {317: 'hard fault', 318: 'memory management fault', 319: 'bus fault', 320: 'usage fault'}
+
+CFSR_BITS = [
+    (0, 'IACCVIOL: instruction access violation'),
+    (1, 'DACCVIOL: data access violation (MMFAR)'),
+    (3, 'MUNSTKERR: unstacking on exception return'),
+    (4, 'MSTKERR: stacking on exception entry, likely a stack overflow'),
+    (7, 'MMARVALID'),
+    (8, 'IBUSERR: instruction bus error'),
+    (9, 'PRECISERR: precise data bus error (BFAR)'),
+    (10, 'IMPRECISERR: imprecise data bus error'),
+    (11, 'UNSTKERR: bus fault unstacking'),
+    (12, 'STKERR: bus fault stacking, likely a stack overflow'),
+    (15, 'BFARVALID'),
+    (16, 'UNDEFINSTR: undefined instruction'),
+    (17, 'INVSTATE: invalid EPSR state, e.g. a call through a bad function pointer'),
+    (18, 'INVPC: invalid exception return'),
+    (19, 'NOCP: coprocessor access'),
+    (24, 'UNALIGNED: unaligned access'),
+    (25, 'DIVBYZERO: divide by zero'),
+]
+
+
+def cstr(raw):
+    return raw.split(b'\0', 1)[0].decode('ascii', 'replace')
+
+
+def read_sector(source):
+    if os.path.exists(source):
+        with open(source, 'rb') as f:
+            data = f.read()
+        if len(data) >= 4 and struct.unpack_from('<I', data)[0] == MAGIC:
+            return data
+        chunks = {}
+        for frame in TelemetryDecoder().feed(data):
+            if frame['type'] == 'log_data':
+                chunks[frame['offset']] = frame['data']
+    else:
+        import serial
+        ser = serial.Serial(source, 115200, timeout=0.1)
+        ser.write(b'fault dump\n')
+        decoder = TelemetryDecoder()
+        chunks = {}
+        deadline = time.time() + TIMEOUT_S
+        while time.time() < deadline:
+            for frame in decoder.feed(ser.read(ser.in_waiting or 1)):
+                if frame['type'] == 'log_data':
+                    chunks[frame['offset']] = frame['data']
+                    deadline = time.time() + 1      # done once the frames stop
+        ser.close()
+
+    data = bytearray()
+    for offset in sorted(chunks):
+        if offset - SECTOR_ADDR != len(data):
+            break
+        data += chunks[offset]
+    if not data:
+        sys.exit('no fault record received')
+    return bytes(data)
+
+
+def decode(data):
+    h = HEADER_STRUCT.unpack_from(data)
+    header = dict(zip(['magic', 'length', 'time_ms', 'error_status', 'pc', 'lr', 'sp', 'psr',
+                       'cfsr', 'hfsr', 'mmfar', 'bfar', 'thread', 'cycles_per_us', 'events',
+                       'reason', 'threads', 'tasks', 'culprit', 'probes', 'trace_threads',
+                       'names_size'], h))
+    if header['magic'] != MAGIC:
+        sys.exit('no fault record in the sector')
+    length = header['length']
+    if len(data) < length + 2:
+        sys.exit(f'record truncated, {len(data)} of {length + 2} bytes')
+    stored, = struct.unpack_from('<H', data, length)
+    if crc16(data[:length]) != stored:
+        print('warning: CRC mismatch, the record may be partly written')
+
+    ptr = HEADER_STRUCT.size
+    threads = []
+    for _ in range(header['threads']):
+        name, size, used, sp = THREAD_STRUCT.unpack_from(data, ptr)
+        threads.append({'name': cstr(name), 'stack_size': size, 'stack_max': used, 'sp': sp})
+        ptr += THREAD_STRUCT.size
+    tasks = []
+    for _ in range(header['tasks']):
+        name, deadline, runs, misses, response, beat = TASK_STRUCT.unpack_from(data, ptr)
+        tasks.append({'name': cstr(name), 'deadline_us': deadline, 'runs': runs, 'misses': misses,
+                      'response_max_us': response, 'last_beat_us': beat})
+        ptr += TASK_STRUCT.size
+
+    names = data[ptr:ptr + header['names_size']].split(b'\0')
+    ptr += header['names_size']
+    probes = [n.decode('ascii', 'replace') for n in names[:header['probes']]]
+    trace_threads = [n.decode('ascii', 'replace') for n in names[header['probes']:header['probes'] + header['trace_threads']]]
+
+    events = []
+    for _ in range(header['events']):
+        cycles, phase, name, thread, arg = EVENT_STRUCT.unpack_from(data, ptr)
+        events.append({'cycles': cycles, 'phase': phase.decode(), 'name': name, 'thread': thread, 'arg': arg})
+        ptr += EVENT_STRUCT.size
+
+    trace_names = {
+        'probes': dict(enumerate(probes)),
+        'threads': dict(enumerate(trace_threads)),
+        'tasks': {i: t['name'] for i, t in enumerate(tasks)},
+    }
+    return header, threads, tasks, trace_names, events
+
+
+def report(header, threads, tasks, events):
+    status = header['error_status']
+    reason = REASONS.get(header['reason'], header['reason'])
+    print(f"{reason} at {header['time_ms']} ms in thread '{cstr(header['thread'])}'")
+    if status:
+        code = status & 0xFFFF
+        module = (status >> 16) & 0xFF
+        print(f"  mbed error 0x{status:08X}: code {code} ({FAULT_CODES.get(code, 'see mbed_error.h')}), module {module}")
+    if header['culprit'] != 0xFF and header['culprit'] < len(tasks):
+        print(f"  watchdog withheld for task '{tasks[header['culprit']]['name']}'")
+    print(f"  pc 0x{header['pc']:08X}  lr 0x{header['lr']:08X}  sp 0x{header['sp']:08X}  psr 0x{header['psr']:08X}")
+    print(f"  cfsr 0x{header['cfsr']:08X}  hfsr 0x{header['hfsr']:08X}  mmfar 0x{header['mmfar']:08X}  bfar 0x{header['bfar']:08X}")
+    for bit, text in CFSR_BITS:
+        if header['cfsr'] & (1 << bit):
+            print(f"    {text}")
+    if header['hfsr'] & (1 << 30):
+        print("    FORCED: escalated from a configurable fault")
+    if header['pc']:
+        print(f"  arm-none-eabi-addr2line -e <firmware>.elf 0x{header['pc']:08X} 0x{header['lr']:08X}")
+
+    print('\nthread        stack  max used')
+    for t in threads:
+        pct = 100.0 * t['stack_max'] / t['stack_size'] if t['stack_size'] else 0.0
+        flag = '  <-- full' if t['stack_max'] >= t['stack_size'] else ''
+        print(f"{t['name']:<12} {t['stack_size']:>6} {t['stack_max']:>6} {pct:5.1f}%{flag}")
+
+    print('\ntask         deadline    runs  misses  worst response  last run')
+    for t in tasks:
+        print(f"{t['name']:<12} {t['deadline_us']:>8} {t['runs']:>7} {t['misses']:>7} {t['response_max_us']:>12} us  {t['last_beat_us']} us")
+    print(f"\n{len(events)} trace events, {header['cycles_per_us']} cycles/us")
+
+
+if __name__ == '__main__':
+    source = sys.argv[1] if len(sys.argv) > 1 else 'COM4'
+    header, threads, tasks, trace_names, events = decode(read_sector(source))
+    report(header, threads, tasks, events)
+    if len(sys.argv) > 2 and events:
+        write_chrome(sys.argv[2], trace_names, events, header['cycles_per_us'])
@@ -0,0 +1,42 @@
+import sys
+import serial
+from telemetry import TelemetryDecoder
+
+
+# Prints radio telemetry and link statistics forwarded by the ground station (src/Radio)
+# while it is in binary mode (the default, '!text' switches to readable output).
+# With several flight computers ('!tdma N' on the ground station) every line is
+# tagged with the node it came from.
+
+COM_PORT = sys.argv[1] if len(sys.argv) > 1 else 'COM5'
+RAW_LINK_BPS = 38400
+
+ser = serial.Serial(COM_PORT, 115200, timeout=0.1)
+decoder = TelemetryDecoder()
+
+try:
+    while True:
+        for frame in decoder.feed(ser.read(ser.in_waiting or 1)):
+            kind = frame['type']
+            node = f"node {frame['node']} " if frame.get('node') else ''
+            if kind == 'radio_tlm':
+                fields = ' '.join(f"{k.upper()} {frame[k]}" for k in ('quat', 'enc', 'acc') if k in frame)
+                print(f"{node}[{frame['timestamp']} ms] {frame['state']} {fields}")
+            elif kind == 'radio':
+                print(f"{node}Received message: {frame['data'].decode('ascii', 'replace')}")
+            elif kind == 'link_stats':
+                load = 100.0 * frame['bytes_per_s'] * 8 / RAW_LINK_BPS
+                print(f"link: {frame['frames']} frames, {frame['crc_errors']} crc, "
+                      f"{frame['framing_errors']} framing, {frame['overruns']} overruns, "
+                      f"{frame['bytes_per_s']} B/s ({load:.0f}% of link), "
+                      f"fec {frame['fec_corrected']} fixed {frame['fec_failed']} failed")
+            elif kind == 'node_stats':
+                print(f"node {frame['node']}: {frame['frames']} frames, {frame['crc_errors']} crc, "
+                      f"{frame['empty_slots']} empty slots, last heard {frame['last_heard_ms']} ms ago")
+            elif kind == 'command':
+                print(f"command {frame['seq']} {frame['outcome']} after {frame['tries']} tries, "
+                      f"{frame['latency_ms']} ms (rto {frame['rto_ms']} ms)")
+except KeyboardInterrupt:
+    pass
+finally:
+    ser.close()
@@ -8,58 +8,195 @@
 #include "flash.h"
 #include "onboard.h"
 #include "encoder.h"
+#include "encoder_velocity.h"
+#include "pi_controller.h"
+#include "roll_controller.h"
+#include "hal/us_ticker_api.h"
 #include "USBSerial.h"  
 #include "bno055_const.h"
 #include "radio.h"
+#include "console.h"
+#include "telemetry.h"
+#include "radio_telemetry.h"
+#include "reliable.h"
+#include "download.h"
+#include "tdma.h"
+#include "rate_scheduler.h"
+#include "task_monitor.h"
+#include "profiler.h"
+#include "trace.h"
+#include "fault_log.h"
+#include "flash_polled.h"
+#include "mem_stats.h"
+#include "boot.h"
+#include "config_store.h"
+#include "log_index.h"
+#include "timebase.h"
 #include <chrono>
-#include <string>
 
 
 // System Parameters
 #define WATCHDOG_TIMEOUT_MS 5000
+#define WATCHDOG_CAPTURE_US 4000000                     // kicks withheld this long write a fault record before the reset
 #define MOTOR_SPEED 0.5
-#define SENSOR_INTERVAL chrono::milliseconds(50)
+#define SENSOR_INTERVAL chrono::milliseconds(10)      // BNO055 fusion output rate is 100 Hz
 #define ENCODER_INTERVAL chrono::milliseconds(10)
-#define LOG_INTERVAL chrono::milliseconds(200)
+#define TELEMETRY_INTERVAL chrono::milliseconds(10)
+#define I2C_FREQUENCY 400000                            // fast mode, needed to read all vectors at 100 Hz
+#define RADIO_TELEMETRY_RATE 10                         // Hz, downlink frames during flight
+#define RADIO_FEC FEC_LIGHT                             // see Framing/fec.h, the ground station detects the mode
+#define RADIO_POLL_INTERVAL chrono::milliseconds(TDMA_POLL_MS)  // beacon receive resolution in flight, see Framing/tdma.h
 #define ENCODER_PPM 2048
-#define MAX_LOG_BYTES 0x10000
+#define MAX_LOG_BYTES (LOG_INDEX_ADDR - FLASH_LOG_START_ADDR)   // up to the index, config and fault sectors
 #define ENTRY_SIZE 51
 #define FLASH_LOG_START_ADDR 0x0000
 #define MOTOR_PERCENT 0.4
+#define MOTOR_SETPOINT_RPM 3000.0f                      // wheel speed held during flight, see cmd_speed
+#define MOTOR_PROTOCOL ServoProtocol::OneShot125         // Pwm50 for ESCs without OneShot support
+#define MOTOR_CONTROL_INTERVAL chrono::milliseconds(10)  // each command goes out as a pulse straight away
+#define MOTOR_KFF (MOTOR_PERCENT / MOTOR_SETPOINT_RPM)  // open-loop command per RPM
+#define MOTOR_KP 0.0002f                                // per RPM of error
+#define MOTOR_KI 0.001f                                 // per RPM of error per second
+#define ATTITUDE_ANGLE_KP 2.0f                          // deg/s of rate setpoint per degree of roll error
+#define ATTITUDE_RATE_KP 40.0f                          // wheel RPM/s per deg/s of rate error
+#define ATTITUDE_RATE_KI 10.0f                          // wheel RPM/s per degree of integrated rate error
+#define ATTITUDE_MAX_RATE 30.0f                         // deg/s
+#define ATTITUDE_MAX_WHEEL_ACCEL 20000.0f               // RPM/s
+#define ATTITUDE_WHEEL_MIN 1000.0f                      // RPM, the ESC only spins one way so roll around a bias speed
+#define ATTITUDE_WHEEL_MAX 6000.0f
+#define ATTITUDE_SIGN 1                                 // -1 if the wheel spins against the BNO055 roll axis
+#define ATTITUDE_MAX_AGE_US 25000                       // older IMU samples hold the wheel setpoint instead
+#define FLAG_CONTROL (1UL << 0)
+#define LOG_TIMING_TASKS 8                              // miss counters in a timing log entry
+#define BOOT_TIMEOUT_MS 3000                            // longest bring-up, ESC arming takes 2 s
+#define TRACE_DUMP_EVENTS 30                            // per TELEM_TRACE_EVENTS frame
 #define TIMEOUT_DURATION chrono::seconds(3600)
 
 DigitalOut led (PA_9); // Onboard LED
 DigitalOut rst(PA_5); // RST pin for the BNO055
 EUSBSerial serial(0x3232, 0x1);
 BufferedSerial uart (PA_2, PA_3, 115200);
+Console console(&serial);
+RadioTelemetry radio_telem(&uart, RADIO_TELEMETRY_RATE);
+FrameDecoder radio_rx;
+ReliableReceiver radio_cmd;
+TdmaNode tdma;
+uint32_t radio_fec_corrected = 0;
+uint32_t radio_fec_failed = 0;
 //USBSerial serial;
 
 // Sensors
 BNO055 bno (PB_4, PA_8, 0x50);
+Bno055Boot bno_boot(&bno);
+BootSequencer boot;
 tmp102 tmp(PB_4, PA_8, 0x91);
-Motor mymotor (PA_15);
+Motor mymotor (PA_15, MOTOR_PROTOCOL);
 
 flash f (PA_7, PA_6, PA_5, PA_4);
+PolledFlash fault_flash (PA_7, PA_6, PA_5, PA_4);
+FaultLog fault_log (&fault_flash);
+FaultHeader last_fault;
+bool last_fault_valid = false;
+Mutex flashMutex;       // f is shared by the log task and commands that run during flight
+size_t log_entry_size(uint8_t flags);
+LogIndex log_index(&f, FLASH_LOG_START_ADDR, FLASH_LOG_START_ADDR + MAX_LOG_BYTES, LOG_INDEX_ADDR, log_entry_size);
+static_assert(MAX_LOG_BYTES / LOG_INDEX_SPAN * 4 <= LOG_INDEX_SIZE, "log index sector too small for the log");
 encoder e1 (PB_6, PB_8, 2048);
 encoder e2 (PB_7, PB_9, 2048);
+EncoderVelocity v1 (ENCODER_PPM);
+EncoderVelocity v2 (ENCODER_PPM);
+
+// Every periodic task reports its runs here, and the hardware watchdog is
+// only kicked while they all keep their deadlines (see watchdog_task).
+// Tasks are registered in this order, which is also the order of the miss
+// counters in the log: encoder, sensor, watchdog, log, telemetry, radio,
+// motor.
+TaskMonitor monitor;
+int telemetry_task_id = -1;
+int radio_task_id = -1;
+int motor_task_id = -1;
+volatile uint32_t watchdog_withheld = 0;
+volatile int watchdog_culprit = -1;
+bool watchdog_resumed = false;
+
+// Thread stacks are static, so running out of RAM fails the link rather
+// than a thread start. Size them from the high-water marks `mem` reports,
+// keeping a quarter free, and recheck after changing a task.
+#define STACK_1KHZ      1024
+#define STACK_100HZ     2048
+#define STACK_20HZ      1024
+#define STACK_5HZ       2048
+#define STACK_TELEMETRY 2048
+#define STACK_RADIO     3072
+#define STACK_MOTOR     2048
+MBED_ALIGN(8) unsigned char stack_1khz[STACK_1KHZ];
+MBED_ALIGN(8) unsigned char stack_100hz[STACK_100HZ];
+MBED_ALIGN(8) unsigned char stack_20hz[STACK_20HZ];
+MBED_ALIGN(8) unsigned char stack_5hz[STACK_5HZ];
+MBED_ALIGN(8) unsigned char stack_telemetry[STACK_TELEMETRY];
+MBED_ALIGN(8) unsigned char stack_radio[STACK_RADIO];
+MBED_ALIGN(8) unsigned char stack_motor[STACK_MOTOR];
+
+// Periodic tasks run in rate groups (see Scheduler/rate_scheduler.h), at
+// 1 ms ticks: divider, phase, priority, stack. Telemetry stays on its own
+// thread, EUSBSerial::write waits on a helper thread at normal priority.
+// The groups are named for their default rates, `set rate` changes the
+// encoder (1 kHz), sensor (100 Hz) and log (5 Hz) groups.
+RateGroup rate_1khz ("1kHz", 1, 0, osPriorityRealtime, STACK_1KHZ, stack_1khz);
+RateGroup rate_100hz ("100Hz", 10, 1, osPriorityAboveNormal, STACK_100HZ, stack_100hz);
+RateGroup rate_20hz ("20Hz", 50, 3, osPriorityNormal, STACK_20HZ, stack_20hz);
+RateGroup rate_5hz ("5Hz", 200, 7, osPriorityBelowNormal, STACK_5HZ, stack_5hz);
+RateScheduler scheduler(&monitor);
+
+// Task rates in Hz, changed with `set rate` and kept in the config sector
+// (see Config/config_store.h). The group periods are whole ticks, so a rate
+// that doesn't divide 1 kHz runs at the nearest period.
+#define IMU_DEFAULT_HZ 100
+#define ENC_DEFAULT_HZ 1000
+#define LOG_DEFAULT_HZ 5
+#define IMU_MAX_HZ 100              // BNO055 fusion output rate
+#define ENC_MAX_HZ 1000             // one scheduler tick
+#define LOG_MAX_HZ 50               // entries of up to 128 bytes, 6.4 KB/s of the log
+ConfigStore config_store(&f);
+ConfigData config = {IMU_DEFAULT_HZ, ENC_DEFAULT_HZ, LOG_DEFAULT_HZ, 0xFFFF};
+
+struct RateSetting {
+    const char* name;
+    RateGroup* group;
+    uint16_t* hz;           // in config
+    uint16_t default_hz;
+    uint16_t max_hz;
+};
 
-// watchdog stuff
-// Watchdog &watchdog = Watchdog::get_instance();
-// void watchdog_thread() {
-//     watchdog.start(WATCHDOG_TIMEOUT_MS);
-//     while (true) {
-//         watchdog.kick();
-//         ThisThread::sleep_for(1000ms);
-//     }
-// }
-
+const RateSetting rate_settings[] = {
+    {"imu", &rate_100hz, &config.imu_hz, IMU_DEFAULT_HZ, IMU_MAX_HZ},
+    {"enc", &rate_1khz, &config.enc_hz, ENC_DEFAULT_HZ, ENC_MAX_HZ},
+    {"log", &rate_5hz, &config.log_hz, LOG_DEFAULT_HZ, LOG_MAX_HZ},
+};
 
-Thread thread1;
-Thread thread2;
-Thread thread3;
-Thread thread4;
-Thread thread5;
-Mutex logMutex;
+// Heap use per thread for `mem`. The encoder, sensor and motor loops are the
+// hot path, with HEAP_GUARD 1 an allocation there halts (see mem_stats.h).
+HeapWatch heap_1khz("1kHz", true);
+HeapWatch heap_100hz("100Hz", true);
+HeapWatch heap_20hz("20Hz");
+HeapWatch heap_5hz("5Hz");
+HeapWatch heap_telemetry("telemetry");
+HeapWatch heap_radio("radio");
+HeapWatch heap_motor("motor", true);
+
+// Per-task timing for `stats` and `trace`, the drivers have their own probes
+TRACE_PROBE(prof_encoder, "task encoder", TRACE_TASK);
+TRACE_PROBE(prof_sensor, "task sensor", TRACE_TASK);
+TRACE_PROBE(prof_log, "task log", TRACE_TASK);
+TRACE_PROBE(prof_motor, "task motor", TRACE_TASK);
+
+// Named for the trace timeline
+Thread thread3(osPriorityNormal, STACK_TELEMETRY, stack_telemetry, "telemetry");
+Thread thread6(osPriorityNormal, STACK_RADIO, stack_radio, "radio");
+Thread thread7(osPriorityHigh, STACK_MOTOR, stack_motor, "motor");
+Ticker control_ticker;
+EventFlags control_events;
+PROFILED_MUTEX(logMutex, "logMutex wait", "logMutex held");
 
 struct EncoderData{
     float encoder1_pos;
@@ -93,9 +230,11 @@ struct LogData {
 };
 
 struct EncoderDataRaw {
-    int16_t encoder1_raw;
-    int16_t encoder2_raw;
-    uint32_t timestamp;
+    int32_t encoder1_raw;
+    int32_t encoder2_raw;
+    int32_t encoder1_speed;     // counts/s
+    int32_t encoder2_speed;
+    uint64_t timestamp;
 };
 
 struct BNO055DataRaw {
@@ -106,7 +245,7 @@ struct BNO055DataRaw {
     bno055_raw_vector_t lin;
     bno055_raw_vector_t grav;
     bno055_raw_vector_t quat;
-    uint32_t timestamp;
+    uint64_t timestamp;         // halfway through the burst read
 };
 
 struct MotorDataRaw {
@@ -117,10 +256,37 @@ struct TMPDataRaw {
     int16_t temp_raw;
 };
 
+struct ControlDataRaw {
+    int16_t setpoint_rpm;
+    int16_t error_rpm;
+    uint16_t output;            // motor command x 10000
+    uint16_t jitter_us;         // worst deviation from MOTOR_CONTROL_INTERVAL since the last log entry
+    uint64_t timestamp;
+};
+
+struct AttitudeDataRaw {
+    int16_t target_raw;         // roll, 16 LSB/deg like the BNO055 Euler angles
+    int16_t roll_raw;
+    int16_t rate_raw;           // 16 LSB/dps like the BNO055 gyro
+    int16_t wheel_setpoint_rpm;
+    uint16_t latency_us;        // worst IMU sample to motor command since the last log entry
+    uint64_t timestamp;
+};
+
+struct TimingDataRaw {
+    uint16_t misses[LOG_TIMING_TASKS];  // deadline misses per task since start, in monitor order
+    uint64_t timestamp;
+};
+
+// Timestamps are timebaseNowUs() (see Timebase/timebase.h). The log and the
+// USB telemetry send them as 32 bit microseconds since the session epoch.
 struct LogDataRaw {
     EncoderDataRaw encoder;
     BNO055DataRaw bno055;
     TMPDataRaw tmp;
+    ControlDataRaw control;
+    AttitudeDataRaw attitude;
+    TimingDataRaw timing;
 };
 
 enum class State {
@@ -135,11 +301,150 @@ enum class State {
 LogData logdata;
 LogDataRaw logdataraw;
 
+// Console state: handlers run on the console thread, wait_sequence() and the
+// logging threads pick the values up on their next iteration
+volatile State requested_state = State::Idle;
+volatile State flight_state = State::Idle;
+volatile bool logging = false;
+volatile uint32_t log_write_address = FLASH_LOG_START_ADDR;
+volatile bool log_full = false;             // logging stopped at the end of the log area, until `clear`
+
+// Logging starts at boot in a provisional session, confirmed by start, the
+// idle timeout or a watchdog resume (see session_begin)
+volatile bool session_confirmed = false;
+uint32_t session_address = FLASH_LOG_START_ADDR;
+volatile bool imu_ready = false;            // the sensor task waits for the BNO055 bring-up
+volatile uint32_t first_sample_us = 0;      // time to first IMU sample since reset, 0 until then
+uint64_t session_epoch_us = 0;              // timebase at session_begin(), with logMutex
+uint32_t session_first_us = 0xFFFFFFFF;     // first IMU sample of the session since the epoch, with logMutex
+volatile bool motor_armed = false;
+volatile float motor_setpoint_rpm = MOTOR_SETPOINT_RPM;
+volatile bool attitude_enabled = false;
+volatile float attitude_target_deg = 0.0f;
+
+// Control loop statistics for cmd_status
+volatile uint32_t control_loops = 0;
+volatile uint32_t control_jitter_max_us = 0;
+volatile float control_rpm = 0.0f;
+volatile uint32_t attitude_updates = 0;
+volatile uint32_t attitude_stale = 0;
+volatile uint32_t latency_min_us = UINT32_MAX;
+volatile uint32_t latency_max_us = 0;
+volatile uint64_t latency_sum_us = 0;
+volatile uint32_t latency_count = 0;
+
+void control_tick() {
+    control_events.set(FLAG_CONTROL);
+}
+
+// Holds the wheel (encoder 1) at motor_setpoint_rpm, or at the speed the
+// roll loop asks for once `roll` engages it. The ticker only wakes the
+// thread, which runs above the sensor and logging threads so the loop
+// period stays regular.
+//
+// Every command is stamped against the IMU sample it was computed from.
+// Samples older than ATTITUDE_MAX_AGE_US are not used, which bounds the
+// latency from the BNO055 read to the ESC command. With the OneShot and
+// Multishot protocols the pulse starts on the command; Motor::getLatency()
+// reports the rest (a PWM frame when the previous pulse was still high).
 void motor_thread() {
-    //pwm.pulsewidth_us(1500);
-    mymotor.setSpeed(MOTOR_PERCENT);
-    while(true) {
-        ThisThread::sleep_for(100ms);
+    EncoderVelocity velocity(ENCODER_PPM);
+    PIController pi(MOTOR_KP, MOTOR_KI, MOTOR_KFF, 0.0f, 1.0f);
+    // The wheel encoder's backend may not track the whole wheel range
+    const float wheel_max = e1.getMaxRpm() < ATTITUDE_WHEEL_MAX ? e1.getMaxRpm() : ATTITUDE_WHEEL_MAX;
+    RollController roll(ATTITUDE_ANGLE_KP, ATTITUDE_RATE_KP, ATTITUDE_RATE_KI, ATTITUDE_MAX_RATE,
+                        ATTITUDE_MAX_WHEEL_ACCEL, ATTITUDE_WHEEL_MIN, wheel_max);
+    bool engaged = false;
+    const uint32_t interval_us = chrono::duration_cast<chrono::microseconds>(MOTOR_CONTROL_INTERVAL).count();
+
+    uint32_t last_us = us_ticker_read();
+    velocity.update(e1.getSnapshot(), last_us);
+    control_ticker.attach(control_tick, MOTOR_CONTROL_INTERVAL);
+
+    while (true) {
+        control_events.wait_any(FLAG_CONTROL);
+        PROFILE_SCOPE(prof_motor);
+        HeapScope heap_scope(heap_motor);
+        uint32_t now_us = us_ticker_read();
+        uint32_t period_us = now_us - last_us;
+        last_us = now_us;
+        uint32_t jitter_us = period_us > interval_us ? period_us - interval_us : interval_us - period_us;
+
+        velocity.update(e1.getSnapshot(), now_us);
+        float rpm = velocity.getRPM();
+        float dt = period_us * 1e-6f;
+
+        logMutex.lock();
+        bno055_raw_vector_t gyr = logdataraw.bno055.gyr;
+        bno055_raw_vector_t eul = logdataraw.bno055.eul;
+        uint32_t sample_us = static_cast<uint32_t>(logdataraw.bno055.timestamp);  // us_ticker time
+        logMutex.unlock();
+
+        // BNO055 Euler roll and gyro y are both 16 LSB per degree
+        float roll_deg = ATTITUDE_SIGN * eul.y / 16.0f;
+        float rate_dps = ATTITUDE_SIGN * gyr.y / 16.0f;
+        bool fresh = now_us - sample_us <= ATTITUDE_MAX_AGE_US;
+
+        if (attitude_enabled && !engaged) {
+            roll.engage(rpm > ATTITUDE_WHEEL_MIN ? rpm : motor_setpoint_rpm);
+        }
+        engaged = attitude_enabled;
+
+        float setpoint = motor_setpoint_rpm;
+        if (engaged) {
+            if (fresh) {
+                roll.update(attitude_target_deg, roll_deg, rate_dps, dt);
+                attitude_updates++;
+            } else {
+                attitude_stale++;
+            }
+            setpoint = roll.getWheelSetpoint();
+        }
+
+        float output = 0.0f;
+        if (setpoint > 0.0f) {
+            output = pi.update(setpoint, rpm, dt);
+        } else {
+            pi.reset();
+        }
+        mymotor.setSpeed(output);
+
+        uint32_t latency_us = us_ticker_read() - sample_us;
+        if (fresh) {
+            if (latency_us < latency_min_us) latency_min_us = latency_us;
+            if (latency_us > latency_max_us) latency_max_us = latency_us;
+            latency_sum_us += latency_us;
+            latency_count++;
+        }
+
+        control_loops++;
+        control_rpm = rpm;
+        if (control_loops > 1 && jitter_us > control_jitter_max_us) {
+            control_jitter_max_us = jitter_us;
+        }
+
+        logMutex.lock();
+        logdataraw.control.setpoint_rpm = static_cast<int16_t>(setpoint);
+        logdataraw.control.error_rpm = static_cast<int16_t>(setpoint - rpm);
+        logdataraw.control.output = static_cast<uint16_t>(output * 10000.0f);
+        if (jitter_us > logdataraw.control.jitter_us) {
+            logdataraw.control.jitter_us = static_cast<uint16_t>(jitter_us > 0xFFFF ? 0xFFFF : jitter_us);
+        }
+        logdataraw.control.timestamp = timebaseNowUs();
+        if (engaged) {
+            logdataraw.attitude.target_raw = static_cast<int16_t>(attitude_target_deg * 16.0f);
+            logdataraw.attitude.roll_raw = static_cast<int16_t>(roll_deg * 16.0f);
+            logdataraw.attitude.rate_raw = static_cast<int16_t>(rate_dps * 16.0f);
+            logdataraw.attitude.wheel_setpoint_rpm = static_cast<int16_t>(setpoint);
+            if (fresh && latency_us > logdataraw.attitude.latency_us) {
+                logdataraw.attitude.latency_us = static_cast<uint16_t>(latency_us > 0xFFFF ? 0xFFFF : latency_us);
+            }
+            logdataraw.attitude.timestamp = logdataraw.control.timestamp;
+        }
+        logMutex.unlock();
+
+        // Released by the ticker, which is only known to be before the wakeup
+        monitor.report(motor_task_id, now_us, now_us, us_ticker_read());
     }
 }
 
@@ -154,7 +459,7 @@ void sensor_thread() {
         bno055_vector_t quat = bno.getQuaternion();
         
         float temp = tmp.getTempCelsius() - 10;
-        uint64_t timestamp_us = Kernel::Clock::now().time_since_epoch().count();
+        uint64_t timestamp_us = timebaseNowUs();
 
         logMutex.lock();
         logdata.tmp.temp = temp;
@@ -172,35 +477,37 @@ void sensor_thread() {
     }
 }
 
-void sensor_thread_raw() {
-    while (true) {
-        bno055_raw_vector_t acc  = bno.getRawAccelerometer();
-        bno055_raw_vector_t gyr  = bno.getRawGyroscope();
-        bno055_raw_vector_t mag  = bno.getRawMagnetometer();
-        bno055_raw_vector_t eul  = bno.getRawEuler();
-        bno055_raw_vector_t lin  = bno.getRawLinearAccel();
-        bno055_raw_vector_t grav = bno.getRawGravity();
-        bno055_raw_vector_t quat = bno.getRawQuaternion();
-
-        int16_t temp_raw = tmp.getTemp();
-
-        uint32_t timestamp_us = static_cast<uint32_t>(
-            Kernel::Clock::now().time_since_epoch().count()
-        );
+// 100 Hz group, the BNO055 fusion output rate
+void sensor_task_raw() {
+    if (!imu_ready) {
+        return;
+    }
+    PROFILE_SCOPE(prof_sensor);
+    // One burst, stamped halfway through, so all outputs share the timestamp
+    bno055_raw_sample_t sample;
+    if (!bno.getRawSample(sample)) {
+        return;
+    }
 
-        logMutex.lock();
-        logdataraw.tmp.temp_raw         = temp_raw;
-        logdataraw.bno055.acc           = acc;
-        logdataraw.bno055.gyr           = gyr;
-        logdataraw.bno055.mag           = mag;
-        logdataraw.bno055.eul           = eul;
-        logdataraw.bno055.lin           = lin;
-        logdataraw.bno055.grav          = grav;
-        logdataraw.bno055.quat          = quat;
-        logdataraw.bno055.timestamp     = timestamp_us;
-        logMutex.unlock();
+    int16_t temp_raw = tmp.getTemp();
+
+    logMutex.lock();
+    logdataraw.tmp.temp_raw         = temp_raw;
+    logdataraw.bno055.acc           = sample.acc;
+    logdataraw.bno055.gyr           = sample.gyr;
+    logdataraw.bno055.mag           = sample.mag;
+    logdataraw.bno055.eul           = sample.eul;
+    logdataraw.bno055.lin           = sample.lin;
+    logdataraw.bno055.grav          = sample.grav;
+    logdataraw.bno055.quat          = sample.quat;
+    logdataraw.bno055.timestamp     = sample.time_us;
+    if (session_first_us == 0xFFFFFFFF && sample.time_us >= session_epoch_us) {
+        session_first_us = static_cast<uint32_t>(sample.time_us - session_epoch_us);
+    }
+    logMutex.unlock();
 
-        ThisThread::sleep_for(SENSOR_INTERVAL);
+    if (first_sample_us == 0) {
+        first_sample_us = static_cast<uint32_t>(sample.time_us);
     }
 }
 
@@ -208,7 +515,7 @@ void encoder_thread(){
     while (true) {
         float pos1 = e1.getOrientationDegrees();
         float pos2 = e2.getOrientationDegrees();
-        uint64_t timestamp_us = Kernel::Clock::now().time_since_epoch().count();
+        uint64_t timestamp_us = timebaseNowUs();
 
         logMutex.lock();
         logdata.encoder.encoder1_pos = pos1;
@@ -220,138 +527,545 @@ void encoder_thread(){
     }
 }
 
-void encoder_thread_raw(){
-    while (true) {
-        int16_t pos1 = static_cast<int16_t>(e1.getCount());
-        int16_t pos2 = static_cast<int16_t>(e2.getCount());
-        uint32_t timestamp_us = static_cast<uint32_t>(
-            Kernel::Clock::now().time_since_epoch().count()
-        );
-
-        logMutex.lock();
-        logdataraw.encoder.encoder1_raw = pos1;
-        logdataraw.encoder.encoder2_raw = pos2;
-        logdataraw.encoder.timestamp = timestamp_us;
-        logMutex.unlock();
-
-        ThisThread::sleep_for(ENCODER_INTERVAL);
-    }
+// 1 kHz group: cheap, and the speed estimates see every edge time
+void encoder_task_raw(){
+    PROFILE_SCOPE(prof_encoder);
+    EncoderSnapshot s1 = e1.getSnapshot();
+    EncoderSnapshot s2 = e2.getSnapshot();
+    uint64_t timestamp_us = timebaseNowUs();
+    uint32_t now_us = static_cast<uint32_t>(timestamp_us);     // us_ticker time
+    v1.update(s1, now_us);
+    v2.update(s2, now_us);
+
+    logMutex.lock();
+    logdataraw.encoder.encoder1_raw = s1.count;
+    logdataraw.encoder.encoder2_raw = s2.count;
+    logdataraw.encoder.encoder1_speed = static_cast<int32_t>(v1.getSpeed());
+    logdataraw.encoder.encoder2_speed = static_cast<int32_t>(v2.getSpeed());
+    logdataraw.encoder.timestamp = timestamp_us;
+    logMutex.unlock();
 }
 
-void log_thread() {
-    LogData last_snapshot = {};
-    while (true) {
-        LogData snapshot;
+// Streams the latest raw snapshot to the host as binary frames (see telemetry.h)
+void telemetry_thread() {
+    LogDataRaw last_snapshot = {};
+    TelemetryFrame frame;
+    uint8_t out[2 * TELEM_MAX_FRAME];
 
+    while (true) {
+        uint32_t start_us = us_ticker_read();
+        uint32_t heap_start = heap_telemetry.begin();
         logMutex.lock();
-        snapshot = logdata;
+        LogDataRaw snapshot = logdataraw;
+        uint64_t epoch_us = session_epoch_us;
         logMutex.unlock();
-        
 
         bool encoder_ready = snapshot.encoder.timestamp != last_snapshot.encoder.timestamp;
-        bool sensor_ready = snapshot.bno055.timestamp != last_snapshot.bno055.timestamp;
-
-        if (encoder_ready || sensor_ready) {
-            if (encoder_ready) {
-                serial.printf(
-                    "[%llu us] ENC1: %.2f ENC2: %.2f\n",
-                    snapshot.encoder.timestamp,
-                    snapshot.encoder.encoder1_pos,
-                    snapshot.encoder.encoder2_pos
-                );
+        bool sensor_ready  = snapshot.bno055.timestamp != last_snapshot.bno055.timestamp;
+        size_t n = 0;
+
+        if (encoder_ready) {
+            frame.begin(TELEM_ENC);
+            frame.putU32(static_cast<uint32_t>(snapshot.encoder.timestamp - epoch_us));
+            frame.putI32(snapshot.encoder.encoder1_raw);
+            frame.putI32(snapshot.encoder.encoder2_raw);
+            frame.putI32(snapshot.encoder.encoder1_speed);
+            frame.putI32(snapshot.encoder.encoder2_speed);
+            if (frame.finish()) {
+                memcpy(&out[n], frame.data(), frame.size());
+                n += frame.size();
             }
+        }
 
-            if (sensor_ready) {
-                serial.printf("[%llu us] IMU:\n", snapshot.bno055.timestamp);
-                serial.printf("  ACC  [x: %.2f, y: %.2f, z: %.2f]\n",
-                    snapshot.bno055.acc.x, snapshot.bno055.acc.y, snapshot.bno055.acc.z);
-                serial.printf("  GYR  [x: %.2f, y: %.2f, z: %.2f]\n",
-                    snapshot.bno055.gyr.x, snapshot.bno055.gyr.y, snapshot.bno055.gyr.z);
-                serial.printf("  MAG  [x: %.2f, y: %.2f, z: %.2f]\n",
-                    snapshot.bno055.mag.x, snapshot.bno055.mag.y, snapshot.bno055.mag.z);
-                serial.printf("  EUL  [x: %.2f, y: %.2f, z: %.2f]\n",
-                    snapshot.bno055.eul.x, snapshot.bno055.eul.y, snapshot.bno055.eul.z);
-                serial.printf("  LIN  [x: %.2f, y: %.2f, z: %.2f]\n",
-                    snapshot.bno055.lin.x, snapshot.bno055.lin.y, snapshot.bno055.lin.z);
-                serial.printf("  GRAV [x: %.2f, y: %.2f, z: %.2f]\n",
-                    snapshot.bno055.grav.x, snapshot.bno055.grav.y, snapshot.bno055.grav.z);
-                serial.printf("  QUAT [w: %.2f, x: %.2f, y: %.2f, z: %.2f]\n",
-                    snapshot.bno055.quat.w, snapshot.bno055.quat.x,
-                    snapshot.bno055.quat.y, snapshot.bno055.quat.z);
-                serial.printf(" Temp: %f\n", snapshot.tmp.temp);
+        if (sensor_ready) {
+            auto put_vec = [&](const bno055_raw_vector_t& v, bool with_w = false) {
+                if (with_w) frame.putI16(v.w);
+                frame.putI16(v.x);
+                frame.putI16(v.y);
+                frame.putI16(v.z);
+            };
+
+            frame.begin(TELEM_IMU);
+            frame.putU32(static_cast<uint32_t>(snapshot.bno055.timestamp - epoch_us));
+            put_vec(snapshot.bno055.acc);
+            put_vec(snapshot.bno055.gyr);
+            put_vec(snapshot.bno055.mag);
+            put_vec(snapshot.bno055.eul);
+            put_vec(snapshot.bno055.lin);
+            put_vec(snapshot.bno055.grav);
+            put_vec(snapshot.bno055.quat, true);
+            frame.putI16(snapshot.tmp.temp_raw);
+            if (frame.finish()) {
+                memcpy(&out[n], frame.data(), frame.size());
+                n += frame.size();
             }
+        }
 
+        // One USB write per cycle for both frames
+        if (n > 0) {
+            serial.write(reinterpret_cast<const char*>(out), n);
             last_snapshot = snapshot;
         }
-        ThisThread::sleep_for(LOG_INTERVAL);
+
+        heap_telemetry.end(heap_start);
+        monitor.report(telemetry_task_id, start_us, start_us, us_ticker_read());
+        ThisThread::sleep_for(TELEMETRY_INTERVAL);
     }
+}
 
+/**
+ * @brief Undo FEC and the node envelope of a received radio frame.
+ *
+ * @param buf  Scratch buffer of FRAME_MAX_PAYLOAD bytes.
+ * @return The message, or nullptr if it is unreadable or addressed to another node.
+ */
+const uint8_t* radio_decode(const FrameDecoder& rx, uint8_t* buf, size_t& len) {
+    const uint8_t* msg = rx.payload();
+    len = rx.length();
+
+    int fixed = fecDecode(rx.payload(), rx.length(), buf, len);
+    if (fixed == FEC_FAILED) {
+        radio_fec_failed++;
+        return nullptr;
+    }
+    if (fixed == FEC_UNCODED) {
+        len = rx.length();
+    } else {
+        radio_fec_corrected += fixed;
+        msg = buf;
+    }
+
+    uint8_t node;
+    if (!nodeUnwrap(msg, len, node)) {
+        return nullptr;
+    }
+    if (node != 0 && node != tdma.getNode()) {
+        return nullptr;
+    }
+    return msg;
 }
 
-void log_thread_raw() {
-    LogDataRaw last_snapshot = {};
-    uint32_t write_address = 0x000000;
+/**
+ * @brief Resync the TDMA schedule if msg is a beacon.
+ *
+ * @param frame_len  Received payload size, to estimate when the beacon was sent.
+ */
+bool radio_beacon(const uint8_t* msg, size_t len, size_t frame_len) {
+    uint32_t now_ms = static_cast<uint32_t>(Kernel::Clock::now().time_since_epoch().count());
+    // Ground station UART and airtime, then our own UART
+    size_t air_bytes = frame_len + FRAME_OVERHEAD + RADIO_AIR_OVERHEAD;
+    uint32_t delay_ms = 2 * tdmaUartMs(air_bytes) + tdmaAirMs(air_bytes);
+    return tdma.onBeacon(msg, len, now_ms, delay_ms);
+}
+
+// Commands the radio thread runs in flight, quick enough for its deadline
+const char* const flight_radio_commands[] = {"set", "status", "stop", "speed", "roll", "radio", "fec"};
+
+bool flight_radio_command(const char* line) {
+    for (const char* name : flight_radio_commands) {
+        size_t n = strlen(name);
+        if (strncmp(line, name, n) == 0 && (line[n] == 0 || line[n] == ' ')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Execute one command received over the radio.
+ *
+ * Sequence numbered commands are acknowledged once per copy received and
+ * executed only once; anything else is treated as a plain text line and
+ * echoed back a single time. In flight only flight_radio_commands run, the
+ * rest are rejected.
+ *
+ * @return true if an acknowledgement is due, see radio_ack().
+ */
+bool radio_command(const uint8_t* msg, size_t len, bool flight) {
+    char line[CONSOLE_MAX_LINE];
+    uint32_t now_ms = static_cast<uint32_t>(Kernel::Clock::now().time_since_epoch().count());
+
+    switch (radio_cmd.accept(msg, len, now_ms)) {
+        case ReliableReceiver::New: {
+            size_t n = radio_cmd.length() < sizeof(line) - 1 ? radio_cmd.length() : sizeof(line) - 1;
+            memcpy(line, radio_cmd.payload(), n);
+            line[n] = 0;
+            bool ok = (!flight || flight_radio_command(line)) && console.execute(line);
+            radio_cmd.complete(ok ? RADIO_ACK_OK : RADIO_ACK_REJECTED);
+            return true;
+        }
+        case ReliableReceiver::Duplicate:
+        case ReliableReceiver::Corrupt:
+            return true;
+
+        case ReliableReceiver::Invalid: {
+            // legacy unsequenced text command
+            size_t n = len < sizeof(line) - 1 ? len : sizeof(line) - 1;
+            memcpy(line, msg, n);
+            line[n] = 0;
+            writeUART(&uart, reinterpret_cast<const uint8_t*>(line), n);
+            if (!flight || flight_radio_command(line)) {
+                console.execute(line);
+            }
+            return false;
+        }
+    }
+    return false;
+}
+
+void radio_ack() {
+    uint8_t ack[RELIABLE_ACK_SIZE];
+    writeRadio(&uart, ack, radio_cmd.ack(ack), radio_telem.getFec(), tdma.getNode());
+}
+
+/**
+ * @brief Downlinks the latest sample over the 434 MHz radio at the configured rate.
+ *
+ * With a node ID the frames only go out in the node's TDMA slot, timed from
+ * the ground station's beacons which are read here during flight, along with
+ * commands (see radio_command()).
+ */
+void radio_thread() {
+    uint32_t next_frame = static_cast<uint32_t>(Kernel::Clock::now().time_since_epoch().count());
+    bool ack_due = false;
+
+    while (true) {
+        uint32_t start_us = us_ticker_read();
+        uint32_t heap_start = heap_radio.begin();
+        while (uart.readable()) {
+            uint8_t c;
+            uart.read(&c, 1);
+            if (radio_rx.feed(c) == FrameDecoder::Frame) {
+                uint8_t buf[FRAME_MAX_PAYLOAD];
+                size_t len;
+                const uint8_t* msg = radio_decode(radio_rx, buf, len);
+                if (msg && !radio_beacon(msg, len, radio_rx.length())) {
+                    ack_due |= radio_command(msg, len, true);
+                }
+            }
+        }
+
+        uint32_t now = static_cast<uint32_t>(Kernel::Clock::now().time_since_epoch().count());
+        uint32_t period = static_cast<uint32_t>(radio_telem.getPeriod().count());
+        radio_telem.setSlotBytes(tdma.getSlotBytes(now));
+        size_t air_bytes = radio_telem.getBudget();     // frames are never larger
+
+        if (static_cast<int32_t>(now - next_frame) < 0 || tdma.timeUntilSlot(now, air_bytes) != 0) {
+            heap_radio.end(heap_start);
+            monitor.report(radio_task_id, start_us, start_us, us_ticker_read());
+            // At most one period, so the heartbeat keeps to the monitor's
+            // deadline when `radio` shortens the period mid-wait
+            uint32_t wait_ms = next_frame - now < period ? next_frame - now : period;
+            ThisThread::sleep_for(tdma.getNode() ? RADIO_POLL_INTERVAL : chrono::milliseconds(wait_ms));
+            continue;
+        }
+
+        // A command acknowledgement takes this frame's slot
+        if (ack_due) {
+            radio_ack();
+            tdma.onTransmit(now, air_bytes);
+            ack_due = false;
+            heap_radio.end(heap_start);
+            monitor.report(radio_task_id, start_us, start_us, us_ticker_read());
+            next_frame += period;
+            continue;
+        }
 
-    while(true) {
         logMutex.lock();
-        LogDataRaw snapshot = logdataraw;
+        BNO055DataRaw imu = logdataraw.bno055;
         logMutex.unlock();
 
-        bool encoder_ready = snapshot.encoder.timestamp != last_snapshot.encoder.timestamp;
-        bool sensor_ready  = snapshot.bno055.timestamp != last_snapshot.bno055.timestamp;
+        RadioTelemetrySample sample;
+        sample.timestamp = static_cast<uint32_t>(
+            Kernel::Clock::now().time_since_epoch().count()
+        );
+        sample.state   = static_cast<uint8_t>(flight_state);
+        sample.quat[0] = imu.quat.w;
+        sample.quat[1] = imu.quat.x;
+        sample.quat[2] = imu.quat.y;
+        sample.quat[3] = imu.quat.z;
+        sample.enc[0]  = e1.getCount();
+        sample.enc[1]  = e2.getCount();
+        sample.acc[0]  = imu.acc.x;
+        sample.acc[1]  = imu.acc.y;
+        sample.acc[2]  = imu.acc.z;
+
+        if (radio_telem.send(sample)) {
+            tdma.onTransmit(now, air_bytes);
+        }
+        heap_radio.end(heap_start);
+        monitor.report(radio_task_id, start_us, start_us, us_ticker_read());
 
-        if (encoder_ready || sensor_ready) {
-            uint8_t buffer[128];
-            uint8_t* ptr = buffer;
+        // Catch up after waiting for a slot, but never burst
+        next_frame += period;
+        if (static_cast<int32_t>(now - next_frame) >= static_cast<int32_t>(period)) {
+            next_frame = now;
+        }
+    }
+}
 
-            // Header byte: bit flags
-            uint8_t flags = 0;
-            if (encoder_ready) flags |= 0x01;
-            if (sensor_ready)  flags |= 0x02;
-            *ptr++ = flags;
+// 5 Hz group
+// Session entry (flag 0x40), first in every session's log: the epoch, the
+// timebase in us when logging started, the first IMU sample in us since the
+// epoch, and 0xFF while provisional, 0x00 once confirmed. The last two are
+// written erased and programmed in place once known, flash bits only go from
+// 1 to 0. Every timestamp after it is a u32 in us since its epoch; entries
+// from firmware before sessions have ms since reset.
+#define SESSION_ENTRY_SIZE 14
+#define SESSION_FIRST_SAMPLE_OFFSET 9
+#define SESSION_STATE_OFFSET 13
+
+// Which of them the log task has programmed into the current session entry
+bool session_first_written = false;
+bool session_confirm_written = false;
+
+// Log task, with flashMutex held
+void session_update(uint32_t first_us) {
+    if (!session_first_written && first_us != 0xFFFFFFFF) {
+        f.write(session_address + SESSION_FIRST_SAMPLE_OFFSET, reinterpret_cast<const uint8_t*>(&first_us), sizeof(first_us));
+        session_first_written = true;
+    }
+    if (!session_confirm_written && session_confirmed) {
+        uint8_t state = 0x00;
+        f.write(session_address + SESSION_STATE_OFFSET, &state, 1);
+        session_confirm_written = true;
+    }
+}
 
-            if (encoder_ready) {
-                memcpy(ptr, &snapshot.encoder.timestamp, sizeof(uint32_t)); ptr += 4;
-                memcpy(ptr, &snapshot.encoder.encoder1_raw, sizeof(int16_t)); ptr += 2;
-                memcpy(ptr, &snapshot.encoder.encoder2_raw, sizeof(int16_t)); ptr += 2;
-            }
+void log_task_raw() {
+    if (!logging) {
+        return;
+    }
+    PROFILE_SCOPE(prof_log);
+    static LogDataRaw last_snapshot = {};
+
+    logMutex.lock();
+    LogDataRaw snapshot = logdataraw;
+    uint64_t epoch_us = session_epoch_us;
+    uint32_t first_us = session_first_us;
+    logdataraw.control.jitter_us = 0;       // worst case per entry
+    logdataraw.attitude.latency_us = 0;
+    logMutex.unlock();
+
+    flashMutex.lock();
+    session_update(first_us);
+    flashMutex.unlock();
+
+    // Only written when a task missed a deadline since the last entry
+    for (int i = 0; i < LOG_TIMING_TASKS; i++) {
+        uint32_t misses = monitor.getTiming(i).misses;
+        snapshot.timing.misses[i] = static_cast<uint16_t>(misses > 0xFFFF ? 0xFFFF : misses);
+    }
+    snapshot.timing.timestamp = timebaseNowUs();
+
+    // Samples from before the epoch belong to the previous session
+    auto fresh = [&](uint64_t timestamp, uint64_t last) {
+        return timestamp != last && timestamp >= epoch_us;
+    };
+    bool encoder_ready = fresh(snapshot.encoder.timestamp, last_snapshot.encoder.timestamp);
+    bool sensor_ready  = fresh(snapshot.bno055.timestamp, last_snapshot.bno055.timestamp);
+    bool control_ready = fresh(snapshot.control.timestamp, last_snapshot.control.timestamp);
+    bool attitude_ready = fresh(snapshot.attitude.timestamp, last_snapshot.attitude.timestamp);
+    bool timing_ready = memcmp(snapshot.timing.misses, last_snapshot.timing.misses, sizeof(snapshot.timing.misses)) != 0;
+
+    if (encoder_ready || sensor_ready || control_ready || attitude_ready || timing_ready) {
+        uint8_t buffer[128];
+        uint8_t* ptr = buffer;
+        auto put_time = [&](uint64_t timestamp) {
+            uint32_t since_epoch_us = static_cast<uint32_t>(timestamp - epoch_us);
+            memcpy(ptr, &since_epoch_us, sizeof(since_epoch_us)); ptr += 4;
+        };
 
-            if (sensor_ready) {
-                memcpy(ptr, &snapshot.bno055.timestamp, sizeof(uint32_t)); ptr += 4;
-
-                auto write_vec = [&](const bno055_raw_vector_t& v, bool with_w = false) {
-                    if (with_w) { memcpy(ptr, &v.w, 2); ptr += 2; }
-                    memcpy(ptr, &v.x, 2); ptr += 2;
-                    memcpy(ptr, &v.y, 2); ptr += 2;
-                    memcpy(ptr, &v.z, 2); ptr += 2;
-                };
-
-                write_vec(snapshot.bno055.acc);
-                write_vec(snapshot.bno055.gyr);
-                write_vec(snapshot.bno055.mag);
-                write_vec(snapshot.bno055.eul);
-                write_vec(snapshot.bno055.lin);
-                write_vec(snapshot.bno055.grav);
-                write_vec(snapshot.bno055.quat, true);
-
-                memcpy(ptr, &snapshot.tmp.temp_raw, sizeof(int16_t)); ptr += 2;
-            }
+        // Header byte: bit flags (0x01, 16-bit encoder counts, is only
+        // written by older firmware)
+        uint8_t flags = 0;
+        if (encoder_ready) flags |= 0x04;
+        if (sensor_ready)  flags |= 0x02;
+        if (control_ready) flags |= 0x08;
+        if (attitude_ready) flags |= 0x10;
+        if (timing_ready) flags |= 0x20;
+        *ptr++ = flags;
+
+        if (encoder_ready) {
+            put_time(snapshot.encoder.timestamp);
+            memcpy(ptr, &snapshot.encoder.encoder1_raw, sizeof(int32_t)); ptr += 4;
+            memcpy(ptr, &snapshot.encoder.encoder2_raw, sizeof(int32_t)); ptr += 4;
+            memcpy(ptr, &snapshot.encoder.encoder1_speed, sizeof(int32_t)); ptr += 4;
+            memcpy(ptr, &snapshot.encoder.encoder2_speed, sizeof(int32_t)); ptr += 4;
+        }
+
+        if (sensor_ready) {
+            put_time(snapshot.bno055.timestamp);
+
+            auto write_vec = [&](const bno055_raw_vector_t& v, bool with_w = false) {
+                if (with_w) { memcpy(ptr, &v.w, 2); ptr += 2; }
+                memcpy(ptr, &v.x, 2); ptr += 2;
+                memcpy(ptr, &v.y, 2); ptr += 2;
+                memcpy(ptr, &v.z, 2); ptr += 2;
+            };
+
+            write_vec(snapshot.bno055.acc);
+            write_vec(snapshot.bno055.gyr);
+            write_vec(snapshot.bno055.mag);
+            write_vec(snapshot.bno055.eul);
+            write_vec(snapshot.bno055.lin);
+            write_vec(snapshot.bno055.grav);
+            write_vec(snapshot.bno055.quat, true);
+
+            memcpy(ptr, &snapshot.tmp.temp_raw, sizeof(int16_t)); ptr += 2;
+        }
 
-            size_t entry_size = ptr - buffer;
-            f.write(write_address, buffer, entry_size);
-            write_address += entry_size;
+        if (control_ready) {
+            put_time(snapshot.control.timestamp);
+            memcpy(ptr, &snapshot.control.setpoint_rpm, sizeof(int16_t)); ptr += 2;
+            memcpy(ptr, &snapshot.control.error_rpm, sizeof(int16_t)); ptr += 2;
+            memcpy(ptr, &snapshot.control.output, sizeof(uint16_t)); ptr += 2;
+            memcpy(ptr, &snapshot.control.jitter_us, sizeof(uint16_t)); ptr += 2;
+        }
 
-            last_snapshot = snapshot;
+        if (attitude_ready) {
+            put_time(snapshot.attitude.timestamp);
+            memcpy(ptr, &snapshot.attitude.target_raw, sizeof(int16_t)); ptr += 2;
+            memcpy(ptr, &snapshot.attitude.roll_raw, sizeof(int16_t)); ptr += 2;
+            memcpy(ptr, &snapshot.attitude.rate_raw, sizeof(int16_t)); ptr += 2;
+            memcpy(ptr, &snapshot.attitude.wheel_setpoint_rpm, sizeof(int16_t)); ptr += 2;
+            memcpy(ptr, &snapshot.attitude.latency_us, sizeof(uint16_t)); ptr += 2;
         }
 
-        ThisThread::sleep_for(LOG_INTERVAL);
+        if (timing_ready) {
+            put_time(snapshot.timing.timestamp);
+            memcpy(ptr, snapshot.timing.misses, sizeof(snapshot.timing.misses)); ptr += sizeof(snapshot.timing.misses);
+        }
+
+        size_t entry_size = ptr - buffer;
+        flashMutex.lock();
+        // session_stop() may have run since the check above
+        if (logging && log_write_address + entry_size > FLASH_LOG_START_ADDR + MAX_LOG_BYTES) {
+            logging = false;
+            log_full = true;
+        } else if (logging) {
+            f.write(log_write_address, buffer, entry_size);
+            log_index.noteEntry(log_write_address);
+            log_write_address += entry_size;
+        }
+        flashMutex.unlock();
+
+        last_snapshot = snapshot;
     }
 }
 
+// Size of a log entry from its flag byte (see log_task_raw), 0 for a byte
+// that starts no entry
+size_t log_entry_size(uint8_t flags) {
+    if (flags & 0x80) {
+        return 0;       // no such entry, a corrupt or torn flag byte
+    }
+    size_t entry_size = 1;
+    if (flags & 0x01){
+         entry_size += 4 + 2 + 2;
+    }
+    if (flags & 0x04){
+        entry_size += 4 + 4 * 4;
+    }
+    if (flags & 0x02){
+        entry_size += 4 + 6 * 3 * 2 + 4 * 2 + 2;
+    }
+    if (flags & 0x08){
+        entry_size += 4 + 4 * 2;
+    }
+    if (flags & 0x10){
+        entry_size += 4 + 5 * 2;
+    }
+    if (flags & 0x20){
+        entry_size += 4 + LOG_TIMING_TASKS * 2;
+    }
+    if (flags & 0x40){
+        entry_size += 8 + 4 + 1;
+    }
+    return entry_size;
+}
+
+// First erased entry of the log, or the end of the log area once it is full
+// (see Log/log_index.h). The search is timed for `status`, it runs before
+// the first sample at boot.
+uint32_t log_end_us = 0;
+uint32_t find_log_end() {
+    uint32_t start_us = us_ticker_read();
+    uint32_t end = log_index.findEnd();
+    log_end_us = us_ticker_read() - start_us;
+    return end;
+}
+
+// Starts the provisional session: logs from the first sample without
+// waiting for the operator. Leaves logging off once the log is full.
+void session_begin() {
+    uint8_t entry[SESSION_ENTRY_SIZE];
+    memset(entry, 0xFF, sizeof(entry));
+    entry[0] = 0x40;
+    uint64_t epoch_us = timebaseNowUs();
+    memcpy(&entry[1], &epoch_us, sizeof(epoch_us));
+
+    logMutex.lock();
+    session_epoch_us = epoch_us;
+    session_first_us = 0xFFFFFFFF;
+    logMutex.unlock();
+
+    flashMutex.lock();
+    log_write_address = find_log_end();     // after the last flight, or the one a reset interrupted
+    if (log_write_address + SESSION_ENTRY_SIZE > FLASH_LOG_START_ADDR + MAX_LOG_BYTES) {
+        log_full = true;
+        logging = false;
+        flashMutex.unlock();
+        return;
+    }
+    log_full = false;
+    session_address = log_write_address;
+    f.write(log_write_address, entry, sizeof(entry));
+    log_index.noteEntry(log_write_address);
+    log_write_address += sizeof(entry);
+    session_first_written = false;
+    session_confirm_written = false;
+    session_confirmed = false;
+    logging = true;
+    flashMutex.unlock();
+}
+
+// Keeps the session, the log task marks it confirmed on its next run. After
+// `stop` this starts a new one.
+void session_confirm() {
+    if (!logging) {
+        session_begin();
+    }
+    session_confirmed = true;
+}
+
+// Ends the session, for `stop` and the commands that need the flash
+void session_stop() {
+    flashMutex.lock();
+    logging = false;
+    flashMutex.unlock();
+}
+
+// Timestamps are in us since the last session entry, in ms since reset
+// before the first (older firmware)
+bool decode_session_us = false;
+
 void decode(const uint8_t* buffer, size_t length) {
     const uint8_t* ptr = buffer;
     uint8_t flags = *ptr++;
 
+    if (flags & 0x40) {
+        uint64_t epoch_us = *reinterpret_cast<const uint64_t*>(ptr); ptr += 8;
+        uint32_t first_us = *reinterpret_cast<const uint32_t*>(ptr); ptr += 4;
+        uint8_t state = *ptr++;
+        decode_session_us = true;
+
+        serial.printf("[%llu us] SESSION: %s, first IMU sample at %d us\n", static_cast<unsigned long long>(epoch_us),
+            state == 0x00 ? "confirmed" : "provisional", first_us == 0xFFFFFFFF ? -1 : static_cast<int>(first_us));
+        return;
+    }
+    const char* unit = decode_session_us ? "us" : "ms";
+
     if (flags & 0x01) {
         uint32_t ts_enc = *reinterpret_cast<const uint32_t*>(ptr); ptr += 4;
         int16_t enc1 = *reinterpret_cast<const int16_t*>(ptr); ptr += 2;
@@ -360,11 +1074,25 @@ void decode(const uint8_t* buffer, size_t length) {
         float enc1_pos = static_cast<float>(enc1) / ENCODER_PPM;
         float enc2_pos = static_cast<float>(enc2) / ENCODER_PPM;
 
-        serial.printf("[%u us] ENCODERS:\n", ts_enc);
+        serial.printf("[%u %s] ENCODERS:\n", ts_enc, unit);
         serial.printf("  ENC1: %.3f (raw %d)\n", enc1_pos, enc1);
         serial.printf("  ENC2: %.3f (raw %d)\n", enc2_pos, enc2);
     }
 
+    if (flags & 0x04) {
+        uint32_t ts_enc = *reinterpret_cast<const uint32_t*>(ptr); ptr += 4;
+        int32_t enc1 = *reinterpret_cast<const int32_t*>(ptr); ptr += 4;
+        int32_t enc2 = *reinterpret_cast<const int32_t*>(ptr); ptr += 4;
+        int32_t speed1 = *reinterpret_cast<const int32_t*>(ptr); ptr += 4;
+        int32_t speed2 = *reinterpret_cast<const int32_t*>(ptr); ptr += 4;
+
+        serial.printf("[%u %s] ENCODERS:\n", ts_enc, unit);
+        serial.printf("  ENC1: %.3f (raw %d), %.1f RPM\n",
+            static_cast<float>(enc1) / ENCODER_PPM, enc1, speed1 * 60.0f / ENCODER_PPM);
+        serial.printf("  ENC2: %.3f (raw %d), %.1f RPM\n",
+            static_cast<float>(enc2) / ENCODER_PPM, enc2, speed2 * 60.0f / ENCODER_PPM);
+    }
+
     if (flags & 0x02) {
         uint32_t ts_imu = *reinterpret_cast<const uint32_t*>(ptr); ptr += 4;
 
@@ -389,7 +1117,7 @@ void decode(const uint8_t* buffer, size_t length) {
             serial.printf("  QUAT [w: %.4f, x: %.4f, y: %.4f, z: %.4f]\n", v.w, v.x, v.y, v.z);
         };
 
-        serial.printf("[%u us] BNO055:\n", ts_imu);
+        serial.printf("[%u %s] BNO055:\n", ts_imu, unit);
         read_vec3("ACC ", BNO055_VECTOR_ACCELEROMETER);
         read_vec3("GYR ", BNO055_VECTOR_GYROSCOPE);
         read_vec3("MAG ", BNO055_VECTOR_MAGNETOMETER);
@@ -402,14 +1130,65 @@ void decode(const uint8_t* buffer, size_t length) {
         float temp_celsius = temp_raw * 0.0625f;
         serial.printf("  TEMP: %.2f C\n", temp_celsius, temp_raw);
     }
+
+    if (flags & 0x08) {
+        uint32_t ts_ctl = *reinterpret_cast<const uint32_t*>(ptr); ptr += 4;
+        int16_t setpoint = *reinterpret_cast<const int16_t*>(ptr); ptr += 2;
+        int16_t error = *reinterpret_cast<const int16_t*>(ptr); ptr += 2;
+        uint16_t output = *reinterpret_cast<const uint16_t*>(ptr); ptr += 2;
+        uint16_t jitter = *reinterpret_cast<const uint16_t*>(ptr); ptr += 2;
+
+        serial.printf("[%u %s] CONTROL:\n", ts_ctl, unit);
+        serial.printf("  SETPOINT: %d RPM, ERROR: %d RPM, OUTPUT: %.4f, JITTER: %u us\n",
+            setpoint, error, output / 10000.0f, jitter);
+    }
+
+    if (flags & 0x10) {
+        uint32_t ts_att = *reinterpret_cast<const uint32_t*>(ptr); ptr += 4;
+        int16_t target = *reinterpret_cast<const int16_t*>(ptr); ptr += 2;
+        int16_t roll = *reinterpret_cast<const int16_t*>(ptr); ptr += 2;
+        int16_t rate = *reinterpret_cast<const int16_t*>(ptr); ptr += 2;
+        int16_t wheel = *reinterpret_cast<const int16_t*>(ptr); ptr += 2;
+        uint16_t latency = *reinterpret_cast<const uint16_t*>(ptr); ptr += 2;
+
+        serial.printf("[%u %s] ATTITUDE:\n", ts_att, unit);
+        serial.printf("  TARGET: %.2f deg, ROLL: %.2f deg, RATE: %.2f dps, WHEEL: %d RPM, LATENCY: %u us\n",
+            target / 16.0f, roll / 16.0f, rate / 16.0f, wheel, latency);
+    }
+
+    if (flags & 0x20) {
+        uint32_t ts_mon = *reinterpret_cast<const uint32_t*>(ptr); ptr += 4;
+
+        serial.printf("[%u %s] DEADLINE MISSES:\n ", ts_mon, unit);
+        for (int i = 0; i < LOG_TIMING_TASKS; i++) {
+            uint16_t misses = *reinterpret_cast<const uint16_t*>(ptr); ptr += 2;
+            serial.printf(" TASK %d: %u", i, misses);
+        }
+        serial.printf("\n");
+    }
 }
 
 void decodeCSV(const uint8_t* buffer, size_t length) {
     const uint8_t* ptr = buffer;
     uint8_t flags = *ptr++;
 
+    // Sessions are comment lines, between the rows of the sessions they
+    // start: # session,epoch us since reset,first IMU sample us,state. The
+    // row timestamps are us since that epoch, ms since reset before any.
+    if (flags & 0x40) {
+        uint64_t epoch_us = *reinterpret_cast<const uint64_t*>(ptr); ptr += 8;
+        uint32_t first_us = *reinterpret_cast<const uint32_t*>(ptr); ptr += 4;
+        uint8_t state = *ptr++;
+        decode_session_us = true;
+
+        serial.printf("# session,%llu,%d,%s\n", static_cast<unsigned long long>(epoch_us), first_us == 0xFFFFFFFF ? -1 : static_cast<int>(first_us),
+            state == 0x00 ? "confirmed" : "provisional");
+        return;
+    }
+
     uint32_t ts_enc = 0, ts_imu = 0;
     float enc1_pos = -999999.0f, enc2_pos = -999999.0f;
+    float enc1_rpm = -999999.0f, enc2_rpm = -999999.0f;
     float acc[3] = {-999999.0f, -999999.0f, -999999.0f};
     float gyr[3] = {-999999.0f, -999999.0f, -999999.0f};
     float mag[3] = {-999999.0f, -999999.0f, -999999.0f};
@@ -418,6 +1197,15 @@ void decodeCSV(const uint8_t* buffer, size_t length) {
     float grav[3] = {-999999.0f, -999999.0f, -999999.0f};
     float quat[4] = {-999999.0f, -999999.0f, -999999.0f, -999999.0f};
     float temp_celsius = -999999.0f;
+    uint32_t ts_ctl = 0;
+    float setpoint_rpm = -999999.0f, error_rpm = -999999.0f, output = -999999.0f;
+    int jitter_us = -1;
+    uint32_t ts_att = 0;
+    float target_deg = -999999.0f, roll_deg = -999999.0f, rate_dps = -999999.0f, wheel_rpm = -999999.0f;
+    int latency_us = -1;
+    uint32_t ts_mon = 0;
+    int misses[LOG_TIMING_TASKS];
+    for (int i = 0; i < LOG_TIMING_TASKS; i++) misses[i] = -1;
 
     if (flags & 0x01) {
         ts_enc = *reinterpret_cast<const uint32_t*>(ptr); ptr += 4;
@@ -428,6 +1216,19 @@ void decodeCSV(const uint8_t* buffer, size_t length) {
         enc2_pos = static_cast<float>(enc2) / ENCODER_PPM;
     }
 
+    if (flags & 0x04) {
+        ts_enc = *reinterpret_cast<const uint32_t*>(ptr); ptr += 4;
+        int32_t enc1 = *reinterpret_cast<const int32_t*>(ptr); ptr += 4;
+        int32_t enc2 = *reinterpret_cast<const int32_t*>(ptr); ptr += 4;
+        int32_t speed1 = *reinterpret_cast<const int32_t*>(ptr); ptr += 4;
+        int32_t speed2 = *reinterpret_cast<const int32_t*>(ptr); ptr += 4;
+
+        enc1_pos = static_cast<float>(enc1) / ENCODER_PPM;
+        enc2_pos = static_cast<float>(enc2) / ENCODER_PPM;
+        enc1_rpm = speed1 * 60.0f / ENCODER_PPM;
+        enc2_rpm = speed2 * 60.0f / ENCODER_PPM;
+    }
+
     if (flags & 0x02) {
         ts_imu = *reinterpret_cast<const uint32_t*>(ptr); ptr += 4;
 
@@ -467,7 +1268,31 @@ void decodeCSV(const uint8_t* buffer, size_t length) {
         temp_celsius = temp_raw * 0.0625f;
     }
 
-    serial.printf("%u,%.3f,%.3f,%u,", ts_enc, enc1_pos, enc2_pos, ts_imu);
+    if (flags & 0x08) {
+        ts_ctl = *reinterpret_cast<const uint32_t*>(ptr); ptr += 4;
+        setpoint_rpm = *reinterpret_cast<const int16_t*>(ptr); ptr += 2;
+        error_rpm = *reinterpret_cast<const int16_t*>(ptr); ptr += 2;
+        output = *reinterpret_cast<const uint16_t*>(ptr) / 10000.0f; ptr += 2;
+        jitter_us = *reinterpret_cast<const uint16_t*>(ptr); ptr += 2;
+    }
+
+    if (flags & 0x10) {
+        ts_att = *reinterpret_cast<const uint32_t*>(ptr); ptr += 4;
+        target_deg = *reinterpret_cast<const int16_t*>(ptr) / 16.0f; ptr += 2;
+        roll_deg = *reinterpret_cast<const int16_t*>(ptr) / 16.0f; ptr += 2;
+        rate_dps = *reinterpret_cast<const int16_t*>(ptr) / 16.0f; ptr += 2;
+        wheel_rpm = *reinterpret_cast<const int16_t*>(ptr); ptr += 2;
+        latency_us = *reinterpret_cast<const uint16_t*>(ptr); ptr += 2;
+    }
+
+    if (flags & 0x20) {
+        ts_mon = *reinterpret_cast<const uint32_t*>(ptr); ptr += 4;
+        for (int i = 0; i < LOG_TIMING_TASKS; i++) {
+            misses[i] = *reinterpret_cast<const uint16_t*>(ptr); ptr += 2;
+        }
+    }
+
+    serial.printf("%u,%.3f,%.3f,%.1f,%.1f,%u,", ts_enc, enc1_pos, enc2_pos, enc1_rpm, enc2_rpm, ts_imu);
     for (int i = 0; i < 3; i++) serial.printf("%.3f,", acc[i]);
     for (int i = 0; i < 3; i++) serial.printf("%.3f,", gyr[i]);
     for (int i = 0; i < 3; i++) serial.printf("%.3f,", mag[i]);
@@ -475,7 +1300,12 @@ void decodeCSV(const uint8_t* buffer, size_t length) {
     for (int i = 0; i < 3; i++) serial.printf("%.3f,", lin[i]);
     for (int i = 0; i < 3; i++) serial.printf("%.3f,", grav[i]);
     for (int i = 0; i < 4; i++) serial.printf("%.4f,", quat[i]);
-    serial.printf("%.2f\n", temp_celsius);
+    serial.printf("%.2f,", temp_celsius);
+    serial.printf("%u,%.0f,%.0f,%.4f,%d,", ts_ctl, setpoint_rpm, error_rpm, output, jitter_us);
+    serial.printf("%u,%.2f,%.2f,%.2f,%.0f,%d,", ts_att, target_deg, roll_deg, rate_dps, wheel_rpm, latency_us);
+    serial.printf("%u", ts_mon);
+    for (int i = 0; i < LOG_TIMING_TASKS; i++) serial.printf(",%d", misses[i]);
+    serial.printf("\n");
 }
 
 void suspend() {
@@ -483,47 +1313,615 @@ void suspend() {
     tmp.shutDown(); // SD mode
 }
 
-void setup(bool motor) {
-    // pwm.pulsewidth_us(2000);
-    // ThisThread::sleep_for(1000ms);
-    // pwm.pulsewidth_us(1000);
-    // ThisThread::sleep_for(1000ms);
-    if (motor) {
-        mymotor.arm();
-    }
-    bno.writeData(0x3E, 0x00, 1); // PWR_MODE = Normal
-    ThisThread::sleep_for(10ms);
-
-    bno.writeData(0x3D, 0x00, 1); // OPR_MODE = CONFIGMODE
-    ThisThread::sleep_for(25ms);
-
-    bno.writeData(0x3F, 0x20, 1); // SYS_TRIGGER = RESET
-    ThisThread::sleep_for(650ms);
-
-    bno.writeData(0x07, 0x00, 1); // PAGE_ID = 0
-    ThisThread::sleep_for(10ms);
-
-    bno.writeData(0x3D, 0x0C, 1); // OPR_MODE = NDOF
-    ThisThread::sleep_for(20ms);
-    tmp.turnOn();
-    std::string freq = "+sfreq434000000";
-    std::string rate = "+srate38400";
-    std::string filter = "+sfilter104166";
-    std::string dev = "+sdev20000";
-    std::string mod = "+smod1";
-    std::string app = "+app";
-    writeUART(&uart,reinterpret_cast<const uint8_t*>(freq.c_str()), freq.length());
-    writeUART(&uart,reinterpret_cast<const uint8_t*>(rate.c_str()), rate.length());
-    writeUART(&uart,reinterpret_cast<const uint8_t*>(filter.c_str()), filter.length());
-    writeUART(&uart,reinterpret_cast<const uint8_t*>(dev.c_str()), dev.length());
-    writeUART(&uart,reinterpret_cast<const uint8_t*>(mod.c_str()), mod.length());
-    writeUART(&uart,reinterpret_cast<const uint8_t*>(app.c_str()), app.length());
+// Bring-up steps for boot_devices()
+BootStatus boot_imu() {
+    BootStatus status = bno_boot.poll();
+    if (status != BootStatus::Pending) {
+        tmp.turnOn();
+        imu_ready = true;       // sampled even if the bring-up failed, as before
+    }
+    return status;
+}
+
+BootStatus boot_radio() {
+    static const char* const modem_config[] = {
+        "+sfreq434000000", "+srate38400", "+sfilter104166", "+sdev20000", "+smod1", "+app"
+    };
+    for (const char* command : modem_config) {
+        writeUART(&uart, reinterpret_cast<const uint8_t*>(command), strlen(command));
+    }
+    return BootStatus::Done;
+}
+
+BootStatus boot_esc() {
+    static bool started = false;
+    if (!started) {
+        mymotor.beginArm();
+        started = true;
+    }
+    return mymotor.pollArm() ? BootStatus::Done : BootStatus::Pending;
 }
+
+// BNO055 reset, modem configuration and ESC arming side by side, see
+// Boot/boot.h. The sensor task samples as soon as the BNO055 is up.
+void boot_devices(bool arm_esc) {
+    bno.i2c->frequency(I2C_FREQUENCY);
+    tmp.i2c->frequency(I2C_FREQUENCY);
+    boot.add("bno055", boot_imu);
+    boot.add("radio", boot_radio);
+    if (arm_esc) {
+        boot.add("esc", boot_esc);
+    }
+    boot.run(BOOT_TIMEOUT_MS);
+}
+
+// Group period in ticks for a rate, the nearest whole tick
+uint32_t rate_divider(uint32_t hz) {
+    const uint32_t tick_hz = 1000000 / RATE_TICK_US;
+    uint32_t divider = (tick_hz + hz / 2) / hz;
+    return divider > 0 ? divider : 1;
+}
+
+void print_rates() {
+    for (const RateSetting& setting : rate_settings) {
+        uint32_t period_us = setting.group->getPeriodUs();
+        serial.printf("rate %s: %u Hz, every %u.%03u ms\n", setting.name, *setting.hz,
+            period_us / 1000, period_us % 1000);
+    }
+}
+
+void request_state(State next, const char* reply) {
+    if (logging && session_confirmed) {
+        serial.printf("busy: logging\n");
+        return;
+    }
+    requested_state = next;
+    serial.printf("%s", reply);
+}
+
+void cmd_clear(int argc, char** argv) {
+    request_state(State::Reset, "clear received\n");
+}
+
+void cmd_log(int argc, char** argv) {
+    request_state(State::Decode, "log received\n");
+}
+
+void cmd_start(int argc, char** argv) {
+    // The node ID picks this board's TDMA slot and radio address
+    if (argc > 1 && !(logging && session_confirmed)) {
+        int node = atoi(argv[1]);
+        if (node < 0 || node > TDMA_MAX_NODES) {
+            serial.printf("usage: start [node 1-%u]\n", TDMA_MAX_NODES);
+            return;
+        }
+        uint32_t now_ms = static_cast<uint32_t>(Kernel::Clock::now().time_since_epoch().count());
+        tdma.setNode(node, now_ms);
+        radio_telem.setNode(node);
+        serial.printf("node %u\n", node);
+    }
+    request_state(State::Setup, "starting\n");
+}
+
+void print_fault(const FaultHeader& fault) {
+    serial.printf("fault record: %s at %u ms in %.*s, status 0x%08x, late task %d\n",
+        fault.reason == FAULT_WATCHDOG ? "watchdog" : "error", fault.time_ms,
+        FAULT_NAME_LEN, fault.thread, fault.error_status, fault.culprit == 0xFF ? -1 : fault.culprit);
+    serial.printf("  pc 0x%08x lr 0x%08x sp 0x%08x cfsr 0x%08x hfsr 0x%08x, %u threads, %u tasks, %u trace events\n",
+        fault.pc, fault.lr, fault.sp, fault.cfsr, fault.hfsr, fault.threads, fault.tasks, fault.events);
+}
+
+void cmd_status(int argc, char** argv) {
+    uint32_t uptime_ms = static_cast<uint32_t>(
+        Kernel::Clock::now().time_since_epoch().count()
+    );
+    serial.printf("state: %s\n", !logging ? "idle" : session_confirmed ? "logging" : "logging, provisional");
+    serial.printf("uptime: %u ms\n", uptime_ms);
+    serial.printf("log bytes: %u of %u%s\n", log_write_address - FLASH_LOG_START_ADDR, MAX_LOG_BYTES,
+        log_full ? ", log full, not logging until clear" : "");
+    serial.printf("log end: found in %u us, %u bytes walked\n", log_end_us, log_index.getWalked());
+    char line[96];
+    int n = snprintf(line, sizeof(line), "boot: %u ms", boot.getElapsedMs());
+    static const char* results[] = {"pending", "done", "failed"};
+    for (int i = 0; i < boot.getCount() && n < static_cast<int>(sizeof(line)); i++) {
+        const BootStep* step = boot.getStep(i);
+        n += snprintf(&line[n], sizeof(line) - n, ", %s %s at %u ms", step->name,
+            results[static_cast<int>(step->status)], step->done_ms);
+    }
+    serial.printf("%s\n", line);
+    serial.printf("first IMU sample: %u.%03u ms after reset\n", first_sample_us / 1000, first_sample_us % 1000);
+    print_rates();
+    serial.printf("console overflows: %u\n", console.getOverflows());
+    serial.printf("radio: %u Hz, %u frames, %u fields dropped\n",
+        radio_telem.getRate(), radio_telem.getFramesSent(), radio_telem.getFieldsDropped());
+    serial.printf("radio commands: %u duplicates, %u corrupt\n",
+        radio_cmd.getDuplicates(), radio_cmd.getCorrupt());
+    serial.printf("radio fec: mode %u, %u bytes corrected, %u frames failed\n",
+        radio_telem.getFec(), radio_fec_corrected, radio_fec_failed);
+
+    const TdmaSchedule& schedule = tdma.getSchedule();
+    serial.printf("radio node: %u, %s, %u slots of %u ms, %u beacons, %u missed, error %d ms\n",
+        tdma.getNode(), tdma.isSynced(uptime_ms) ? "synced" : "free running",
+        schedule.nodes, schedule.slot_ms, tdma.getBeacons(), tdma.getMissed(), tdma.getError());
+    const encoder* encoders[] = {&e1, &e2};
+    for (int i = 0; i < 2; i++) {
+        EncoderHealth health = encoders[i]->getHealth();
+        serial.printf("encoder %d: %s%s, up to %.0f RPM, %u edges, %u invalid, %u glitches, %u storms\n",
+            i + 1, encoders[i]->isHardware() ? "timer" : "interrupts", health.polling ? " (polling)" : "",
+            encoders[i]->getMaxRpm(), health.edges, health.invalid, health.glitches, health.storms);
+    }
+    serial.printf("motor: %s, setpoint %.0f RPM, %.0f RPM, output %.3f, %u loops, worst jitter %u us\n",
+        motor_armed ? "armed" : "off", motor_setpoint_rpm, control_rpm, mymotor.getSpeed(),
+        control_loops, control_jitter_max_us);
+    static const char* protocols[] = {"pwm50", "pwm400", "oneshot125", "multishot"};
+    serial.printf("esc: %s, command to pulse %.1f us, worst %.1f us\n",
+        protocols[static_cast<int>(mymotor.getProtocol())], mymotor.getLatency(), mymotor.getMaxLatency());
+    uint32_t samples = latency_count;
+    serial.printf("attitude: %s, target %.1f deg, %u updates, %u stale, latency %u/%u/%u us (min/avg/max)\n",
+        attitude_enabled ? "engaged" : "off", attitude_target_deg, attitude_updates, attitude_stale,
+        samples ? latency_min_us : 0, samples ? static_cast<uint32_t>(latency_sum_us / samples) : 0, latency_max_us);
+
+    // Each task used to be a thread with a default stack
+    int tasks = 0;
+    for (int i = 0; i < scheduler.getGroupCount(); i++) {
+        const RateGroup* group = scheduler.getGroup(i);
+        RateGroupStats stats = group->getStats();
+        uint32_t timed = stats.runs > 1 ? stats.runs - 1 : 1;
+        serial.printf("rate %s: %u runs, %u overruns, jitter %u/%u us (avg/max), longest run %u us\n",
+            group->getName(), stats.runs, stats.overruns, static_cast<uint32_t>(stats.jitter_sum_us / timed),
+            stats.jitter_max_us, stats.exec_max_us);
+        tasks += group->getTaskCount();
+    }
+    serial.printf("rate stacks: %u bytes for %d tasks, %u as threads\n",
+        scheduler.getStackBytes(), tasks, tasks * OS_STACK_SIZE);
+
+    for (int i = 0; i < monitor.getCount(); i++) {
+        TaskTiming timing = monitor.getTiming(i);
+        serial.printf("task %s: %u runs, %u misses, worst response %u us of %u, longest run %u us\n",
+            timing.name, timing.runs, timing.misses, timing.response_max_us, timing.deadline_us, timing.exec_max_us);
+    }
+    int culprit = watchdog_culprit;
+    serial.printf("watchdog: %s, %u kicks withheld, last for %s%s\n",
+        Watchdog::get_instance().is_running() ? "running" : "off", watchdog_withheld,
+        culprit >= 0 ? monitor.getTiming(culprit).name : "none",
+        watchdog_resumed ? ", resumed after a watchdog reset" : "");
+    if (last_fault_valid) {
+        print_fault(last_fault);
+    } else {
+        serial.printf("fault record: none\n");
+    }
+}
+
+void cmd_stats(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+        profilerReset();
+        serial.printf("stats reset\n");
+        return;
+    }
+    if (!PROFILER_ENABLED) {
+        serial.printf("profiler disabled (PROFILER_ENABLED)\n");
+        return;
+    }
+
+    float per_us = static_cast<float>(profilerCyclesPerUs());
+    serial.printf("cpu load: %.1f%% last 200 ms, %.1f%% average\n",
+        profilerLoad() * 100.0f, profilerAverageLoad() * 100.0f);
+    serial.printf("probe overhead: %u cycles, %.0f cycles/us\n", profilerOverhead(), per_us);
+
+    // One USB write per line
+    char line[192];
+    int n = snprintf(line, sizeof(line), "histogram bins end at");
+    for (int b = 0; b < PROFILE_HIST_BINS - 1; b++) {
+        n += snprintf(&line[n], sizeof(line) - n, " %.1f", PROFILE_BIN_END(b) / per_us);
+    }
+    serial.printf("%s us\n", line);
+
+    for (const ProfileProbe* probe = profileFirst(); probe; probe = probe->getNext()) {
+        if (probe->getCategory() == TRACE_MARKS) {
+            continue;       // trace instants only, never timed
+        }
+        ProfileStats stats = probe->getStats();
+        float mean = stats.count ? static_cast<float>(stats.total) / stats.count : 0.0f;
+        n = snprintf(line, sizeof(line), "%s: %u, min %.1f, mean %.1f, max %.1f us, bins",
+            stats.name, stats.count, stats.min / per_us, mean / per_us, stats.max / per_us);
+        for (int b = 0; b < PROFILE_HIST_BINS && n < static_cast<int>(sizeof(line)); b++) {
+            n += snprintf(&line[n], sizeof(line) - n, " %u", stats.hist[b]);
+        }
+        serial.printf("%s\n", line);
+    }
+}
+
+/**
+ * @brief Send the trace as TELEM_TRACE_* frames for trace.py: probe, thread
+ * and monitored task names first, then the events oldest first.
+ */
+void trace_dump() {
+    TelemetryFrame frame;
+    auto send_name = [&](uint8_t table, uint8_t index, const char* name) {
+        frame.begin(TELEM_TRACE_NAME);
+        frame.putU8(table);
+        frame.putU8(index);
+        for (const char* c = name; *c; c++) {
+            frame.putU8(static_cast<uint8_t>(*c));
+        }
+        if (frame.finish()) {
+            serial.write(reinterpret_cast<const char*>(frame.data()), frame.size());
+        }
+    };
+
+    for (const ProfileProbe* probe = profileFirst(); probe; probe = probe->getNext()) {
+        send_name(0, probe->getId(), probe->getName());
+    }
+    for (int i = 0; traceThreadName(i); i++) {
+        send_name(1, i, traceThreadName(i));
+    }
+    for (int i = 0; i < monitor.getCount(); i++) {
+        send_name(2, i, monitor.getTiming(i).name);
+    }
+
+    // An empty trace still sends one frame, so the host knows the total
+    uint32_t total = traceCount();
+    uint32_t first = 0;
+    TraceEvent events[TRACE_DUMP_EVENTS];
+    do {
+        size_t n = traceRead(first, events, TRACE_DUMP_EVENTS);
+        frame.begin(TELEM_TRACE_EVENTS);
+        frame.putU32(first);
+        frame.putU32(total);
+        frame.putU16(static_cast<uint16_t>(profilerCyclesPerUs()));
+        for (size_t i = 0; i < n; i++) {
+            frame.putU32(events[i].cycles);
+            frame.putU8(events[i].phase);
+            frame.putU8(events[i].name);
+            frame.putU8(events[i].thread);
+            frame.putU8(events[i].arg);
+        }
+        if (frame.finish()) {
+            serial.write(reinterpret_cast<const char*>(frame.data()), frame.size());
+        }
+        first += n;
+    } while (first < total);
+}
+
+void cmd_trace(int argc, char** argv) {
+    if (argc < 2) {
+        serial.printf("trace %s%s, %u of %u events, mask 0x%02x\n",
+            traceRunning() ? "running" : "stopped", traceTriggered() ? " after a deadline miss" : "",
+            traceCount(), TRACE_EVENTS, trace_mask);
+        serial.printf("usage: trace on|miss [mask] (default 0x%02x), off, dump\n", TRACE_DEFAULT);
+        return;
+    }
+
+    if (strcmp(argv[1], "on") == 0 || strcmp(argv[1], "miss") == 0) {
+        uint32_t mask = argc > 2 ? strtoul(argv[2], nullptr, 0) : TRACE_DEFAULT;
+        bool on_miss = strcmp(argv[1], "miss") == 0;
+        if (!traceStart(mask, on_miss)) {
+            serial.printf("profiler disabled (PROFILER_ENABLED)\n");
+            return;
+        }
+        serial.printf("tracing 0x%02x%s\n", mask, on_miss ? " until half a ring after the next deadline miss" : "");
+    } else if (strcmp(argv[1], "off") == 0) {
+        traceStop();
+        serial.printf("trace stopped, %u events\n", traceCount());
+    } else if (strcmp(argv[1], "dump") == 0) {
+        traceStop();
+        trace_dump();
+    } else {
+        serial.printf("usage: trace on|miss [mask], off, dump\n");
+    }
+}
+
+// `fault dump` sends the record as TELEM_LOG_DATA frames at its flash
+// address, for fault.py
+void cmd_fault(int argc, char** argv) {
+    if (argc < 2) {
+        if (last_fault_valid) {
+            print_fault(last_fault);
+        } else {
+            serial.printf("fault record: none\n");
+        }
+        serial.printf("usage: fault dump|clear\n");
+        return;
+    }
+
+    if (strcmp(argv[1], "dump") == 0) {
+        if (!last_fault_valid) {
+            serial.printf("fault record: none\n");
+            return;
+        }
+        TelemetryFrame frame;
+        uint8_t data[128];
+        uint32_t size = last_fault.length + sizeof(uint16_t);
+        for (uint32_t offset = 0; offset < size; offset += sizeof(data)) {
+            uint32_t n = size - offset < sizeof(data) ? size - offset : sizeof(data);
+            flashMutex.lock();
+            f.read(FAULT_SECTOR_ADDR + offset, data, n);
+            flashMutex.unlock();
+
+            frame.begin(TELEM_LOG_DATA);
+            frame.putU32(FAULT_SECTOR_ADDR + offset);
+            for (uint32_t i = 0; i < n; i++) {
+                frame.putU8(data[i]);
+            }
+            if (frame.finish()) {
+                serial.write(reinterpret_cast<const char*>(frame.data()), frame.size());
+            }
+        }
+    } else if (strcmp(argv[1], "clear") == 0) {
+        flashMutex.lock();
+        f.eraseSector(FAULT_SECTOR_ADDR);
+        flashMutex.unlock();
+        last_fault_valid = false;
+        serial.printf("fault record erased\n");
+    } else {
+        serial.printf("usage: fault dump|clear\n");
+    }
+}
+
+void cmd_roll(int argc, char** argv) {
+    if (argc < 2) {
+        serial.printf("usage: roll <deg>|off\n");
+        return;
+    }
+    if (strcmp(argv[1], "off") == 0) {
+        attitude_enabled = false;
+        serial.printf("attitude control off, wheel back to %.0f RPM\n", motor_setpoint_rpm);
+        return;
+    }
+    attitude_target_deg = atof(argv[1]);
+    attitude_enabled = true;
+    serial.printf("holding roll at %.1f deg\n", attitude_target_deg);
+}
+
+void cmd_speed(int argc, char** argv) {
+    if (argc < 2) {
+        serial.printf("usage: speed <rpm>\n");
+        return;
+    }
+    float rpm = atof(argv[1]);
+    float max_rpm = e1.getMaxRpm();     // above it the wheel speed is not measured
+    if (rpm > max_rpm) {
+        rpm = max_rpm;
+    }
+    motor_setpoint_rpm = rpm > 0.0f ? rpm : 0.0f;
+    serial.printf("motor setpoint %.0f RPM (encoder limit %.0f)\n", motor_setpoint_rpm, max_rpm);
+}
+
+void cmd_radio(int argc, char** argv) {
+    if (argc < 2) {
+        serial.printf("usage: radio <hz>\n");
+        return;
+    }
+    radio_telem.setRate(atoi(argv[1]));
+    // The radio thread reports once per period, slow rates need a longer deadline
+    monitor.setDeadline(radio_task_id, chrono::duration_cast<chrono::microseconds>(radio_telem.getPeriod()).count());
+    serial.printf("radio telemetry %u Hz, %u byte budget\n",
+        radio_telem.getRate(), radio_telem.getBudget());
+}
+
+void cmd_fec(int argc, char** argv) {
+    if (argc < 2) {
+        serial.printf("usage: fec <0-%u>\n", FEC_MODES - 1);
+        return;
+    }
+    radio_telem.setFec(atoi(argv[1]));
+    serial.printf("radio fec mode %u, %u byte budget\n",
+        radio_telem.getFec(), radio_telem.getBudget());
+}
+
+// Sets a task rate from its next period on, and keeps it for the next boot
+void cmd_set(int argc, char** argv) {
+    if (argc == 1) {
+        print_rates();
+        return;
+    }
+    const RateSetting* setting = nullptr;
+    if (argc == 4 && strcmp(argv[1], "rate") == 0) {
+        for (const RateSetting& s : rate_settings) {
+            if (strcmp(argv[2], s.name) == 0) {
+                setting = &s;
+            }
+        }
+    }
+    int hz = argc == 4 ? atoi(argv[3]) : 0;
+    if (!setting || hz < 1 || hz > setting->max_hz) {
+        serial.printf("usage: set rate imu|enc|log <hz>, up to %u|%u|%u Hz\n", IMU_MAX_HZ, ENC_MAX_HZ, LOG_MAX_HZ);
+        return;
+    }
+
+    setting->group->setDivider(rate_divider(hz));
+    flashMutex.lock();
+    *setting->hz = hz;
+    config_store.save(config);
+    flashMutex.unlock();
+    print_rates();
+}
+
+// Ends the flight's logging and stops the motor; start begins a new session,
+// log and clear work again
+void cmd_stop(int argc, char** argv) {
+    if (!logging) {
+        serial.printf("not logging\n");
+        return;
+    }
+    session_stop();
+    attitude_enabled = false;
+    motor_setpoint_rpm = 0.0f;
+    if (flight_state == State::Main) {
+        flight_state = State::Idle;
+    }
+    serial.printf("stopped, %u log bytes\n", log_write_address - FLASH_LOG_START_ADDR);
+}
+
+// Stack high-water marks of every thread, then heap use per watched thread
+void cmd_mem(int argc, char** argv) {
+    osThreadId_t threads[MEM_MAX_THREADS];
+    uint32_t count = osThreadEnumerate(threads, MEM_MAX_THREADS);
+
+    serial.printf("thread        stack   used\n");
+    for (uint32_t i = 0; i < count; i++) {
+        const char* name = osThreadGetName(threads[i]);
+        uint32_t size = osThreadGetStackSize(threads[i]);
+        uint32_t used = size - osThreadGetStackSpace(threads[i]);
+        serial.printf("%-12s %6u %6u %5.1f%%\n", name ? name : "?", size, used, 100.0f * used / size);
+    }
+    // Only exists during writes, serial measures it itself
+    serial.printf("%-12s %6u %6u %5.1f%%\n", "usb", serial.getStackSize(), serial.getStackMax(),
+        100.0f * serial.getStackMax() / serial.getStackSize());
+
+    mbed_stats_heap_t heap;
+    mbed_stats_heap_get(&heap);
+    if (heap.reserved_size == 0) {
+        serial.printf("heap stats disabled (platform.heap-stats-enabled)\n");
+        return;
+    }
+    serial.printf("heap: %u of %u bytes in %u blocks, most %u, %u failed\n",
+        heap.current_size, heap.reserved_size, heap.alloc_cnt, heap.max_size, heap.alloc_fail_cnt);
+    serial.printf("heap watch     runs allocating    bytes   peak\n");
+    for (const HeapWatch* watch = heapWatchFirst(); watch; watch = watch->getNext()) {
+        HeapStats stats = watch->getStats();
+        serial.printf("%-12s %6u %10u %8u %6u%s\n", stats.name, stats.runs, stats.allocating,
+            stats.bytes, stats.peak, stats.hot ? " hot path" : "");
+    }
+}
+
+void register_commands() {
+    console.addCommand("clear", cmd_clear, "erase the log and exit");
+    console.addCommand("log", cmd_log, "dump flash log as CSV");
+    console.addCommand("start", cmd_start, "arm motor and start logging, optional TDMA node ID");
+    console.addCommand("status", cmd_status, "print logger status");
+    console.addCommand("radio", cmd_radio, "set radio telemetry rate (Hz)");
+    console.addCommand("fec", cmd_fec, "set radio FEC mode (0 off - 3 heavy)");
+    console.addCommand("speed", cmd_speed, "set motor speed setpoint (RPM, 0 stops)");
+    console.addCommand("roll", cmd_roll, "hold a roll angle with the reaction wheel, or off");
+    console.addCommand("stats", cmd_stats, "CPU load and profiler timings, or reset");
+    console.addCommand("trace", cmd_trace, "event trace: on|miss [mask], off, dump (see trace.py)");
+    console.addCommand("fault", cmd_fault, "last fault record, dump (see fault.py) or clear");
+    console.addCommand("mem", cmd_mem, "stack and heap high-water marks per thread");
+    console.addCommand("set", cmd_set, "set rate imu|enc|log <hz>, saved to flash");
+    console.addCommand("stop", cmd_stop, "stop logging and the motor");
+}
+
+/**
+ * @brief Answer log download requests (Framing/download.h).
+ *
+ * Requested chunks are streamed back paced to the radio's airtime so the
+ * modem is never handed more than it can send.
+ *
+ * @return true if msg was a download request.
+ */
+bool serve_download(const uint8_t* msg, size_t len) {
+    static uint32_t log_end = 0;
+    static bool log_end_known = false;
+    uint32_t base, mask;
+
+    bool info = dlIsInfoRequest(msg, len);
+    bool read = !info && dlParseRead(msg, len, base, mask);
+    if (!info && !read) {
+        return false;
+    }
+
+    // Every download starts with a size request, walk the log again then
+    // in case a flight was recorded since the last one
+    if (info || !log_end_known) {
+        flashMutex.lock();
+        log_end = find_log_end();
+        flashMutex.unlock();
+        log_end_known = true;
+    }
+    uint32_t size = log_end - FLASH_LOG_START_ADDR;
+    uint8_t out[DL_DATA_MAX_SIZE];
+
+    if (info) {
+        writeRadio(&uart, out, dlPackInfo(size, out), radio_telem.getFec(), tdma.getNode());
+        return true;
+    }
+
+    for (uint32_t i = 0; i < 32; i++) {
+        uint32_t offset = base + i * DL_CHUNK_SIZE;
+        if (!(mask & (1u << i)) || offset >= size) {
+            continue;
+        }
+
+        uint8_t data[DL_CHUNK_SIZE];
+        size_t n = (size - offset < DL_CHUNK_SIZE) ? size - offset : DL_CHUNK_SIZE;
+        flashMutex.lock();
+        f.read(FLASH_LOG_START_ADDR + offset, data, n);
+        flashMutex.unlock();
+
+        size_t msg_len = dlPackData(offset, data, n, out);
+        writeRadio(&uart, out, msg_len, radio_telem.getFec(), tdma.getNode());
+
+        size_t envelope = tdma.getNode() ? TDMA_NODE_OVERHEAD : 0;
+        size_t air_bytes = tdmaAirBytes(msg_len + envelope, radio_telem.getFec());
+        ThisThread::sleep_for(chrono::milliseconds(air_bytes * 8 * 1000 / RADIO_AIR_BPS + 1));
+    }
+    return true;
+}
+
+/**
+ * @brief Dispatch one radio message received while idle.
+ * @return true for download traffic, which keeps the board idle.
+ */
+bool radio_message(const uint8_t* msg, size_t len) {
+    if (serve_download(msg, len)) {
+        return true;
+    }
+    if (radio_command(msg, len, false)) {
+        radio_ack();
+    }
+    return false;
+}
+
+// clear and log end the firmware, the board restarts from a reset. Only
+// the log area and its index are erased: the saved config and the fault
+// record after them stay, `fault clear` erases the latter.
+void erase_flash() {
+    session_stop();
+    f.eraseRange(FLASH_LOG_START_ADDR, LOG_INDEX_ADDR + LOG_INDEX_SIZE);     // the log and its index
+    serial.printf("Flash Cleared, exiting\n");
+    exit(0);
+}
+
+void dump_log() {
+    session_stop();
+    uint32_t addr = FLASH_LOG_START_ADDR;
+    decode_session_us = false;
+    serial.printf("Starting\n");
+
+    while (addr < FLASH_LOG_START_ADDR + MAX_LOG_BYTES) {
+        serial.printf("%u", addr);
+        uint8_t flags = 0xFF;
+        f.read(addr, &flags, 1);
+
+        if (flags == 0xFF) {
+            break;
+        }
+
+        uint8_t entry[128];
+        size_t entry_size = log_entry_size(flags);
+        if (entry_size == 0 || entry_size > sizeof(entry) || addr + entry_size > FLASH_LOG_START_ADDR + MAX_LOG_BYTES) {
+            serial.printf("# bad entry, flags 0x%02x\n", flags);
+            break;
+        }
+        f.read(addr, entry, entry_size);
+
+        //decode(entry, entry_size); // Readable Printout
+        decodeCSV(entry, entry_size); // CSV Printout
+
+        addr += entry_size;
+        ThisThread::sleep_for(100ms);
+    }
+
+    serial.printf("# END OF LOG\n");
+    exit(0);
+}
+
 void wait_sequence() {
     State fsm_state = State::Idle;
-    char cmd_buffer[32];
     
     while (true) {
+        flight_state = fsm_state;
         switch(fsm_state) {
             case State::Idle: {
                 static Timer idle_timer;
@@ -533,48 +1931,45 @@ void wait_sequence() {
                     idle_timer.start();
                     timer_started = true;
                 }
-                // radio input commands
+                // radio input commands share the console command table
                 if (uart.readable()) {
-                    char uart_buf[256];
-                    std::string message;
+                    char uart_buf[64];
+                    bool received = false;
+                    bool downloading = false;
 
                     ssize_t n = uart.read(uart_buf, sizeof(uart_buf));
-                    if (n > 0) {
-                        if (parse(uart_buf, n, message)) {
-                            std::string msg = "ok";
-                            for (int i = 0; i < 5; i++){
-                                writeUART(&uart, reinterpret_cast<const uint8_t*>(message.c_str()), message.length());
-                            }
-                            if (strcmp(message.c_str(), "clear") == 0) {
-                                fsm_state = State::Reset;
-                                serial.printf("clear received\n");
-                            } else if (strcmp(message.c_str(), "log") == 0) {
-                                fsm_state = State::Decode;
-                                serial.printf("log received\n");
-                            } else if (strcmp(message.c_str(), "start") == 0) {
-                                fsm_state = State::Setup;
-                                serial.printf("starting");
+                    for (ssize_t i = 0; i < n; i++) {
+                        if (radio_rx.feed(uart_buf[i]) == FrameDecoder::Frame) {
+                            uint8_t buf[FRAME_MAX_PAYLOAD];
+                            size_t len;
+                            const uint8_t* msg = radio_decode(radio_rx, buf, len);
+
+                            // Beacons keep the schedule warm for the start of the flight
+                            if (msg && !radio_beacon(msg, len, radio_rx.length())) {
+                                downloading |= radio_message(msg, len);
                             }
+                            received = true;
+                        }
+                    }
+                    // Stay idle while the ground station is pulling the log
+                    if (downloading) {
+                        idle_timer.reset();
+                    }
+                    if (!received && n > 0) {
+                        char line[CONSOLE_MAX_LINE];
+                        if (parse(uart_buf, n, line, sizeof(line))) {
+                            radio_command(reinterpret_cast<const uint8_t*>(line), strlen(line), false);
                         }
                     }
+                }
 
-                }    
-                if (serial.readline(cmd_buffer, sizeof(cmd_buffer))) {
+                // USB commands arrive asynchronously through the console
+                State next = requested_state;
+                if (next != State::Idle) {
+                    requested_state = State::Idle;
+                    fsm_state = next;
                     idle_timer.reset();
-
-                    if (strcmp(cmd_buffer, "clear") == 0) {
-                        fsm_state = State::Reset;
-                        serial.printf("clear received\n");
-                        timer_started = false;
-                    } else if (strcmp(cmd_buffer, "log") == 0) {
-                        fsm_state = State::Decode;
-                        serial.printf("log received\n");
-                        timer_started = false;
-                    } else if (strcmp(cmd_buffer, "start") == 0) {
-                        fsm_state = State::Setup;
-                        serial.printf("starting\n");
-                        timer_started = false;
-                    }
+                    timer_started = false;
                 } else if (idle_timer.elapsed_time() > 30s) {
                     fsm_state = State::Timeout;
                     serial.printf("timeout\n");
@@ -588,70 +1983,93 @@ void wait_sequence() {
             }
 
             case State::Reset:
-                f.eraseAll();
-                serial.printf("Flash Cleared, exiting\n");
-                exit(0);
+                erase_flash();
+                break;
 
 
             case State::Setup:
-                setup(true);
+                // PWM ESCs calibrate with full throttle, only on the operator's start
+                if (!mymotor.isArmed()) {
+                    mymotor.arm();
+                }
+                motor_armed = true;
+                session_confirm();
                 fsm_state = State::Main;
-                ThisThread::sleep_for(1000ms);
                 break;
 
             case State::Timeout:
-                setup(false);
+                session_confirm();
                 fsm_state = State::Main;
-                ThisThread::sleep_for(1000ms);
                 break;
 
             case State::Main:
                 return;
 
             case State::Decode:
-                uint32_t addr = FLASH_LOG_START_ADDR;
-                serial.printf("Starting\n");
-
-                while (true) {
-                    serial.printf("%u", addr);
-                    uint8_t flags = 0xFF;
-                    f.read(addr, &flags, 1);
-
-                    if (flags == 0xFF) {
-                        break;
-                    }
-
-                    size_t entry_size = 1;
-                    if (flags & 0x01){
-                         entry_size += 4 + 2 + 2;
-                    }
-                    if (flags & 0x02){
-                        entry_size += 4 + 6 * 3 * 2 + 4 * 2 + 2;
-                    }
-
-                    if (entry_size > 128) break;
-
-                    uint8_t entry[128];
-                    f.read(addr, entry, entry_size);
-
-                    //decode(entry, entry_size); // Readable Printout
-                    decodeCSV(entry, entry_size); // CSV Printout
-
-                    addr += entry_size;
-                    ThisThread::sleep_for(100ms);
-                }
-
-                serial.printf("# END OF LOG\n");
-                exit(0);
+                dump_log();
+                break;
         }
         
     }
 }
 
-void led_thread() {
+// Once flying, the commands keep running on the console and radio threads.
+// After `stop`, start begins a new session and log and clear are served here.
+void flight_sequence() {
     while (true) {
+        State next = requested_state;
+        requested_state = State::Idle;
+        switch (next) {
+            case State::Setup:
+                session_confirm();
+                flight_state = State::Main;
+                break;
+            case State::Reset:
+                erase_flash();
+                break;
+            case State::Decode:
+                dump_log();
+                break;
+            default:
+                break;
+        }
+        ThisThread::sleep_for(10ms);
+    }
+}
+
+// 20 Hz group. A stalled task, or one that keeps missing its deadline,
+// stops the kicks and the watchdog resets the board WATCHDOG_TIMEOUT_MS later.
+void watchdog_task() {
+    static uint32_t withheld_since_us = 0;
+    uint32_t now_us = us_ticker_read();
+    int late = monitor.check(now_us);
+    if (late < 0) {
+        Watchdog::get_instance().kick();
+        withheld_since_us = 0;
+        return;
+    }
+
+    watchdog_withheld++;
+    watchdog_culprit = late;
+    if (withheld_since_us == 0) {
+        withheld_since_us = now_us;
+    } else if (now_us - withheld_since_us >= WATCHDOG_CAPTURE_US) {
+        // Only the first capture writes, the reset follows shortly
+        fault_log.capture(FAULT_WATCHDOG, nullptr, late);
+    }
+}
+
+// mbed calls this for fatal errors, hard faults included, before halting
+void mbed_error_hook(const mbed_error_ctx* error_context) {
+    fault_log.capture(FAULT_ERROR, error_context);
+}
+
+// 20 Hz group, blinks at the old 100 ms
+void led_task() {
+    static bool phase = false;
+    phase = !phase;
+    if (phase) {
         led = !led;
-        ThisThread::sleep_for(100ms);
     }
 }
 
@@ -670,10 +2088,74 @@ void scanI2C() {
 // Run to log data
 int main() {
     //suspend();
-    wait_sequence();
-    thread1.start(sensor_thread_raw);
-    thread2.start(encoder_thread_raw);
-    //thread3.start(motor_thread);
-    thread4.start(log_thread_raw);
-    thread5.start(led_thread);
+    profilerStart();
+    last_fault_valid = faultRead(f, last_fault);
+    register_commands();
+    radio_telem.setFec(RADIO_FEC);
+    console.start();
+
+    // Logging starts with the first IMU sample, in a session that only
+    // counts once confirmed (see session_begin())
+    session_begin();
+    flashMutex.lock();
+    config_store.load(config);
+    flashMutex.unlock();
+    for (const RateSetting& setting : rate_settings) {
+        if (*setting.hz < 1 || *setting.hz > setting.max_hz) {
+            *setting.hz = setting.default_hz;
+        }
+        setting.group->setDivider(rate_divider(*setting.hz));
+    }
+    rate_1khz.add(encoder_task_raw, "encoder");
+    rate_100hz.add(sensor_task_raw, "sensor");
+    rate_20hz.add(led_task);
+    rate_20hz.add(watchdog_task, "watchdog");
+    rate_5hz.add(log_task_raw, "log");
+    rate_5hz.add(profilerSample);
+    rate_1khz.watchHeap(&heap_1khz);
+    rate_100hz.watchHeap(&heap_100hz);
+    rate_20hz.watchHeap(&heap_20hz);
+    rate_5hz.watchHeap(&heap_5hz);
+    scheduler.add(&rate_1khz);
+    scheduler.add(&rate_100hz);
+    scheduler.add(&rate_20hz);
+    scheduler.add(&rate_5hz);
+    scheduler.start();
+
+    // After a watchdog reset the motor stays off, as it might have been the
+    // fault. PWM ESCs arm on the operator's start.
+    bool resumed = ResetReason::get() == RESET_REASON_WATCHDOG;
+    boot_devices(!resumed && !mymotor.armNeedsFullThrottle());
+    if (resumed) {
+        watchdog_resumed = true;
+        session_confirm();
+    } else {
+        wait_sequence();
+    }
+    flight_state = State::Main;
+
+    telemetry_task_id = monitor.add("telemetry", chrono::duration_cast<chrono::microseconds>(TELEMETRY_INTERVAL).count());
+    // One report per telemetry period, at the rate `radio` may have set
+    radio_task_id = monitor.add("radio", chrono::duration_cast<chrono::microseconds>(radio_telem.getPeriod()).count());
+    if (motor_armed) {
+        motor_task_id = monitor.add("motor", chrono::duration_cast<chrono::microseconds>(MOTOR_CONTROL_INTERVAL).count());
+        thread7.start(motor_thread);
+    }
+    monitor.start(us_ticker_read());
+    Watchdog::get_instance().start(WATCHDOG_TIMEOUT_MS);
+    thread3.start(telemetry_thread);
+    thread6.start(radio_thread);
+
+    fault_log.watchTasks(&monitor);
+    fault_log.watchThread(console.getThreadId());
+    for (int i = 0; i < scheduler.getGroupCount(); i++) {
+        fault_log.watchThread(scheduler.getGroup(i)->getThreadId());
+    }
+    fault_log.watchThread(thread3.get_id());
+    fault_log.watchThread(thread6.get_id());
+    if (motor_armed) {
+        fault_log.watchThread(thread7.get_id());
+    }
+
+    flight_sequence();
 }
\ No newline at end of file
@@ -1,74 +1,63 @@
 #include "mbed.h"
 #include "radio.h"
 #include <cstdint>
-#include <vector>
 #include <cstddef>
 
-void cobs(std::vector<uint8_t>& buf, uint8_t start) {
-    size_t count = 0;
-    size_t last_i = 2;
+// ===== UART WRITE FUNCTION WITH FRAMING =====
+void writeUART(BufferedSerial* ser, const uint8_t* data, size_t len) {
+    if (!ser || len > FRAME_MAX_PAYLOAD) return;
 
-    for (size_t i = 3; i < buf.size(); ++i) {
-        count += 1;
-        if (buf[i] == start) {
-            buf[last_i] = static_cast<uint8_t>(count);
-            last_i = i;
-            count = 0;
-        }
-    }
+    uint8_t buf[FRAME_MAX_SIZE];
+    size_t n = frameEncode(data, len, buf);
 
-    buf[last_i] = 0;
+    ser->write(buf, n);
 }
 
-// ===== UART WRITE FUNCTION WITH COBS =====
-void writeUART(BufferedSerial* ser, const uint8_t* data, size_t len) {
-    if (!ser || len + 4 > 256) return;
-
-    std::vector<uint8_t> buf(len + 3, 0); // len + 4 to include \n terminator
-
-    for (size_t i = 0; i < len; ++i) {
-        buf[i + 3] = data[i];
+// Protocol messages go through FEC, modem '+' commands must use writeUART().
+// A non zero node ID adds the sender's envelope (tdma.h).
+void writeRadio(BufferedSerial* ser, const uint8_t* data, size_t len, uint8_t fec, uint8_t node) {
+    uint8_t wrapped[FRAME_MAX_PAYLOAD];
+    if (node != 0) {
+        len = nodeWrap(node, data, len, wrapped);
+        if (len == 0) return;
+        data = wrapped;
     }
 
-    buf[0] = 234;
-    buf[1] = static_cast<uint8_t>(len + 3);
-    buf[2] = 0;
-
-    cobs(buf, 234);
+    uint8_t coded[FRAME_MAX_PAYLOAD];
+    size_t n = fecEncode(fec, data, len, coded);
 
-    // buf[len + 3] = '\n'; // end of frame
-
-    ser->write(buf.data(), buf.size());
+    if (n == 0) {
+        writeUART(ser, data, len);     // too long for the mode, send uncoded
+    } else {
+        writeUART(ser, coded, n);
+    }
 }
 
-bool parse(const char* data, size_t length, std::string& result) {
-    static std::string buffer;
-    buffer.append(data, length);
-
-    size_t start = buffer.find('"');
-    while (start != std::string::npos) {
-        size_t end = buffer.find('"', start + 1);
-        if (end == std::string::npos) {
-            // Incomplete: keep only from opening quote onward
-            if (start > 0) buffer.erase(0, start);
-            return false;
-        }
-
-        // Extract and filter printable ASCII chars only
-        std::string raw = buffer.substr(start + 1, end - start - 1);
-        std::string cleaned;
-        for (char c : raw) {
-            if (c >= 32 && c <= 126) {
-                cleaned += c;
+// Extracts the next "quoted" message, keeping printable ASCII only.
+// Partial messages are kept in a fixed buffer between calls.
+bool parse(const char* data, size_t length, char* result, size_t size) {
+    static char buffer[FRAME_MAX_PAYLOAD + 1];
+    static size_t len = 0;
+    static bool in_quote = false;
+
+    for (size_t i = 0; i < length; i++) {
+        char c = data[i];
+
+        if (c == '"') {
+            if (in_quote) {
+                in_quote = false;
+                size_t n = (len < size - 1) ? len : size - 1;
+                memcpy(result, buffer, n);
+                result[n] = 0;
+                len = 0;
+                return true;
             }
+            in_quote = true;
+            len = 0;
+        } else if (in_quote && c >= 32 && c <= 126 && len < FRAME_MAX_PAYLOAD) {
+            buffer[len++] = c;
         }
-
-        result = cleaned;
-        buffer.erase(0, end + 1);  // Trim processed portion
-        return true;
     }
 
-    // No quote found at all
-    buffer.clear();
     return false;
-}
\ No newline at end of file
+}
@@ -1,8 +1,10 @@
 #include "mbed.h"
 #include <cstdint>
-#include <string>
 #include "EUSBSerial.h"
+#include "framing.h"
+#include "fec.h"
+#include "tdma.h"
 
-void cobs(uint8_t* Vec, uint8_t start);
 void writeUART(BufferedSerial* ser, const uint8_t* data, size_t len);
-bool parse(const char* data, size_t length, std::string& result);
\ No newline at end of file
+void writeRadio(BufferedSerial* ser, const uint8_t* data, size_t len, uint8_t fec, uint8_t node = 0);
+bool parse(const char* data, size_t length, char* result, size_t size);
@@ -0,0 +1,131 @@
+#include "radio_telemetry.h"
+#include "radio.h"
+#include "crc.h"
+#include "framing.h"
+#include <cstring>
+
+RadioTelemetry::RadioTelemetry(BufferedSerial* uart, uint32_t rate_hz, float duty)
+    : _uart(uart), _rate(1), _duty(duty), _fec(FEC_OFF), _node(0), _slot_bytes(0), _sent(0), _dropped(0) {
+    setRate(rate_hz);
+    setDutyCycle(duty);
+}
+
+void RadioTelemetry::setRate(uint32_t rate_hz) {
+    if (rate_hz < 1) rate_hz = 1;
+    if (rate_hz > 100) rate_hz = 100;
+    _rate = rate_hz;
+}
+
+uint32_t RadioTelemetry::getRate() const {
+    return _rate;
+}
+
+void RadioTelemetry::setDutyCycle(float duty) {
+    if (duty < 0.05f) duty = 0.05f;
+    if (duty > 1.0f) duty = 1.0f;
+    _duty = duty;
+}
+
+void RadioTelemetry::setFec(uint8_t mode) {
+    _fec = (mode < FEC_MODES) ? mode : FEC_OFF;
+}
+
+uint8_t RadioTelemetry::getFec() const {
+    return _fec;
+}
+
+void RadioTelemetry::setNode(uint8_t node) {
+    _node = node;
+}
+
+uint8_t RadioTelemetry::getNode() const {
+    return _node;
+}
+
+void RadioTelemetry::setSlotBytes(size_t bytes) {
+    _slot_bytes = bytes;
+}
+
+chrono::milliseconds RadioTelemetry::getPeriod() const {
+    return chrono::milliseconds(1000 / _rate);
+}
+
+size_t RadioTelemetry::getBudget() const {
+    size_t budget = static_cast<size_t>((RADIO_AIR_BPS / 8) * _duty / _rate);
+    if (_slot_bytes != 0 && _slot_bytes < budget) {
+        budget = _slot_bytes;
+    }
+    return budget;
+}
+
+size_t RadioTelemetry::pack(const RadioTelemetrySample& sample, uint8_t* out) {
+    const size_t fixed = RADIO_AIR_OVERHEAD + FRAME_OVERHEAD + fecOverhead(_fec) +
+                         (_node ? TDMA_NODE_OVERHEAD : 0) + RADIO_TLM_BASE_SIZE + RADIO_TLM_CRC_SIZE;
+    size_t budget = getBudget();
+    if (fixed > budget) {
+        return 0;
+    }
+    size_t room = budget - fixed;
+
+    // Optional fields in priority order
+    static const struct { uint8_t bit; size_t size; } fields[] = {
+        { RADIO_TLM_QUAT, RADIO_TLM_QUAT_SIZE },
+        { RADIO_TLM_ENC,  RADIO_TLM_ENC_SIZE  },
+        { RADIO_TLM_ACC,  RADIO_TLM_ACC_SIZE  },
+    };
+
+    // Stop at the first field that does not fit, a smaller one after it
+    // has lower priority
+    const size_t count = sizeof(fields) / sizeof(fields[0]);
+    uint8_t mask = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (fields[i].size > room) {
+            _dropped += count - i;
+            break;
+        }
+        mask |= fields[i].bit;
+        room -= fields[i].size;
+    }
+
+    uint8_t* ptr = out;
+    *ptr++ = RADIO_MSG_TELEMETRY;
+    *ptr++ = mask;
+    memcpy(ptr, &sample.timestamp, 4); ptr += 4;
+    *ptr++ = sample.state;
+
+    if (mask & RADIO_TLM_QUAT) {
+        memcpy(ptr, sample.quat, RADIO_TLM_QUAT_SIZE); ptr += RADIO_TLM_QUAT_SIZE;
+    }
+    if (mask & RADIO_TLM_ENC) {
+        memcpy(ptr, sample.enc, RADIO_TLM_ENC_SIZE); ptr += RADIO_TLM_ENC_SIZE;
+    }
+    if (mask & RADIO_TLM_ACC) {
+        memcpy(ptr, sample.acc, RADIO_TLM_ACC_SIZE); ptr += RADIO_TLM_ACC_SIZE;
+    }
+
+    uint16_t crc = crc16(out, ptr - out);
+    *ptr++ = static_cast<uint8_t>(crc & 0xFF);
+    *ptr++ = static_cast<uint8_t>(crc >> 8);
+
+    return ptr - out;
+}
+
+bool RadioTelemetry::send(const RadioTelemetrySample& sample) {
+    uint8_t msg[RADIO_TLM_MAX_SIZE];
+    size_t len = pack(sample, msg);
+    if (len == 0) {
+        return false;
+    }
+
+    writeRadio(_uart, msg, len, _fec, _node);
+    _sent++;
+    return true;
+}
+
+uint32_t RadioTelemetry::getFramesSent() const {
+    return _sent;
+}
+
+uint32_t RadioTelemetry::getFieldsDropped() const {
+    return _dropped;
+}
@@ -0,0 +1,100 @@
+#ifndef RADIO_TELEMETRY_H
+#define RADIO_TELEMETRY_H
+
+#include "mbed.h"
+#include "radio_protocol.h"
+#include "fec.h"
+#include "tdma.h"
+
+/**
+ * @brief Latest values offered to the radio downlink.
+ */
+struct RadioTelemetrySample {
+    uint32_t timestamp;
+    uint8_t state;
+    int16_t quat[4];
+    int32_t enc[2];
+    int16_t acc[3];
+};
+
+/**
+ * @brief Packs telemetry samples into compact frames that fit the link's
+ *        airtime budget and sends them through writeRadio().
+ *
+ * The budget per frame is bitrate * duty cycle / frame rate. Optional fields
+ * are added in priority order (quaternion, encoders, acceleration) and the
+ * lowest priority ones are dropped when they would exceed the budget.
+ * FEC parity counts against the same budget. With TDMA the frame must also
+ * fit in the node's slot.
+ */
+class RadioTelemetry {
+public:
+    /**
+     * @param uart     Serial port connected to the radio.
+     * @param rate_hz  Frames per second.
+     * @param duty     Fraction of the link's airtime telemetry may use (0-1],
+     *                 the rest is left for uplink commands.
+     */
+    RadioTelemetry(BufferedSerial* uart, uint32_t rate_hz = 10, float duty = 0.5f);
+
+    void setRate(uint32_t rate_hz);
+    uint32_t getRate() const;
+    void setDutyCycle(float duty);
+
+    /**
+     * @brief Select the forward error correction mode (FEC_OFF .. FEC_HEAVY).
+     */
+    void setFec(uint8_t mode);
+    uint8_t getFec() const;
+
+    /**
+     * @brief Node ID added to every frame, 0 for none.
+     */
+    void setNode(uint8_t node);
+    uint8_t getNode() const;
+
+    /**
+     * @brief Limit frames to the on-air bytes of one TDMA slot, 0 for no limit.
+     */
+    void setSlotBytes(size_t bytes);
+
+    /**
+     * @brief Frame period for the configured rate.
+     */
+    chrono::milliseconds getPeriod() const;
+
+    /**
+     * @brief On-air bytes available for one frame, including all overheads.
+     */
+    size_t getBudget() const;
+
+    /**
+     * @brief Pack a sample into a message, dropping fields to fit the budget.
+     *
+     * @param sample  Values to send.
+     * @param out     Buffer of at least RADIO_TLM_MAX_SIZE bytes.
+     * @return size_t Message length, or 0 if not even the base fields fit.
+     */
+    size_t pack(const RadioTelemetrySample& sample, uint8_t* out);
+
+    /**
+     * @brief Pack and transmit one frame.
+     * @return true if a frame was sent.
+     */
+    bool send(const RadioTelemetrySample& sample);
+
+    uint32_t getFramesSent() const;
+    uint32_t getFieldsDropped() const;
+
+private:
+    BufferedSerial* _uart;
+    uint32_t _rate;
+    float _duty;
+    uint8_t _fec;
+    uint8_t _node;
+    size_t _slot_bytes;
+    uint32_t _sent;
+    uint32_t _dropped;
+};
+
+#endif // RADIO_TELEMETRY_H
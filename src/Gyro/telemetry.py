@@ -0,0 +1,266 @@
+import struct
+
+# Host side decoder for the binary USB telemetry frames produced by
+# telemetry_thread() (see Telemetry/telemetry.h for the wire format)
+
+SYNC = b'\xa5\x5a'
+HEADER_SIZE = 4
+CRC_SIZE = 2
+
+TELEM_IMU = 0x01
+TELEM_ENC = 0x02
+TELEM_TRACE_NAME = 0x03
+TELEM_TRACE_EVENTS = 0x04
+TELEM_RADIO = 0x10
+TELEM_LINK_STATS = 0x11
+TELEM_COMMAND = 0x12
+TELEM_LOG_DATA = 0x13
+TELEM_LOG_PROGRESS = 0x14
+TELEM_NODE_STATS = 0x15
+
+# Radio messages carried in TELEM_RADIO frames (Framing/radio_protocol.h)
+RADIO_MSG_TELEMETRY = 0x20
+RADIO_TLM_QUAT = 0x01
+RADIO_TLM_ENC = 0x02
+RADIO_TLM_ACC = 0x04
+FLIGHT_STATES = ['idle', 'setup', 'reset', 'main', 'timeout', 'decode']
+
+# ReliableSender::Outcome (Framing/reliable.h)
+COMMAND_OUTCOMES = ['pending', 'ok', 'rejected', 'failed']
+
+# DownloadClient::State (Framing/download.h)
+DOWNLOAD_STATES = ['idle', 'sizing', 'running', 'done']
+
+# TELEM_TRACE_NAME tables
+TRACE_TABLES = ['probes', 'threads', 'tasks']
+
+# BNO055 LSB scaling (bno055_const.h)
+ACC_SCALE = 100.0
+GYR_SCALE = 16.0
+MAG_SCALE = 16.0
+EUL_SCALE = 16.0
+QUAT_SCALE = float(1 << 14)
+TEMP_SCALE = 0.0625
+ENCODER_PPR = 2048
+
+IMU_STRUCT = struct.Struct('<I18h4hh')
+ENC_STRUCT = struct.Struct('<Iiiii')
+COMMAND_STRUCT = struct.Struct('<BBBII')
+LOG_PROGRESS_STRUCT = struct.Struct('<BBIIII')
+NODE_STATS_STRUCT = struct.Struct('<BIIII')
+TRACE_EVENTS_STRUCT = struct.Struct('<IIH')
+TRACE_EVENT_STRUCT = struct.Struct('<IcBBB')     # TraceEvent in Profiler/trace.h
+
+
+def crc16(data, crc=0xFFFF):
+    """CRC-16/CCITT-FALSE, matching crc16() in telemetry.cpp"""
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def decode_imu(payload):
+    v = IMU_STRUCT.unpack(payload)
+    vec = lambda i, s: [x / s for x in v[i:i + 3]]
+    return {
+        'type': 'imu',
+        'timestamp': v[0],
+        'acc': vec(1, ACC_SCALE),
+        'gyr': vec(4, GYR_SCALE),
+        'mag': vec(7, MAG_SCALE),
+        'eul': vec(10, EUL_SCALE),
+        'lin': vec(13, ACC_SCALE),
+        'grav': vec(16, ACC_SCALE),
+        'quat': [x / QUAT_SCALE for x in v[19:23]],
+        'temp': v[23] * TEMP_SCALE,
+    }
+
+
+def decode_enc(payload):
+    ts, e1, e2, s1, s2 = ENC_STRUCT.unpack(payload)
+    return {
+        'type': 'enc',
+        'timestamp': ts,
+        'enc1': e1 / ENCODER_PPR,
+        'enc2': e2 / ENCODER_PPR,
+        'rpm1': s1 * 60 / ENCODER_PPR,
+        'rpm2': s2 * 60 / ENCODER_PPR,
+    }
+
+
+def decode_radio_telemetry(msg):
+    # CRC was already checked by the ground station
+    mask, ts, state = struct.unpack_from('<BIB', msg, 1)
+    ptr = 7
+    out = {
+        'type': 'radio_tlm',
+        'timestamp': ts,
+        'state': FLIGHT_STATES[state] if state < len(FLIGHT_STATES) else state,
+    }
+    if mask & RADIO_TLM_QUAT:
+        out['quat'] = [x / QUAT_SCALE for x in struct.unpack_from('<4h', msg, ptr)]
+        ptr += 8
+    if mask & RADIO_TLM_ENC:
+        out['enc'] = list(struct.unpack_from('<2i', msg, ptr))
+        ptr += 8
+    if mask & RADIO_TLM_ACC:
+        out['acc'] = [x / ACC_SCALE for x in struct.unpack_from('<3h', msg, ptr)]
+        ptr += 6
+    return out
+
+
+def decode_radio(payload):
+    # first byte is the sending node, 0 for frames without a node envelope
+    node, msg = payload[0], payload[1:]
+    if len(msg) > 0 and msg[0] == RADIO_MSG_TELEMETRY:
+        out = decode_radio_telemetry(msg)
+    else:
+        out = {'type': 'radio', 'data': bytes(msg)}
+    out['node'] = node
+    return out
+
+
+def decode_link_stats(payload):
+    frames, crc, framing, overruns, rate, fec_fixed, fec_failed = struct.unpack('<7I', payload)
+    return {
+        'type': 'link_stats',
+        'frames': frames,
+        'crc_errors': crc,
+        'framing_errors': framing,
+        'overruns': overruns,
+        'bytes_per_s': rate,
+        'fec_corrected': fec_fixed,
+        'fec_failed': fec_failed,
+    }
+
+
+def decode_command(payload):
+    seq, outcome, tries, latency, rto = COMMAND_STRUCT.unpack(payload)
+    return {
+        'type': 'command',
+        'seq': seq,
+        'outcome': COMMAND_OUTCOMES[outcome] if outcome < len(COMMAND_OUTCOMES) else outcome,
+        'tries': tries,
+        'latency_ms': latency,
+        'rto_ms': rto,
+    }
+
+
+def decode_log_data(payload):
+    offset, = struct.unpack_from('<I', payload)
+    return {'type': 'log_data', 'offset': offset, 'data': bytes(payload[4:])}
+
+
+def decode_log_progress(payload):
+    state, stalled, offset, size, rate, repeats = LOG_PROGRESS_STRUCT.unpack(payload)
+    return {
+        'type': 'log_progress',
+        'state': DOWNLOAD_STATES[state] if state < len(DOWNLOAD_STATES) else state,
+        'stalled': bool(stalled),
+        'offset': offset,
+        'size': size,
+        'bytes_per_s': rate,
+        'repeats': repeats,
+    }
+
+
+def decode_node_stats(payload):
+    node, frames, crc, empty, age = NODE_STATS_STRUCT.unpack(payload)
+    return {
+        'type': 'node_stats',
+        'node': node,
+        'frames': frames,
+        'crc_errors': crc,
+        'empty_slots': empty,
+        'last_heard_ms': age,
+    }
+
+
+def decode_trace_name(payload):
+    table, index = payload[0], payload[1]
+    return {
+        'type': 'trace_name',
+        'table': TRACE_TABLES[table] if table < len(TRACE_TABLES) else table,
+        'index': index,
+        'name': bytes(payload[2:]).decode('ascii', 'replace'),
+    }
+
+
+def decode_trace_events(payload):
+    first, total, cycles_per_us = TRACE_EVENTS_STRUCT.unpack_from(payload)
+    events = []
+    for offset in range(TRACE_EVENTS_STRUCT.size, len(payload) - TRACE_EVENT_STRUCT.size + 1, TRACE_EVENT_STRUCT.size):
+        cycles, phase, name, thread, arg = TRACE_EVENT_STRUCT.unpack_from(payload, offset)
+        events.append({'cycles': cycles, 'phase': phase.decode(), 'name': name, 'thread': thread, 'arg': arg})
+    return {
+        'type': 'trace_events',
+        'first': first,
+        'total': total,
+        'cycles_per_us': cycles_per_us,
+        'events': events,
+    }
+
+
+DECODERS = {
+    TELEM_IMU: decode_imu,
+    TELEM_ENC: decode_enc,
+    TELEM_TRACE_NAME: decode_trace_name,
+    TELEM_TRACE_EVENTS: decode_trace_events,
+    TELEM_RADIO: decode_radio,
+    TELEM_LINK_STATS: decode_link_stats,
+    TELEM_COMMAND: decode_command,
+    TELEM_LOG_DATA: decode_log_data,
+    TELEM_LOG_PROGRESS: decode_log_progress,
+    TELEM_NODE_STATS: decode_node_stats,
+}
+
+
+class TelemetryDecoder:
+    """Incremental frame decoder: feed() arbitrary chunks, get decoded frames back"""
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.frames = 0
+        self.crc_errors = 0
+        self.unknown = 0
+
+    def feed(self, data):
+        self.buf += data
+        out = []
+        while True:
+            start = self.buf.find(SYNC)
+            if start < 0:
+                # keep a trailing half sync word
+                del self.buf[:max(0, len(self.buf) - 1)]
+                return out
+            del self.buf[:start]
+
+            if len(self.buf) < HEADER_SIZE:
+                return out
+            ftype, length = self.buf[2], self.buf[3]
+            total = HEADER_SIZE + length + CRC_SIZE
+            if len(self.buf) < total:
+                return out
+
+            body = bytes(self.buf[2:HEADER_SIZE + length])
+            crc = self.buf[HEADER_SIZE + length] | (self.buf[HEADER_SIZE + length + 1] << 8)
+            if crc16(body) != crc:
+                # false sync or corrupted frame, resync one byte later
+                self.crc_errors += 1
+                del self.buf[:1]
+                continue
+
+            del self.buf[:total]
+            decoder = DECODERS.get(ftype)
+            try:
+                frame = decoder(body[2:]) if decoder else None
+            except struct.error:
+                frame = None
+            if frame is None:
+                self.unknown += 1
+                continue
+            self.frames += 1
+            out.append(frame)
@@ -0,0 +1,123 @@
+import os
+import sys
+import json
+import time
+import struct
+from telemetry import TelemetryDecoder
+
+
+# Fetches the event trace (`trace` console command, see Profiler/trace.h) and
+# writes it as Chrome trace JSON, for chrome://tracing or ui.perfetto.dev.
+#
+#   python trace.py COM4 trace.json         sends `trace dump` and reads the frames
+#   python trace.py capture.bin trace.json  converts frames saved from the port
+#
+# Every thread gets its own track, interrupts share track 0. Start a trace
+# with `trace on` or `trace miss` first. fault.py uses write_chrome() for the
+# events saved with a fault record.
+
+TIMEOUT_S = 5
+
+
+def read_frames(source):
+    decoder = TelemetryDecoder()
+    names = {'probes': {}, 'threads': {}, 'tasks': {}}
+    events = {}
+    total = None
+    cycles_per_us = 0
+
+    def feed(data):
+        nonlocal total, cycles_per_us
+        for frame in decoder.feed(data):
+            if frame['type'] == 'trace_name':
+                names[frame['table']][frame['index']] = frame['name']
+            elif frame['type'] == 'trace_events':
+                total = frame['total']
+                cycles_per_us = frame['cycles_per_us']
+                for i, event in enumerate(frame['events']):
+                    events[frame['first'] + i] = event
+        return total is not None and len(events) >= total
+
+    if os.path.exists(source):
+        with open(source, 'rb') as f:
+            feed(f.read())
+    else:
+        import serial
+        ser = serial.Serial(source, 115200, timeout=0.1)
+        ser.write(b'trace dump\n')
+        deadline = time.time() + TIMEOUT_S
+        while time.time() < deadline:
+            if feed(ser.read(ser.in_waiting or 1)):
+                break
+        ser.close()
+
+    if total is None:
+        sys.exit('no trace frames received')
+    if len(events) < total:
+        print(f"warning: {total - len(events)} of {total} events missing")
+    return names, [events[i] for i in sorted(events)], cycles_per_us
+
+
+def to_chrome(names, events, cycles_per_us):
+    out = [{'name': 'process_name', 'ph': 'M', 'pid': 1, 'args': {'name': 'gyro'}}]
+    for slot in sorted(names['threads']):
+        name = names['threads'][slot] or f'thread {slot}'
+        out.append({'name': 'thread_name', 'ph': 'M', 'pid': 1, 'tid': slot,
+                    'args': {'name': 'interrupts' if slot == 0 else name}})
+    if not events:
+        return out, {}
+
+    # CYCCNT wraps every 2^32 cycles, events are much closer together than
+    # that but may be a few cycles out of order
+    cycles = 0
+    last = events[0]['cycles']
+    open_spans = {}
+    longest = {}
+    ts = 0.0
+    for event in events:
+        delta = struct.unpack('<i', struct.pack('<I', (event['cycles'] - last) & 0xFFFFFFFF))[0]
+        last = event['cycles']
+        cycles += delta
+        ts = cycles / cycles_per_us
+        name = names['probes'].get(event['name'], f"probe {event['name']}")
+        tid = event['thread']
+        entry = {'name': name, 'ph': event['phase'], 'ts': ts, 'pid': 1, 'tid': tid}
+
+        stack = open_spans.setdefault(tid, [])
+        if event['phase'] == 'B':
+            stack.append((name, ts))
+        elif event['phase'] == 'E':
+            # The trace may have started inside the span
+            if not stack or stack[-1][0] != name:
+                continue
+            _, start = stack.pop()
+            longest[name] = max(longest.get(name, 0.0), ts - start)
+        else:
+            entry['s'] = 't'
+            entry['args'] = {'arg': event['arg']}
+            if name == 'deadline miss':
+                entry['args']['task'] = names['tasks'].get(event['arg'], event['arg'])
+        out.append(entry)
+
+    # Spans still open when the trace stopped end with it
+    for tid, stack in open_spans.items():
+        for name, _ in reversed(stack):
+            out.append({'name': name, 'ph': 'E', 'ts': ts, 'pid': 1, 'tid': tid})
+    return out, longest
+
+
+def write_chrome(path, names, events, cycles_per_us):
+    trace, longest = to_chrome(names, events, cycles_per_us)
+    with open(path, 'w') as f:
+        json.dump({'traceEvents': trace, 'displayTimeUnit': 'ns'}, f)
+
+    span_ms = trace[-1]['ts'] / 1000 if events else 0.0
+    print(f"{len(events)} events over {span_ms:.1f} ms from {len(names['threads'])} threads -> {path}")
+    for name, us in sorted(longest.items(), key=lambda item: -item[1]):
+        print(f"  longest {name}: {us:.1f} us")
+
+
+if __name__ == '__main__':
+    SOURCE = sys.argv[1] if len(sys.argv) > 1 else 'COM4'
+    OUT_FILE = sys.argv[2] if len(sys.argv) > 2 else 'trace.json'
+    write_chrome(OUT_FILE, *read_frames(SOURCE))
@@ -91,6 +91,18 @@ char EUSBSerial::_getc() {
     return pc._getc();
 }
 
+size_t EUSBSerial::read(char* buf, size_t size) {
+    uint32_t n = 0;
+    if (!pc.receive_nb(reinterpret_cast<uint8_t*>(buf), size, &n))
+        return 0;
+
+    return n;
+}
+
+void EUSBSerial::attach(Callback<void()> cb) {
+    pc.attach(cb);
+}
+
 size_t EUSBSerial::available() {
     return pc.available();
 }
@@ -7,6 +7,7 @@
  * found in USBSerial.h. Features as follows:
  *     formatted print support (printf)
  *     newline terminated read support (readline)
+ *     non-blocking bulk reads and receive callbacks (read, attach)
  *     Redundant USB Connection monitoring and protection
  *
  * EUSBSerial implements QOL features while encapsulating
@@ -35,6 +36,12 @@ public:
 
     bool readline(char* buf, size_t size);
 
+    // Non-blocking: copies up to size already-received bytes into buf
+    size_t read(char* buf, size_t size);
+
+    // cb runs in interrupt context whenever new data arrives
+    void attach(Callback<void()> cb);
+
     size_t available();
     char _getc();
 
@@ -0,0 +1,16 @@
+#ifndef CRC_H
+#define CRC_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief CRC-16/CCITT-FALSE (poly 0x1021), table driven.
+ *
+ * @param data  Bytes to checksum.
+ * @param len   Number of bytes.
+ * @param crc   Running CRC, 0xFFFF to start a new checksum.
+ */
+uint16_t crc16(const uint8_t* data, size_t len, uint16_t crc = 0xFFFF);
+
+#endif // CRC_H
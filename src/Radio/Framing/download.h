@@ -0,0 +1,162 @@
+#ifndef DOWNLOAD_H
+#define DOWNLOAD_H
+
+#include <cstddef>
+#include <cstdint>
+#include "framing.h"
+#include "radio_protocol.h"
+
+/*
+ * Flash log download over the radio, shared by src/Gyro and src/Radio (keep
+ * both copies identical).
+ *
+ * The ground station asks for the log size, then requests a window of up to
+ * 32 chunks at a time with one RADIO_MSG_LOG_READ. The flight computer
+ * streams the requested chunks back, each with its own CRC. Chunks that have
+ * not arrived when the window times out are requested again (selective
+ * repeat), and the window only slides once it is complete.
+ *
+ * Every chunk carries its absolute offset, so the host can write it straight
+ * into the output file. A download interrupted by link loss keeps retrying
+ * at a slower pace and carries on when the link returns. After a ground
+ * station reset the host restarts it from the first missing offset.
+ *
+ * Times are milliseconds supplied by the caller, as in reliable.h.
+ */
+
+#define DL_CHUNK_SIZE       128
+#define DL_HEADER_SIZE      5       // type, offset
+#define DL_CRC_SIZE         2
+#define DL_DATA_MAX_SIZE    (DL_HEADER_SIZE + DL_CHUNK_SIZE + DL_CRC_SIZE)
+#define DL_INFO_SIZE        (1 + 4 + DL_CRC_SIZE)
+#define DL_READ_SIZE        (1 + 4 + 4 + DL_CRC_SIZE)
+
+#ifndef DL_WINDOW
+#define DL_WINDOW           16      // chunks per request, at most 32
+#endif
+
+// Extra wait after the last expected chunk of a request
+#ifndef DL_TIMEOUT_MARGIN_MS
+#define DL_TIMEOUT_MARGIN_MS 300
+#endif
+
+// Without any data for this long the link is considered lost, requests
+// continue at this interval until it comes back
+#ifndef DL_STALL_MS
+#define DL_STALL_MS         3000
+#endif
+
+// ===== FLIGHT SIDE =====
+
+/**
+ * @return true if msg is a valid log size request.
+ */
+bool dlIsInfoRequest(const uint8_t* msg, size_t len);
+
+/**
+ * @brief Parse a chunk request.
+ * @return true if msg is a valid RADIO_MSG_LOG_READ.
+ */
+bool dlParseRead(const uint8_t* msg, size_t len, uint32_t& base, uint32_t& mask);
+
+/**
+ * @param out  Buffer of at least DL_INFO_SIZE bytes.
+ */
+size_t dlPackInfo(uint32_t size, uint8_t* out);
+
+/**
+ * @param out  Buffer of at least DL_DATA_MAX_SIZE bytes.
+ * @return size_t Message length, 0 if len exceeds DL_CHUNK_SIZE.
+ */
+size_t dlPackData(uint32_t offset, const uint8_t* data, size_t len, uint8_t* out);
+
+// ===== GROUND SIDE =====
+
+/**
+ * @brief Drives a download: decides what to request and tracks which chunks arrived.
+ */
+class DownloadClient {
+public:
+    enum State {
+        Idle,
+        Sizing,         ///< Waiting for the log size
+        Running,
+        Done,
+    };
+
+    enum Result {
+        Ignored,        ///< Not a download message
+        Info,           ///< Log size received
+        Chunk,          ///< New chunk, see chunk()
+        Duplicate,      ///< Chunk already received or outside the window
+        Corrupt,        ///< CRC or length check failed
+    };
+
+    /**
+     * @param chunk_air_ms  Airtime of one data chunk, used to size request timeouts.
+     */
+    DownloadClient(uint32_t chunk_air_ms);
+
+    /**
+     * @brief Start (or restart) downloading at offset, rounded down to a chunk.
+     */
+    void start(uint32_t offset, uint32_t now_ms);
+    void cancel();
+
+    /**
+     * @brief Returns the request to transmit now, if any.
+     */
+    const uint8_t* poll(uint32_t now_ms, size_t& len);
+
+    /**
+     * @brief Milliseconds until poll() may have something to send, UINT32_MAX if idle.
+     */
+    uint32_t timeUntilNext(uint32_t now_ms) const;
+
+    Result onMessage(const uint8_t* msg, size_t len, uint32_t now_ms);
+
+    const uint8_t* chunk() const;       ///< Data of the last Chunk result
+    uint32_t chunkOffset() const;
+    size_t chunkLength() const;
+
+    State getState() const;
+    bool isStalled(uint32_t now_ms) const;
+    uint32_t getSize() const;           ///< Log size, 0 until known
+    uint32_t getOffset() const;         ///< Everything below this offset has arrived
+    uint32_t getReceived() const;       ///< New bytes received since start()
+    uint32_t getRate(uint32_t now_ms) const;    ///< Average new bytes per second
+    uint32_t getRequests() const;
+    uint32_t getRepeats() const;        ///< Chunks requested more than once
+    uint32_t getDuplicates() const;
+    uint32_t getCorrupt() const;
+
+private:
+    uint32_t windowMask() const;        ///< Chunks of the window inside the log
+    void schedule(uint32_t now_ms, uint32_t chunks);
+
+    uint32_t _chunk_ms;
+    State _state;
+
+    uint32_t _size;
+    uint32_t _base;         ///< Offset of the window's first chunk
+    uint32_t _have;         ///< Received chunks of the window
+    uint32_t _asked;        ///< Chunks requested at least once in this window
+    bool _due;
+    uint32_t _deadline;
+    uint32_t _last_data;
+
+    uint32_t _start;
+    uint32_t _end;
+    uint32_t _received;
+    uint32_t _requests;
+    uint32_t _repeats;
+    uint32_t _duplicates;
+    uint32_t _corrupt;
+
+    uint8_t _msg[DL_READ_SIZE];
+    uint8_t _chunk[DL_CHUNK_SIZE];
+    uint32_t _chunk_offset;
+    size_t _chunk_len;
+};
+
+#endif // DOWNLOAD_H
@@ -0,0 +1,171 @@
+#include "framing.h"
+#include <cstring>
+
+FrameEncoder::FrameEncoder() {
+    begin();
+}
+
+/**
+ * Starts a new frame. The pointer slot and every escaped byte hold 0 until
+ * the next FRAME_START in the payload patches them.
+ */
+void FrameEncoder::begin() {
+    _buf[0] = FRAME_START;
+    _buf[1] = FRAME_OVERHEAD;
+    _buf[2] = 0;
+    _len = FRAME_OVERHEAD;
+    _last = 2;
+}
+
+bool FrameEncoder::put(uint8_t byte) {
+    if (_len >= FRAME_MAX_SIZE) {
+        return false;
+    }
+
+    if (byte == FRAME_START) {
+        _buf[_last] = static_cast<uint8_t>(_len - _last);
+        _last = _len;
+        byte = 0;
+    }
+
+    _buf[_len++] = byte;
+    return true;
+}
+
+bool FrameEncoder::put(const uint8_t* data, size_t len) {
+    if (len > FRAME_MAX_SIZE - _len) {
+        return false;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        put(data[i]);
+    }
+    return true;
+}
+
+size_t FrameEncoder::finish() {
+    _buf[1] = static_cast<uint8_t>(_len);
+    return _len;
+}
+
+const uint8_t* FrameEncoder::data() const {
+    return _buf;
+}
+
+size_t FrameEncoder::size() const {
+    return _len;
+}
+
+size_t frameEncode(const uint8_t* data, size_t len, uint8_t* out) {
+    if (len > FRAME_MAX_PAYLOAD) {
+        return 0;
+    }
+
+    size_t last = 2;
+    out[0] = FRAME_START;
+    out[1] = static_cast<uint8_t>(len + FRAME_OVERHEAD);
+
+    for (size_t i = 0; i < len; i++) {
+        size_t pos = i + FRAME_OVERHEAD;
+        if (data[i] == FRAME_START) {
+            out[last] = static_cast<uint8_t>(pos - last);
+            last = pos;
+        } else {
+            out[pos] = data[i];
+        }
+    }
+
+    out[last] = 0;
+    return len + FRAME_OVERHEAD;
+}
+
+FrameDecoder::FrameDecoder()
+    : _len(0), _frames(0), _errors(0), _skipped(0) {
+    reset();
+}
+
+void FrameDecoder::reset() {
+    _state = WaitStart;
+    _total = 0;
+    _count = 0;
+    _skip = 0;
+}
+
+FrameDecoder::Result FrameDecoder::feed(uint8_t byte) {
+    switch (_state) {
+        case WaitStart:
+            if (byte == FRAME_START) {
+                _state = WaitLength;
+            } else {
+                _skipped++;
+            }
+            return None;
+
+        case WaitLength:
+            if (byte < FRAME_OVERHEAD) {
+                break;
+            }
+            _total = byte;
+            _state = WaitPointer;
+            return None;
+
+        case WaitPointer:
+            // The first escaped byte must lie inside the frame
+            if (byte != 0 && 2 + static_cast<size_t>(byte) >= _total) {
+                break;
+            }
+            _skip = byte;
+            _count = FRAME_OVERHEAD;
+            if (_total == FRAME_OVERHEAD) {
+                _len = 0;
+                _frames++;
+                reset();
+                return Frame;
+            }
+            _state = Body;
+            return None;
+
+        case Body:
+            if (_skip > 0 && --_skip == 0) {
+                // Escaped byte: it holds the distance to the next one
+                if (byte != 0 && _count + byte >= _total) {
+                    break;
+                }
+                _skip = byte;
+                byte = FRAME_START;
+            }
+
+            _buf[_count - FRAME_OVERHEAD] = byte;
+            if (++_count == _total) {
+                _len = _total - FRAME_OVERHEAD;
+                _frames++;
+                reset();
+                return Frame;
+            }
+            return None;
+    }
+
+    _errors++;
+    reset();
+    return Error;
+}
+
+const uint8_t* FrameDecoder::payload() const {
+    return _buf;
+}
+
+size_t FrameDecoder::length() const {
+    return _len;
+}
+
+uint32_t FrameDecoder::getFrames() const {
+    return _frames;
+}
+
+uint32_t FrameDecoder::getErrors() const {
+    return _errors;
+}
+
+uint32_t FrameDecoder::getSkipped() const {
+    return _skipped;
+}
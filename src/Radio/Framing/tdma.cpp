@@ -0,0 +1,210 @@
+#include "tdma.h"
+#include "crc.h"
+#include "fec.h"
+#include "download.h"
+#include "reliable.h"
+#include <cstring>
+
+uint32_t tdmaAirMs(size_t air_bytes) {
+    return static_cast<uint32_t>((air_bytes * 8 * 1000ULL + RADIO_AIR_BPS - 1) / RADIO_AIR_BPS);
+}
+
+uint32_t tdmaUartMs(size_t air_bytes) {
+    // 10 bits per byte, the modem only sends once it has the whole frame
+    size_t uart_bytes = air_bytes > RADIO_AIR_OVERHEAD ? air_bytes - RADIO_AIR_OVERHEAD : 0;
+    return static_cast<uint32_t>(uart_bytes * 10 * 1000ULL / RADIO_UART_BAUD);
+}
+
+size_t tdmaAirBytes(size_t msg_len, uint8_t fec) {
+    return msg_len + fecOverhead(fec) + FRAME_OVERHEAD + RADIO_AIR_OVERHEAD;
+}
+
+size_t nodeWrap(uint8_t node, const uint8_t* msg, size_t len, uint8_t* out) {
+    if (len + TDMA_NODE_OVERHEAD > FRAME_MAX_PAYLOAD) {
+        return 0;
+    }
+    out[0] = RADIO_MSG_NODE;
+    out[1] = static_cast<uint8_t>((node & 0x0F) | ((~node & 0x0F) << 4));
+    memcpy(&out[TDMA_NODE_OVERHEAD], msg, len);
+    return len + TDMA_NODE_OVERHEAD;
+}
+
+bool nodeUnwrap(const uint8_t*& msg, size_t& len, uint8_t& node) {
+    if (len < TDMA_NODE_OVERHEAD || msg[0] != RADIO_MSG_NODE) {
+        node = 0;
+        return true;
+    }
+    uint8_t id = msg[1] & 0x0F;
+    if ((msg[1] >> 4) != (~id & 0x0F)) {
+        return false;
+    }
+    node = id;
+    msg += TDMA_NODE_OVERHEAD;
+    len -= TDMA_NODE_OVERHEAD;
+    return true;
+}
+
+uint32_t TdmaSchedule::period() const {
+    return ground_ms + static_cast<uint32_t>(nodes) * slot_ms;
+}
+
+uint16_t TdmaSchedule::groundSlot(uint8_t fec) {
+    // The slot starts when the beacon is written, later frames queue behind it
+    size_t beacon = tdmaAirBytes(TDMA_BEACON_SIZE, fec);
+    size_t command = tdmaAirBytes(RELIABLE_HEADER_SIZE + TDMA_UPLINK_MAX + RELIABLE_CRC_SIZE + TDMA_NODE_OVERHEAD, fec);
+    size_t request = tdmaAirBytes(DL_READ_SIZE + TDMA_NODE_OVERHEAD, fec);
+    uint32_t ms = tdmaUartMs(beacon) + tdmaAirMs(beacon) + tdmaAirMs(command) + tdmaAirMs(request);
+    return static_cast<uint16_t>(ms + 2 * TDMA_GUARD_MS);
+}
+
+uint16_t TdmaSchedule::nodeSlot(uint8_t fec) {
+    uint32_t air = tdmaAirMs(tdmaAirBytes(RADIO_TLM_MAX_SIZE + TDMA_NODE_OVERHEAD, fec));
+    return static_cast<uint16_t>(air + 2 * TDMA_GUARD_MS + TDMA_POLL_MS);
+}
+
+size_t tdmaPackBeacon(const TdmaSchedule& schedule, uint8_t seq, uint8_t* out) {
+    out[0] = RADIO_MSG_BEACON;
+    out[1] = seq;
+    out[2] = schedule.nodes;
+    memcpy(&out[3], &schedule.ground_ms, 2);
+    memcpy(&out[5], &schedule.slot_ms, 2);
+    uint16_t crc = crc16(out, 7);
+    out[7] = static_cast<uint8_t>(crc & 0xFF);
+    out[8] = static_cast<uint8_t>(crc >> 8);
+    return TDMA_BEACON_SIZE;
+}
+
+bool tdmaParseBeacon(const uint8_t* msg, size_t len, TdmaSchedule& schedule, uint8_t& seq) {
+    if (len != TDMA_BEACON_SIZE || msg[0] != RADIO_MSG_BEACON ||
+        crc16(msg, 7) != (msg[7] | (msg[8] << 8))) {
+        return false;
+    }
+    seq = msg[1];
+    schedule.nodes = msg[2];
+    memcpy(&schedule.ground_ms, &msg[3], 2);
+    memcpy(&schedule.slot_ms, &msg[5], 2);
+    return schedule.nodes > 0 && schedule.nodes <= TDMA_MAX_NODES && schedule.slot_ms > 2 * TDMA_GUARD_MS;
+}
+
+TdmaNode::TdmaNode()
+    : _node(0),
+      _schedule{0, 0, 0},
+      _synced(false),
+      _start(0),
+      _last_beacon(0),
+      _busy_until(0),
+      _seq(0),
+      _beacons(0),
+      _missed(0),
+      _error(0)
+{
+}
+
+void TdmaNode::setNode(uint8_t node, uint32_t now_ms) {
+    _node = (node <= TDMA_MAX_NODES) ? node : 0;
+    _synced = false;
+    _last_beacon = now_ms;      // wait up to one holdover for the first beacon
+}
+
+uint8_t TdmaNode::getNode() const {
+    return _node;
+}
+
+bool TdmaNode::onBeacon(const uint8_t* msg, size_t len, uint32_t now_ms, uint32_t delay_ms) {
+    TdmaSchedule schedule;
+    uint8_t seq;
+    if (!tdmaParseBeacon(msg, len, schedule, seq)) {
+        return false;
+    }
+
+    // The beacon goes out one guard time into the ground slot, which keeps
+    // the last node's late frames clear of it
+    uint32_t measured = now_ms - delay_ms - TDMA_GUARD_MS;
+    bool same = schedule.nodes == _schedule.nodes && schedule.ground_ms == _schedule.ground_ms &&
+                schedule.slot_ms == _schedule.slot_ms;
+
+    if (!isSynced(now_ms) || !same) {
+        _start = measured;
+        _error = 0;
+    } else {
+        uint32_t period = _schedule.period();
+        uint32_t periods = (measured - _start + period / 2) / period;
+        uint32_t predicted = _start + periods * period;
+        _error = static_cast<int32_t>(measured - predicted);
+
+        if (_error < 0) {
+            _start = measured;          // least delayed reading so far
+        } else {
+            _start = predicted + (_error + 7) / 8;
+        }
+        _missed += static_cast<uint8_t>(seq - _seq - 1);
+    }
+
+    _schedule = schedule;
+    _synced = true;
+    _seq = seq;
+    _last_beacon = now_ms;
+    _beacons++;
+    return true;
+}
+
+uint32_t TdmaNode::timeUntilSlot(uint32_t now_ms, size_t air_bytes) const {
+    if (_node == 0) {
+        return 0;
+    }
+    if (!isSynced(now_ms)) {
+        // Hold off for the first beacon, then fall back to transmitting freely
+        int32_t left = static_cast<int32_t>(_last_beacon + TDMA_HOLDOVER_MS - now_ms);
+        return left > 0 ? static_cast<uint32_t>(left) : 0;
+    }
+    if (_node > _schedule.nodes) {
+        return UINT32_MAX;      // no slot for this node in the schedule
+    }
+
+    uint32_t wait = 0;
+    if (static_cast<int32_t>(_busy_until - now_ms) > 0) {
+        wait = _busy_until - now_ms;
+    }
+    uint32_t t = now_ms + wait;
+
+    // Range of times to hand the frame over, as phases of the superframe
+    uint32_t period = _schedule.period();
+    uint32_t lead = tdmaUartMs(air_bytes);
+    uint32_t air = tdmaAirMs(air_bytes);
+    uint32_t open = _schedule.ground_ms + (_node - 1) * _schedule.slot_ms + TDMA_GUARD_MS;
+    uint32_t close = open + _schedule.slot_ms - 2 * TDMA_GUARD_MS;
+    if (air > close - open) {
+        return UINT32_MAX;      // never fits
+    }
+    uint32_t first = (open + period - lead) % period;
+    uint32_t span = close - open - air;
+
+    uint32_t phase = (t - _start) % period;
+    uint32_t into = (phase + period - first) % period;
+    if (into <= span) {
+        return wait;
+    }
+    return wait + period - into;
+}
+
+void TdmaNode::onTransmit(uint32_t now_ms, size_t air_bytes) {
+    _busy_until = now_ms + tdmaUartMs(air_bytes) + tdmaAirMs(air_bytes);
+}
+
+size_t TdmaNode::getSlotBytes(uint32_t now_ms) const {
+    if (_node == 0 || !isSynced(now_ms)) {
+        return 0;
+    }
+    // Leave room to start anywhere within one poll interval
+    uint32_t room = _schedule.slot_ms - 2 * TDMA_GUARD_MS - TDMA_POLL_MS;
+    return static_cast<size_t>(room) * RADIO_AIR_BPS / 8000;
+}
+
+bool TdmaNode::isSynced(uint32_t now_ms) const {
+    return _synced && now_ms - _last_beacon <= TDMA_HOLDOVER_MS;
+}
+
+const TdmaSchedule& TdmaNode::getSchedule() const { return _schedule; }
+uint32_t TdmaNode::getBeacons() const { return _beacons; }
+uint32_t TdmaNode::getMissed() const { return _missed; }
+int32_t TdmaNode::getError() const { return _error; }
@@ -0,0 +1,55 @@
+#include "telemetry.h"
+#include <cstring>
+
+TelemetryFrame::TelemetryFrame() : _len(0), _overflow(false) {
+}
+
+/**
+ * Starts a new frame of the given type, discarding any previous contents.
+ */
+void TelemetryFrame::begin(uint8_t type) {
+    _buf[0] = TELEM_SYNC_0;
+    _buf[1] = TELEM_SYNC_1;
+    _buf[2] = type;
+    _buf[3] = 0;
+    _len = TELEM_HEADER_SIZE;
+    _overflow = false;
+}
+
+void TelemetryFrame::put(const void* src, size_t n) {
+    if (_len + n > TELEM_HEADER_SIZE + TELEM_MAX_PAYLOAD) {
+        _overflow = true;
+        return;
+    }
+    // Cortex-M is little endian, matching the wire format
+    memcpy(&_buf[_len], src, n);
+    _len += n;
+}
+
+void TelemetryFrame::putU8(uint8_t v)   { put(&v, sizeof(v)); }
+void TelemetryFrame::putI16(int16_t v)  { put(&v, sizeof(v)); }
+void TelemetryFrame::putU16(uint16_t v) { put(&v, sizeof(v)); }
+void TelemetryFrame::putU32(uint32_t v) { put(&v, sizeof(v)); }
+void TelemetryFrame::putI32(int32_t v)  { put(&v, sizeof(v)); }
+
+size_t TelemetryFrame::finish() {
+    if (_overflow) {
+        _len = 0;
+        return 0;
+    }
+
+    _buf[3] = static_cast<uint8_t>(_len - TELEM_HEADER_SIZE);
+
+    uint16_t crc = crc16(&_buf[2], _len - 2);
+    _buf[_len++] = static_cast<uint8_t>(crc & 0xFF);
+    _buf[_len++] = static_cast<uint8_t>(crc >> 8);
+    return _len;
+}
+
+const uint8_t* TelemetryFrame::data() const {
+    return _buf;
+}
+
+size_t TelemetryFrame::size() const {
+    return _len;
+}
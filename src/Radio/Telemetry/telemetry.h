@@ -0,0 +1,77 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <cstddef>
+#include <cstdint>
+#include "crc.h"
+
+/*
+ * Binary telemetry frame sent over USB (decoded on the host by telemetry.py)
+ *
+ *   offset  size  field
+ *   0       2     sync word 0xA5 0x5A
+ *   2       1     frame type (TELEM_*)
+ *   3       1     payload length N
+ *   4       N     payload, little endian
+ *   4+N     2     CRC-16/CCITT-FALSE over type, length and payload (little endian)
+ */
+
+#define TELEM_SYNC_0        0xA5
+#define TELEM_SYNC_1        0x5A
+#define TELEM_HEADER_SIZE   4
+#define TELEM_CRC_SIZE      2
+#define TELEM_MAX_PAYLOAD   255
+#define TELEM_MAX_FRAME     (TELEM_HEADER_SIZE + TELEM_MAX_PAYLOAD + TELEM_CRC_SIZE)
+
+// Frame types
+#define TELEM_IMU   0x01    // u32 timestamp, acc/gyr/mag/eul/lin/grav xyz, quat wxyz, temp (int16 raw)
+#define TELEM_ENC   0x02    // u32 timestamp, enc1, enc2 (int32 raw counts), speed1, speed2 (int32 counts/s)
+#define TELEM_TRACE_NAME    0x03    // u8 table (0 probes, 1 threads, 2 monitored tasks), u8 index, name
+#define TELEM_TRACE_EVENTS  0x04    // u32 first, u32 total, u16 cycles/us, up to 30 trace events of 8 bytes (see Profiler/trace.h)
+
+// Ground station (src/Radio) frames
+#define TELEM_RADIO         0x10    // u8 node (0 if none), one radio message as received, see radio_protocol.h
+#define TELEM_LINK_STATS    0x11    // u32 frames, crc errors, framing errors, overruns, bytes/s, fec corrected, fec failed
+#define TELEM_COMMAND       0x12    // u8 seq, u8 outcome, u8 tries, u32 latency ms, u32 rto ms
+#define TELEM_LOG_DATA      0x13    // u32 offset, flash log bytes (up to 128)
+#define TELEM_LOG_PROGRESS  0x14    // u8 state, u8 stalled, u32 offset, u32 size, u32 bytes/s, u32 repeats
+#define TELEM_NODE_STATS    0x15    // u8 node, u32 frames, crc errors, empty TDMA slots, ms since last frame
+
+/**
+ * @brief Builds one telemetry frame in a fixed internal buffer.
+ *
+ * Usage: begin(type), put*() the payload fields, finish(), then send
+ * data()/size(). Fields that would overflow the payload are dropped and
+ * reported by finish() returning 0.
+ */
+class TelemetryFrame {
+public:
+    TelemetryFrame();
+
+    void begin(uint8_t type);
+
+    void putU8(uint8_t v);
+    void putI16(int16_t v);
+    void putU16(uint16_t v);
+    void putU32(uint32_t v);
+    void putI32(int32_t v);
+
+    /**
+     * @brief Fill in length and CRC.
+     *
+     * @return size_t Total frame size in bytes, or 0 if the payload overflowed.
+     */
+    size_t finish();
+
+    const uint8_t* data() const;
+    size_t size() const;
+
+private:
+    void put(const void* src, size_t n);
+
+    uint8_t _buf[TELEM_MAX_FRAME];
+    size_t _len;
+    bool _overflow;
+};
+
+#endif // TELEMETRY_H
@@ -1,114 +1,638 @@
 #include "mbed.h"
 #include <cstdint>
 #include <cstring>
-#include <vector>
 #include "EUSBSerial.h"
-#include <string>
+#include "crc.h"
+#include "framing.h"
+#include "fec.h"
+#include "radio_protocol.h"
+#include "reliable.h"
+#include "download.h"
+#include "tdma.h"
+#include "telemetry.h"
+
+#define RX_RING_SIZE    2048        // ~180 ms of radio UART data at 115200
+#define USB_BATCH_SIZE  512         // bytes of USB frames per write
+#define INPUT_MAX_LINE  128
+#define STATS_INTERVAL  1s
+#define UPLINK_FEC      FEC_LIGHT   // received frames are decoded in any mode
+
+// Event flags raised from interrupt context
+#define FLAG_UART_RX    (1UL << 0)
+#define FLAG_USB_RX     (1UL << 1)
+#define FLAG_STATS      (1UL << 2)
+#define FLAG_BEACON     (1UL << 3)
 
 // USB Serial to PC
 EUSBSerial pc;
 
-// UART connection to target device
-BufferedSerial uart(PA_2, PA_3, 115200);
+// UART connection to target device, read from its RX interrupt
+UnbufferedSerial uart(PA_2, PA_3, 115200);
+
+CircularBuffer<uint8_t, RX_RING_SIZE> rx_ring;
+EventFlags link_events;
+Ticker stats_ticker;
+Ticker beacon_ticker;
+FrameDecoder decoder;
+
+// Commands typed on the PC are sent one at a time until acknowledged
+ReliableSender commander;
+uint8_t uplink_fec = UPLINK_FEC;
+
+// Airtime of one full log chunk, assuming the flight computer codes its
+// downlink with the same FEC mode as the uplink
+static const uint32_t chunk_air_ms =
+    (DL_DATA_MAX_SIZE + fecOverhead(UPLINK_FEC) + FRAME_OVERHEAD + RADIO_AIR_OVERHEAD) * 8 * 1000 / RADIO_AIR_BPS + 1;
+DownloadClient downloader(chunk_air_ms);
+
+// TDMA is off until "!tdma N", then the uplink only goes out in the ground
+// slot right after each beacon (Framing/tdma.h)
+TdmaSchedule tdma = {0, 0, 0};
+uint8_t beacon_seq = 0;
+
+// Commands and download requests go to this node, 0 sends them unaddressed
+uint8_t target_node = 0;
+
+// Binary mode forwards every radio frame to the host wrapped in a USB
+// telemetry frame (decoded by telemetry.py), text mode prints them
+bool binary_mode = true;
+
+uint8_t usb_batch[USB_BATCH_SIZE];
+size_t usb_batch_len = 0;
+
+char input_line[INPUT_MAX_LINE];
+size_t input_len = 0;
+
+struct LinkStats {
+    uint32_t frames;
+    uint32_t crc_errors;
+    uint32_t framing_errors;
+    uint32_t overruns;
+    uint32_t bytes;
+    uint32_t fec_corrected;     // bytes repaired by FEC
+    uint32_t fec_failed;        // coded frames with too many errors
+};
+
+LinkStats stats = {};
+
+struct NodeStats {
+    uint32_t frames;
+    uint32_t crc_errors;
+    uint32_t empty_slots;       // superframes without a frame from the node
+    uint32_t last_ms;           // 0 until the node is heard
+    uint32_t superframe_frames;
+};
+
+// Index 0 collects frames without a node envelope
+NodeStats node_stats[TDMA_MAX_NODES + 1] = {};
+volatile uint32_t rx_bytes = 0;
+volatile uint32_t rx_overruns = 0;
+
+// ===== UART WRITE FUNCTION WITH FRAMING =====
+void write(FileHandle* ser, const uint8_t* data, size_t len) {
+    if (!ser || len > FRAME_MAX_PAYLOAD) return;
+
+    uint8_t buf[FRAME_MAX_SIZE];
+    size_t n = frameEncode(data, len, buf);
+
+    ser->write(buf, n);
+}
+
+void writeCoded(FileHandle* ser, const uint8_t* data, size_t len) {
+    uint8_t coded[FRAME_MAX_PAYLOAD];
+    size_t n = fecEncode(uplink_fec, data, len, coded);
+
+    if (n == 0) {
+        write(ser, data, len);
+    } else {
+        write(ser, coded, n);
+    }
+}
+
+// Commands and download requests, addressed to target_node
+void writeUplink(const uint8_t* data, size_t len) {
+    uint8_t wrapped[FRAME_MAX_PAYLOAD];
+    if (target_node != 0) {
+        len = nodeWrap(target_node, data, len, wrapped);
+        if (len == 0) return;
+        data = wrapped;
+    }
+    writeCoded(&uart, data, len);
+}
+
+static uint32_t nowMs() {
+    return static_cast<uint32_t>(Kernel::Clock::now().time_since_epoch().count());
+}
+
+// ===== INTERRUPT HANDLERS =====
+void uartRxISR() {
+    uint8_t c;
+    while (uart.readable()) {
+        uart.read(&c, 1);
+        rx_bytes++;
+        if (rx_ring.full()) {
+            rx_overruns++;
+        } else {
+            rx_ring.push(c);
+        }
+    }
+    link_events.set(FLAG_UART_RX);
+}
+
+void usbRxISR() {
+    link_events.set(FLAG_USB_RX);
+}
+
+void statsISR() {
+    link_events.set(FLAG_STATS);
+}
+
+void beaconISR() {
+    link_events.set(FLAG_BEACON);
+}
+
+// Names match the State enum order in src/Gyro/main.cpp
+static const char* stateName(uint8_t state) {
+    static const char* names[] = {"idle", "setup", "reset", "main", "timeout", "decode"};
+    return state < sizeof(names) / sizeof(names[0]) ? names[state] : "?";
+}
+
+void printTelemetry(const uint8_t* msg, size_t len) {
+    const uint8_t* ptr = msg + 1;
+    uint8_t mask = *ptr++;
+    uint32_t ts;
+    memcpy(&ts, ptr, 4); ptr += 4;
+    uint8_t state = *ptr++;
+
+    pc.printf("[%u ms] %s", ts, stateName(state));
+
+    if (mask & RADIO_TLM_QUAT) {
+        int16_t q[4];
+        memcpy(q, ptr, sizeof(q)); ptr += sizeof(q);
+        pc.printf(" QUAT [%.4f %.4f %.4f %.4f]",
+            q[0] / 16384.0f, q[1] / 16384.0f, q[2] / 16384.0f, q[3] / 16384.0f);
+    }
+    if (mask & RADIO_TLM_ENC) {
+        int32_t e[2];
+        memcpy(e, ptr, sizeof(e)); ptr += sizeof(e);
+        pc.printf(" ENC [%d %d]", e[0], e[1]);
+    }
+    if (mask & RADIO_TLM_ACC) {
+        int16_t a[3];
+        memcpy(a, ptr, sizeof(a)); ptr += sizeof(a);
+        pc.printf(" ACC [%.2f %.2f %.2f]", a[0] / 100.0f, a[1] / 100.0f, a[2] / 100.0f);
+    }
+    pc.printf("\r\n");
+}
+
+// ===== USB OUTPUT =====
+void flushUSB() {
+    if (usb_batch_len > 0) {
+        pc.write(reinterpret_cast<const char*>(usb_batch), usb_batch_len);
+        usb_batch_len = 0;
+    }
+}
+
+void queueUSB(const TelemetryFrame& frame) {
+    if (usb_batch_len + frame.size() > sizeof(usb_batch)) {
+        flushUSB();
+    }
+    memcpy(&usb_batch[usb_batch_len], frame.data(), frame.size());
+    usb_batch_len += frame.size();
+}
+
+// ===== COMMANDS =====
+static const char* outcomeName(ReliableSender::Outcome outcome) {
+    switch (outcome) {
+        case ReliableSender::Delivered: return "ok";
+        case ReliableSender::Rejected:  return "rejected";
+        case ReliableSender::Failed:    return "failed";
+        default:                        return "pending";
+    }
+}
+
+void reportCommand() {
+    if (binary_mode) {
+        TelemetryFrame frame;
+        frame.begin(TELEM_COMMAND);
+        frame.putU8(commander.getSequence());
+        frame.putU8(commander.getOutcome());
+        frame.putU8(commander.getTries());
+        frame.putU32(commander.getLatency());
+        frame.putU32(commander.getRto());
+        if (frame.finish()) {
+            queueUSB(frame);
+        }
+    } else {
+        pc.printf("command %u %s after %u tries, %u ms (rto %u ms)\r\n",
+            commander.getSequence(), outcomeName(commander.getOutcome()),
+            commander.getTries(), commander.getLatency(), commander.getRto());
+    }
+}
+
+// ===== LOG DOWNLOAD =====
+static const char* downloadStateName(DownloadClient::State state) {
+    switch (state) {
+        case DownloadClient::Sizing:  return "sizing";
+        case DownloadClient::Running: return "running";
+        case DownloadClient::Done:    return "done";
+        default:                      return "idle";
+    }
+}
+
+void reportDownload() {
+    uint32_t now = nowMs();
+
+    if (binary_mode) {
+        TelemetryFrame frame;
+        frame.begin(TELEM_LOG_PROGRESS);
+        frame.putU8(downloader.getState());
+        frame.putU8(downloader.isStalled(now));
+        frame.putU32(downloader.getOffset());
+        frame.putU32(downloader.getSize());
+        frame.putU32(downloader.getRate(now));
+        frame.putU32(downloader.getRepeats());
+        if (frame.finish()) {
+            queueUSB(frame);
+        }
+    } else {
+        // Raw link capacity in bytes/s, to show how much of it the download uses
+        uint32_t raw = RADIO_AIR_BPS / 8;
+        uint32_t rate = downloader.getRate(now);
+        pc.printf("download %s%s: %u / %u bytes, %u B/s (%u%% of link), %u repeats, %u duplicates, %u corrupt\r\n",
+            downloadStateName(downloader.getState()), downloader.isStalled(now) ? " (stalled)" : "",
+            downloader.getOffset(), downloader.getSize(), rate, rate * 100 / raw,
+            downloader.getRepeats(), downloader.getDuplicates(), downloader.getCorrupt());
+    }
+}
+
+void handleDownload(const uint8_t* msg, size_t len) {
+    DownloadClient::State before = downloader.getState();
+    DownloadClient::Result result = downloader.onMessage(msg, len, nowMs());
+
+    if (result == DownloadClient::Chunk && binary_mode) {
+        TelemetryFrame frame;
+        frame.begin(TELEM_LOG_DATA);
+        frame.putU32(downloader.chunkOffset());
+        const uint8_t* data = downloader.chunk();
+        for (size_t i = 0; i < downloader.chunkLength(); i++) {
+            frame.putU8(data[i]);
+        }
+        if (frame.finish()) {
+            queueUSB(frame);
+        }
+    }
+    // Report the final state straight away rather than on the next tick
+    if (downloader.getState() != before && downloader.getState() == DownloadClient::Done) {
+        reportDownload();
+    }
+}
 
-// ===== COBS ENCODING FUNCTION =====
-void cobs(std::vector<uint8_t>& buf, uint8_t start) {
-    size_t count = 0;
-    size_t last_i = 2;
+// Transmits the command in flight when it is due, returns ms until the next check
+uint32_t serviceCommands() {
+    uint32_t now = nowMs();
+    bool was_busy = commander.busy();
+    size_t len;
+    const uint8_t* msg = commander.poll(now, len);
 
-    for (size_t i = 3; i < buf.size(); ++i) {
-        count += 1;
-        if (buf[i] == start) {
-            buf[last_i] = static_cast<uint8_t>(count);
-            last_i = i;
-            count = 0;
+    if (msg) {
+        writeUplink(msg, len);
+    } else if (was_busy && commander.getOutcome() == ReliableSender::Failed) {
+        reportCommand();
+    }
+
+    // Download requests share the uplink, but never while a command waits
+    // for its turn so commands keep priority
+    if (!commander.busy()) {
+        msg = downloader.poll(now, len);
+        if (msg) {
+            writeUplink(msg, len);
         }
     }
 
-    buf[last_i] = 0;
+    uint32_t wait = commander.timeUntilNext(now);
+    uint32_t dl_wait = downloader.timeUntilNext(now);
+    return dl_wait < wait ? dl_wait : wait;
 }
 
-// ===== UART WRITE FUNCTION WITH COBS =====
-void write(BufferedSerial* ser, const uint8_t* data, size_t len) {
-    if (!ser || len + 4 > 256) return;
+// ===== TDMA =====
+void sendBeacon() {
+    uint8_t beacon[TDMA_BEACON_SIZE];
+    writeCoded(&uart, beacon, tdmaPackBeacon(tdma, beacon_seq++, beacon));
+
+    // A node that was heard but sent nothing since the last beacon left its slot empty
+    uint32_t now = nowMs();
+    for (uint8_t node = 1; node <= tdma.nodes; node++) {
+        NodeStats& ns = node_stats[node];
+        if (ns.last_ms != 0 && now - ns.last_ms < 5000 && ns.superframe_frames == 0) {
+            ns.empty_slots++;
+        }
+        ns.superframe_frames = 0;
+    }
+}
 
-    std::vector<uint8_t> buf(len + 3, 0); // len + 4 to include \n terminator
+void setTdma(uint8_t nodes, uint16_t slot_ms) {
+    beacon_ticker.detach();
+    tdma.nodes = nodes;
+    tdma.slot_ms = slot_ms;
+    tdma.ground_ms = TdmaSchedule::groundSlot(uplink_fec);
 
-    for (size_t i = 0; i < len; ++i) {
-        buf[i + 3] = data[i];
+    if (nodes > 0) {
+        beacon_ticker.attach(beaconISR, chrono::milliseconds(tdma.period()));
     }
+}
 
-    buf[0] = 234;
-    buf[1] = static_cast<uint8_t>(len + 3);
-    buf[2] = 0;
+void reportNodes() {
+    uint32_t now = nowMs();
 
-    cobs(buf, 234);
+    for (uint8_t node = 1; node <= TDMA_MAX_NODES; node++) {
+        const NodeStats& ns = node_stats[node];
+        if (ns.last_ms == 0) {
+            continue;
+        }
+        if (binary_mode) {
+            TelemetryFrame frame;
+            frame.begin(TELEM_NODE_STATS);
+            frame.putU8(node);
+            frame.putU32(ns.frames);
+            frame.putU32(ns.crc_errors);
+            frame.putU32(ns.empty_slots);
+            frame.putU32(now - ns.last_ms);
+            if (frame.finish()) {
+                queueUSB(frame);
+            }
+        } else {
+            pc.printf("node %u: %u frames, %u crc, %u empty slots, last heard %u ms ago\r\n",
+                node, ns.frames, ns.crc_errors, ns.empty_slots, now - ns.last_ms);
+        }
+    }
+}
 
-    // buf[len + 3] = '\n'; // end of frame
+// ===== RADIO INPUT =====
+void handleMessage(const uint8_t* msg, size_t len) {
+    uint8_t node;
+    if (!nodeUnwrap(msg, len, node) || node > TDMA_MAX_NODES) {
+        stats.crc_errors++;
+        return;
+    }
+    NodeStats& ns = node_stats[node];
+    uint8_t type = len > 0 ? msg[0] : 0;
 
-    ser->write(buf.data(), buf.size());
+    // Replies only count from the node being talked to
+    bool from_target = node == target_node || target_node == 0;
+
+    if (type == RADIO_MSG_LOG_INFO || type == RADIO_MSG_LOG_DATA) {
+        stats.frames++;
+        ns.frames++;
+        ns.last_ms = nowMs();
+        if (from_target) {
+            handleDownload(msg, len);
+        }
+        return;
+    }
+
+    bool checked = type == RADIO_MSG_TELEMETRY || type == RADIO_MSG_ACK;
+
+    if (checked) {
+        if (len < RADIO_TLM_CRC_SIZE + 1 ||
+            crc16(msg, len - 2) != (msg[len - 2] | (msg[len - 1] << 8))) {
+            stats.crc_errors++;
+            ns.crc_errors++;
+            return;
+        }
+    }
+    stats.frames++;
+    ns.frames++;
+    ns.superframe_frames++;
+    ns.last_ms = nowMs();
+
+    if (type == RADIO_MSG_ACK) {
+        if (from_target && commander.onAck(msg, len, nowMs())) {
+            reportCommand();
+        }
+        return;
+    }
+
+    if (binary_mode) {
+        TelemetryFrame frame;
+        frame.begin(TELEM_RADIO);
+        frame.putU8(node);
+        for (size_t i = 0; i < len; i++) {
+            frame.putU8(msg[i]);
+        }
+        if (frame.finish()) {
+            queueUSB(frame);
+        }
+    } else if (type == RADIO_MSG_TELEMETRY) {
+        if (node != 0) {
+            pc.printf("node %u ", node);
+        }
+        printTelemetry(msg, len);
+    } else {
+        pc.printf("Received message: %.*s\r\n", static_cast<int>(len), reinterpret_cast<const char*>(msg));
+    }
 }
 
-bool parse(const char* data, size_t length, std::string& result) {
-    static std::string buffer;
-    buffer.append(data, length);
+void handleFrame(const uint8_t* payload, size_t len) {
+    uint8_t msg[FRAME_MAX_PAYLOAD];
+    size_t msg_len;
+    int fixed = fecDecode(payload, len, msg, msg_len);
 
-    size_t start = buffer.find('"');
-    while (start != std::string::npos) {
-        size_t end = buffer.find('"', start + 1);
-        if (end == std::string::npos) {
-            // Incomplete: keep only from opening quote onward
-            if (start > 0) buffer.erase(0, start);
-            return false;
+    if (fixed == FEC_UNCODED) {
+        handleMessage(payload, len);
+    } else if (fixed == FEC_FAILED) {
+        stats.fec_failed++;
+    } else {
+        stats.fec_corrected += fixed;
+        handleMessage(msg, msg_len);
+    }
+}
+
+void drainUART() {
+    uint8_t chunk[64];
+    uint32_t n;
+
+    while ((n = rx_ring.pop(chunk, sizeof(chunk))) > 0) {
+        for (uint32_t i = 0; i < n; i++) {
+            FrameDecoder::Result result = decoder.feed(chunk[i]);
+            if (result == FrameDecoder::Frame) {
+                handleFrame(decoder.payload(), decoder.length());
+            } else if (result == FrameDecoder::Error) {
+                stats.framing_errors++;
+            }
         }
+    }
 
-        // Extract and filter printable ASCII chars only
-        std::string raw = buffer.substr(start + 1, end - start - 1);
-        std::string cleaned;
-        for (char c : raw) {
-            if (c >= 32 && c <= 126) {
-                cleaned += c;
+    flushUSB();
+}
+
+// ===== PC INPUT =====
+// Lines starting with '!' configure the ground station, everything else is sent to the radio
+void handleLine(char* line) {
+    if (strcmp(line, "!text") == 0) {
+        binary_mode = false;
+        pc.printf("text mode\r\n");
+    } else if (strcmp(line, "!binary") == 0) {
+        binary_mode = true;
+    } else if (strncmp(line, "!fec ", 5) == 0) {
+        int mode = atoi(line + 5);
+        uplink_fec = (mode >= 0 && mode < FEC_MODES) ? mode : FEC_OFF;
+        if (tdma.nodes > 0) {
+            setTdma(tdma.nodes, tdma.slot_ms);     // ground slot depends on the FEC mode
+        }
+        if (!binary_mode) {
+            pc.printf("uplink fec mode %u\r\n", uplink_fec);
+        }
+    } else if (strcmp(line, "!download") == 0 || strncmp(line, "!download ", 10) == 0) {
+        uint32_t offset = line[9] ? strtoul(line + 10, nullptr, 0) : 0;
+        downloader.start(offset, nowMs());
+        if (!binary_mode) {
+            pc.printf("downloading log from offset %u\r\n", offset - offset % DL_CHUNK_SIZE);
+        }
+    } else if (strcmp(line, "!cancel") == 0) {
+        downloader.cancel();
+        if (!binary_mode) {
+            pc.printf("download cancelled\r\n");
+        }
+    } else if (strncmp(line, "!tdma ", 6) == 0) {
+        char* end;
+        int nodes = strtol(line + 6, &end, 0);
+        int slot_ms = *end ? strtol(end, nullptr, 0) : TdmaSchedule::nodeSlot(uplink_fec);
+        if (nodes < 0 || nodes > TDMA_MAX_NODES || slot_ms <= 2 * TDMA_GUARD_MS || slot_ms > 1000) {
+            nodes = 0;
+        }
+        setTdma(nodes, slot_ms);
+        if (!binary_mode) {
+            if (nodes > 0) {
+                pc.printf("tdma %u nodes, %u ms slots, %u ms ground slot, %u ms superframe\r\n",
+                    tdma.nodes, tdma.slot_ms, tdma.ground_ms, tdma.period());
+            } else {
+                pc.printf("tdma off\r\n");
+            }
+        }
+    } else if (strncmp(line, "!node ", 6) == 0) {
+        int node = atoi(line + 6);
+        target_node = (node > 0 && node <= TDMA_MAX_NODES) ? node : 0;
+        if (!binary_mode) {
+            pc.printf("talking to node %u\r\n", target_node);
+        }
+    } else if (tdma.nodes > 0 && strlen(line) > TDMA_UPLINK_MAX) {
+        if (!binary_mode) {
+            pc.printf("too long for the tdma ground slot (%u characters max)\r\n", TDMA_UPLINK_MAX);
+        }
+    } else if (line[0] != 0) {
+        // In binary mode the host learns the result from the TELEM_COMMAND report
+        bool queued = commander.send(reinterpret_cast<uint8_t*>(line), strlen(line), nowMs());
+        if (!binary_mode) {
+            if (queued) {
+                pc.printf("Sent %u: %s\r\n", commander.getSequence(), line);
+            } else {
+                pc.printf("busy: command %u in flight\r\n", commander.getSequence());
             }
         }
+    }
+}
 
-        result = cleaned;
-        buffer.erase(0, end + 1);  // Trim processed portion
-        return true;
+void drainUSB() {
+    char chunk[32];
+    size_t n;
+
+    while ((n = pc.read(chunk, sizeof(chunk))) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            char c = chunk[i];
+            if (c == '\r') {
+                continue;
+            }
+            if (c == '\n') {
+                input_line[input_len] = 0;
+                handleLine(input_line);
+                input_len = 0;
+            } else if (input_len < sizeof(input_line) - 1) {
+                input_line[input_len++] = c;
+            }
+        }
     }
+}
 
-    // No quote found at all
-    buffer.clear();
-    return false;
+// ===== LINK STATISTICS =====
+void reportStats() {
+    static uint32_t last_bytes = 0;
+
+    core_util_critical_section_enter();
+    uint32_t bytes = rx_bytes;
+    stats.overruns = rx_overruns;
+    core_util_critical_section_exit();
+
+    stats.bytes = bytes - last_bytes;
+    last_bytes = bytes;
+
+    if (binary_mode) {
+        TelemetryFrame frame;
+        frame.begin(TELEM_LINK_STATS);
+        frame.putU32(stats.frames);
+        frame.putU32(stats.crc_errors);
+        frame.putU32(stats.framing_errors);
+        frame.putU32(stats.overruns);
+        frame.putU32(stats.bytes);
+        frame.putU32(stats.fec_corrected);
+        frame.putU32(stats.fec_failed);
+        if (frame.finish()) {
+            queueUSB(frame);
+            flushUSB();
+        }
+    } else {
+        pc.printf("link: %u frames, %u crc, %u framing, %u overruns, %u B/s, fec %u fixed %u failed\r\n",
+            stats.frames, stats.crc_errors, stats.framing_errors, stats.overruns, stats.bytes,
+            stats.fec_corrected, stats.fec_failed);
+    }
 }
 
 int main() {
-    uart.set_blocking(true);
-    pc.printf("Bidirectional UART <-> PC ready. Type and press Enter:\r\n");
-
-    char input_buf[128];
-    char uart_buf[256];
-    uint8_t empty_buf[1];
+    // Random first sequence number so a rebooted ground station is not
+    // mistaken for duplicates of its previous commands
+    commander = ReliableSender(static_cast<uint8_t>(us_ticker_read()));
 
+    uart.attach(uartRxISR, SerialBase::RxIrq);
+    pc.attach(usbRxISR);
+    stats_ticker.attach(statsISR, STATS_INTERVAL);
 
+    // Sleeps between events, all input arrives through interrupts. The
+    // wait is cut short when a command retransmission or log download
+    // request is due, or the beacon ticker sets the pace with TDMA.
+    uint32_t wait_ms = UINT32_MAX;
     while (true) {
-        // === PC to UART ===
-        if (pc.readline(input_buf, sizeof(input_buf))) {
-            write(&uart, reinterpret_cast<uint8_t*>(input_buf), strlen(input_buf)); 
-            pc.printf("Sent: %s\r\n", input_buf);
-        }
-
-        // === UART to PC (raw passthrough) ===
-        while (uart.readable()) {
-            char uart_buf[128];
-            std::string message;
-
-            ssize_t n = uart.read(uart_buf, sizeof(uart_buf));
-            if (n > 0) {
-                // if (parse(uart_buf, n, message)) {
-                //     pc.printf("Received message: %s\n", message.c_str());
-                // }
-                pc.printf("%s", uart_buf.c_str());
+        uint32_t mask = FLAG_UART_RX | FLAG_USB_RX | FLAG_STATS | FLAG_BEACON;
+        uint32_t flags = (wait_ms == UINT32_MAX)
+            ? link_events.wait_any(mask)
+            : link_events.wait_any_for(mask, Kernel::Clock::duration_u32(wait_ms));
+        if (flags & osFlagsError) {
+            flags = 0;      // timeout
+        }
+
+        if (flags & FLAG_UART_RX) {
+            drainUART();
+        }
+        if (flags & FLAG_USB_RX) {
+            drainUSB();
+        }
+        if (flags & FLAG_STATS) {
+            reportStats();
+            DownloadClient::State state = downloader.getState();
+            if (state == DownloadClient::Sizing || state == DownloadClient::Running) {
+                reportDownload();
+            }
+            reportNodes();
+        }
+        if (tdma.nodes > 0) {
+            // The beacon ticker paces the uplink, one slot per superframe
+            if (flags & FLAG_BEACON) {
+                sendBeacon();
+                serviceCommands();
             }
+            wait_ms = UINT32_MAX;
+        } else {
+            wait_ms = serviceCommands();
         }
+        flushUSB();
     }
 }
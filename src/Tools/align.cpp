@@ -0,0 +1,521 @@
+/*
+ * Host alignment of the flight log: the encoder and IMU streams merged onto
+ * one timebase and resampled at a uniform rate.
+ *
+ * Build from src/:
+ *   g++ -O2 -std=c++17 -IGyro/BNO055 Tools/align.cpp -o align
+ *
+ * Usage:
+ *   align LOG [CSV] [--rate HZ] [--max-gap MS] [--session N]
+ *
+ * LOG is the binary log as download.py writes it, or a whole chip image; it
+ * is read from offset 0 up to the first erased entry or the end of the log
+ * area, where the log index, config and fault sectors start. The entry layout is
+ * log_task_raw()'s in src/Gyro/main.cpp. Output goes to CSV, or stdout.
+ *
+ * Each stream keeps its own sample times (the encoder task's and the
+ * BNO055 burst midpoint), in us since the session epoch. Every session gets
+ * its own grid, at whole multiples of 1/HZ from the epoch, from its first
+ * sample to its last. At each grid time a stream is interpolated between
+ * the samples either side of it: linearly for the encoders, IMU vectors and
+ * temperature, along the shorter way round for the Euler angles, and by
+ * slerp for the quaternion. Where the samples either side are more than
+ * MS apart (default three times the stream's median interval), or the grid
+ * is outside the stream, its columns are left empty, which pandas reads as
+ * NaN, instead of decodeCSV()'s -999999.
+ *
+ * Logs from firmware before sessions have ms since reset; they come out as
+ * session 0 with the times scaled to us. The control, attitude and timing
+ * entries are only decoded for their size.
+ */
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "bno055_const.h"
+
+#define ENCODER_PPM         2048    // src/Gyro/main.cpp
+#define LOG_AREA_END        0x3FD000    // LOG_INDEX_ADDR, src/Gyro/Log/log_index.h
+#define LOG_TIMING_TASKS    8
+#define TEMP_SCALE          0.0625  // TMP102, C per LSB
+#define GAP_INTERVALS       3       // default --max-gap, in median intervals
+
+struct Options {
+    const char* in = nullptr;
+    const char* out = nullptr;
+    double rate = 100.0;
+    double max_gap_ms = 0.0;        // 0 for GAP_INTERVALS median intervals
+    int session = -1;               // -1 for all of them
+};
+
+struct EncoderSample {
+    double t_us;
+    double pos[2];                  // revolutions
+    double rpm[2];                  // NAN in 16-bit count entries
+};
+
+struct ImuSample {
+    double t_us;
+    double vec[15];                 // acc, gyr, mag, lin, grav
+    double eul[3];                  // heading, roll, pitch, degrees
+    double quat[4];                 // w, x, y, z
+    double temp;
+};
+
+struct Session {
+    int number;                     // 0 before the first session entry
+    uint64_t epoch_us;
+    int64_t first_us;               // -1 if never programmed
+    bool confirmed;
+    std::vector<EncoderSample> enc;
+    std::vector<ImuSample> imu;
+};
+
+// ===== LOG =====
+
+template <typename T>
+static T get(const uint8_t*& ptr) {
+    T value;
+    memcpy(&value, ptr, sizeof(value));
+    ptr += sizeof(value);
+    return value;
+}
+
+// log_entry_size() in src/Gyro/main.cpp, 0 for a byte that starts no entry
+static size_t entrySize(uint8_t flags) {
+    if (flags & 0x80) {
+        return 0;
+    }
+    size_t size = 1;
+    if (flags & 0x01) size += 4 + 2 + 2;
+    if (flags & 0x04) size += 4 + 4 * 4;
+    if (flags & 0x02) size += 4 + 6 * 3 * 2 + 4 * 2 + 2;
+    if (flags & 0x08) size += 4 + 4 * 2;
+    if (flags & 0x10) size += 4 + 5 * 2;
+    if (flags & 0x20) size += 4 + LOG_TIMING_TASKS * 2;
+    if (flags & 0x40) size += 8 + 4 + 1;
+    return size;
+}
+
+// Sample times are u32 since the epoch and wrap after 71 minutes
+static double unwrap(uint32_t t, uint64_t& last) {
+    uint64_t now = (last & ~0xFFFFFFFFULL) | t;
+    if (now + 0x80000000ULL < last) {
+        now += 1ULL << 32;
+    }
+    last = now;
+    return static_cast<double>(now);
+}
+
+static std::vector<Session> parseLog(const std::vector<uint8_t>& log, size_t& entries) {
+    std::vector<Session> sessions;
+    sessions.push_back(Session{0, 0, -1, true, {}, {}});
+    double time_scale = 1000.0;     // ms before the first session entry
+    uint64_t last_enc = 0, last_imu = 0;
+    entries = 0;
+
+    const size_t end = std::min<size_t>(log.size(), LOG_AREA_END);
+    size_t addr = 0;
+    while (addr < end && log[addr] != 0xFF) {
+        uint8_t flags = log[addr];
+        size_t size = entrySize(flags);
+        if (size == 0 || addr + size > end) {
+            fprintf(stderr, "stopped at offset %zu: %s\n", addr, size == 0 ? "not an entry" : "entry cut short");
+            break;
+        }
+        const uint8_t* ptr = &log[addr + 1];
+        addr += size;
+        entries++;
+
+        if (flags & 0x40) {
+            Session s;
+            s.number = static_cast<int>(sessions.size());
+            s.epoch_us = get<uint64_t>(ptr);
+            uint32_t first = get<uint32_t>(ptr);
+            s.first_us = first == 0xFFFFFFFF ? -1 : static_cast<int64_t>(first);
+            s.confirmed = get<uint8_t>(ptr) == 0x00;
+            sessions.push_back(s);
+            time_scale = 1.0;
+            last_enc = last_imu = 0;
+            continue;
+        }
+
+        Session& s = sessions.back();
+        if (flags & 0x01) {
+            EncoderSample e;
+            e.t_us = unwrap(get<uint32_t>(ptr), last_enc) * time_scale;
+            e.pos[0] = static_cast<double>(get<int16_t>(ptr)) / ENCODER_PPM;
+            e.pos[1] = static_cast<double>(get<int16_t>(ptr)) / ENCODER_PPM;
+            e.rpm[0] = e.rpm[1] = NAN;
+            s.enc.push_back(e);
+        }
+        if (flags & 0x04) {
+            EncoderSample e;
+            e.t_us = unwrap(get<uint32_t>(ptr), last_enc) * time_scale;
+            e.pos[0] = static_cast<double>(get<int32_t>(ptr)) / ENCODER_PPM;
+            e.pos[1] = static_cast<double>(get<int32_t>(ptr)) / ENCODER_PPM;
+            e.rpm[0] = get<int32_t>(ptr) * 60.0 / ENCODER_PPM;
+            e.rpm[1] = get<int32_t>(ptr) * 60.0 / ENCODER_PPM;
+            s.enc.push_back(e);
+        }
+        if (flags & 0x02) {
+            // acc, gyr, mag, eul, lin, grav, quat (w first), temperature
+            static const double scales[6] = {accelScale, angularRateScale, magScale, eulerScale, accelScale, accelScale};
+            ImuSample m;
+            m.t_us = unwrap(get<uint32_t>(ptr), last_imu) * time_scale;
+            double* out = m.vec;
+            for (int v = 0; v < 6; v++) {
+                double* dst = v == 3 ? m.eul : out;
+                for (int i = 0; i < 3; i++) {
+                    dst[i] = get<int16_t>(ptr) / scales[v];
+                }
+                if (v != 3) {
+                    out += 3;
+                }
+            }
+            for (int i = 0; i < 4; i++) {
+                m.quat[i] = static_cast<double>(get<int16_t>(ptr)) / quaScale;
+            }
+            m.temp = get<int16_t>(ptr) * TEMP_SCALE;
+            s.imu.push_back(m);
+        }
+    }
+
+    // Nothing logged before the first session entry in current logs
+    if (sessions.size() > 1 && sessions[0].enc.empty() && sessions[0].imu.empty()) {
+        sessions.erase(sessions.begin());
+    }
+    return sessions;
+}
+
+// ===== INTERPOLATION =====
+
+static double lerp(double a, double b, double f) {
+    return a + (b - a) * f;
+}
+
+// Along the shorter way round, wrapped to [low, low + 360)
+static double lerpAngle(double a, double b, double f, double low) {
+    double d = std::fmod(b - a + 540.0, 360.0) - 180.0;
+    double x = std::fmod(a + d * f - low, 360.0);
+    return (x < 0.0 ? x + 360.0 : x) + low;
+}
+
+static void slerp(const double* a, const double* b, double f, double* out) {
+    double qa[4], qb[4];
+    double na = 0.0, nb = 0.0;
+    for (int i = 0; i < 4; i++) {
+        na += a[i] * a[i];
+        nb += b[i] * b[i];
+    }
+    // All zero while the BNO055 is still in config mode
+    if (na == 0.0 || nb == 0.0) {
+        for (int i = 0; i < 4; i++) out[i] = lerp(a[i], b[i], f);
+        return;
+    }
+    na = std::sqrt(na);
+    nb = std::sqrt(nb);
+    for (int i = 0; i < 4; i++) {
+        qa[i] = a[i] / na;
+        qb[i] = b[i] / nb;
+    }
+
+    // q and -q are the same rotation, take the nearer one
+    double dot = qa[0] * qb[0] + qa[1] * qb[1] + qa[2] * qb[2] + qa[3] * qb[3];
+    if (dot < 0.0) {
+        dot = -dot;
+        for (int i = 0; i < 4; i++) qb[i] = -qb[i];
+    }
+
+    double wa = 1.0 - f, wb = f;
+    if (dot < 0.9995) {
+        double theta = std::acos(dot);
+        double sin_theta = std::sin(theta);
+        wa = std::sin((1.0 - f) * theta) / sin_theta;
+        wb = std::sin(f * theta) / sin_theta;
+    }
+    double n = 0.0;
+    for (int i = 0; i < 4; i++) {
+        out[i] = wa * qa[i] + wb * qb[i];
+        n += out[i] * out[i];
+    }
+    n = std::sqrt(n);
+    for (int i = 0; i < 4; i++) out[i] /= n;
+}
+
+static void interpolate(const EncoderSample& a, const EncoderSample& b, double f, EncoderSample& out) {
+    for (int i = 0; i < 2; i++) {
+        out.pos[i] = lerp(a.pos[i], b.pos[i], f);
+        out.rpm[i] = lerp(a.rpm[i], b.rpm[i], f);
+    }
+}
+
+static void interpolate(const ImuSample& a, const ImuSample& b, double f, ImuSample& out) {
+    for (int i = 0; i < 15; i++) {
+        out.vec[i] = lerp(a.vec[i], b.vec[i], f);
+    }
+    out.eul[0] = lerpAngle(a.eul[0], b.eul[0], f, 0.0);
+    out.eul[1] = lerpAngle(a.eul[1], b.eul[1], f, -180.0);
+    out.eul[2] = lerpAngle(a.eul[2], b.eul[2], f, -180.0);
+    slerp(a.quat, b.quat, f, out.quat);
+    out.temp = lerp(a.temp, b.temp, f);
+}
+
+static double medianInterval(const std::vector<double>& times) {
+    if (times.size() < 2) {
+        return 0.0;
+    }
+    std::vector<double> d(times.size() - 1);
+    for (size_t i = 1; i < times.size(); i++) {
+        d[i - 1] = times[i] - times[i - 1];
+    }
+    std::nth_element(d.begin(), d.begin() + d.size() / 2, d.end());
+    return d[d.size() / 2];
+}
+
+// Walks one stream along the grid, the grid times only ever increase
+template <typename Sample>
+class Cursor {
+public:
+    Cursor(std::vector<Sample>& samples, double max_gap_ms)
+        : _s(samples), _i(0)
+    {
+        // The log task writes them in order, the walk depends on it
+        auto earlier = [](const Sample& a, const Sample& b) { return a.t_us < b.t_us; };
+        if (!std::is_sorted(_s.begin(), _s.end(), earlier)) {
+            std::stable_sort(_s.begin(), _s.end(), earlier);
+        }
+        std::vector<double> times(_s.size());
+        for (size_t i = 0; i < _s.size(); i++) {
+            times[i] = _s[i].t_us;
+        }
+        _interval_us = medianInterval(times);
+        _max_gap_us = max_gap_ms > 0.0 ? max_gap_ms * 1000.0 : GAP_INTERVALS * _interval_us;
+    }
+
+    bool at(double t_us, Sample& out) {
+        if (_s.empty() || t_us < _s.front().t_us || t_us > _s.back().t_us) {
+            return false;
+        }
+        while (_i + 1 < _s.size() && _s[_i + 1].t_us <= t_us) {
+            _i++;
+        }
+        const Sample& a = _s[_i];
+        if (a.t_us == t_us || _i + 1 == _s.size()) {
+            out = a;
+            return true;
+        }
+        const Sample& b = _s[_i + 1];
+        double span = b.t_us - a.t_us;
+        if (span > _max_gap_us) {
+            return false;
+        }
+        interpolate(a, b, (t_us - a.t_us) / span, out);
+        return true;
+    }
+
+    double interval() const { return _interval_us; }
+    double maxGap() const { return _max_gap_us; }
+
+private:
+    std::vector<Sample>& _s;
+    size_t _i;
+    double _interval_us;
+    double _max_gap_us;
+};
+
+// ===== OUTPUT =====
+
+// Rows are built by hand into one buffer, snprintf per value took most of
+// the time at high rates
+class Writer {
+public:
+    explicit Writer(FILE* file) : _file(file) { _buf.reserve(1 << 20); }
+    ~Writer() { flush(); }
+
+    void text(const char* s) { _buf.append(s); }
+
+    void num(double v, int decimals) {
+        char tmp[32];
+        tmp[0] = ',';
+        auto result = std::to_chars(tmp + 1, tmp + sizeof(tmp), v, std::chars_format::fixed, decimals);
+        _buf.append(tmp, static_cast<size_t>(result.ptr - tmp));
+    }
+
+    void empty(int count) { _buf.append(static_cast<size_t>(count), ','); }
+
+    void endRow() {
+        _buf.push_back('\n');
+        if (_buf.size() > (1 << 20) - 1024) {
+            flush();
+        }
+    }
+
+    void flush() {
+        fwrite(_buf.data(), 1, _buf.size(), _file);
+        _buf.clear();
+    }
+
+private:
+    FILE* _file;
+    std::string _buf;
+};
+
+static const char* _header =
+    "session,t_us,"
+    "enc1_rev,enc2_rev,enc1_rpm,enc2_rpm,"
+    "acc_x,acc_y,acc_z,gyr_x,gyr_y,gyr_z,mag_x,mag_y,mag_z,"
+    "lin_x,lin_y,lin_z,grav_x,grav_y,grav_z,"
+    "eul_heading,eul_roll,eul_pitch,quat_w,quat_x,quat_y,quat_z,temp\n";
+
+static size_t resample(Session& s, const Options& opt, Writer& w) {
+    Cursor<EncoderSample> enc(s.enc, opt.max_gap_ms);
+    Cursor<ImuSample> imu(s.imu, opt.max_gap_ms);
+
+    double start = INFINITY, end = -INFINITY;
+    if (!s.enc.empty()) {
+        start = std::min(start, s.enc.front().t_us);
+        end = std::max(end, s.enc.back().t_us);
+    }
+    if (!s.imu.empty()) {
+        start = std::min(start, s.imu.front().t_us);
+        end = std::max(end, s.imu.back().t_us);
+    }
+
+    fprintf(stderr, "session %d: epoch %llu us, %s, first IMU sample %lld us, %zu encoder samples (%.1f ms apart), %zu IMU samples (%.1f ms apart)\n",
+        s.number, static_cast<unsigned long long>(s.epoch_us), s.number == 0 ? "no session entry" : s.confirmed ? "confirmed" : "provisional",
+        static_cast<long long>(s.first_us), s.enc.size(), enc.interval() / 1000.0, s.imu.size(), imu.interval() / 1000.0);
+    if (start > end) {
+        return 0;
+    }
+
+    char prefix[32];
+    snprintf(prefix, sizeof(prefix), "%d", s.number);
+    const double period_us = 1e6 / opt.rate;
+    size_t rows = 0;
+    EncoderSample e;
+    ImuSample m;
+    double last_quat[4] = {1.0, 0.0, 0.0, 0.0};
+
+    for (int64_t k = static_cast<int64_t>(std::ceil(start / period_us)); k * period_us <= end; k++) {
+        double t = k * period_us;
+        bool have_enc = enc.at(t, e);
+        bool have_imu = imu.at(t, m);
+        if (!have_enc && !have_imu) {
+            continue;
+        }
+
+        w.text(prefix);
+        w.num(t, 0);
+        if (have_enc) {
+            w.num(e.pos[0], 4);
+            w.num(e.pos[1], 4);
+            if (std::isnan(e.rpm[0])) {
+                w.empty(2);
+            } else {
+                w.num(e.rpm[0], 1);
+                w.num(e.rpm[1], 1);
+            }
+        } else {
+            w.empty(4);
+        }
+        if (have_imu) {
+            // The BNO055 flips the quaternion's sign as it likes, keep it
+            // continuous from row to row
+            double dot = 0.0;
+            for (int i = 0; i < 4; i++) dot += m.quat[i] * last_quat[i];
+            for (int i = 0; i < 4; i++) {
+                if (dot < 0.0) m.quat[i] = 0.0 - m.quat[i];
+                last_quat[i] = m.quat[i];
+            }
+            for (int i = 0; i < 15; i++) w.num(m.vec[i], 3);
+            for (int i = 0; i < 3; i++) w.num(m.eul[i], 3);
+            for (int i = 0; i < 4; i++) w.num(m.quat[i], 5);
+            w.num(m.temp, 2);
+        } else {
+            w.empty(23);
+        }
+        w.endRow();
+        rows++;
+    }
+    return rows;
+}
+
+static bool readFile(const char* path, std::vector<uint8_t>& data) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data.resize(size > 0 ? static_cast<size_t>(size) : 0);
+    size_t n = fread(data.data(), 1, data.size(), file);
+    fclose(file);
+    return n == data.size();
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            opt.rate = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--max-gap") == 0 && i + 1 < argc) {
+            opt.max_gap_ms = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--session") == 0 && i + 1 < argc) {
+            opt.session = atoi(argv[++i]);
+        } else if (argv[i][0] != '-' && !opt.in) {
+            opt.in = argv[i];
+        } else if (argv[i][0] != '-' && !opt.out) {
+            opt.out = argv[i];
+        } else {
+            fprintf(stderr, "usage: %s LOG [CSV] [--rate HZ] [--max-gap MS] [--session N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (!opt.in || opt.rate <= 0.0 || opt.max_gap_ms < 0.0) {
+        fprintf(stderr, "usage: %s LOG [CSV] [--rate HZ] [--max-gap MS] [--session N]\n", argv[0]);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<uint8_t> log;
+    if (!readFile(opt.in, log)) {
+        fprintf(stderr, "cannot read %s\n", opt.in);
+        return 1;
+    }
+    FILE* out = opt.out ? fopen(opt.out, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "cannot write %s\n", opt.out);
+        return 1;
+    }
+
+    size_t entries = 0;
+    std::vector<Session> sessions = parseLog(log, entries);
+
+    size_t rows = 0;
+    {
+        Writer w(out);
+        w.text(_header);
+        for (Session& s : sessions) {
+            if (opt.session < 0 || s.number == opt.session) {
+                rows += resample(s, opt, w);
+            }
+        }
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "%zu entries, %zu sessions, %zu rows at %.1f Hz in %.1f ms\n", entries, sessions.size(), rows, opt.rate, ms);
+    return 0;
+}
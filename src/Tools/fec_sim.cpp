@@ -0,0 +1,222 @@
+/*
+ * Host benchmark and bit error rate simulation for the radio FEC modes
+ * (Framing/fec.h).
+ *
+ * Build from src/:
+ *   g++ -O2 -std=c++17 -IGyro/Framing Tools/fec_sim.cpp \
+ *       Gyro/Framing/fec.cpp Gyro/Framing/framing.cpp Gyro/Framing/crc.cpp -o fec_sim
+ *
+ * Usage:
+ *   fec_sim [--frames N] [--seed S] [--burst B] [--size BYTES]
+ *
+ * Each simulated frame is a telemetry sized message with its CRC, FEC coded,
+ * framed and pushed through a binary symmetric channel. The receiver uses
+ * the real FrameDecoder, so errors that break the frame header or pointer
+ * chain are counted as losses too. With --burst B every error event flips B
+ * consecutive bits (same average BER), which shows the effect of interleaving.
+ * Errors inside the radio modem's own preamble and header are not modelled.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include "crc.h"
+#include "fec.h"
+#include "framing.h"
+#include "radio_protocol.h"
+
+static const char* _names[FEC_MODES] = {"off", "light", "medium", "heavy"};
+
+struct Options {
+    int frames = 20000;
+    unsigned seed = 1;
+    int burst = 1;
+    size_t size = RADIO_TLM_MAX_SIZE;
+};
+
+static void makeMessage(std::mt19937& rng, uint8_t* msg, size_t len) {
+    msg[0] = RADIO_MSG_TELEMETRY;
+    for (size_t i = 1; i < len - 2; i++) {
+        msg[i] = static_cast<uint8_t>(rng());
+    }
+    uint16_t crc = crc16(msg, len - 2);
+    msg[len - 2] = static_cast<uint8_t>(crc & 0xFF);
+    msg[len - 1] = static_cast<uint8_t>(crc >> 8);
+}
+
+static bool checkMessage(const uint8_t* msg, size_t len) {
+    return len >= 3 && crc16(msg, len - 2) == (msg[len - 2] | (msg[len - 1] << 8));
+}
+
+// ===== THROUGHPUT =====
+
+static double elapsedNs(std::chrono::steady_clock::time_point start, int runs) {
+    auto dt = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(dt).count() / runs;
+}
+
+static void benchmark(const Options& opt) {
+    std::mt19937 rng(opt.seed);
+    uint8_t msg[FRAME_MAX_PAYLOAD];
+    uint8_t coded[FRAME_MAX_PAYLOAD];
+    uint8_t out[FRAME_MAX_PAYLOAD];
+    size_t out_len;
+    const int runs = 20000;
+
+    printf("throughput, %zu byte message\n", opt.size);
+    printf("%-8s %6s %12s %12s %14s\n", "mode", "bytes", "encode MB/s", "clean MB/s", "t errors MB/s");
+
+    for (uint8_t mode = FEC_LIGHT; mode < FEC_MODES; mode++) {
+        makeMessage(rng, msg, opt.size);
+        size_t n = 0;
+        volatile int sink = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < runs; i++) {
+            msg[1] = static_cast<uint8_t>(i);
+            n = fecEncode(mode, msg, opt.size, coded);
+            sink += coded[n - 1];
+        }
+        double encode_ns = elapsedNs(start, runs);
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < runs; i++) {
+            sink += fecDecode(coded, n, out, out_len);
+        }
+        double clean_ns = elapsedNs(start, runs);
+
+        // Worst case: every codeword carries the most errors it can correct
+        uint8_t noisy[FRAME_MAX_PAYLOAD];
+        memcpy(noisy, coded, n);
+        size_t burst = (fecOverhead(mode) - 1) / 2;
+        for (size_t j = 0; j < burst && j < opt.size; j++) {
+            noisy[1 + j] ^= 0xA5;
+        }
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < runs; i++) {
+            sink += fecDecode(noisy, n, out, out_len);
+        }
+        double noisy_ns = elapsedNs(start, runs);
+        (void)sink;
+
+        printf("%-8s %6zu %12.1f %12.1f %14.1f\n", _names[mode], n,
+            opt.size * 1e3 / encode_ns, opt.size * 1e3 / clean_ns, opt.size * 1e3 / noisy_ns);
+    }
+    printf("\n");
+}
+
+// ===== BIT ERROR RATE =====
+
+class Channel {
+public:
+    Channel(unsigned seed, double ber, int burst)
+        : _rng(seed), _event(ber / burst), _burst(burst), _pending(0) {}
+
+    void corrupt(uint8_t* data, size_t len) {
+        for (size_t i = 0; i < len; i++) {
+            for (int bit = 0; bit < 8; bit++) {
+                if (_pending == 0 && _uniform(_rng) < _event) {
+                    _pending = _burst;
+                }
+                if (_pending > 0) {
+                    data[i] ^= 1 << bit;
+                    _pending--;
+                }
+            }
+        }
+    }
+
+private:
+    std::mt19937 _rng;
+    std::uniform_real_distribution<double> _uniform{0.0, 1.0};
+    double _event;
+    int _burst;
+    int _pending;
+};
+
+static double delivery(const Options& opt, uint8_t mode, double ber) {
+    std::mt19937 rng(opt.seed);
+    Channel channel(opt.seed * 7919 + mode, ber, opt.burst);
+    FrameDecoder decoder;
+    int delivered = 0;
+
+    for (int f = 0; f < opt.frames; f++) {
+        uint8_t msg[FRAME_MAX_PAYLOAD];
+        uint8_t coded[FRAME_MAX_PAYLOAD];
+        uint8_t frame[FRAME_MAX_SIZE];
+        makeMessage(rng, msg, opt.size);
+
+        size_t n = fecEncode(mode, msg, opt.size, coded);
+        size_t len = frameEncode(coded, n, frame);
+        channel.corrupt(frame, len);
+
+        bool ok = false;
+        for (size_t i = 0; i < len; i++) {
+            if (decoder.feed(frame[i]) != FrameDecoder::Frame) {
+                continue;
+            }
+            uint8_t out[FRAME_MAX_PAYLOAD];
+            size_t out_len = 0;
+            int fixed = fecDecode(decoder.payload(), decoder.length(), out, out_len);
+            if (fixed == FEC_UNCODED) {
+                out_len = decoder.length();
+                memcpy(out, decoder.payload(), out_len);
+            }
+            ok = fixed != FEC_FAILED && out_len == opt.size && checkMessage(out, out_len) &&
+                 memcmp(out, msg, out_len) == 0;
+        }
+        // The modem delimits packets, so a truncated frame never spills into the next
+        decoder.reset();
+        delivered += ok;
+    }
+    return 100.0 * delivered / opt.frames;
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            opt.frames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            opt.seed = static_cast<unsigned>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--burst") == 0 && i + 1 < argc) {
+            opt.burst = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            opt.size = static_cast<size_t>(atoi(argv[++i]));
+        } else {
+            fprintf(stderr, "usage: %s [--frames N] [--seed S] [--burst B] [--size BYTES]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (opt.frames <= 0 || opt.burst <= 0 || opt.size < 3 || opt.size > fecMaxData(FEC_HEAVY)) {
+        fprintf(stderr, "invalid option\n");
+        return 1;
+    }
+
+    benchmark(opt);
+
+    static const double bers[] = {1e-5, 1e-4, 3e-4, 1e-3, 3e-3, 1e-2, 2e-2};
+
+    printf("frame delivery, %zu byte message, %d frames, burst %d bits\n", opt.size, opt.frames, opt.burst);
+    printf("%-8s", "BER");
+    for (uint8_t mode = 0; mode < FEC_MODES; mode++) {
+        printf(" %8s", _names[mode]);
+    }
+    printf("\n%-8s", "rate");
+    for (uint8_t mode = 0; mode < FEC_MODES; mode++) {
+        printf(" %8.2f", static_cast<double>(opt.size) / (opt.size + fecOverhead(mode)));
+    }
+    printf("\n");
+
+    for (double ber : bers) {
+        printf("%-8.0e", ber);
+        for (uint8_t mode = 0; mode < FEC_MODES; mode++) {
+            printf(" %7.2f%%", delivery(opt, mode, ber));
+        }
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,242 @@
+/*
+ * Host simulation of radio command delivery: sequence numbered commands with
+ * ACKs (Framing/reliable.h) against the old scheme of sending every command
+ * five times and echoing it five times.
+ *
+ * Build from src/:
+ *   g++ -O2 -std=c++17 -IGyro/Framing Tools/reliable_sim.cpp \
+ *       Gyro/Framing/reliable.cpp Gyro/Framing/crc.cpp -o reliable_sim
+ *
+ * Usage:
+ *   reliable_sim [--loss P] [--count N] [--seed S] [--command TEXT]
+ *
+ * Latency is until the ground station knows the command ran (the ACK) for
+ * the ACK scheme, and until the first copy arrives for the blind scheme,
+ * which never learns whether it was delivered.
+ *
+ * Every frame in either direction is lost independently with probability P.
+ * One way delay is the frame's airtime at 38400 bps plus modem latency; the
+ * flight computer adds up to one 10 ms idle loop before answering.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <vector>
+#include "reliable.h"
+
+#define AIR_BPS             38400
+#define AIR_OVERHEAD        12      // preamble, sync word and modem header, see radio_protocol.h
+#define MODEM_LATENCY_MS    5
+#define IDLE_LOOP_MS        10
+#define BLIND_REPEATS       5
+
+struct Options {
+    double loss = 0.1;
+    int count = 1000;
+    unsigned seed = 1;
+    const char* command = "status";
+};
+
+struct Result {
+    int delivered = 0;
+    int failed = 0;
+    int executions = 0;
+    int duplicates = 0;     // executions beyond the first per command
+    uint64_t air_bytes = 0;
+    std::vector<uint32_t> latency;
+};
+
+static size_t airBytes(size_t payload) {
+    return payload + FRAME_OVERHEAD + AIR_OVERHEAD;
+}
+
+static uint32_t airMs(size_t payload) {
+    return static_cast<uint32_t>((airBytes(payload) * 8 * 1000 + AIR_BPS - 1) / AIR_BPS);
+}
+
+class Link {
+public:
+    Link(const Options& opt) : _rng(opt.seed), _loss(opt.loss) {}
+
+    bool lost() {
+        return std::uniform_real_distribution<double>(0, 1)(_rng) < _loss;
+    }
+
+    uint32_t delay(size_t payload) {
+        return airMs(payload) + MODEM_LATENCY_MS;
+    }
+
+    uint32_t processing() {
+        return std::uniform_int_distribution<uint32_t>(0, IDLE_LOOP_MS)(_rng);
+    }
+
+private:
+    std::mt19937 _rng;
+    double _loss;
+};
+
+struct Event {
+    bool to_flight;
+    std::vector<uint8_t> msg;
+};
+
+static Result runReliable(const Options& opt) {
+    Result res;
+    Link link(opt);
+    ReliableSender sender(static_cast<uint8_t>(opt.seed));
+    ReliableReceiver receiver;
+    std::multimap<uint32_t, Event> air;
+    uint32_t now = 0;
+    size_t cmd_len = strlen(opt.command);
+
+    for (int i = 0; i < opt.count; i++) {
+        sender.send(reinterpret_cast<const uint8_t*>(opt.command), cmd_len, now);
+
+        while (sender.busy()) {
+            size_t len;
+            const uint8_t* msg = sender.poll(now, len);
+            if (msg) {
+                res.air_bytes += airBytes(len);
+                if (!link.lost()) {
+                    uint32_t at = now + link.delay(len) + link.processing();
+                    air.insert({at, {true, std::vector<uint8_t>(msg, msg + len)}});
+                }
+                continue;
+            }
+            if (!sender.busy()) {
+                break;
+            }
+
+            uint32_t next = now + sender.timeUntilNext(now);
+            if (!air.empty() && air.begin()->first < next) {
+                next = air.begin()->first;
+            }
+            now = next;
+
+            while (!air.empty() && air.begin()->first <= now) {
+                Event ev = air.begin()->second;
+                air.erase(air.begin());
+
+                if (ev.to_flight) {
+                    ReliableReceiver::Result r = receiver.accept(ev.msg.data(), ev.msg.size(), now);
+                    if (r == ReliableReceiver::Invalid) {
+                        continue;
+                    }
+                    if (r == ReliableReceiver::New) {
+                        res.executions++;
+                        if (ev.msg[1] != sender.getSequence()) {
+                            res.duplicates++;
+                        }
+                        receiver.complete(RADIO_ACK_OK);
+                    }
+                    uint8_t ack[RELIABLE_ACK_SIZE];
+                    size_t n = receiver.ack(ack);
+                    res.air_bytes += airBytes(n);
+                    if (!link.lost()) {
+                        air.insert({now + link.delay(n), {false, std::vector<uint8_t>(ack, ack + n)}});
+                    }
+                } else {
+                    sender.onAck(ev.msg.data(), ev.msg.size(), now);
+                }
+            }
+        }
+
+        if (sender.getOutcome() == ReliableSender::Failed) {
+            res.failed++;
+        } else {
+            res.delivered++;
+            res.latency.push_back(sender.getLatency());
+        }
+    }
+    return res;
+}
+
+static Result runBlind(const Options& opt) {
+    Result res;
+    Link link(opt);
+    size_t len = strlen(opt.command);
+
+    for (int i = 0; i < opt.count; i++) {
+        bool delivered = false;
+        for (int copy = 0; copy < BLIND_REPEATS; copy++) {
+            res.air_bytes += airBytes(len);
+            if (link.lost()) {
+                continue;
+            }
+            // Every received copy is executed and echoed five times
+            res.executions++;
+            res.air_bytes += BLIND_REPEATS * airBytes(len);
+            if (delivered) {
+                res.duplicates++;
+            } else {
+                delivered = true;
+                res.latency.push_back(copy * airMs(len) + link.delay(len) + link.processing());
+            }
+        }
+        if (delivered) {
+            res.delivered++;
+        } else {
+            res.failed++;
+        }
+    }
+    return res;
+}
+
+static void report(const char* name, Result& res, const Options& opt) {
+    std::sort(res.latency.begin(), res.latency.end());
+    double mean = 0;
+    for (uint32_t l : res.latency) {
+        mean += l;
+    }
+    size_t n = res.latency.size();
+    if (n > 0) {
+        mean /= n;
+    }
+
+    printf("%-10s %6.2f%% %8d %9.1f %7u %7u %9.1f %9.1f\n",
+        name,
+        100.0 * res.delivered / opt.count,
+        res.duplicates,
+        mean,
+        n ? res.latency[std::min(n - 1, n * 95 / 100)] : 0,
+        n ? res.latency[n - 1] : 0,
+        static_cast<double>(res.air_bytes) / opt.count,
+        res.air_bytes * 8.0 * 1000 / AIR_BPS / opt.count);
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--loss") == 0 && i + 1 < argc) {
+            opt.loss = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            opt.count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            opt.seed = static_cast<unsigned>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--command") == 0 && i + 1 < argc) {
+            opt.command = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--loss P] [--count N] [--seed S] [--command TEXT]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (opt.count <= 0 || strlen(opt.command) > RELIABLE_MAX_COMMAND) {
+        fprintf(stderr, "invalid count or command length\n");
+        return 1;
+    }
+
+    Result reliable = runReliable(opt);
+    Result blind = runBlind(opt);
+
+    printf("%d commands \"%s\", %.1f%% loss each way\n\n", opt.count, opt.command, opt.loss * 100);
+    printf("%-10s %7s %8s %9s %7s %7s %9s %9s\n",
+        "scheme", "deliv", "dup exec", "mean ms", "p95 ms", "max ms", "air B/cmd", "air ms/cmd");
+    report("ack", reliable, opt);
+    report("blind x5", blind, opt);
+    return 0;
+}
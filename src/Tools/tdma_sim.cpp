@@ -0,0 +1,349 @@
+/*
+ * Host simulation of several flight computers sharing the radio channel:
+ * TDMA slots synced from the ground station's beacon (Framing/tdma.h)
+ * against every node transmitting on its own schedule as before.
+ *
+ * Build from src/:
+ *   g++ -O2 -std=c++17 -IGyro/Framing Tools/tdma_sim.cpp Gyro/Framing/tdma.cpp \
+ *       Gyro/Framing/fec.cpp Gyro/Framing/crc.cpp -o tdma_sim
+ *
+ * Usage:
+ *   tdma_sim [--seconds S] [--seed S] [--rate HZ] [--slot MS] [--loss P] [--ppm PPM]
+ *
+ * Each node runs the radio_thread() logic of src/Gyro/main.cpp: it polls the
+ * UART every 2 ms, feeds beacons to a TdmaNode and sends a full telemetry
+ * frame when one is due and its slot allows it. Node clocks have a random
+ * offset and up to +-PPM drift. A frame takes its UART transfer plus a
+ * jittered modem latency before going on air. Any overlap on air destroys
+ * both frames (no capture effect), and a radio that is transmitting hears
+ * nothing. Every frame is also lost independently with probability P.
+ *
+ * The ground station sends a beacon, a longest allowed command and a
+ * download request every superframe, so a ground slot that is too short
+ * shows up as collisions with node 1.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "download.h"
+#include "fec.h"
+#include "reliable.h"
+#include "tdma.h"
+
+#define POLL_US             2000    // RADIO_POLL_INTERVAL in src/Gyro/main.cpp
+#define MODEM_LATENCY_US    1000
+#define MODEM_JITTER_US     1000
+#define STEP_US             100
+#define FEC_MODE            FEC_LIGHT
+
+struct Options {
+    int seconds = 60;
+    unsigned seed = 1;
+    uint32_t rate = 10;
+    uint16_t slot = TdmaSchedule::nodeSlot(FEC_MODE);
+    double loss = 0.0;
+    double ppm = 50.0;
+};
+
+enum Kind { Beacon, Uplink, Telemetry };
+
+struct Tx {
+    int sender;             // 0 ground, 1..N nodes
+    Kind kind;
+    int64_t start;
+    int64_t end;
+    size_t frame_len;       // coded payload length, for the receiver's delay estimate
+    uint8_t msg[TDMA_BEACON_SIZE];
+    bool evaluated;
+};
+
+struct Delivery {
+    int64_t at;
+    size_t frame_len;
+    uint8_t msg[TDMA_BEACON_SIZE];
+};
+
+struct Node {
+    TdmaNode tdma;
+    double drift;
+    int64_t offset_us;
+    int64_t next_poll;
+    uint32_t next_frame;
+    std::vector<Delivery> inbox;
+    uint32_t sent;
+    uint32_t delivered;
+    int32_t worst_error;
+};
+
+struct Result {
+    double hz_avg;
+    double hz_min;
+    double loss;            // sent frames not received
+    double efficiency;      // telemetry payload bits received / link bits
+    uint32_t collisions;
+    int32_t worst_error;
+};
+
+static int64_t uartUs(size_t air_bytes) {
+    return static_cast<int64_t>((air_bytes - RADIO_AIR_OVERHEAD) * 10 * 1000000ULL / RADIO_UART_BAUD);
+}
+
+static int64_t airUs(size_t air_bytes) {
+    return static_cast<int64_t>(air_bytes * 8 * 1000000ULL / RADIO_AIR_BPS);
+}
+
+class Sim {
+public:
+    Sim(const Options& opt, int nodes, bool tdma)
+        : _opt(opt), _tdma(tdma), _rng(opt.seed * 131 + nodes * 2 + tdma), _nodes(nodes + 1) {
+        _schedule.nodes = static_cast<uint8_t>(nodes);
+        _schedule.slot_ms = opt.slot;
+        _schedule.ground_ms = TdmaSchedule::groundSlot(FEC_MODE);
+
+        std::uniform_real_distribution<double> drift(-opt.ppm * 1e-6, opt.ppm * 1e-6);
+        std::uniform_int_distribution<int64_t> offset(0, 1000000000);
+        std::uniform_int_distribution<int64_t> phase(0, POLL_US - 1);
+        for (int i = 1; i <= nodes; i++) {
+            Node& n = _nodes[i];
+            n.drift = drift(_rng);
+            n.offset_us = offset(_rng);
+            n.next_poll = phase(_rng);
+            n.tdma.setNode(tdma ? static_cast<uint8_t>(i) : 0, localMs(n, 0));
+            // Free running nodes start at random points in their telemetry period
+            n.next_frame = localMs(n, 0) + std::uniform_int_distribution<uint32_t>(0, 1000 / opt.rate)(_rng);
+            n.sent = n.delivered = 0;
+            n.worst_error = 0;
+        }
+        _tlm_len = RADIO_TLM_MAX_SIZE + (tdma ? TDMA_NODE_OVERHEAD : 0);
+    }
+
+    Result run() {
+        int64_t end = static_cast<int64_t>(_opt.seconds) * 1000000;
+        int64_t next_beacon = 0;
+        uint8_t seq = 0;
+
+        for (int64_t t = 0; t < end; t += STEP_US) {
+            if (_tdma && t >= next_beacon) {
+                groundSlot(t, seq++);
+                next_beacon += static_cast<int64_t>(_schedule.period()) * 1000;
+            }
+            for (size_t i = 1; i < _nodes.size(); i++) {
+                if (t >= _nodes[i].next_poll) {
+                    poll(static_cast<int>(i), t);
+                    _nodes[i].next_poll += POLL_US;
+                }
+            }
+            evaluate(t);
+        }
+        evaluate(INT64_MAX);
+        return summary();
+    }
+
+private:
+    uint32_t localMs(const Node& n, int64_t t) const {
+        return static_cast<uint32_t>((t * (1.0 + n.drift) + n.offset_us) / 1000);
+    }
+
+    int64_t modemUs() {
+        return MODEM_LATENCY_US + std::uniform_int_distribution<int64_t>(0, MODEM_JITTER_US)(_rng);
+    }
+
+    // Queues a frame the sender writes to its modem at time t
+    Tx& transmit(int sender, Kind kind, size_t msg_len, int64_t t, int64_t not_before) {
+        size_t air = tdmaAirBytes(msg_len, FEC_MODE);
+        Tx tx = {};
+        tx.sender = sender;
+        tx.kind = kind;
+        tx.start = std::max(t + uartUs(air) + modemUs(), not_before);
+        tx.end = tx.start + airUs(air);
+        tx.frame_len = msg_len + fecOverhead(FEC_MODE);
+        _air.push_back(tx);
+        return _air.back();
+    }
+
+    void groundSlot(int64_t t, uint8_t seq) {
+        Tx& beacon = transmit(0, Beacon, TDMA_BEACON_SIZE, t, 0);
+        tdmaPackBeacon(_schedule, seq, beacon.msg);
+
+        // Worst case uplink: the longest command and a download request, written
+        // to the UART after the beacon and sent by the modem back to back
+        size_t command = RELIABLE_HEADER_SIZE + TDMA_UPLINK_MAX + RELIABLE_CRC_SIZE + TDMA_NODE_OVERHEAD;
+        int64_t written = t + uartUs(tdmaAirBytes(TDMA_BEACON_SIZE, FEC_MODE));
+        int64_t busy = transmit(0, Uplink, command, written, beacon.end).end;
+        written += uartUs(tdmaAirBytes(command, FEC_MODE));
+        transmit(0, Uplink, DL_READ_SIZE + TDMA_NODE_OVERHEAD, written, busy);
+    }
+
+    void poll(int i, int64_t t) {
+        Node& n = _nodes[i];
+        uint32_t now = localMs(n, t);
+
+        for (size_t k = 0; k < n.inbox.size();) {
+            const Delivery& d = n.inbox[k];
+            if (d.at > t) {
+                k++;
+                continue;
+            }
+            // Same estimate as radio_beacon() in src/Gyro/main.cpp
+            size_t bytes = d.frame_len + FRAME_OVERHEAD + RADIO_AIR_OVERHEAD;
+            uint32_t delay = 2 * tdmaUartMs(bytes) + tdmaAirMs(bytes);
+            if (n.tdma.onBeacon(d.msg, TDMA_BEACON_SIZE, now, delay)) {
+                n.worst_error = std::max(n.worst_error, std::abs(n.tdma.getError()));
+            }
+            n.inbox.erase(n.inbox.begin() + k);
+        }
+
+        size_t air = tdmaAirBytes(_tlm_len, FEC_MODE);
+        uint32_t period = 1000 / _opt.rate;
+        if (static_cast<int32_t>(now - n.next_frame) < 0 || n.tdma.timeUntilSlot(now, air) != 0) {
+            return;
+        }
+
+        transmit(i, Telemetry, _tlm_len, t, 0);
+        n.tdma.onTransmit(now, air);
+        n.sent++;
+
+        n.next_frame += period;
+        if (static_cast<int32_t>(now - n.next_frame) >= static_cast<int32_t>(period)) {
+            n.next_frame = now;
+        }
+    }
+
+    bool transmitting(int who, int64_t start, int64_t end) const {
+        for (const Tx& other : _air) {
+            if (other.sender == who && other.start < end && other.end > start) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Decides the fate of every frame that has left the air
+    void evaluate(int64_t t) {
+        for (Tx& tx : _air) {
+            if (tx.evaluated || tx.end > t) {
+                continue;
+            }
+            tx.evaluated = true;
+
+            bool collided = false;
+            for (const Tx& other : _air) {
+                if (&other != &tx && other.sender != tx.sender && other.start < tx.end && other.end > tx.start) {
+                    collided = true;
+                }
+            }
+            if (collided && tx.kind == Telemetry) {
+                _collisions++;
+            }
+
+            std::uniform_real_distribution<double> u(0.0, 1.0);
+            if (tx.kind == Telemetry) {
+                if (!collided && !transmitting(0, tx.start, tx.end) && u(_rng) >= _opt.loss) {
+                    _nodes[tx.sender].delivered++;
+                }
+            } else if (tx.kind == Beacon) {
+                for (size_t i = 1; i < _nodes.size(); i++) {
+                    if (collided || transmitting(static_cast<int>(i), tx.start, tx.end) || u(_rng) < _opt.loss) {
+                        continue;
+                    }
+                    Delivery d;
+                    size_t air = tdmaAirBytes(TDMA_BEACON_SIZE, FEC_MODE);
+                    d.at = tx.end + modemUs() + uartUs(air);
+                    d.frame_len = tx.frame_len;
+                    memcpy(d.msg, tx.msg, TDMA_BEACON_SIZE);
+                    _nodes[i].inbox.push_back(d);
+                }
+            }
+        }
+
+        // Keep frames that could still overlap something undecided
+        int64_t horizon = t - 1000000;
+        _air.erase(std::remove_if(_air.begin(), _air.end(), [horizon](const Tx& tx) {
+            return tx.evaluated && tx.end < horizon;
+        }), _air.end());
+    }
+
+    Result summary() const {
+        Result r = {};
+        uint32_t sent = 0, delivered = 0;
+        r.hz_min = 1e9;
+        for (size_t i = 1; i < _nodes.size(); i++) {
+            const Node& n = _nodes[i];
+            double hz = static_cast<double>(n.delivered) / _opt.seconds;
+            r.hz_avg += hz / (_nodes.size() - 1);
+            r.hz_min = std::min(r.hz_min, hz);
+            sent += n.sent;
+            delivered += n.delivered;
+            r.worst_error = std::max(r.worst_error, n.worst_error);
+        }
+        r.loss = sent ? 100.0 * (sent - delivered) / sent : 0.0;
+        r.efficiency = 100.0 * delivered * RADIO_TLM_MAX_SIZE * 8 / (static_cast<double>(_opt.seconds) * RADIO_AIR_BPS);
+        r.collisions = _collisions;
+        return r;
+    }
+
+    Options _opt;
+    bool _tdma;
+    std::mt19937 _rng;
+    std::vector<Node> _nodes;
+    std::vector<Tx> _air;
+    TdmaSchedule _schedule;
+    size_t _tlm_len;
+    uint32_t _collisions = 0;
+};
+
+int main(int argc, char** argv) {
+    Options opt;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            opt.seconds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            opt.seed = static_cast<unsigned>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            opt.rate = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--slot") == 0 && i + 1 < argc) {
+            opt.slot = static_cast<uint16_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--loss") == 0 && i + 1 < argc) {
+            opt.loss = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--ppm") == 0 && i + 1 < argc) {
+            opt.ppm = atof(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--seconds S] [--seed S] [--rate HZ] [--slot MS] [--loss P] [--ppm PPM]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (opt.seconds <= 0 || opt.rate < 1 || opt.rate > 100 || opt.slot <= 2 * TDMA_GUARD_MS ||
+        opt.loss < 0.0 || opt.loss >= 1.0) {
+        fprintf(stderr, "invalid option\n");
+        return 1;
+    }
+
+    printf("%u Hz telemetry per node, %zu byte frames, %u ms slots, %u ms ground slot, loss %.2f, +-%.0f ppm\n",
+        opt.rate, tdmaAirBytes(RADIO_TLM_MAX_SIZE + TDMA_NODE_OVERHEAD, FEC_MODE), opt.slot,
+        TdmaSchedule::groundSlot(FEC_MODE), opt.loss, opt.ppm);
+    printf("%-6s %-5s %10s %8s %8s %8s %10s %8s %6s\n",
+        "nodes", "mode", "superframe", "Hz avg", "Hz min", "lost", "collisions", "channel", "error");
+
+    for (int nodes = 2; nodes <= TDMA_MAX_NODES; nodes++) {
+        for (int tdma = 0; tdma <= 1; tdma++) {
+            Result r = Sim(opt, nodes, tdma).run();
+            TdmaSchedule s = {static_cast<uint8_t>(nodes), TdmaSchedule::groundSlot(FEC_MODE), opt.slot};
+            char superframe[16] = "-";
+            char error[16] = "-";
+            if (tdma) {
+                snprintf(superframe, sizeof(superframe), "%u ms", s.period());
+                snprintf(error, sizeof(error), "%d ms", r.worst_error);
+            }
+            printf("%-6d %-5s %10s %8.2f %8.2f %7.1f%% %10u %7.1f%% %6s\n",
+                nodes, tdma ? "tdma" : "free", superframe, r.hz_avg, r.hz_min, r.loss, r.collisions,
+                r.efficiency, error);
+        }
+    }
+    return 0;
+}